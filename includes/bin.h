@@ -9,6 +9,12 @@
  *  > update - funções que podem mover o ponteiro de arquivo e escrevem nele.
  *  > write  - funções que escrevem num arquivo sem mover o ponteiro.
  *  > read   - funções que leem de um arquivo sem mover o ponteiro
+ *  > encode - funções que escrevem um registro num buffer em memória.
+ *  > decode - funções que leem um registro de um buffer em memória.
+ *  > compile - funções que preparam uma condição de busca antes de uma
+ *              leitura sequencial.
+ *  > scan   - funções que percorrem os registros de um arquivo em ordem,
+ *             devolvendo visões (veja `DBVehicleView`) sem alocar as strings.
  *
  */
 
@@ -21,6 +27,76 @@
 
 #include <common.h>
 
+// Leitor sequencial dos registros de um arquivo binário. O arquivo é mapeado em
+// memória (veja `scan_map`) ou lido em blocos (veja `scan_new`), e cada
+// registro é devolvido como uma visão para dentro do mapeamento ou do bloco,
+// que só é válida até a próxima leitura. Enquanto o leitor é usado, a posição
+// do arquivo não corresponde ao registro atual.
+typedef struct {
+    FILE    *fp;
+    // Se `buf` é o arquivo inteiro mapeado em memória, e não um bloco dele.
+    bool     mapped;
+    uint8_t *buf;
+    size_t   cap;
+    // Início do próximo registro no buffer e número de bytes válidos nele.
+    size_t   pos;
+    size_t   len;
+    // Offset do primeiro registro no arquivo, para onde `scan_rewind` volta.
+    size_t   start;
+    // Se os registros removidos são pulados pelo `tamanhoRegistro`, sem que o
+    // restante deles seja lido ou decodificado. Começa como `false`.
+    bool     skip_removed;
+    // Conteúdo do registro atual depois de `tamanhoRegistro`, usado para
+    // completar uma leitura parcial (veja `scan_vehicle_complete`).
+    const uint8_t *current;
+} RecordScan;
+
+// Campos de um registro de veículo, na ordem em que são guardados. Uma leitura
+// parcial (veja `scan_vehicle_fields`) decodifica os campos até o indicado.
+typedef enum {
+    VEHICLE_FIELD_PREFIXO,
+    VEHICLE_FIELD_DATA,
+    VEHICLE_FIELD_QUANTIDADE_LUGARES,
+    VEHICLE_FIELD_COD_LINHA,
+    VEHICLE_FIELD_MODELO,
+    VEHICLE_FIELD_CATEGORIA,
+} VehicleFieldId;
+
+// Mesmo que `VehicleFieldId` para linhas de ônibus.
+typedef enum {
+    BUS_LINE_FIELD_COD_LINHA,
+    BUS_LINE_FIELD_ACEITA_CARTAO,
+    BUS_LINE_FIELD_NOME_LINHA,
+    BUS_LINE_FIELD_COR_LINHA,
+} BusLineFieldId;
+
+typedef struct VehiclePredicate VehiclePredicate;
+typedef struct BusLinePredicate BusLinePredicate;
+
+// Condição de busca `campo = valor` sobre veículos, compilada por
+// `compile_vehicle_predicate`: o campo já foi resolvido para a função `match`
+// e o valor já foi convertido.
+struct VehiclePredicate {
+    bool        (*match)(const VehiclePredicate *pred, const DBVehicleView *view);
+    // O campo comparado, até onde os registros precisam ser decodificados.
+    VehicleFieldId field;
+    // O valor como string, para os campos de texto, e como número.
+    const char  *text;
+    int32_t      number;
+    // Se o campo identifica um único registro, de modo que a busca pode parar
+    // no primeiro encontrado.
+    bool         unique;
+};
+
+// Mesmo que `VehiclePredicate` para linhas de ônibus.
+struct BusLinePredicate {
+    bool        (*match)(const BusLinePredicate *pred, const DBBusLineView *view);
+    BusLineFieldId field;
+    const char  *text;
+    int32_t      number;
+    bool         unique;
+};
+
 // Atualiza o byte indicador de status do aquivo.
 bool update_header_status(char new_val, FILE *fp);
 
@@ -67,6 +143,24 @@ bool read_vehicle_register(FILE *fp, DBVehicleRegister *reg);
  */
 bool read_bus_line_register(FILE *fp, DBBusLineRegister *reg);
 
+/*
+ * Compila a condição de busca `field = equals` sobre registros de veículos
+ * @param field - nome do campo a ser buscado
+ * @param equals - valor do campo, que precisa continuar válido enquanto o predicado for usado
+ * @param pred - onde o predicado é colocado
+ * @return 'true' se o predicado for compilado 'false' se o campo não existir
+*/
+bool compile_vehicle_predicate(const char *field, const char *equals, VehiclePredicate *pred);
+
+/*
+ * Compila a condição de busca `field = equals` sobre registros de linhas de ônibus
+ * @param field - nome do campo a ser buscado
+ * @param equals - valor do campo, que precisa continuar válido enquanto o predicado for usado
+ * @param pred - onde o predicado é colocado
+ * @return 'true' se o predicado for compilado 'false' se o campo não existir
+*/
+bool compile_bus_line_predicate(const char *field, const char *equals, BusLinePredicate *pred);
+
 /**
  * Seleciona os dados de uma tabela que contém os arquivos veículos
  * @param from_file - caminho do arquivo binário que contém os veículos
@@ -83,6 +177,12 @@ bool select_from_vehicle_where(const char *from_file, const char *where_field, c
  */
 bool select_from_bus_line_where(const char *from_file, const char *where_campo, const char *where_valor);
 
+// Mesmo que `print_bus_line` para uma visão.
+void print_bus_line_view(FILE *out, const DBBusLineView *view, const DBBusLineHeader *header);
+
+// Mesmo que `print_vehicle` para uma visão.
+void print_vehicle_view(FILE *out, const DBVehicleView *view, const DBVehicleHeader *header);
+
 // Imprime as informações de busca do arquivo binário das linhas de ônibus
 void print_bus_line(FILE *out, const DBBusLineRegister *reg, const DBBusLineHeader *header);
 
@@ -111,4 +211,123 @@ bool write_vehicle_registers(const DBVehicleRegister *vehicle, FILE *fp);
 */
 bool write_bus_line_register(const DBBusLineRegister *line, FILE *fp);
 
+/*
+* Codifica um registro de linha de ônibus num buffer, no mesmo formato em que
+* ele é escrito no arquivo binário.
+* @param line - struct do tipo DBBusLineRegister
+* @param buf - buffer onde o registro é escrito
+* @param capacity - tamanho de `buf`
+* @returns - o número de bytes escritos em `buf`, ou 0 caso o registro não caiba
+*            nele.
+*/
+uint32_t encode_bus_line_register(const DBBusLineRegister *line, uint8_t *buf, uint32_t capacity);
+
+/*
+* Decodifica um registro de linha de ônibus codificado por
+* `encode_bus_line_register`. As strings são alocadas como em
+* `read_bus_line_register` e devem ser liberadas com `bus_line_drop`.
+* @param buf - buffer com o registro
+* @param len - tamanho do buffer
+* @param reg - ponteiro de DBBusLineRegister
+* @returns - 'true' se for decodificado com sucesso 'false' se o buffer não
+*            contém um registro completo.
+*/
+bool decode_bus_line_register(const uint8_t *buf, uint32_t len, DBBusLineRegister *reg);
+
+/*
+* Cria um leitor sequencial que lê o arquivo em blocos com `fread`, começando na
+* posição atual do arquivo, normalmente logo após o cabeçalho.
+* @param fp - ponteiro do arquivo binário
+* @returns - o leitor, que deve ser liberado com `scan_drop`.
+*/
+RecordScan scan_new(FILE *fp);
+
+/*
+* Cria um leitor sequencial que mapeia o arquivo inteiro em memória e percorre
+* os registros pelo `tamanhoRegistro`, sem passar pelo `stdio`. Começa na
+* posição atual do arquivo, assim como `scan_new`, que é usado caso o arquivo
+* não possa ser mapeado.
+* @param fp - ponteiro do arquivo binário, aberto somente para leitura
+* @returns - o leitor, que deve ser liberado com `scan_drop`.
+*/
+RecordScan scan_map(FILE *fp);
+
+// Volta o leitor para o primeiro registro, onde ele foi criado.
+void scan_rewind(RecordScan *scan);
+
+// Libera o buffer ou o mapeamento do leitor. O arquivo não é fechado.
+void scan_drop(RecordScan scan);
+
+/*
+* Avança para o próximo registro de veículo, incluindo os removidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_vehicle(RecordScan *scan, DBVehicleView *view);
+
+/*
+* Avança para o próximo registro de veículo decodificando somente os campos até
+* `upto`. Os demais campos da visão não são preenchidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @param upto - o último campo a ser decodificado
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_vehicle_fields(RecordScan *scan, DBVehicleView *view, VehicleFieldId upto);
+
+/*
+* Decodifica todos os campos do registro de veículo atual, lido por
+* `scan_vehicle_fields`.
+* @param scan - o leitor
+* @param view - a visão do registro atual
+* @returns - 'true' se o registro for decodificado 'false' se ele estiver
+*            incompleto.
+*/
+bool scan_vehicle_complete(const RecordScan *scan, DBVehicleView *view);
+
+/*
+* Avança para o próximo registro de linha de ônibus, incluindo os removidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_bus_line(RecordScan *scan, DBBusLineView *view);
+
+/*
+* Avança para o próximo registro de linha de ônibus decodificando somente os
+* campos até `upto`. Os demais campos da visão não são preenchidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @param upto - o último campo a ser decodificado
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_bus_line_fields(RecordScan *scan, DBBusLineView *view, BusLineFieldId upto);
+
+/*
+* Decodifica todos os campos do registro de linha de ônibus atual, lido por
+* `scan_bus_line_fields`.
+* @param scan - o leitor
+* @param view - a visão do registro atual
+* @returns - 'true' se o registro for decodificado 'false' se ele estiver
+*            incompleto.
+*/
+bool scan_bus_line_complete(const RecordScan *scan, DBBusLineView *view);
+
+// Copia uma visão de veículo para um registro que não depende do buffer da
+// visão. As strings são alocadas e devem ser liberadas com `vehicle_drop`.
+void vehicle_view_materialize(const DBVehicleView *view, DBVehicleRegister *reg);
+
+// Copia uma visão de linha de ônibus para um registro que não depende do buffer
+// da visão. As strings são alocadas e devem ser liberadas com `bus_line_drop`.
+void bus_line_view_materialize(const DBBusLineView *view, DBBusLineRegister *reg);
+
 #endif
@@ -0,0 +1,104 @@
+/**
+ * Módulo do BloomFilter.
+ *
+ * Esse módulo consiste de um filtro de Bloom de chaves inteiras, guardado num
+ * arquivo ao lado de cada índice árvore-B. Antes de descer na árvore, a busca
+ * consulta o filtro, que responde com certeza quando uma chave não está no
+ * índice. Assim, a maioria das buscas por chaves inexistentes custa uma única
+ * consulta em memória em vez da leitura de vários nós.
+ *
+ * O filtro não suporta remoções, então chaves removidas do índice apenas
+ * continuam sendo respondidas como possivelmente presentes.
+ */
+
+
+#ifndef _BLOOM_H_
+#define _BLOOM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bits do filtro para cada chave. Com o número ótimo de funções de hash, dá
+// uma taxa de falsos positivos de cerca de 1%.
+#define BLOOM_BITS_PER_KEY 10
+
+// Número de funções de hash, ótimo para `BLOOM_BITS_PER_KEY`.
+#define BLOOM_N_HASHES 7
+
+// Menor número de chaves para o qual um filtro é dimensionado, de modo que
+// índices pequenos ainda comportem inserções futuras.
+#define BLOOM_MIN_CAPACITY 1024
+
+typedef struct {
+    // Tamanho do filtro em bits, ou 0 caso o filtro esteja vazio. Um filtro
+    // vazio responde que qualquer chave pode estar presente.
+    uint32_t n_bits;
+    uint32_t n_hashes;
+    uint8_t *bits;
+} BloomFilter;
+
+/**
+ * Cria um filtro vazio, que responde que qualquer chave pode estar presente.
+ * Não envolve alocação.
+ *
+ * @return o filtro vazio.
+ */
+BloomFilter bloom_empty();
+
+/**
+ * Cria um filtro sem nenhuma chave dimensionado para `capacity` chaves, ou
+ * `BLOOM_MIN_CAPACITY` caso seja menor.
+ *
+ * @param capacity - o número de chaves esperado.
+ * @return o filtro criado, que deve ser liberado com `bloom_drop`.
+ */
+BloomFilter bloom_with_capacity(size_t capacity);
+
+/**
+ * Libera o filtro.
+ *
+ * @param filter - o filtro a ser liberado.
+ */
+void bloom_drop(BloomFilter filter);
+
+/**
+ * Adiciona uma chave ao filtro. Não tem efeito num filtro vazio.
+ *
+ * @param filter - o filtro a ser modificado.
+ * @param key - a chave a ser adicionada.
+ */
+void bloom_add(BloomFilter *filter, int32_t key);
+
+/**
+ * Verifica se uma chave pode estar presente no filtro.
+ *
+ * @param filter - o filtro a ser consultado.
+ * @param key - a chave de busca.
+ * @return `false` caso `key` certamente não tenha sido adicionada e `true`
+ *         caso contrário.
+ */
+bool bloom_may_contain(const BloomFilter *filter, int32_t key);
+
+/**
+ * Carrega o filtro que acompanha um índice, escrito por `bloom_save`.
+ *
+ * @param filter - referência mutável para onde o filtro é carregado.
+ * @param index_fname - nome do arquivo do índice. O filtro fica no arquivo de
+ *                      mesmo nome com o sufixo "_bloom".
+ * @return `true` em caso de sucesso e `false` caso o arquivo do filtro não
+ *         exista ou seja inválido. No segundo caso, `filter` é um filtro vazio.
+ */
+bool bloom_load(BloomFilter *filter, const char *index_fname);
+
+/**
+ * Escreve o filtro que acompanha um índice, substituindo o anterior.
+ *
+ * @param filter - o filtro a ser escrito, que não pode ser vazio.
+ * @param index_fname - nome do arquivo do índice. O filtro fica no arquivo de
+ *                      mesmo nome com o sufixo "_bloom".
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool bloom_save(const BloomFilter *filter, const char *index_fname);
+
+#endif
@@ -1,10 +1,23 @@
 /**
  * Módulo da BTreeMap.
  *
- * Esse módulo consiste da implementação de uma BTree em disco. Ele não envolve
- * qualquer alocação dinâmica para operar normalmente e talvez apenas aloque
- * memória para mensagens de erro. Além disso, a BTree em disco é atualizada e
+ * Esse módulo consiste da implementação de uma BTree em disco. Além das
+ * mensagens de erro, as únicas alocações dinâmicas são a do cache de páginas
+ * e a das travas, feitas ao vincular um arquivo, e vetores temporários das
+ * operações em lote. Além disso, a BTree em disco é atualizada e
  * verificada somente quando necessário.
+ *
+ * Cada nó ocupa exatamente uma página no arquivo e é lido ou escrito por
+ * inteiro com uma única chamada `pread`/`pwrite`, sendo codificado e
+ * decodificado em memória.
+ *
+ * Várias threads podem buscar numa mesma BTree ao mesmo tempo, cada uma com o
+ * seu `BTreeReader`, enquanto uma única thread a modifica pelo `BTreeMap`.
+ * As demais operações não devem ser usadas concorrentemente.
+ *
+ * Com cópia na escrita, as inserções nunca sobrescrevem as páginas do último
+ * snapshot gravado no header, de modo que outros processos podem abrir e ler
+ * o arquivo enquanto ele é modificado, vendo sempre uma árvore consistente.
  */
 
 
@@ -15,11 +28,80 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Tamanho de página padrão dos arquivos criados por `btree_create`.
+#define BTREE_DEFAULT_PAGE_SZ 4096
+
+// Maior tamanho de página suportado.
+#define BTREE_MAX_PAGE_SZ 8192
+
+// Tamanho de página do formato original, de ordem 5.
+#define BTREE_LEGACY_PAGE_SZ 77
+
+// Orçamento padrão de memória, em bytes, do cache de páginas de cada BTree.
+#define BTREE_DEFAULT_CACHE_BUDGET (1 << 20)
+
+// Cache de páginas com política de despejo CLOCK, uma aproximação da LRU em
+// que um acerto apenas marca o quadro como usado. Os nós modificados só são
+// escritos no disco quando despejados ou em `btree_drop`.
+typedef struct BTreePageCache BTreePageCache;
+
+// Travas que permitem que leitores busquem na BTree enquanto ela é modificada.
+typedef struct BTreeLatch BTreeLatch;
+
+// Contadores do cache de páginas.
+typedef struct {
+    // Número máximo de páginas que cabem no cache.
+    uint32_t capacity;
+    uint64_t hits;
+    uint64_t misses;
+    // Páginas removidas do cache para dar lugar a outras.
+    uint64_t evictions;
+    // Páginas modificadas que foram escritas no disco.
+    uint64_t writebacks;
+} BTreeCacheStats;
+
 typedef struct {
-    FILE *fp;
+    // Descritor do arquivo vinculado ou -1 caso não haja nenhum.
+    int fd;
     char *error_msg;
     int32_t rrn_root;
     uint32_t next_rrn;
+    // Primeira página da lista de páginas livres, ou -1 caso ela esteja vazia.
+    // As páginas dos nós removidos são reaproveitadas antes de `next_rrn`.
+    int32_t rrn_free;
+    // RRN da última folha, ou -1 caso seja desconhecido. Não é armazenado no
+    // arquivo: é descoberto pelas inserções e esquecido a cada remoção.
+    int32_t rrn_last_leaf;
+    // Tamanho de cada página em bytes e a ordem (número máximo de filhos) dos
+    // nós. Ambos são armazenados no header do arquivo.
+    uint32_t page_sz;
+    uint32_t order;
+    // Se a árvore aceita chaves duplicadas. Nesse caso, cada chave guarda uma
+    // lista de valores em vez de um único valor (veja `BTreePostings`).
+    bool duplicate_keys;
+    // Com chaves duplicadas, a página compartilhada onde as próximas listas
+    // de valores serão criadas, ou -1 caso nenhuma tenha espaço livre.
+    int32_t rrn_shared;
+    // Se a árvore é uma árvore B+: todas as entradas ficam nas folhas, que são
+    // encadeadas em ordem, e os nós internos guardam apenas separadores.
+    bool linked_leaves;
+    // Se as modificações são feitas com cópia na escrita (veja
+    // `btree_set_copy_on_write`). Nesse modo, as páginas com RRN menor que
+    // `rrn_committed`, que é o `next_rrn` do último header gravado, nunca são
+    // sobrescritas.
+    bool copy_on_write;
+    uint32_t rrn_committed;
+    // Orçamento de memória do cache em bytes e o cache em si, que é NULL
+    // enquanto não houver arquivo vinculado ou se o orçamento for 0.
+    size_t cache_budget;
+    BTreePageCache *cache;
+    // Mapeamento somente leitura do arquivo inteiro e o seu tamanho, ou NULL
+    // caso o arquivo não tenha sido vinculado por `btree_open_mmap`.
+    const uint8_t *map;
+    size_t map_sz;
+    // Travas compartilhadas com os leitores, ou NULL enquanto não houver
+    // arquivo vinculado.
+    BTreeLatch *latch;
 } BTreeMap;
 
 typedef enum {
@@ -27,6 +109,124 @@ typedef enum {
     BTREE_FAIL,
 } BTreeResult;
 
+// Leitor de uma BTree para uso por uma única thread. Possui o seu próprio
+// estado de erro, de forma que vários leitores podem buscar na mesma BTree ao
+// mesmo tempo.
+typedef struct {
+    BTreeMap *btree;
+    char *error_msg;
+} BTreeReader;
+
+// Fração padrão de cada nó ocupada no carregamento em massa. Deixa espaço para
+// inserções futuras sem que ocorram splits imediatamente.
+#define BTREE_DEFAULT_FILL_FACTOR 0.9
+
+// Um par chave-valor, usado no carregamento em massa.
+typedef struct {
+    int32_t  key;
+    uint64_t value;
+} BTreePair;
+
+// Altura máxima de uma BTree percorrida por um cursor. Mesmo com a menor ordem
+// possível, uma árvore mais alta teria mais nós do que RRNs disponíveis.
+#define BTREE_CURSOR_MAX_DEPTH 32
+
+// Estatísticas da estrutura de uma BTree, calculadas por `btree_stats`.
+typedef struct {
+    uint32_t page_sz;
+    uint32_t order;
+    // Número de níveis da árvore, ou 0 caso ela esteja vazia.
+    uint32_t height;
+    // Número de nós em cada nível, a partir da raiz.
+    uint32_t level_nodes[BTREE_CURSOR_MAX_DEPTH];
+    uint32_t n_nodes;
+    // Número de chaves na árvore. Com folhas encadeadas, os separadores dos nós
+    // internos não são contados.
+    uint64_t n_keys;
+    // Fração média das entradas dos nós que está ocupada.
+    double   fill_factor;
+    // Páginas do arquivo, das quais `free_pages` estão na lista de páginas
+    // livres e `postings_pages` guardam valores de chaves duplicadas. Das
+    // demais, as que não são nós alcançados a partir da raiz são contadas em
+    // `orphan_pages`, como em `BTreeCheck`.
+    uint32_t n_pages;
+    uint32_t free_pages;
+    uint32_t postings_pages;
+    uint32_t orphan_pages;
+    // A menor e a maior chave, válidas apenas quando `n_keys > 0`.
+    int32_t  min_key;
+    int32_t  max_key;
+} BTreeStats;
+
+// Resultado da verificação de uma BTree por `btree_check`.
+typedef struct {
+    // Páginas do arquivo, classificadas pelo seu conteúdo. Os nós que não são
+    // alcançados a partir da raiz, como os substituídos com cópia na escrita,
+    // são contados também em `orphan_pages`.
+    uint32_t n_pages;
+    uint32_t node_pages;
+    uint32_t free_pages;
+    uint32_t postings_pages;
+    uint32_t orphan_pages;
+    // Número de chaves na árvore, contadas como em `BTreeStats`, e de valores
+    // verificados. Com chaves duplicadas, cada chave pode ter vários valores.
+    uint64_t n_keys;
+    uint64_t n_values;
+    // Número de problemas encontrados. A descrição do primeiro deles fica na
+    // mensagem de erro da btree.
+    uint32_t n_problems;
+} BTreeCheck;
+
+// Função que verifica um par chave-valor da BTree em `btree_check`, recebendo
+// também o argumento repassado por ela. Retorna `false` caso o valor seja
+// inválido.
+typedef bool (BTreeCheckFunc)(int32_t key, uint64_t value, void *data);
+
+// Um nó no caminho da raiz até a entrada atual de um cursor.
+typedef struct {
+    uint32_t rrn;
+    uint32_t len;
+    bool     is_leaf;
+    // No nó do topo da pilha é a posição da entrada atual, nos demais é a
+    // posição do filho pelo qual o cursor desceu.
+    int32_t  pos;
+} BTreeCursorFrame;
+
+// Cursor para percorrer as entradas da BTree em ordem de chave. A descida é
+// feita com uma pilha explícita, e a página do nó atual é mantida no cursor
+// para que avançar dentro de uma folha não precise ler o disco.
+typedef struct {
+    BTreeMap *btree;
+    // Indica se o cursor está posicionado sobre uma entrada.
+    bool     valid;
+    // A entrada atual, válida apenas se `valid` for `true`. Com chaves
+    // duplicadas, `value` é de uso interno, e os valores de `key` devem ser
+    // lidos com `btree_postings_open`.
+    int32_t  key;
+    uint64_t value;
+    uint32_t depth;
+    BTreeCursorFrame stack[BTREE_CURSOR_MAX_DEPTH];
+    uint8_t  page[BTREE_MAX_PAGE_SZ];
+} BTreeCursor;
+
+// Leitor da lista de valores de uma chave numa BTree com chaves duplicadas.
+// Os primeiros valores de cada lista ficam numa página compartilhada com as
+// listas de outras chaves, e os demais em páginas encadeadas. A página atual é
+// mantida no leitor.
+typedef struct {
+    BTreeMap *btree;
+    // O valor atual, preenchido por `btree_postings_next`.
+    uint64_t value;
+    // RRN da próxima página da lista ou -1 caso não haja.
+    int32_t  next;
+    // Quantidade de valores na página atual, a posição do próximo valor e onde
+    // os valores da lista começam na página.
+    uint32_t len;
+    uint32_t pos;
+    uint32_t base;
+    uint8_t  page[BTREE_MAX_PAGE_SZ];
+} BTreePostings;
+
 /**
  * Cria um novo `BtreeMap`. Não envolve alocação ou abertura de arquivos.
  *
@@ -43,7 +243,9 @@ void btree_drop(BTreeMap btree);
 
 /**
  * Carrega a BTree de um arquivo. Essa operação lê apenas o header da BTree. O
- * arquivo precisa já estar criado e possuir ao menos o header disponível.
+ * arquivo precisa já estar criado e possuir ao menos o header disponível. O
+ * tamanho de página e a ordem são lidos do header, e arquivos no formato
+ * original (páginas de 77 bytes) também são aceitos.
  *
  * @param btree - referência mutável da btree que terá o arquivo vinculado.
  * @param fname - nome do arquivo a ser vinculado a essa btree.
@@ -53,7 +255,38 @@ void btree_drop(BTreeMap btree);
 BTreeResult btree_load(BTreeMap *btree, const char *fname);
 
 /**
- * Cria um arquivo de BTree e vincula ele a um `BTreeMap`.
+ * Vincula um arquivo de BTree a um `BTreeMap` somente para leitura, mapeando o
+ * arquivo inteiro em memória. Os nós são decodificados diretamente do
+ * mapeamento, sem chamadas de sistema, e as páginas são compartilhadas com o
+ * cache do sistema operacional, inclusive entre processos diferentes. Nesse
+ * modo o cache de páginas da `btree` não é usado e qualquer modificação
+ * resulta em erro.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser mapeado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_open_mmap(BTreeMap *btree, const char *fname);
+
+/**
+ * Lê do header de um arquivo de BTree apenas a sua configuração: o tamanho de
+ * página e se a árvore aceita chaves duplicadas ou tem as folhas encadeadas.
+ * Diferente de `btree_load`, o arquivo não é vinculado e o header é aceito
+ * mesmo com status '0', de modo que uma BTree que não foi fechada
+ * corretamente pode ser recriada com a mesma configuração por `btree_create`.
+ *
+ * @param btree - referência mutável da btree, que não pode ter arquivo
+ *                vinculado, onde a configuração é colocada.
+ * @param fname - nome do arquivo cujo header é lido.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_read_layout(BTreeMap *btree, const char *fname);
+
+/**
+ * Cria um arquivo de BTree e vincula ele a um `BTreeMap`. O arquivo usa o
+ * tamanho de página configurado em `btree` (veja `btree_set_page_size`).
  *
  * @param btree - referência mutável da btree que terá o arquivo vinculado.
  * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
@@ -64,10 +297,11 @@ BTreeResult btree_create(BTreeMap *btree, const char *fname);
 
 /**
  * Acessa um valor dado uma chave. Esse processo não envolve escritas ao disco,
- * entretanto muda o *file_pointer* da `btree` e por isso ela não se mantém
+ * entretanto pode registrar um erro na `btree` e por isso ela não se mantém
  * constante.
  *
- * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado
+ *                e não aceitar chaves duplicadas.
  * @param key - a chave de busca.
  * @return o valor associado à `key` caso `key` esteja contida na btree e -1
  *         caso contrário. Em caso de erro, -1 é retornado e `btree_has_error()`
@@ -75,9 +309,138 @@ BTreeResult btree_create(BTreeMap *btree, const char *fname);
  */
 int64_t btree_get(BTreeMap *btree, int32_t key);
 
+/**
+ * Acessa os valores de várias chaves de uma só vez. As chaves são ordenadas e
+ * a árvore é percorrida uma única vez, de modo que chaves próximas
+ * compartilham a leitura dos nós em comum.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado
+ *                e não aceitar chaves duplicadas.
+ * @param keys - as chaves de busca, em qualquer ordem e possivelmente
+ *               repetidas.
+ * @param n - o número de chaves.
+ * @param values - vetor de `n` posições onde o valor de cada chave é colocado
+ *                 na mesma posição da chave em `keys`, ou -1 caso ela não esteja
+ *                 contida na btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_get_many(BTreeMap *btree, const int32_t *keys, size_t n, int64_t *values);
+
+/**
+ * Cria um leitor da `btree`, que pode ser usado por uma única thread. Cada
+ * thread que busca na btree deve ter o seu próprio leitor. Não envolve
+ * alocação.
+ *
+ * @param btree - a btree a ser lida, que precisa continuar válida enquanto o
+ *                leitor for usado.
+ * @return o leitor criado.
+ */
+BTreeReader btree_reader_new(BTreeMap *btree);
+
+/**
+ * Libera um leitor. A btree lida não é afetada.
+ *
+ * @param reader - o leitor a ser liberado.
+ */
+void btree_reader_drop(BTreeReader reader);
+
+/**
+ * Acessa um valor dado uma chave, assim como `btree_get`, mas podendo ser
+ * chamada por várias threads ao mesmo tempo, cada uma com o seu leitor, e
+ * enquanto outra thread modifica a btree. Os erros são registrados apenas no
+ * leitor.
+ *
+ * @param reader - o leitor da thread, cuja btree precisa ter um arquivo
+ *                 vinculado e não aceitar chaves duplicadas.
+ * @param key - a chave de busca.
+ * @return o valor associado à `key` caso `key` esteja contida na btree e -1
+ *         caso contrário. Em caso de erro, -1 é retornado e
+ *         `btree_reader_has_error()` retorna `true`.
+ */
+int64_t btree_reader_get(BTreeReader *reader, int32_t key);
+
+/**
+ * Verifica se o leitor possui algum erro registrado.
+ *
+ * @param reader - o leitor a ser verificado.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool btree_reader_has_error(BTreeReader *reader);
+
+/**
+ * Recupera a mensagem de erro do leitor. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param reader - o leitor com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *btree_reader_get_error(BTreeReader *reader);
+
+/**
+ * Posiciona o cursor na primeira entrada com chave maior ou igual a `key`.
+ * Depois disso, `btree_cursor_next` e `btree_cursor_prev` percorrem as
+ * entradas em ordem de chave. A `btree` não deve ser modificada enquanto o
+ * cursor estiver em uso.
+ *
+ * @param btree - a btree a ser percorrida que precisa ter um arquivo vinculado.
+ * @param cursor - o cursor a ser posicionado.
+ * @param key - a menor chave de interesse.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso não
+ *         haja entrada com chave maior ou igual a `key` ou em caso de erro
+ *         (nesse caso `btree_has_error()` retorna `true`).
+ */
+bool btree_cursor_seek(BTreeMap *btree, BTreeCursor *cursor, int32_t key);
+
+/**
+ * Avança o cursor para a entrada com a próxima chave.
+ *
+ * @param cursor - um cursor posicionado sobre uma entrada.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso as
+ *         entradas tenham acabado ou em caso de erro. Em ambos os casos o
+ *         cursor deixa de ser válido e precisa ser posicionado novamente.
+ */
+bool btree_cursor_next(BTreeCursor *cursor);
+
+/**
+ * Recua o cursor para a entrada com a chave anterior.
+ *
+ * @param cursor - um cursor posicionado sobre uma entrada.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso as
+ *         entradas tenham acabado ou em caso de erro. Em ambos os casos o
+ *         cursor deixa de ser válido e precisa ser posicionado novamente.
+ */
+bool btree_cursor_prev(BTreeCursor *cursor);
+
+/**
+ * Prepara a leitura de todos os valores associados a uma chave numa BTree que
+ * aceita chaves duplicadas. Os valores são lidos com `btree_postings_next`, na
+ * ordem em que foram inseridos.
+ *
+ * @param btree - a btree a ser consultada que precisa ter um arquivo vinculado.
+ * @param postings - o leitor da lista de valores.
+ * @param key - a chave de busca.
+ * @return `true` caso `key` esteja contida na btree e `false` caso contrário.
+ *         Em caso de erro, `false` é retornado e `btree_has_error()` retorna
+ *         `true`.
+ */
+bool btree_postings_open(BTreeMap *btree, BTreePostings *postings, int32_t key);
+
+/**
+ * Avança para o próximo valor da lista, que é colocado em `postings->value`.
+ *
+ * @param postings - o leitor da lista de valores, preparado por
+ *                   `btree_postings_open`.
+ * @return `true` caso haja um próximo valor e `false` caso os valores tenham
+ *         acabado ou em caso de erro.
+ */
+bool btree_postings_next(BTreePostings *postings);
+
 /**
  * Insere um par chave-valor na BTree. Assume que `btree` já possua algum
- * arquivo vinculado.
+ * arquivo vinculado. Caso a btree aceite chaves duplicadas, `value` é
+ * adicionado ao fim da lista de valores de `key`. Outras threads podem buscar
+ * na btree com `BTreeReader`s durante a inserção.
  *
  * @param btree - a btree no qual inserir.
  * @param key - a chave usada para ordenação da btree.
@@ -87,6 +450,169 @@ int64_t btree_get(BTreeMap *btree, int32_t key);
  */
 BTreeResult btree_insert(BTreeMap *btree, int32_t key, uint64_t value);
 
+/**
+ * Remove uma chave da BTree. Os nós que ficarem com menos entradas do que o
+ * mínimo pegam entradas emprestadas dos irmãos ou são juntados a eles, e as
+ * páginas que deixarem de ser usadas são reaproveitadas em inserções futuras.
+ * Com folhas encadeadas, a entrada é apenas retirada da sua folha. Não é
+ * suportada com cópia na escrita.
+ *
+ * @param btree - a btree da qual remover, que precisa ter um arquivo vinculado.
+ * @param key - a chave a ser removida.
+ * @return o valor que estava associado à `key` caso `key` estivesse contida na
+ *         btree e -1 caso contrário. Com chaves duplicadas, todos os valores de
+ *         `key` são removidos e o primeiro deles é retornado. Em caso de erro,
+ *         -1 é retornado e `btree_has_error()` retorna `true`.
+ */
+int64_t btree_remove(BTreeMap *btree, int32_t key);
+
+/**
+ * Define o orçamento de memória do cache de páginas. Caso a `btree` já possua
+ * um arquivo vinculado, as páginas modificadas são escritas no disco e o
+ * cache é recriado com o novo tamanho.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param budget - número máximo de bytes usados pelas páginas em cache. Um
+ *                 orçamento menor que uma página desabilita o cache.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_cache_budget(BTreeMap *btree, size_t budget);
+
+/**
+ * Define o tamanho de página usado por `btree_create`. A ordem da árvore é a
+ * maior ordem ímpar cujo nó ainda caiba numa página. Só pode ser chamada antes
+ * de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param page_sz - o tamanho de cada página em bytes, no máximo
+ *                  `BTREE_MAX_PAGE_SZ`. Com `BTREE_LEGACY_PAGE_SZ` o arquivo
+ *                  criado segue o formato original.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_page_size(BTreeMap *btree, uint32_t page_sz);
+
+/**
+ * Define se a BTree criada por `btree_create` aceita chaves duplicadas. Nesse
+ * caso, cada chave guarda uma lista com todos os valores inseridos para ela,
+ * lida com `btree_postings_open`, em vez de um único valor. Só pode ser
+ * chamada antes de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param duplicate_keys - se a btree aceita chaves duplicadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_duplicate_keys(BTreeMap *btree, bool duplicate_keys);
+
+/**
+ * Define se a BTree criada por `btree_create` é uma árvore B+ com as folhas
+ * encadeadas. Nesse caso, todas as entradas ficam nas folhas, os nós internos
+ * guardam apenas separadores e cada folha aponta para a próxima, de modo que
+ * percorrer as entradas em ordem com um cursor é uma leitura sequencial das
+ * folhas. As remoções não rebalanceiam os nós, e as folhas vazias continuam
+ * encadeadas. Só pode ser chamada antes de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param linked_leaves - se a btree tem as folhas encadeadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_linked_leaves(BTreeMap *btree, bool linked_leaves);
+
+/**
+ * Define se as inserções na BTree são feitas com cópia na escrita. Nesse modo,
+ * um nó que pertence ao último snapshot gravado no header não é sobrescrito:
+ * ele é escrito numa página nova no fim do arquivo, assim como todos os nós
+ * no caminho até a raiz. A nova raiz só passa a valer quando o header é
+ * gravado, com uma única escrita, por `btree_commit` ou `btree_drop`. Até lá,
+ * quem abrir o arquivo lê o snapshot anterior, que continua intacto.
+ *
+ * As páginas substituídas não voltam para a lista de páginas livres, já que
+ * leitores de snapshots anteriores ainda podem usá-las, e a lista de páginas
+ * livres não é usada nesse modo. Remoções não são suportadas, nem árvores com
+ * chaves duplicadas ou folhas encadeadas. Caso a `btree` já possua um arquivo
+ * vinculado, as modificações pendentes são gravadas antes.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param copy_on_write - se as inserções são feitas com cópia na escrita.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_copy_on_write(BTreeMap *btree, bool copy_on_write);
+
+/**
+ * Grava no disco as páginas modificadas que estão no cache e então o header
+ * da btree, com status '1'. Com cópia na escrita, é a gravação do header que
+ * troca a raiz vista por quem abrir o arquivo.
+ *
+ * @param btree - a btree a ser gravada, que precisa ter um arquivo vinculado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_commit(BTreeMap *btree);
+
+/**
+ * Recupera os contadores do cache de páginas da `btree`. Caso o cache esteja
+ * desabilitado, todos os contadores são 0.
+ *
+ * @param btree - a btree a ser consultada.
+ * @return os contadores do cache.
+ */
+BTreeCacheStats btree_cache_stats(const BTreeMap *btree);
+
+/**
+ * Calcula as estatísticas da estrutura da `btree`, como a altura, o número de
+ * nós de cada nível e a ocupação média dos nós. Todos os nós alcançáveis a
+ * partir da raiz, as listas de valores das chaves duplicadas e a lista de
+ * páginas livres são lidos.
+ *
+ * @param btree - a btree a ser consultada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param stats - referência mutável para onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_stats(BTreeMap *btree, BTreeStats *stats);
+
+/**
+ * Verifica a consistência da `btree`. Todas as páginas do arquivo são lidas uma
+ * única vez, em sequência, e as relações entre os nós são verificadas em
+ * memória: a ordem das chaves dentro de cada nó e em relação aos separadores
+ * dos pais, os limites de todos os RRNs em relação a `next_rrn`, que cada nó
+ * seja alcançado uma única vez a partir da raiz, que as folhas estejam no mesmo
+ * nível e que a lista de páginas livres não tenha ciclos. Depois, os nós
+ * alcançáveis são lidos novamente para que cada valor seja verificado.
+ *
+ * @param btree - a btree a ser verificada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param report - referência mutável para onde o resultado é colocado.
+ * @param check_value - função que verifica cada par chave-valor, ou NULL.
+ * @param data - argumento repassado para `check_value`.
+ * @return `BTREE_OK` caso nenhum problema seja encontrado e `BTREE_FAIL` caso
+ *         contrário ou em caso de erro. Em ambos os casos de falha, uma
+ *         mensagem de erro estará disponível.
+ */
+BTreeResult btree_check(BTreeMap *btree, BTreeCheck *report, BTreeCheckFunc *check_value, void *data);
+
+/**
+ * Constrói a BTree de baixo para cima a partir de pares ordenados. Os nós são
+ * preenchidos até `fill_factor` da sua capacidade e escritos em sequência no
+ * arquivo, sem os splits que ocorreriam com `btree_insert`. Assume que `btree`
+ * já possua algum arquivo vinculado e que esteja vazia.
+ *
+ * @param btree - a btree a ser construída.
+ * @param pairs - os pares chave-valor em ordem estritamente crescente de chave.
+ *                Caso a btree aceite chaves duplicadas, chaves iguais podem ser
+ *                consecutivas e os seus valores são mantidos na mesma ordem.
+ * @param n - o número de pares.
+ * @param fill_factor - fração de cada nó a ser ocupada, no intervalo (0, 1].
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_bulk_load(BTreeMap *btree, const BTreePair *pairs, size_t n, double fill_factor);
+
 /**
  * Verifica se a `btree` possui algum erro registrado.
  *
@@ -105,12 +631,10 @@ bool btree_has_error(BTreeMap *btree);
 const char *btree_get_error(BTreeMap *btree);
 
 /**
- * Imprime os conteúdos da `btree`.
- * ATENÇÃO: Essa função causará undefined behavior caso possua um nível com
- * mais de 10000 nós.
+ * Imprime os conteúdos da `btree`, um nível por linha.
  *
  * @param btree - a btree a ser impressa. Essa função não causa escritas ao
- *                disco, mas utiliza de `fseek` o que modifica `btree`.
+ *                disco nem modifica `btree`.
  */
 void btree_print(BTreeMap *btree);
 
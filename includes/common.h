@@ -6,6 +6,8 @@
  *      - Representação lida do binário: DBMeta, DBVehicleHeader,
  *                                       DBBusLineHeader, DBVehicleRegister,
  *                                       DBBusLineRegister
+ *      - Visões de registros do binário, que não possuem as próprias strings:
+ *                                       DBVehicleView, DBBusLineView
  */
 
 
@@ -104,6 +106,39 @@ typedef struct {
     char      *corLinha;
 } DBBusLineRegister;
 
+// Fatia de uma string que pertence a outro buffer e não termina em '\0'.
+typedef struct {
+    const char *ptr;
+    uint32_t    len;
+} StrSlice;
+
+// Visão de um registro de veículo do binário. Os campos apontam para o buffer
+// de onde o registro foi lido, sem cópia, e só são válidos enquanto ele não é
+// modificado.
+typedef struct {
+    char        removido;
+    uint32_t    tamanhoRegistro;
+    // 5 bytes, assim como em `DBVehicleRegister`.
+    const char *prefixo;
+    // 10 bytes, assim como em `DBVehicleRegister`.
+    const char *data;
+    int32_t     quantidadeLugares;
+    uint32_t    codLinha;
+    StrSlice    modelo;
+    StrSlice    categoria;
+} DBVehicleView;
+
+// Visão de um registro de linha de ônibus do binário. Assim como em
+// `DBVehicleView`, as strings apontam para o buffer de onde ele foi lido.
+typedef struct {
+    char        removido;
+    uint32_t    tamanhoRegistro;
+    uint32_t    codLinha;
+    char        aceitaCartao;
+    StrSlice    nomeLinha;
+    StrSlice    corLinha;
+} DBBusLineView;
+
 
 
 #endif
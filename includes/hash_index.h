@@ -0,0 +1,211 @@
+/**
+ * Módulo do HashIndex.
+ *
+ * Esse módulo consiste de um índice hash extensível em disco, com chaves
+ * inteiras únicas, que pode substituir a BTree (veja btree.h) quando o índice
+ * só é usado para buscas por igualdade.
+ *
+ * Os pares chave-valor ficam em buckets de uma página cada. Um diretório com
+ * `2^global_depth` posições, mantido inteiro em memória enquanto o arquivo
+ * está vinculado, aponta para o bucket de cada hash: a posição é dada pelos
+ * `global_depth` bits menos significativos do hash da chave. Assim, uma busca
+ * custa a leitura de uma única página, independente do número de chaves.
+ *
+ * Quando um bucket enche ele é dividido em dois pelo próximo bit do hash, e
+ * somente quando esse bucket já usa todos os bits do diretório é que o
+ * diretório dobra de tamanho. O diretório é escrito de volta no arquivo apenas
+ * em `hash_index_drop`.
+ *
+ * O arquivo começa pelo mesmo campo de status da BTree, seguido por um
+ * identificador próprio, de modo que as operações de índice reconhecem qual
+ * dos dois tipos de índice um arquivo contém (veja `hash_index_detect`).
+ */
+
+
+#ifndef _HASH_INDEX_H_
+#define _HASH_INDEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <btree.h>
+
+// Tamanho de cada página do arquivo.
+#define HASH_INDEX_PAGE_SZ 4096
+
+// Maior profundidade do diretório, que então ocupa 4MiB. Com chaves
+// distintas, um bucket só não pode mais ser dividido caso mais chaves do que
+// cabem nele compartilhem os mesmos `HASH_INDEX_MAX_DEPTH` bits de hash.
+#define HASH_INDEX_MAX_DEPTH 20
+
+typedef struct {
+    // Descritor do arquivo vinculado ou -1 caso não haja nenhum.
+    int fd;
+    char *error_msg;
+    // Número de bits do hash usados pelo diretório, que tem
+    // `2^global_depth` posições.
+    uint32_t global_depth;
+    uint32_t next_rrn;
+    // Onde o diretório está no arquivo: RRN da primeira página e o número de
+    // páginas reservadas para ele, ou 0 caso ainda não tenha sido escrito.
+    uint32_t dir_rrn;
+    uint32_t dir_pages;
+    uint64_t n_keys;
+    // O diretório, com o RRN do bucket de cada posição, ou NULL enquanto não
+    // houver arquivo vinculado.
+    uint32_t *dir;
+    // Se o índice foi modificado desde que foi vinculado. Nesse caso, o header
+    // está com status '0' até `hash_index_drop`.
+    bool dirty;
+} HashIndex;
+
+// Estatísticas da estrutura de um índice hash.
+typedef struct {
+    uint32_t global_depth;
+    uint32_t n_buckets;
+    // Número de páginas do arquivo, sem contar o header.
+    uint32_t n_pages;
+    uint32_t dir_pages;
+    uint64_t n_keys;
+    // Fração média ocupada dos buckets.
+    double fill_factor;
+    // Número de inconsistências encontradas por `hash_index_check`. É sempre
+    // 0 em `hash_index_stats`.
+    uint32_t n_problems;
+} HashIndexStats;
+
+/**
+ * Cria um novo `HashIndex`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return um índice ainda sem arquivo vinculado.
+ */
+HashIndex hash_index_new();
+
+/**
+ * Libera o `HashIndex` inclusive fechando algum arquivo vinculado. Caso o
+ * índice tenha sido modificado, escreve o diretório e o header, agora com
+ * status '1'.
+ *
+ * @param index - o índice a ser liberado.
+ */
+void hash_index_drop(HashIndex index);
+
+/**
+ * Verifica se um arquivo contém um índice hash, criado por
+ * `hash_index_create`, independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja um índice hash e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool hash_index_detect(const char *fname);
+
+/**
+ * Carrega o índice de um arquivo, lendo o header e o diretório. O arquivo
+ * precisa já estar criado por `hash_index_create`.
+ *
+ * @param index - referência mutável do índice que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a esse índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_load(HashIndex *index, const char *fname);
+
+/**
+ * Cria um arquivo de índice hash vazio e vincula ele a um `HashIndex`.
+ *
+ * @param index - referência mutável do índice que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a esse índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_create(HashIndex *index, const char *fname);
+
+/**
+ * Acessa um valor dado uma chave, com a leitura de uma única página.
+ *
+ * @param index - o índice a ser utilizado que precisa ter um arquivo
+ *                vinculado.
+ * @param key - a chave de busca.
+ * @return o valor associado à `key` caso `key` esteja contida no índice e -1
+ *         caso contrário. Em caso de erro, -1 é retornado e
+ *         `hash_index_has_error()` retorna `true`.
+ */
+int64_t hash_index_get(HashIndex *index, int32_t key);
+
+/**
+ * Mesmo que `hash_index_get` para várias chaves de uma vez. Chaves seguidas que
+ * caem no mesmo bucket compartilham a leitura da página.
+ *
+ * @param index - o índice a ser utilizado que precisa ter um arquivo
+ *                vinculado.
+ * @param keys - as chaves de busca, em qualquer ordem e possivelmente
+ *               repetidas.
+ * @param n - o número de chaves.
+ * @param values - vetor de `n` posições onde o valor de cada chave é colocado
+ *                 na mesma posição da chave em `keys`, ou -1 caso ela não esteja
+ *                 contida no índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_get_many(HashIndex *index, const int32_t *keys, size_t n, int64_t *values);
+
+/**
+ * Insere um par chave-valor no índice. Caso a chave já exista, o seu valor é
+ * substituído.
+ *
+ * @param index - o índice no qual inserir, que precisa ter um arquivo
+ *                vinculado.
+ * @param key - a chave.
+ * @param value - o valor associado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_insert(HashIndex *index, int32_t key, uint64_t value);
+
+/**
+ * Calcula as estatísticas da estrutura do índice, lendo cada bucket uma vez.
+ *
+ * @param index - o índice, que precisa ter um arquivo vinculado.
+ * @param stats - onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_stats(HashIndex *index, HashIndexStats *stats);
+
+/**
+ * Verifica a consistência do índice: que cada bucket é apontado exatamente
+ * pelas posições do diretório correspondentes à sua profundidade, que as
+ * chaves de cada bucket pertencem a ele e não se repetem, e que o número de
+ * chaves confere com o header. Opcionalmente, `check` é chamada com cada par
+ * chave-valor.
+ *
+ * @param index - o índice, que precisa ter um arquivo vinculado.
+ * @param report - onde as estatísticas e o número de problemas são colocados.
+ * @param check - função que valida cada par, ou NULL.
+ * @param data - argumento repassado para `check`.
+ * @return `BTREE_OK` caso o índice esteja consistente e `BTREE_FAIL` caso
+ *         contrário ou em caso de erro. Em ambos os casos de falha, uma
+ *         mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_check(HashIndex *index, HashIndexStats *report, BTreeCheckFunc *check, void *data);
+
+/**
+ * Verifica se o `index` possui algum erro registrado.
+ *
+ * @param index - o índice a ser verificado.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool hash_index_has_error(HashIndex *index);
+
+/**
+ * Recupera a mensagem de erro do `index`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param index - o índice com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *hash_index_get_error(HashIndex *index);
+
+#endif
@@ -27,10 +27,55 @@ bool index_vehicle_create(const char *bin_fname, const char *index_fname);
  */
 bool index_bus_line_create(const char *bin_fname, const char *index_fname);
 
+/**
+ * Cria um arquivo de indice arvore B+ para o arquivo de dados linhas de onibus,
+ * cujas folhas encadeadas permitem percorrer as linhas em ordem de codLinha
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario de indice arvore B+
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_bus_line_ordered_create(const char *bin_fname, const char *index_fname);
+
+/**
+ * Cria um arquivo de indice arvore-B com chaves duplicadas para o campo codLinha do arquivo de dados veiculo
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_vehicle_line_create(const char *bin_fname, const char *index_fname);
+
+/**
+ * Cria um arquivo de indice hash para o arquivo de dados veiculo, que pode ser usado no lugar do indice arvore-B
+ * criado por index_vehicle_create nas buscas por prefixo
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice hash
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_vehicle_hash_create(const char *bin_fname, const char *index_fname);
+
+/**
+ * Cria um arquivo de indice hash para o arquivo de dados linhas de onibus, que pode ser usado no lugar do indice
+ * arvore-B criado por index_bus_line_create nas buscas por codLinha
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario de indice hash
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_bus_line_hash_create(const char *bin_fname, const char *index_fname);
+
+/**
+ * Cria uma tabela organizada por indice para o arquivo de dados linhas de onibus, cujas folhas guardam os proprios
+ * registros das linhas nao removidas. Pode ser usada no lugar do indice arvore-B criado por index_bus_line_create nas
+ * buscas por codLinha e na juncao, que entao nao leem o arquivo de linhas
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario da tabela organizada por indice
+ * @returns um valor booleano - true se for criada, false se der algum erro
+ */
+bool index_bus_line_clustered_create(const char *bin_fname, const char *index_fname);
+
 /**
  * Recupera os regstros buscados de um determinado arquivo de dados veiculo usando o indice arvore-B
  * @params bin_fname - nome do arquivo binario veiculos
- * @params index_fname - nome do arquivo binario de indices arvore-B
+ * @params index_fname - nome do arquivo binario de indices arvore-B ou hash
  * @params prefixo[6] - valor do campo prefixo em que sera feita a busca
  * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
  */
@@ -39,12 +84,91 @@ bool search_for_vehicle(const char *bin_fname, const char *index_fname, const ch
 /**
  * Recupera os regstros buscados de um determinado arquivo de dados lnhas de onibus usando o indice arvore-B
  * @params bin_fname - nome do arquivo binario linhas de onibus
- * @params index_fname - nome do arquivo binario de indices arvore-B
+ * @params index_fname - nome do arquivo binario de indices arvore-B ou hash
  * @params code - valor do campo cdigo em que sera feita a busca
  * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
  */
 bool search_for_bus_line(const char *bin_fname, const char *index_fname, uint32_t code);
 
+/**
+ * Recupera todos os veiculos de uma linha usando o indice arvore-B de codLinha com chaves duplicadas
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice criado por index_vehicle_line_create
+ * @params code - valor do campo codLinha em que sera feita a busca
+ * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+ */
+bool search_for_vehicles_of_line(const char *bin_fname, const char *index_fname, int32_t code);
+
+/**
+ * Imprime as estatisticas da estrutura de um indice, de qualquer um dos tipos, uma por linha no formato "campo valor"
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @returns um valor booleano - true se as estatisticas forem impressas, false se ocorrer algum erro
+ */
+bool print_index_stats(const char *index_fname);
+
+
+/**
+ * Cria um arquivo de indice arvore-B com chaves de texto para um campo de texto do arquivo de dados veiculo
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @params field - o campo indexado, "modelo" ou "categoria"
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_vehicle_string_create(const char *bin_fname, const char *index_fname, const char *field);
+
+/**
+ * Cria um arquivo de indice arvore-B com chaves de texto para um campo de texto do arquivo de dados linhas de onibus
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @params field - o campo indexado, "nomeLinha" ou "corLinha"
+ * @returns um valor booleano - true se for criado, false se der algum erro
+ */
+bool index_bus_line_string_create(const char *bin_fname, const char *index_fname, const char *field);
+
+/**
+ * Recupera os veiculos cujo campo de texto e igual a um valor usando o indice arvore-B com chaves de texto.
+ * Exibe o mesmo que select_from_vehicle_where, sem percorrer o arquivo de dados inteiro
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice criado por index_vehicle_string_create
+ * @params field - o campo indexado
+ * @params value - valor do campo em que sera feita a busca
+ * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+ */
+bool search_for_vehicles_where(const char *bin_fname, const char *index_fname, const char *field, const char *value);
+
+/**
+ * Recupera as linhas de onibus cujo campo de texto e igual a um valor usando o indice arvore-B com chaves de texto.
+ * Exibe o mesmo que select_from_bus_line_where, sem percorrer o arquivo de dados inteiro
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario de indice criado por index_bus_line_string_create
+ * @params field - o campo indexado
+ * @params value - valor do campo em que sera feita a busca
+ * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+ */
+bool search_for_bus_lines_where(const char *bin_fname, const char *index_fname, const char *field, const char *value);
+
+/**
+ * Verifica um indice do arquivo de dados veiculo, criado por index_vehicle_create, index_vehicle_line_create,
+ * index_vehicle_hash_create ou index_vehicle_string_create, e o recria caso esteja inconsistente ou nao tenha sido
+ * fechado corretamente. Um arquivo que nao e um indice desses tipos nunca e sobrescrito. Imprime o resultado da verificacao, um
+ * por linha no formato "campo valor"
+ * @params bin_fname - nome do arquivo binario veiculos
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @returns um valor booleano - true se o indice estiver consistente ou for recriado, false se ocorrer algum erro
+ */
+bool check_vehicle_index(const char *bin_fname, const char *index_fname);
+
+/**
+ * Verifica um indice do arquivo de dados linhas de onibus, criado por index_bus_line_create,
+ * index_bus_line_ordered_create, index_bus_line_hash_create, index_bus_line_clustered_create ou
+ * index_bus_line_string_create, e o recria caso esteja inconsistente ou nao tenha sido fechado corretamente. Um arquivo
+ * que nao e um indice desses tipos nunca e sobrescrito. Imprime o
+ * resultado da verificacao, um por linha no formato "campo valor"
+ * @params bin_fname - nome do arquivo binario linhas de onibus
+ * @params index_fname - nome do arquivo binario de indice arvore-B
+ * @returns um valor booleano - true se o indice estiver consistente ou for recriado, false se ocorrer algum erro
+ */
+bool check_bus_line_index(const char *bin_fname, const char *index_fname);
 
 /**
  * Insere cada registro em um arquivo binário de dados veículo e a chave de busca correspondente a essa inserção inserida no indice arvore-B
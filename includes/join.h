@@ -15,16 +15,39 @@ bool join_vehicle_and_bus_line(const char *vehiclebin_fname, const char *busline
 * Exibe os resultados que satisfazem a busca de codLinha no arquivo binário de veículos e no arquivo binário de linhsa de ônibus 
 * @param vehiclebin_fname - caminho para o arquivo binário de veículos
 * @param buslinebin_fname - caminho para o arquivo binário de linhas de ônibus
-* @param index_btree_fname - caminho para o arquivo binário de índices árvore-B
+* @param index_btree_fname - caminho para o arquivo binário de índices árvore-B, hash ou de linhas organizadas por índice
 * @returns - um valor booleano = true se a leitura dos arquivos der certo e retornar algum resultado, false se a leitura dos arquivos der errado ou não retornar nenhum resultado da busca
 */
 bool join_vehicle_and_bus_line_using_btree(const char *vehiclebin_fname, const char *buslinebin_fname, const char *index_btree_fname);
 
 /**
- * Ordena os dois arquivos fornecidos gerando novos arquivos ordenados com o
- * sufixo "_ordenado". Em seguida abre esses arquivos ordenados e itera sobre os
- * registros imprimindo os registros onde veiculo.codLinha == linha.codLinha
- * usando um merge.
+ * Exibe os resultados que satisfazem a busca de codLinha no arquivo binário de
+ * veículos e no arquivo binário de linha de ônibus. Percorre as linhas e busca
+ * os veículos de cada uma no índice árvore-B de codLinha com chaves duplicadas,
+ * sem percorrer o arquivo de veículos inteiro. Os resultados são agrupados por
+ * linha, na ordem do arquivo de linhas.
+ *
+ * @param vehicle_bin_fname - caminho para o arquivo binário de veículos
+ * @param busline_bin_fname - caminho para o arquivo binário de linhas de ônibus
+ * @param vehicle_index_fname - caminho para o índice criado por
+ *                              `index_vehicle_line_create`
+ * @returns - um valor booleano = true se a leitura dos arquivos der certo e retornar algum
+ *            resultado, false se a leitura dos arquivos der errado ou não retornar nenhum
+ *            resultado da busca
+ */
+bool join_vehicle_index_and_bus_line(
+    const char *vehicle_bin_fname,
+    const char *busline_bin_fname,
+    const char *vehicle_index_fname
+);
+
+/**
+ * Ordena o arquivo de veículos gerando um novo arquivo ordenado com o sufixo
+ * "_ordenado", e cria um índice árvore B+ de codLinha do arquivo de linhas com
+ * o sufixo "_indice". Em seguida percorre os veículos ordenados junto das
+ * folhas encadeadas do índice, que já estão em ordem de codLinha, imprimindo os
+ * registros onde veiculo.codLinha == linha.codLinha usando um merge. Somente as
+ * linhas com algum veículo correspondente são lidas do arquivo de linhas.
  *
  * @param vehicle_bin_fname - nome do arquivo binário com os registros de veículo.
  * @param busline_bin_fname - nome do arquivo binário com os registros de linha.
@@ -0,0 +1,200 @@
+/**
+ * Módulo da RecBTreeMap.
+ *
+ * Esse módulo consiste de uma árvore B+ em disco com chaves inteiras únicas
+ * cujas folhas guardam os próprios registros, e não o offset deles num arquivo
+ * de dados. É um índice organizado como tabela: uma busca desce até a folha e
+ * já encontra o registro inteiro, sem uma segunda leitura no arquivo de dados.
+ * É indicada para tabelas pequenas e muito acessadas, como a de linhas de
+ * ônibus.
+ *
+ * Assim como na StrBTree (veja str_btree.h), cada nó ocupa uma página com
+ * slots: um vetor de offsets no início da página aponta para as células, que
+ * são guardadas a partir do fim dela e têm tamanho variável nas folhas. As
+ * folhas são encadeadas em ordem, de modo que a tabela inteira pode ser
+ * percorrida em ordem de chave com `RecBTreeCursor`.
+ *
+ * O arquivo começa pelo mesmo campo de status da BTree, seguido por um
+ * identificador próprio (veja `rec_btree_detect`).
+ */
+
+
+#ifndef _REC_BTREE_H_
+#define _REC_BTREE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <btree.h>
+
+// Tamanho de cada página do arquivo.
+#define REC_BTREE_PAGE_SZ 4096
+
+// Maior tamanho de registro guardado, de modo que cada folha comporte ao
+// menos três registros.
+#define REC_BTREE_MAX_RECORD_SZ 1024
+
+// Altura máxima da árvore. Mesmo com o menor número de células por nó, uma
+// árvore mais alta teria mais nós do que RRNs disponíveis.
+#define REC_BTREE_MAX_DEPTH 32
+
+typedef struct {
+    // Descritor do arquivo vinculado ou -1 caso não haja nenhum.
+    int fd;
+    char *error_msg;
+    int32_t rrn_root;
+    uint32_t next_rrn;
+    // Se a árvore foi modificada desde que foi vinculada. Nesse caso, o header
+    // está com status '0' até `rec_btree_drop`.
+    bool dirty;
+} RecBTreeMap;
+
+// Um registro a ser carregado por `rec_btree_bulk_load`.
+typedef struct {
+    int32_t        key;
+    uint32_t       len;
+    const uint8_t *record;
+} RecBTreeRecord;
+
+// Leitor que percorre todos os registros em ordem de chave, folha por folha.
+typedef struct {
+    RecBTreeMap *btree;
+    // O registro atual, preenchido por `rec_btree_cursor_next`. `record` aponta
+    // para dentro de `page` e só é válido até a próxima chamada.
+    int32_t        key;
+    uint32_t       len;
+    const uint8_t *record;
+    // RRN da próxima folha ou -1 caso não haja.
+    int32_t  next;
+    // Posição da próxima célula da folha atual.
+    uint32_t pos;
+    uint8_t  page[REC_BTREE_PAGE_SZ];
+} RecBTreeCursor;
+
+/**
+ * Cria um novo `RecBTreeMap`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return uma RecBTree ainda sem arquivo vinculado.
+ */
+RecBTreeMap rec_btree_new();
+
+/**
+ * Libera o `RecBTreeMap` inclusive fechando algum arquivo vinculado.
+ *
+ * @param btree - a btree a ser liberada.
+ */
+void rec_btree_drop(RecBTreeMap btree);
+
+/**
+ * Verifica se um arquivo contém uma RecBTree, criada por `rec_btree_create`,
+ * independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja uma RecBTree e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool rec_btree_detect(const char *fname);
+
+/**
+ * Carrega a RecBTree de um arquivo. Essa operação lê apenas o header. O
+ * arquivo precisa já estar criado por `rec_btree_create`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_load(RecBTreeMap *btree, const char *fname);
+
+/**
+ * Cria um arquivo de RecBTree vazio e vincula ele a um `RecBTreeMap`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_create(RecBTreeMap *btree, const char *fname);
+
+/**
+ * Insere um registro na RecBTree. Caso a chave já exista, o seu registro é
+ * substituído.
+ *
+ * @param btree - a btree no qual inserir, que precisa ter um arquivo vinculado.
+ * @param key - a chave do registro.
+ * @param record - os bytes do registro.
+ * @param len - o tamanho do registro, de até `REC_BTREE_MAX_RECORD_SZ` bytes.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_insert(RecBTreeMap *btree, int32_t key, const void *record, uint32_t len);
+
+/**
+ * Constrói a RecBTree de baixo para cima a partir de registros ordenados. As
+ * folhas são preenchidas até `fill_factor` da página e escritas em sequência,
+ * seguidas pelos nós internos de cada nível, sem as divisões que ocorreriam
+ * com `rec_btree_insert`. Assume que `btree` já possua algum arquivo vinculado
+ * e que esteja vazia.
+ *
+ * @param btree - a btree a ser construída.
+ * @param records - os registros em ordem estritamente crescente de chave.
+ * @param n - o número de registros.
+ * @param fill_factor - fração de cada página a ser ocupada, no intervalo
+ *                      (0, 1].
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_bulk_load(RecBTreeMap *btree, const RecBTreeRecord *records, size_t n, double fill_factor);
+
+/**
+ * Busca o registro de uma chave, lendo somente os nós do caminho da raiz até a
+ * folha.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
+ * @param key - a chave de busca.
+ * @param record - onde o registro é copiado, com espaço para
+ *                 `REC_BTREE_MAX_RECORD_SZ` bytes.
+ * @return o tamanho do registro caso `key` esteja contida na btree e -1 caso
+ *         contrário. Em caso de erro, -1 é retornado e `rec_btree_has_error()`
+ *         retorna `true`.
+ */
+int32_t rec_btree_get(RecBTreeMap *btree, int32_t key, uint8_t *record);
+
+/**
+ * Prepara um cursor antes do primeiro registro da btree.
+ *
+ * @param btree - a btree a ser percorrida, que precisa ter um arquivo
+ *                vinculado.
+ * @param cursor - o cursor a ser preparado.
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool rec_btree_cursor_first(RecBTreeMap *btree, RecBTreeCursor *cursor);
+
+/**
+ * Avança para o próximo registro, cuja chave, tamanho e bytes são colocados no
+ * cursor.
+ *
+ * @param cursor - o cursor, preparado por `rec_btree_cursor_first`.
+ * @return `true` caso haja um próximo registro e `false` caso os registros
+ *         tenham acabado ou em caso de erro.
+ */
+bool rec_btree_cursor_next(RecBTreeCursor *cursor);
+
+/**
+ * Verifica se a `btree` possui algum erro registrado.
+ *
+ * @param btree - a btree a ser verificada.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool rec_btree_has_error(RecBTreeMap *btree);
+
+/**
+ * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param btree - a btree com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *rec_btree_get_error(RecBTreeMap *btree);
+
+#endif
@@ -0,0 +1,260 @@
+/**
+ * Módulo da StrBTreeMap.
+ *
+ * Esse módulo consiste de uma variante da BTree em disco (veja btree.h) cujas
+ * chaves são strings de tamanho variável. É uma árvore B+: todos os pares
+ * chave-valor ficam nas folhas, que são encadeadas em ordem, e os nós internos
+ * guardam apenas separadores.
+ *
+ * Cada nó ocupa uma página com slots: um vetor de offsets no início da página
+ * aponta para as células, que são guardadas a partir do fim dela. O prefixo
+ * comum a todas as chaves de um nó é guardado uma única vez e cada célula
+ * guarda somente o restante da sua chave, de modo que chaves repetidas ou
+ * parecidas ocupam pouco espaço.
+ *
+ * Uma mesma chave pode ter vários valores. Os pares são ordenados pela chave e
+ * depois pelo valor, então os valores de uma chave são lidos em ordem
+ * crescente com `str_btree_values_open`.
+ *
+ * O arquivo começa pelo mesmo campo de status da BTree, seguido por um
+ * identificador próprio (veja `str_btree_detect`).
+ */
+
+
+#ifndef _STR_BTREE_H_
+#define _STR_BTREE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <btree.h>
+
+// Tamanho de cada página do arquivo.
+#define STR_BTREE_PAGE_SZ 4096
+
+// Maior tamanho de chave guardado. Chaves maiores são truncadas, então chaves
+// com os mesmos primeiros `STR_BTREE_MAX_KEY_SZ` bytes compartilham os seus
+// valores.
+#define STR_BTREE_MAX_KEY_SZ 255
+
+// Altura máxima da árvore. Mesmo com o menor número de células por nó, uma
+// árvore mais alta teria mais nós do que RRNs disponíveis.
+#define STR_BTREE_MAX_DEPTH 32
+
+// Maior tamanho do rótulo guardado no header (veja `str_btree_create`).
+#define STR_BTREE_MAX_LABEL_SZ 32
+
+typedef struct {
+    // Descritor do arquivo vinculado ou -1 caso não haja nenhum.
+    int fd;
+    char *error_msg;
+    int32_t rrn_root;
+    uint32_t next_rrn;
+    // Se o arquivo foi aberto por `str_btree_load_read_only`, caso em que
+    // inserções falham.
+    bool read_only;
+    // Se a árvore foi modificada desde que foi vinculada. Nesse caso, o header
+    // está com status '0' até `str_btree_drop`.
+    bool dirty;
+    // Rótulo dado em `str_btree_create`, terminado em '\0'.
+    char label[STR_BTREE_MAX_LABEL_SZ + 1];
+} StrBTreeMap;
+
+// Leitor dos valores de uma chave. Como os valores podem estar em várias
+// folhas, a folha atual é mantida no leitor.
+typedef struct {
+    StrBTreeMap *btree;
+    // O valor atual, preenchido por `str_btree_values_next`.
+    uint64_t value;
+    // RRN da próxima folha ou -1 caso não haja.
+    int32_t  next;
+    // Posição da próxima célula da folha atual.
+    uint32_t pos;
+    // A chave buscada, já truncada.
+    uint32_t key_len;
+    char     key[STR_BTREE_MAX_KEY_SZ];
+    uint8_t  page[STR_BTREE_PAGE_SZ];
+} StrBTreeValues;
+
+// Estatísticas da estrutura de uma StrBTree, calculadas por `str_btree_stats`.
+typedef struct {
+    // Número de níveis da árvore, ou 0 caso ela esteja vazia.
+    uint32_t height;
+    // Páginas do arquivo, que são todas nós, das quais `leaf_nodes` são folhas.
+    uint32_t n_pages;
+    uint32_t leaf_nodes;
+    // Número de pares e de chaves distintas.
+    uint64_t n_values;
+    uint64_t n_keys;
+    // Fração média dos bytes das páginas que está ocupada.
+    double   fill_factor;
+} StrBTreeStats;
+
+// Leitor que percorre todos os pares em ordem, folha por folha.
+typedef struct {
+    StrBTreeMap *btree;
+    // O par atual, preenchido por `str_btree_cursor_next`. A chave não é
+    // terminada em '\0'.
+    uint32_t key_len;
+    char     key[STR_BTREE_MAX_KEY_SZ];
+    uint64_t value;
+    // RRN da próxima folha ou -1 caso não haja.
+    int32_t  next;
+    // Posição da próxima célula da folha atual.
+    uint32_t pos;
+    uint8_t  page[STR_BTREE_PAGE_SZ];
+} StrBTreeCursor;
+
+/**
+ * Cria um novo `StrBTreeMap`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return uma StrBTree ainda sem arquivo vinculado.
+ */
+StrBTreeMap str_btree_new();
+
+/**
+ * Libera o `StrBTreeMap` inclusive fechando algum arquivo vinculado.
+ *
+ * @param btree - a btree a ser liberada.
+ */
+void str_btree_drop(StrBTreeMap btree);
+
+/**
+ * Verifica se um arquivo contém uma StrBTree, criada por `str_btree_create`,
+ * independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja uma StrBTree e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool str_btree_detect(const char *fname);
+
+/**
+ * Lê o rótulo de uma StrBTree independente do seu status, de modo que ele
+ * possa ser recuperado mesmo de um arquivo que não foi fechado corretamente.
+ *
+ * @param fname - nome do arquivo.
+ * @param label - onde o rótulo é colocado, com espaço para
+ *                `STR_BTREE_MAX_LABEL_SZ + 1` bytes.
+ * @return `true` caso o arquivo seja uma StrBTree e o rótulo seja lido e
+ *         `false` caso contrário.
+ */
+bool str_btree_read_label(const char *fname, char *label);
+
+/**
+ * Carrega a StrBTree de um arquivo. Essa operação lê apenas o header. O
+ * arquivo precisa já estar criado por `str_btree_create`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_load(StrBTreeMap *btree, const char *fname);
+
+/**
+ * Carrega a StrBTree de um arquivo somente para buscas. O arquivo é aberto
+ * apenas para leitura e nunca é modificado, nem mesmo por `str_btree_drop`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_load_read_only(StrBTreeMap *btree, const char *fname);
+
+/**
+ * Cria um arquivo de StrBTree vazio e vincula ele a um `StrBTreeMap`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @param label - texto de até `STR_BTREE_MAX_LABEL_SZ` bytes guardado no
+ *                header, como o nome do campo indexado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_create(StrBTreeMap *btree, const char *fname, const char *label);
+
+/**
+ * Insere um par chave-valor na StrBTree. Uma chave pode ter vários valores,
+ * mas inserir um par que já existe não tem efeito.
+ *
+ * @param btree - a btree no qual inserir, que precisa ter um arquivo vinculado.
+ * @param key - a chave, truncada em `STR_BTREE_MAX_KEY_SZ` bytes.
+ * @param value - o valor associado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_insert(StrBTreeMap *btree, const char *key, uint64_t value);
+
+/**
+ * Prepara a leitura dos valores de uma chave, que são lidos em ordem crescente
+ * com `str_btree_values_next`.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
+ * @param values - o leitor a ser preparado.
+ * @param key - a chave de busca, truncada em `STR_BTREE_MAX_KEY_SZ` bytes.
+ * @return `true` caso `key` possua algum valor e `false` caso contrário ou em
+ *         caso de erro. No segundo caso, `str_btree_has_error()` retorna
+ *         `true`.
+ */
+bool str_btree_values_open(StrBTreeMap *btree, StrBTreeValues *values, const char *key);
+
+/**
+ * Avança para o próximo valor da chave, que é colocado em `values->value`.
+ *
+ * @param values - o leitor, preparado por `str_btree_values_open`.
+ * @return `true` caso haja um próximo valor e `false` caso os valores tenham
+ *         acabado ou em caso de erro.
+ */
+bool str_btree_values_next(StrBTreeValues *values);
+
+/**
+ * Prepara um cursor antes do primeiro par da btree, descendo pelo primeiro
+ * filho de cada nó até a folha mais à esquerda.
+ *
+ * @param btree - a btree a ser percorrida, que precisa ter um arquivo
+ *                vinculado.
+ * @param cursor - o cursor a ser preparado.
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool str_btree_cursor_first(StrBTreeMap *btree, StrBTreeCursor *cursor);
+
+/**
+ * Avança para o próximo par, cuja chave e valor são colocados no cursor.
+ *
+ * @param cursor - o cursor, preparado por `str_btree_cursor_first`.
+ * @return `true` caso haja um próximo par e `false` caso os pares tenham
+ *         acabado ou em caso de erro.
+ */
+bool str_btree_cursor_next(StrBTreeCursor *cursor);
+
+/**
+ * Calcula as estatísticas da estrutura da `btree`. Todas as páginas são lidas.
+ *
+ * @param btree - a btree a ser consultada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param stats - referência mutável para onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_stats(StrBTreeMap *btree, StrBTreeStats *stats);
+
+/**
+ * Verifica se a `btree` possui algum erro registrado.
+ *
+ * @param btree - a btree a ser verificada.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool str_btree_has_error(StrBTreeMap *btree);
+
+/**
+ * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param btree - a btree com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *str_btree_get_error(StrBTreeMap *btree);
+
+#endif
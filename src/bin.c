@@ -3,6 +3,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <common.h>
 #include <bin.h>
@@ -246,6 +249,430 @@ bool write_bus_line_register(const DBBusLineRegister *line, FILE *fp) {
 }
 
 
+/* Leitura de registros em memória */
+
+// Bytes ocupados pelos campos do início de todo registro: `removido` e
+// `tamanhoRegistro`.
+#define REGISTER_PREFIX_SZ 5
+
+// Registros de até esse tamanho são lidos num buffer na pilha, sem alocação.
+#define READ_BUFFER_SZ 512
+
+// Tamanho inicial do buffer de um `RecordScan`.
+#define SCAN_BUFFER_SZ (64 * 1024)
+
+// Leitor dos campos de um registro em memória, que nunca lê além de `end`.
+typedef struct {
+    const uint8_t *ptr;
+    const uint8_t *end;
+} FieldReader;
+
+static inline bool take(FieldReader *r, void *dst, size_t size) {
+    if ((size_t)(r->end - r->ptr) < size) return false;
+    memcpy(dst, r->ptr, size);
+    r->ptr += size;
+    return true;
+}
+
+// Aponta `dst` para os próximos `size` bytes, sem copiá-los.
+static inline bool take_ptr(FieldReader *r, size_t size, const char **dst) {
+    if ((size_t)(r->end - r->ptr) < size) return false;
+    *dst = (const char *)r->ptr;
+    r->ptr += size;
+    return true;
+}
+
+// Lê o tamanho de uma string e aponta `dst` para os bytes dela.
+static inline bool take_slice(FieldReader *r, StrSlice *dst) {
+    return take(r, &dst->len, sizeof(uint32_t)) && take_ptr(r, dst->len, &dst->ptr);
+}
+
+// Copia uma fatia para uma nova string terminada em '\0'. Uma string vazia é
+// representada por NULL, assim como nas funções `read`.
+static char *slice_dup(StrSlice slice) {
+    if (slice.len == 0) return NULL;
+
+    char *str = malloc(slice.len + 1);
+    memcpy(str, slice.ptr, slice.len);
+    str[slice.len] = '\0';
+    return str;
+}
+
+// Lê os campos de um veículo que vêm depois de `tamanhoRegistro`, guardados em
+// `body`, sem copiar as strings. Os campos depois de `upto` não são lidos.
+static bool parse_vehicle_view(const uint8_t *body, uint32_t size, DBVehicleView *view, VehicleFieldId upto) {
+    FieldReader r = { body, body + size };
+
+    return take_ptr(&r, sizeof(((DBVehicleRegister *)0)->prefixo), &view->prefixo)
+        && (upto < VEHICLE_FIELD_DATA               || take_ptr(&r, sizeof(((DBVehicleRegister *)0)->data), &view->data))
+        && (upto < VEHICLE_FIELD_QUANTIDADE_LUGARES || take(&r, &view->quantidadeLugares, sizeof(int32_t)))
+        && (upto < VEHICLE_FIELD_COD_LINHA          || take(&r, &view->codLinha, sizeof(uint32_t)))
+        && (upto < VEHICLE_FIELD_MODELO             || take_slice(&r, &view->modelo))
+        && (upto < VEHICLE_FIELD_CATEGORIA          || take_slice(&r, &view->categoria));
+}
+
+// Lê os campos de uma linha de ônibus que vêm depois de `tamanhoRegistro`,
+// guardados em `body`, sem copiar as strings. Os campos depois de `upto` não
+// são lidos.
+static bool parse_bus_line_view(const uint8_t *body, uint32_t size, DBBusLineView *view, BusLineFieldId upto) {
+    FieldReader r = { body, body + size };
+
+    return take(&r, &view->codLinha, sizeof(uint32_t))
+        && (upto < BUS_LINE_FIELD_ACEITA_CARTAO || take(&r, &view->aceitaCartao, sizeof(char)))
+        && (upto < BUS_LINE_FIELD_NOME_LINHA    || take_slice(&r, &view->nomeLinha))
+        && (upto < BUS_LINE_FIELD_COR_LINHA     || take_slice(&r, &view->corLinha));
+}
+
+// Copia uma visão de veículo para um registro que não depende do buffer da
+// visão. As strings são alocadas e devem ser liberadas com `vehicle_drop`.
+void vehicle_view_materialize(const DBVehicleView *view, DBVehicleRegister *reg) {
+    reg->removido          = view->removido;
+    reg->tamanhoRegistro   = view->tamanhoRegistro;
+    reg->quantidadeLugares = view->quantidadeLugares;
+    reg->codLinha          = view->codLinha;
+    reg->tamanhoModelo     = view->modelo.len;
+    reg->modelo            = slice_dup(view->modelo);
+    reg->tamanhoCategoria  = view->categoria.len;
+    reg->categoria         = slice_dup(view->categoria);
+
+    memcpy(reg->prefixo, view->prefixo, sizeof(reg->prefixo));
+    memcpy(reg->data   , view->data   , sizeof(reg->data));
+}
+
+// Copia uma visão de linha de ônibus para um registro que não depende do buffer
+// da visão. As strings são alocadas e devem ser liberadas com `bus_line_drop`.
+void bus_line_view_materialize(const DBBusLineView *view, DBBusLineRegister *reg) {
+    reg->removido        = view->removido;
+    reg->tamanhoRegistro = view->tamanhoRegistro;
+    reg->codLinha        = view->codLinha;
+    reg->aceitaCartao    = view->aceitaCartao;
+    reg->tamanhoNome     = view->nomeLinha.len;
+    reg->nomeLinha       = slice_dup(view->nomeLinha);
+    reg->tamanhoCor      = view->corLinha.len;
+    reg->corLinha        = slice_dup(view->corLinha);
+}
+
+// Visão de um registro já lido, cujas strings apontam para as do registro.
+static DBVehicleView vehicle_view_of(const DBVehicleRegister *reg) {
+    return (DBVehicleView) {
+        .removido          = reg->removido,
+        .tamanhoRegistro   = reg->tamanhoRegistro,
+        .prefixo           = reg->prefixo,
+        .data              = reg->data,
+        .quantidadeLugares = reg->quantidadeLugares,
+        .codLinha          = reg->codLinha,
+        .modelo            = { reg->modelo, reg->tamanhoModelo },
+        .categoria         = { reg->categoria, reg->tamanhoCategoria },
+    };
+}
+
+static DBBusLineView bus_line_view_of(const DBBusLineRegister *reg) {
+    return (DBBusLineView) {
+        .removido        = reg->removido,
+        .tamanhoRegistro = reg->tamanhoRegistro,
+        .codLinha        = reg->codLinha,
+        .aceitaCartao    = reg->aceitaCartao,
+        .nomeLinha       = { reg->nomeLinha, reg->tamanhoNome },
+        .corLinha        = { reg->corLinha, reg->tamanhoCor },
+    };
+}
+
+// Lê `removido` e `tamanhoRegistro` de um registro e, com uma única chamada a
+// `fread`, o restante dele. Retorna o buffer com o restante do registro, que é
+// `local` quando ele cabe em `READ_BUFFER_SZ` bytes e caso contrário precisa
+// ser liberado, ou NULL em caso de erro.
+static uint8_t *read_register(FILE *fp, char *removido, uint32_t *size, uint8_t *local) {
+    uint8_t prefix[REGISTER_PREFIX_SZ];
+    if (fread(prefix, REGISTER_PREFIX_SZ, 1, fp) != 1) return NULL;
+
+    memcpy(removido, prefix, sizeof(char));
+    memcpy(size, prefix + sizeof(char), sizeof(uint32_t));
+
+    uint8_t *body = *size <= READ_BUFFER_SZ ? local : malloc(*size);
+    if (!body) return NULL;
+
+    if (*size > 0 && fread(body, *size, 1, fp) != 1) {
+        if (body != local) free(body);
+        return NULL;
+    }
+
+    return body;
+}
+
+/* Leitura sequencial */
+
+/*
+* Cria um leitor sequencial que lê o arquivo em blocos com `fread`, começando na
+* posição atual do arquivo, normalmente logo após o cabeçalho.
+* @param fp - ponteiro do arquivo binário
+* @returns - o leitor, que deve ser liberado com `scan_drop`.
+*/
+RecordScan scan_new(FILE *fp) {
+    return (RecordScan) {
+        .fp     = fp,
+        .mapped = false,
+        .buf    = malloc(SCAN_BUFFER_SZ),
+        .cap    = SCAN_BUFFER_SZ,
+        .pos    = 0,
+        .len    = 0,
+        .start  = ftell(fp),
+        .skip_removed = false,
+        .current      = NULL,
+    };
+}
+
+/*
+* Cria um leitor sequencial que mapeia o arquivo inteiro em memória e percorre
+* os registros pelo `tamanhoRegistro`, sem passar pelo `stdio`. Começa na
+* posição atual do arquivo, assim como `scan_new`, que é usado caso o arquivo
+* não possa ser mapeado.
+* @param fp - ponteiro do arquivo binário, aberto somente para leitura
+* @returns - o leitor, que deve ser liberado com `scan_drop`.
+*/
+RecordScan scan_map(FILE *fp) {
+    size_t start = ftell(fp);
+
+    struct stat st;
+    if (fstat(fileno(fp), &st) < 0 || st.st_size <= 0)
+        return scan_new(fp);
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (map == MAP_FAILED)
+        return scan_new(fp);
+
+    // Os registros são lidos em ordem, então o kernel pode ler as próximas
+    // páginas antecipadamente e descartar as já lidas.
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    return (RecordScan) {
+        .fp     = fp,
+        .mapped = true,
+        .buf    = map,
+        .cap    = st.st_size,
+        .pos    = start,
+        .len    = st.st_size,
+        .start  = start,
+        .skip_removed = false,
+        .current      = NULL,
+    };
+}
+
+// Volta o leitor para o primeiro registro, onde ele foi criado.
+void scan_rewind(RecordScan *scan) {
+    if (scan->mapped) {
+        scan->pos = scan->start;
+        return;
+    }
+
+    fseek(scan->fp, scan->start, SEEK_SET);
+    scan->pos = 0;
+    scan->len = 0;
+}
+
+// Libera o buffer ou o mapeamento do leitor. O arquivo não é fechado.
+void scan_drop(RecordScan scan) {
+    if (scan.mapped) munmap(scan.buf, scan.cap);
+    else free(scan.buf);
+}
+
+// Garante que o buffer tem ao menos `size` bytes a partir de `pos`, lendo o
+// próximo bloco do arquivo caso necessário. O que ainda não foi consumido é
+// movido para o início do buffer, que cresce caso um registro não caiba nele.
+// Um arquivo mapeado já está inteiro no buffer.
+static bool scan_fill(RecordScan *scan, size_t size) {
+    if (scan->len - scan->pos >= size) return true;
+    if (scan->mapped) return false;
+
+    size_t rest = scan->len - scan->pos;
+    memmove(scan->buf, scan->buf + scan->pos, rest);
+    scan->pos = 0;
+    scan->len = rest;
+
+    if (size > scan->cap) {
+        uint8_t *buf = realloc(scan->buf, size);
+        if (!buf) return false;
+
+        scan->buf = buf;
+        scan->cap = size;
+    }
+
+    scan->len += fread(scan->buf + rest, 1, scan->cap - rest, scan->fp);
+    return scan->len >= size;
+}
+
+// Descarta os próximos `size` bytes. O que não está no buffer é pulado com
+// `fseek`, sem ser lido.
+static bool scan_skip(RecordScan *scan, size_t size) {
+    size_t rest = scan->len - scan->pos;
+    if (rest >= size) {
+        scan->pos += size;
+        return true;
+    }
+    if (scan->mapped) return false;
+
+    scan->pos = 0;
+    scan->len = 0;
+    return fseek(scan->fp, size - rest, SEEK_CUR) == 0;
+}
+
+// Avança para o próximo registro e retorna o seu conteúdo depois de
+// `tamanhoRegistro`, dentro do buffer, ou NULL caso ele não possa ser lido.
+// Com `skip_removed`, os registros removidos são pulados só pelo prefixo.
+static const uint8_t *scan_next(RecordScan *scan, char *removido, uint32_t *size) {
+    while (true) {
+        if (!scan_fill(scan, REGISTER_PREFIX_SZ)) return NULL;
+
+        memcpy(removido, scan->buf + scan->pos, sizeof(char));
+        memcpy(size, scan->buf + scan->pos + sizeof(char), sizeof(uint32_t));
+
+        if (!scan->skip_removed || *removido != '0') break;
+        if (!scan_skip(scan, (size_t)REGISTER_PREFIX_SZ + *size)) return NULL;
+    }
+
+    if (!scan_fill(scan, (size_t)REGISTER_PREFIX_SZ + *size)) return NULL;
+
+    scan->current = scan->buf + scan->pos + REGISTER_PREFIX_SZ;
+    scan->pos += REGISTER_PREFIX_SZ + *size;
+    return scan->current;
+}
+
+/*
+* Avança para o próximo registro de veículo, incluindo os removidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_vehicle(RecordScan *scan, DBVehicleView *view) {
+    return scan_vehicle_fields(scan, view, VEHICLE_FIELD_CATEGORIA);
+}
+
+/*
+* Avança para o próximo registro de veículo decodificando somente os campos até
+* `upto`. Os demais campos da visão não são preenchidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @param upto - o último campo a ser decodificado
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_vehicle_fields(RecordScan *scan, DBVehicleView *view, VehicleFieldId upto) {
+    const uint8_t *body = scan_next(scan, &view->removido, &view->tamanhoRegistro);
+    return body && parse_vehicle_view(body, view->tamanhoRegistro, view, upto);
+}
+
+/*
+* Decodifica todos os campos do registro de veículo atual, lido por
+* `scan_vehicle_fields`.
+* @param scan - o leitor
+* @param view - a visão do registro atual
+* @returns - 'true' se o registro for decodificado 'false' se ele estiver
+*            incompleto.
+*/
+bool scan_vehicle_complete(const RecordScan *scan, DBVehicleView *view) {
+    return parse_vehicle_view(scan->current, view->tamanhoRegistro, view, VEHICLE_FIELD_CATEGORIA);
+}
+
+/*
+* Avança para o próximo registro de linha de ônibus, incluindo os removidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_bus_line(RecordScan *scan, DBBusLineView *view) {
+    return scan_bus_line_fields(scan, view, BUS_LINE_FIELD_COR_LINHA);
+}
+
+/*
+* Avança para o próximo registro de linha de ônibus decodificando somente os
+* campos até `upto`. Os demais campos da visão não são preenchidos.
+* @param scan - o leitor
+* @param view - onde a visão do registro é colocada, válida até a próxima
+*               chamada
+* @param upto - o último campo a ser decodificado
+* @returns - 'true' se um registro for lido 'false' caso o arquivo tenha
+*            acabado ou em caso de erro.
+*/
+bool scan_bus_line_fields(RecordScan *scan, DBBusLineView *view, BusLineFieldId upto) {
+    const uint8_t *body = scan_next(scan, &view->removido, &view->tamanhoRegistro);
+    return body && parse_bus_line_view(body, view->tamanhoRegistro, view, upto);
+}
+
+/*
+* Decodifica todos os campos do registro de linha de ônibus atual, lido por
+* `scan_bus_line_fields`.
+* @param scan - o leitor
+* @param view - a visão do registro atual
+* @returns - 'true' se o registro for decodificado 'false' se ele estiver
+*            incompleto.
+*/
+bool scan_bus_line_complete(const RecordScan *scan, DBBusLineView *view) {
+    return parse_bus_line_view(scan->current, view->tamanhoRegistro, view, BUS_LINE_FIELD_COR_LINHA);
+}
+
+/*
+* Codifica um registro de linha de ônibus num buffer, no mesmo formato em que
+* ele é escrito no arquivo binário.
+* @param line - struct do tipo DBBusLineRegister
+* @param buf - buffer onde o registro é escrito
+* @param capacity - tamanho de `buf`
+* @returns - o número de bytes escritos em `buf`, ou 0 caso o registro não caiba
+*            nele.
+*/
+uint32_t encode_bus_line_register(const DBBusLineRegister *line, uint8_t *buf, uint32_t capacity) {
+    uint32_t tamanhoNome = line->nomeLinha ? strlen(line->nomeLinha) : 0;
+    uint32_t tamanhoCor  = line->corLinha ? strlen(line->corLinha) : 0;
+    uint32_t tamanhoRegistro = sizeof(line->codLinha) + sizeof(line->aceitaCartao)
+                             + sizeof(tamanhoNome) + tamanhoNome
+                             + sizeof(tamanhoCor) + tamanhoCor;
+
+    // O registro inteiro inclui `removido` e `tamanhoRegistro`.
+    if (tamanhoRegistro + sizeof(char) + sizeof(uint32_t) > capacity) return 0;
+
+    uint8_t *ptr = buf;
+    memcpy(ptr, &line->removido    , sizeof(char))    ; ptr += sizeof(char);
+    memcpy(ptr, &tamanhoRegistro   , sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    memcpy(ptr, &line->codLinha    , sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    memcpy(ptr, &line->aceitaCartao, sizeof(char))    ; ptr += sizeof(char);
+    memcpy(ptr, &tamanhoNome       , sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    if (tamanhoNome > 0) memcpy(ptr, line->nomeLinha, tamanhoNome);
+    ptr += tamanhoNome;
+    memcpy(ptr, &tamanhoCor        , sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    if (tamanhoCor > 0) memcpy(ptr, line->corLinha, tamanhoCor);
+    ptr += tamanhoCor;
+
+    return ptr - buf;
+}
+
+/*
+* Decodifica um registro de linha de ônibus codificado por
+* `encode_bus_line_register`. As strings são alocadas como em
+* `read_bus_line_register` e devem ser liberadas com `bus_line_drop`.
+* @param buf - buffer com o registro
+* @param len - tamanho do buffer
+* @param reg - ponteiro de DBBusLineRegister
+* @returns - 'true' se for decodificado com sucesso 'false' se o buffer não
+*            contém um registro completo.
+*/
+bool decode_bus_line_register(const uint8_t *buf, uint32_t len, DBBusLineRegister *reg) {
+    if (len < REGISTER_PREFIX_SZ) return false;
+
+    DBBusLineView view;
+    memcpy(&view.removido       , buf                , sizeof(char));
+    memcpy(&view.tamanhoRegistro, buf + sizeof(char), sizeof(uint32_t));
+
+    if (view.tamanhoRegistro != len - REGISTER_PREFIX_SZ) return false;
+    if (!parse_bus_line_view(buf + REGISTER_PREFIX_SZ, view.tamanhoRegistro, &view, BUS_LINE_FIELD_COR_LINHA)) return false;
+
+    bus_line_view_materialize(&view, reg);
+    return true;
+}
+
+
 // Lê os metadados dos arquivos binários
 bool read_meta(FILE *fp, DBMeta *meta){
     ASSERT(fread(&meta->status, 1, 1, fp));
@@ -279,14 +706,15 @@ bool read_header_bus_line(FILE *fp, DBBusLineHeader *header){
 }
 
 // Imprime a data de entrada de um veículo na frota no formato 'DD de texto(MM) de AAAA'
-static void print_date(const char (*date)[10], FILE *out, const char (*print)[35]) {
+static void print_date(const char *date, FILE *out, const char (*print)[35]) {
     const char *months[12] = { "janeiro", "fevereiro", "março", "abril", "maio",
                                "junho", "julho", "agosto", "setembro", "outubro",
                                "novembro", "dezembro" };
 
     // Copia `date` para garantir `const` ao parâmetro ao usar `strsep`.
-    char date_cpy[10];
-    memcpy(date_cpy, *date, sizeof(*date));
+    char date_cpy[11];
+    memcpy(date_cpy, date, 10);
+    date_cpy[10] = '\0';
 
     char *parse_ptr = date_cpy;
     char *year = strsep(&parse_ptr, "-");
@@ -295,45 +723,45 @@ static void print_date(const char (*date)[10], FILE *out, const char (*print)[35
     fprintf(out, "%.35s: %.2s de %s de %s\n", *print, day, months[atoi(month)-1], year);
 }
 
-// Imprime as informações de busca do arquivo binário de veículo
-void print_vehicle(FILE *out, const DBVehicleRegister *reg, const DBVehicleHeader *header){
-    fprintf(out, "%.18s: %.5s\n", header->descrevePrefixo, reg->prefixo);
+// Mesmo que `print_vehicle` para uma visão.
+void print_vehicle_view(FILE *out, const DBVehicleView *view, const DBVehicleHeader *header){
+    fprintf(out, "%.18s: %.5s\n", header->descrevePrefixo, view->prefixo);
 
-    if(reg->tamanhoModelo != 0)
-        fprintf(out, "%.17s: %s\n", header->descreveModelo, reg->modelo);
+    if(view->modelo.len != 0)
+        fprintf(out, "%.17s: %.*s\n", header->descreveModelo, (int)view->modelo.len, view->modelo.ptr);
     else
         fprintf(out, "%.17s: %s\n", header->descreveModelo, NO_VALUE);
 
-    if(reg->tamanhoCategoria != 0)
-        fprintf(out, "%.20s: %s\n", header->descreveCategoria, reg->categoria);
+    if(view->categoria.len != 0)
+        fprintf(out, "%.20s: %.*s\n", header->descreveCategoria, (int)view->categoria.len, view->categoria.ptr);
     else
         fprintf(out, "%.20s: %s\n", header->descreveCategoria, NO_VALUE);
 
-    if(strlen(reg->data) != 0)
-        print_date(&reg->data, out, &header->descreveData);
+    if(view->data[0] != '\0')
+        print_date(view->data, out, &header->descreveData);
     else
         fprintf(out, "%.35s: %s\n", header->descreveData, NO_VALUE);
 
-    if(reg->quantidadeLugares != -1)
-        fprintf(out, "%.42s: %d\n", header->descreveLugares, reg->quantidadeLugares);
+    if(view->quantidadeLugares != -1)
+        fprintf(out, "%.42s: %d\n", header->descreveLugares, view->quantidadeLugares);
     else
         fprintf(out, "%.42s: %s\n", header->descreveLugares, NO_VALUE);
 }
 
-// Imprime as informações de busca do arquivo binário das linhas de ônibus
-void print_bus_line(FILE *out, const DBBusLineRegister *reg, const DBBusLineHeader *header){
-    fprintf(out, "%.15s: %d\n", header->descreveCodigo, reg->codLinha);
-    if(reg->tamanhoNome != 0)
-        fprintf(out, "%.13s: %s\n", header->descreveNome, reg->nomeLinha);
+// Mesmo que `print_bus_line` para uma visão.
+void print_bus_line_view(FILE *out, const DBBusLineView *view, const DBBusLineHeader *header){
+    fprintf(out, "%.15s: %d\n", header->descreveCodigo, view->codLinha);
+    if(view->nomeLinha.len != 0)
+        fprintf(out, "%.13s: %.*s\n", header->descreveNome, (int)view->nomeLinha.len, view->nomeLinha.ptr);
     else
         fprintf(out, "%.13s: %s\n", header->descreveNome, NO_VALUE);
 
-    if(reg->tamanhoCor != 0)
-        fprintf(out, "%.24s: %s\n", header->descreveCor, reg->corLinha);
+    if(view->corLinha.len != 0)
+        fprintf(out, "%.24s: %.*s\n", header->descreveCor, (int)view->corLinha.len, view->corLinha.ptr);
     else
         fprintf(out, "%.24s: %s\n", header->descreveCor, NO_VALUE);
 
-    switch(reg->aceitaCartao){
+    switch(view->aceitaCartao){
         case 'S':
             fprintf(out, "%.13s: %s\n", header->descreveCartao, YES);
             break;
@@ -349,6 +777,18 @@ void print_bus_line(FILE *out, const DBBusLineRegister *reg, const DBBusLineHead
     }
 }
 
+// Imprime as informações de busca do arquivo binário de veículo
+void print_vehicle(FILE *out, const DBVehicleRegister *reg, const DBVehicleHeader *header){
+    DBVehicleView view = vehicle_view_of(reg);
+    print_vehicle_view(out, &view, header);
+}
+
+// Imprime as informações de busca do arquivo binário das linhas de ônibus
+void print_bus_line(FILE *out, const DBBusLineRegister *reg, const DBBusLineHeader *header){
+    DBBusLineView view = bus_line_view_of(reg);
+    print_bus_line_view(out, &view, header);
+}
+
 // Desaloca a memória alocada para as strings categoria e modelo dos veículos
 void vehicle_drop(DBVehicleRegister v){
     if (v.categoria) free(v.categoria);
@@ -368,33 +808,18 @@ void bus_line_drop(DBBusLineRegister b){
  * @return 'true' se for lido com sucesso 'false' se houver algum erro
 */ 
 bool read_vehicle_register(FILE *fp, DBVehicleRegister *reg) {
-    ASSERT(fread(&reg->removido, 1, 1, fp));
-    ASSERT(fread(&reg->tamanhoRegistro, 4, 1, fp));
-    ASSERT(fread(&reg->prefixo, 5, 1, fp));
-    ASSERT(fread(&reg->data, 10, 1, fp));
-    ASSERT(fread(&reg->quantidadeLugares, 4, 1, fp));
-    ASSERT(fread(&reg->codLinha, 4, 1, fp));
-    ASSERT(fread(&reg->tamanhoModelo, 4, 1, fp));
-
-    reg->modelo = NULL;
-
-    if (reg->tamanhoModelo > 0) {
-        reg->modelo = (char *)malloc((reg->tamanhoModelo + 1) * sizeof(char));
-        ASSERT(fread(reg->modelo, reg->tamanhoModelo, 1, fp));
-        reg->modelo[reg->tamanhoModelo] = '\0';
-    }
-
-    ASSERT(fread(&reg->tamanhoCategoria, 4, 1, fp));
-
-    reg->categoria = NULL;
-
-    if (reg->tamanhoCategoria > 0) {
-        reg->categoria = (char *)malloc((reg->tamanhoCategoria + 1) * sizeof(char));
-        ASSERT(fread(reg->categoria, reg->tamanhoCategoria, 1, fp));
-        reg->categoria[reg->tamanhoCategoria] = '\0';
-    }
-
-    return true;
+    // O registro é lido com duas chamadas a `fread` e os campos são separados
+    // em memória. Nada é escrito em `reg` caso o arquivo já tenha acabado.
+    uint8_t local[READ_BUFFER_SZ];
+    DBVehicleView view;
+    uint8_t *body = read_register(fp, &view.removido, &view.tamanhoRegistro, local);
+    if (!body) return false;
+
+    bool ok = parse_vehicle_view(body, view.tamanhoRegistro, &view, VEHICLE_FIELD_CATEGORIA);
+    if (ok) vehicle_view_materialize(&view, reg);
+
+    if (body != local) free(body);
+    return ok;
 }
 
 /*
@@ -404,81 +829,150 @@ bool read_vehicle_register(FILE *fp, DBVehicleRegister *reg) {
  * @return 'true' se for lido com sucesso 'false' se houver algum erro
 */
 bool read_bus_line_register(FILE *fp, DBBusLineRegister *reg){
-    ASSERT(fread(&reg->removido, 1, 1, fp));
-    ASSERT(fread(&reg->tamanhoRegistro, 4, 1, fp));
-    ASSERT(fread(&reg->codLinha, 4, 1, fp));
-    ASSERT(fread(&reg->aceitaCartao, 1, 1, fp));
-    ASSERT(fread(&reg->tamanhoNome, 4, 1, fp));
-
-    reg->nomeLinha = NULL;
-
-    if (reg->tamanhoNome > 0) {
-        reg->nomeLinha = (char *)malloc((reg->tamanhoNome + 1) * sizeof(char));
-        ASSERT(fread(reg->nomeLinha, reg->tamanhoNome, 1, fp));
-        reg->nomeLinha[reg->tamanhoNome] = '\0';
+    // O registro é lido com duas chamadas a `fread` e os campos são separados
+    // em memória. Nada é escrito em `reg` caso o arquivo já tenha acabado.
+    uint8_t local[READ_BUFFER_SZ];
+    DBBusLineView view;
+    uint8_t *body = read_register(fp, &view.removido, &view.tamanhoRegistro, local);
+    if (!body) return false;
+
+    bool ok = parse_bus_line_view(body, view.tamanhoRegistro, &view, BUS_LINE_FIELD_COR_LINHA);
+    if (ok) bus_line_view_materialize(&view, reg);
+
+    if (body != local) free(body);
+    return ok;
+}
+
+// Compara uma fatia com uma string terminada em '\0'.
+static bool slice_equals(StrSlice slice, const char *str) {
+    return strlen(str) == slice.len && memcmp(slice.ptr, str, slice.len) == 0;
+}
+
+// Verifica se uma string terminada em '\0' aparece em algum ponto da fatia.
+static bool slice_contains(StrSlice slice, const char *str) {
+    size_t len = strlen(str);
+    for (size_t i = 0; i + len <= slice.len; i++) {
+        if (memcmp(slice.ptr + i, str, len) == 0) return true;
     }
+    return false;
+}
 
-    ASSERT(fread(&reg->tamanhoCor, 4, 1, fp));
+// Fatia de um campo de tamanho fixo, que termina no primeiro '\0' caso haja
+// algum.
+static StrSlice fixed_slice(const char *field, uint32_t size) {
+    return (StrSlice) { field, strnlen(field, size) };
+}
 
-    reg->corLinha = NULL;
+/* Predicados de busca */
 
-    if (reg->tamanhoCor > 0) {
-        reg->corLinha = malloc(reg->tamanhoCor + 1);
-        ASSERT(fread(reg->corLinha, reg->tamanhoCor, 1, fp));
-        reg->corLinha[reg->tamanhoCor] = '\0';
-    }
+// Funções de comparação de cada campo, escolhidas uma única vez por
+// `compile_vehicle_predicate` e `compile_bus_line_predicate`.
 
-    return true;
+// Como no `strstr` original, o prefixo só precisa conter o valor buscado.
+static bool match_prefixo(const VehiclePredicate *pred, const DBVehicleView *view) {
+    return slice_contains(fixed_slice(view->prefixo, 5), pred->text);
+}
+
+static bool match_data(const VehiclePredicate *pred, const DBVehicleView *view) {
+    return slice_equals(fixed_slice(view->data, 10), pred->text);
+}
+
+static bool match_quantidade_lugares(const VehiclePredicate *pred, const DBVehicleView *view) {
+    return view->quantidadeLugares == pred->number;
+}
+
+static bool match_modelo(const VehiclePredicate *pred, const DBVehicleView *view) {
+    return slice_equals(view->modelo, pred->text);
+}
+
+static bool match_categoria(const VehiclePredicate *pred, const DBVehicleView *view) {
+    return slice_equals(view->categoria, pred->text);
+}
+
+static bool match_cod_linha(const BusLinePredicate *pred, const DBBusLineView *view) {
+    return view->codLinha == pred->number;
+}
+
+static bool match_aceita_cartao(const BusLinePredicate *pred, const DBBusLineView *view) {
+    return view->aceitaCartao == pred->number;
+}
+
+static bool match_nome_linha(const BusLinePredicate *pred, const DBBusLineView *view) {
+    return slice_equals(view->nomeLinha, pred->text);
+}
+
+static bool match_cor_linha(const BusLinePredicate *pred, const DBBusLineView *view) {
+    return slice_equals(view->corLinha, pred->text);
 }
 
 /*
- * Verifica se o atual registro satisfaz as condições de busca
- * @param reg - ponteiro que contém as informações do registro de veículos
- * @param field - string que contém o campo a ser buscado
- * @param equals - string que contém o valor a ser comparado
- * @return 'true' se o valor do campo do registro buscado equivale ao valor de busca 'false' se não equivaler
- * 
- * Exibe uma mensagem de erro caso algo inesperado ocorra e termina o programa
+ * Compila a condição de busca `field = equals` sobre registros de veículos
+ * @param field - nome do campo a ser buscado
+ * @param equals - valor do campo, que precisa continuar válido enquanto o predicado for usado
+ * @param pred - onde o predicado é colocado
+ * @return 'true' se o predicado for compilado 'false' se o campo não existir
 */
-bool check_vehicle_field_equals(const DBVehicleRegister *reg, const char *field, const char *equals){
-    if(strcmp(field, "prefixo") == 0)
-        return strstr(reg->prefixo, equals) != NULL;
-    else if(strcmp(field, "data") == 0)
-        return strcmp(equals, reg->data) == 0;
-    else if(strcmp(field, "quantidadeLugares") == 0)
-        return reg->quantidadeLugares == (int)strtol(equals, NULL, 10);
-    else if(strcmp(field, "modelo") == 0)
-        return strcmp(equals, reg->modelo) == 0;
-    else if(strcmp(field, "categoria") == 0)
-        return strcmp(equals, reg->categoria) == 0;
-
-    // Nunca deveria acontecer
-    fprintf(stderr, "Erro: Invalid field.");
-    exit(0);
+bool compile_vehicle_predicate(const char *field, const char *equals, VehiclePredicate *pred) {
+    pred->text   = equals;
+    pred->number = 0;
+    pred->unique = false;
+
+    if (strcmp(field, "prefixo") == 0) {
+        pred->field  = VEHICLE_FIELD_PREFIXO;
+        pred->match  = match_prefixo;
+        pred->unique = true;
+    } else if (strcmp(field, "data") == 0) {
+        pred->field  = VEHICLE_FIELD_DATA;
+        pred->match  = match_data;
+    } else if (strcmp(field, "quantidadeLugares") == 0) {
+        pred->field  = VEHICLE_FIELD_QUANTIDADE_LUGARES;
+        pred->match  = match_quantidade_lugares;
+        pred->number = (int)strtol(equals, NULL, 10);
+    } else if (strcmp(field, "modelo") == 0) {
+        pred->field  = VEHICLE_FIELD_MODELO;
+        pred->match  = match_modelo;
+    } else if (strcmp(field, "categoria") == 0) {
+        pred->field  = VEHICLE_FIELD_CATEGORIA;
+        pred->match  = match_categoria;
+    } else {
+        return false;
+    }
+
+    return true;
 }
 
 /*
- * Verifica se o atual registro satisfaz as condições de busca
- * @param reg - ponteiro que contém as informações do registro de veículos
- * @param field - string que contém o campo a ser buscado
- * @param equals - string que contém o valor a ser comparado
- * @return 'true' se o valor do campo do registro buscado equivale ao valor de busca 'false' se não equivaler
- * 
- * Exibe uma mensagem de erro caso algo inesperado ocorra e termina o programa
+ * Compila a condição de busca `field = equals` sobre registros de linhas de ônibus
+ * @param field - nome do campo a ser buscado
+ * @param equals - valor do campo, que precisa continuar válido enquanto o predicado for usado
+ * @param pred - onde o predicado é colocado
+ * @return 'true' se o predicado for compilado 'false' se o campo não existir
 */
-bool check_bus_line_field_equals(const DBBusLineRegister *reg, const char *field, const char *equals){
-    if(strcmp(field, "codLinha") == 0)
-        return reg->codLinha == (int)strtol(equals, NULL, 10);
-    else if(strcmp(field, "aceitaCartao") == 0)
-        return *equals == reg->aceitaCartao;
-    else if(strcmp(field, "nomeLinha") == 0)
-        return strcmp(equals, reg->nomeLinha) == 0;
-    else if(strcmp(field, "corLinha") == 0)
-        return strcmp(equals, reg->corLinha) == 0;
+bool compile_bus_line_predicate(const char *field, const char *equals, BusLinePredicate *pred) {
+    pred->text   = equals;
+    pred->number = 0;
+    pred->unique = false;
+
+    if (strcmp(field, "codLinha") == 0) {
+        pred->field  = BUS_LINE_FIELD_COD_LINHA;
+        pred->match  = match_cod_linha;
+        pred->number = (int)strtol(equals, NULL, 10);
+        pred->unique = true;
+    } else if (strcmp(field, "aceitaCartao") == 0) {
+        pred->field  = BUS_LINE_FIELD_ACEITA_CARTAO;
+        pred->match  = match_aceita_cartao;
+        pred->number = *equals;
+    } else if (strcmp(field, "nomeLinha") == 0) {
+        pred->field  = BUS_LINE_FIELD_NOME_LINHA;
+        pred->match  = match_nome_linha;
+    } else if (strcmp(field, "corLinha") == 0) {
+        pred->field  = BUS_LINE_FIELD_COR_LINHA;
+        pred->match  = match_cor_linha;
+    } else {
+        return false;
+    }
 
-    // Nunca deveria acontecer
-    fprintf(stderr, "Erro: Invalid field.");
-    exit(0);
+    return true;
 }
 
 // Verifica se o arquivo existe no diretório. Se sim, retorna true, se não, exibe a mensagem de erro correspondente e retorna false
@@ -504,25 +998,43 @@ bool select_from_vehicle_where(const char *from_file, const char *where_field, c
         return false;
     }
 
+    // A condição é compilada antes da leitura dos registros, de modo que um
+    // campo inexistente é rejeitado sem percorrer o arquivo.
+    VehiclePredicate pred;
+    bool filter = where_field != NULL && equals_to != NULL;
+
+    if (filter && !compile_vehicle_predicate(where_field, equals_to, &pred)) {
+        printf(ERROR_FOUND);
+        fclose(fp);
+        return false;
+    }
+
     bool print = (where_field == NULL);
-    bool is_unique_field = where_field && strcmp("prefixo", where_field) == 0;
-    DBVehicleRegister reg;
+    bool is_unique_field = filter && pred.unique;
+    // O arquivo é mapeado em memória e os registros são lidos como visões,
+    // sem alocar as strings. Numa busca, os removidos são pulados sem serem
+    // decodificados e, dos demais, só os campos até o comparado são lidos.
+    RecordScan scan = scan_map(fp);
+    scan.skip_removed = filter;
+    DBVehicleView view;
+    VehicleFieldId upto = filter ? pred.field : VEHICLE_FIELD_CATEGORIA;
 
     int n_matching = 0;
-    while (read_vehicle_register(fp, &reg)){
-        if(where_field != NULL && equals_to != NULL)
-            print = reg.removido == '1' && check_vehicle_field_equals(&reg, where_field, equals_to);
+    while (scan_vehicle_fields(&scan, &view, upto)){
+        if(filter)
+            print = pred.match(&pred, &view);
 
         if(print) {
-            print_vehicle(stdout, &reg, &header);
+            if(filter && !scan_vehicle_complete(&scan, &view)) break;
+
+            print_vehicle_view(stdout, &view, &header);
             fprintf(stdout, "\n");
             n_matching++;
         }
 
-        vehicle_drop(reg);
-
         if (is_unique_field && print) break;
     }
+    scan_drop(scan);
     fclose(fp);
 
     if (n_matching == 0) {
@@ -545,25 +1057,43 @@ bool select_from_bus_line_where(const char *from_file, const char *where_field,
         return false;
     }
 
+    // A condição é compilada antes da leitura dos registros, de modo que um
+    // campo inexistente é rejeitado sem percorrer o arquivo.
+    BusLinePredicate pred;
+    bool filter = where_field != NULL && equals_to != NULL;
+
+    if (filter && !compile_bus_line_predicate(where_field, equals_to, &pred)) {
+        printf(ERROR_FOUND);
+        fclose(fp);
+        return false;
+    }
+
     bool print = (where_field == NULL);
-    bool is_unique_field = where_field && strcmp("codLinha", where_field) == 0;
-    DBBusLineRegister reg;
+    bool is_unique_field = filter && pred.unique;
+    // O arquivo é mapeado em memória e os registros são lidos como visões,
+    // sem alocar as strings. Numa busca, os removidos são pulados sem serem
+    // decodificados e, dos demais, só os campos até o comparado são lidos.
+    RecordScan scan = scan_map(fp);
+    scan.skip_removed = filter;
+    DBBusLineView view;
+    BusLineFieldId upto = filter ? pred.field : BUS_LINE_FIELD_COR_LINHA;
 
     int n_matching = 0;
-    while (read_bus_line_register(fp, &reg)){
-        if (where_field != NULL && equals_to != NULL)
-            print = reg.removido == '1' && check_bus_line_field_equals(&reg, where_field, equals_to);
+    while (scan_bus_line_fields(&scan, &view, upto)){
+        if (filter)
+            print = pred.match(&pred, &view);
 
         if (print) {
-            print_bus_line(stdout, &reg, &header);
+            if (filter && !scan_bus_line_complete(&scan, &view)) break;
+
+            print_bus_line_view(stdout, &view, &header);
             fprintf(stdout, "\n");
             n_matching++;
         }
 
-        bus_line_drop(reg);
-
         if (is_unique_field && print) break;
     }
+    scan_drop(scan);
     fclose(fp);
 
     if (n_matching == 0) {
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <utils.h>
+#include <bloom.h>
+
+// Macro simples para prevenir repetição no código
+#define ASSERT(expr) \
+    if (!(expr)) return false
+
+// Maior tamanho de filtro aceito ao carregar um arquivo, para que um arquivo
+// corrompido não cause uma alocação enorme.
+#define MAX_BITS (UINT32_MAX - 7)
+
+/**
+ * Cria um filtro vazio, que responde que qualquer chave pode estar presente.
+ * Não envolve alocação.
+ *
+ * @return o filtro vazio.
+ */
+BloomFilter bloom_empty() {
+    return (BloomFilter) {
+        .n_bits   = 0,
+        .n_hashes = 0,
+        .bits     = NULL,
+    };
+}
+
+/**
+ * Cria um filtro sem nenhuma chave dimensionado para `capacity` chaves, ou
+ * `BLOOM_MIN_CAPACITY` caso seja menor.
+ *
+ * @param capacity - o número de chaves esperado.
+ * @return o filtro criado, que deve ser liberado com `bloom_drop`.
+ */
+BloomFilter bloom_with_capacity(size_t capacity) {
+    if (capacity < BLOOM_MIN_CAPACITY) capacity = BLOOM_MIN_CAPACITY;
+
+    uint64_t n_bits = (uint64_t)capacity * BLOOM_BITS_PER_KEY;
+    if (n_bits > MAX_BITS) n_bits = MAX_BITS;
+
+    return (BloomFilter) {
+        .n_bits   = n_bits,
+        .n_hashes = BLOOM_N_HASHES,
+        .bits     = (uint8_t *)calloc((n_bits + 7) / 8, sizeof(uint8_t)),
+    };
+}
+
+/**
+ * Libera o filtro.
+ *
+ * @param filter - o filtro a ser liberado.
+ */
+void bloom_drop(BloomFilter filter) {
+    if (filter.bits)
+        free(filter.bits);
+}
+
+// Espalha os bits da chave num hash de 64 bits (finalizador do splitmix64).
+static inline uint64_t hash_key(int32_t key) {
+    uint64_t h = (uint32_t)key;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+    return h ^ (h >> 31);
+}
+
+// Posição do bit da `i`-ésima função de hash de uma chave com hash `h`. As
+// funções são obtidas por hashing duplo, `h1 + i * h2`, onde `h1` e `h2` são as
+// duas metades de `h`. `h2` é ímpar para que as posições não se repitam tão
+// facilmente.
+static inline uint32_t bit_position(const BloomFilter *filter, uint64_t h, uint32_t i) {
+    uint32_t h1 = h;
+    uint32_t h2 = (h >> 32) | 1;
+    return (h1 + (uint64_t)i * h2) % filter->n_bits;
+}
+
+/**
+ * Adiciona uma chave ao filtro. Não tem efeito num filtro vazio.
+ *
+ * @param filter - o filtro a ser modificado.
+ * @param key - a chave a ser adicionada.
+ */
+void bloom_add(BloomFilter *filter, int32_t key) {
+    if (filter->n_bits == 0) return;
+
+    uint64_t h = hash_key(key);
+    for (uint32_t i = 0; i < filter->n_hashes; i++) {
+        uint32_t bit = bit_position(filter, h, i);
+        filter->bits[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+/**
+ * Verifica se uma chave pode estar presente no filtro.
+ *
+ * @param filter - o filtro a ser consultado.
+ * @param key - a chave de busca.
+ * @return `false` caso `key` certamente não tenha sido adicionada e `true`
+ *         caso contrário.
+ */
+bool bloom_may_contain(const BloomFilter *filter, int32_t key) {
+    if (filter->n_bits == 0) return true;
+
+    uint64_t h = hash_key(key);
+    for (uint32_t i = 0; i < filter->n_hashes; i++) {
+        uint32_t bit = bit_position(filter, h, i);
+        if (!(filter->bits[bit / 8] & (1 << (bit % 8)))) return false;
+    }
+    return true;
+}
+
+// Lê o conteúdo do arquivo para `filter`, que ainda não possui `bits`.
+static bool read_filter(FILE *fp, BloomFilter *filter) {
+    char status;
+    ASSERT(fread(&status, sizeof(char), 1, fp) == 1 && status == '1');
+    ASSERT(fread(&filter->n_bits  , sizeof(uint32_t), 1, fp) == 1);
+    ASSERT(fread(&filter->n_hashes, sizeof(uint32_t), 1, fp) == 1);
+    ASSERT(filter->n_bits > 0 && filter->n_bits <= MAX_BITS && filter->n_hashes > 0);
+
+    size_t n_bytes = (filter->n_bits + 7) / 8;
+    filter->bits = (uint8_t *)malloc(n_bytes);
+    return fread(filter->bits, sizeof(uint8_t), n_bytes, fp) == n_bytes;
+}
+
+// Nome do arquivo do filtro que acompanha o índice `index_fname`.
+static inline char *filter_fname(const char *index_fname) {
+    return alloc_sprintf("%s_bloom", index_fname);
+}
+
+/**
+ * Carrega o filtro que acompanha um índice, escrito por `bloom_save`.
+ *
+ * @param filter - referência mutável para onde o filtro é carregado.
+ * @param index_fname - nome do arquivo do índice. O filtro fica no arquivo de
+ *                      mesmo nome com o sufixo "_bloom".
+ * @return `true` em caso de sucesso e `false` caso o arquivo do filtro não
+ *         exista ou seja inválido. No segundo caso, `filter` é um filtro vazio.
+ */
+bool bloom_load(BloomFilter *filter, const char *index_fname) {
+    *filter = bloom_empty();
+
+    char *fname = filter_fname(index_fname);
+    FILE *fp = fopen(fname, "rb");
+    free(fname);
+
+    if (!fp) return false;
+
+    bool ok = read_filter(fp, filter);
+    fclose(fp);
+
+    if (!ok) {
+        bloom_drop(*filter);
+        *filter = bloom_empty();
+    }
+
+    return ok;
+}
+
+/**
+ * Escreve o filtro que acompanha um índice, substituindo o anterior.
+ *
+ * @param filter - o filtro a ser escrito, que não pode ser vazio.
+ * @param index_fname - nome do arquivo do índice. O filtro fica no arquivo de
+ *                      mesmo nome com o sufixo "_bloom".
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool bloom_save(const BloomFilter *filter, const char *index_fname) {
+    ASSERT(filter->n_bits > 0);
+
+    char *fname = filter_fname(index_fname);
+    FILE *fp = fopen(fname, "wb");
+    free(fname);
+
+    ASSERT(fp);
+
+    // O arquivo só é marcado como consistente depois de escrito por completo.
+    char status = '0';
+    size_t n_bytes = (filter->n_bits + 7) / 8;
+
+    bool ok = fwrite(&status          , sizeof(char)    , 1, fp) == 1
+           && fwrite(&filter->n_bits  , sizeof(uint32_t), 1, fp) == 1
+           && fwrite(&filter->n_hashes, sizeof(uint32_t), 1, fp) == 1
+           && fwrite(filter->bits     , sizeof(uint8_t) , n_bytes, fp) == n_bytes;
+
+    status = '1';
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&status, sizeof(char), 1, fp) == 1;
+
+    return fclose(fp) == 0 && ok;
+}
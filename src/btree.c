@@ -5,16 +5,53 @@
 #include <stdbool.h>
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include <utils.h>
 #include <btree.h>
 
-#define PAGE_SZ  ((uint64_t)77)
-#define ENTRY_SZ 12
+// Ordem do formato original, cujo header não possui os campos de tamanho de
+// página e ordem.
+#define LEGACY_ORDER    5
+
+// Bytes ocupados pelos campos do header: status, RRN da raiz, próximo RRN,
+// tamanho da página, ordem, RRN da primeira página livre, se a árvore aceita
+// chaves duplicadas, se as folhas são encadeadas e, com chaves duplicadas, a
+// página compartilhada atual das listas de valores.
+#define HEADER_SZ       27
+
+// Bytes ocupados pelos campos fixos de um nó: folha, tamanho, RRN e o RRN do
+// primeiro filho.
+#define NODE_HEADER_SZ  13
+
+// Bytes ocupados por cada entrada de um nó: chave, valor e RRN do filho à
+// direita.
+#define ENTRY_SZ        16
 
-// Para essa implementação em particular temos que assumir que `CAPACITY` é um
-// número ímpar.
-#define CAPACITY 5
+// Para essa implementação em particular temos que assumir que a ordem da
+// árvore é um número ímpar. Portanto, a ordem usada para um tamanho de página é
+// a maior ordem ímpar cujo nó ainda caiba na página.
+#define ORDER_FOR_PAGE(page_sz) ((((page_sz) - NODE_HEADER_SZ) / ENTRY_SZ) | 1)
+
+// A maior ordem possível, usada para dimensionar os nós em memória.
+#define MAX_ORDER ORDER_FOR_PAGE(BTREE_MAX_PAGE_SZ)
+
+// Valores do campo do header que indica se a árvore aceita chaves duplicadas.
+#define UNIQUE_KEYS     'U'
+#define DUPLICATE_KEYS  'D'
+
+// Valor do campo do header que indica que a árvore é uma árvore B+ com as
+// folhas encadeadas. Nas demais árvores o campo não é escrito.
+#define LINKED_LEAVES   'L'
 
 // Macro simples para prevenir repetição no código
 #define ASSERT(expr) \
@@ -35,19 +72,44 @@ typedef struct {
     bool     is_leaf;
     uint32_t len;
     uint32_t rrn;
-
-    // Apenas CAPACITY - 1 espaços serão realmente ocupados no campo `entries`.
-    // O espaço extra é pra podermos inserir uma `Entry` a mais de maneira
-    // ordenada e assim escolher facilmente `Entry` do meio para ser promovida.
-    // O mesmo vale para o campo `children`.
-    uint32_t children[CAPACITY + 1];
-    Entry    entries[CAPACITY];
+    // RRN da próxima folha ou -1 caso não haja. Só é usado nas folhas de uma
+    // árvore com folhas encadeadas, onde ocupa o lugar do primeiro filho.
+    int32_t  next;
+
+    // Apenas `order - 1` espaços serão realmente ocupados nos campos `keys` e
+    // `values`. O espaço extra é pra podermos inserir uma entrada a mais de
+    // maneira ordenada e assim escolher facilmente a entrada do meio para ser
+    // promovida. O mesmo vale para o campo `children`.
+    uint32_t children[MAX_ORDER + 1];
+    // As chaves ficam contíguas, separadas dos valores, para que a busca no nó
+    // compare várias chaves de uma vez (veja `key_position`).
+    int32_t  keys[MAX_ORDER];
+    uint64_t values[MAX_ORDER];
 } Node;
 
-// Mesmo que `error` mas funciona com argumentos variáveis
-static void verror(BTreeMap *btree, const char *format, va_list ap) {
-    if (btree->error_msg) free(btree->error_msg);
-    btree->error_msg = alloc_vsprintf(format, ap);
+// Lê a entrada na posição `at` de um nó.
+static inline Entry node_entry(const Node *node, int at) {
+    return (Entry){ .key = node->keys[at], .value = node->values[at] };
+}
+
+// Escreve uma entrada na posição `at` de um nó.
+static inline void set_node_entry(Node *node, int at, Entry entry) {
+    node->keys[at]   = entry.key;
+    node->values[at] = entry.value;
+}
+
+// Copia `n` entradas de `src` a partir da posição `from` para `dst` a partir
+// da posição `to`. Os dois intervalos podem se sobrepor.
+static inline void move_entries(Node *dst, int to, const Node *src, int from, int n) {
+    memmove(&dst->keys[to]  , &src->keys[from]  , n * sizeof( int32_t));
+    memmove(&dst->values[to], &src->values[from], n * sizeof(uint64_t));
+}
+
+// Mesmo que `error` mas funciona com argumentos variáveis e coloca a mensagem
+// em `*error_msg`.
+static void verror(char **error_msg, const char *format, va_list ap) {
+    if (*error_msg) free(*error_msg);
+    *error_msg = alloc_vsprintf(format, ap);
 }
 
 // Coloca uma determinada mensagem de erro na `btree`. O formato dos argumentos
@@ -55,83 +117,518 @@ static void verror(BTreeMap *btree, const char *format, va_list ap) {
 static void error(BTreeMap *btree, const char *format, ...) {
     va_list ap;
     va_start(ap, format);
-    verror(btree, format, ap);
+    verror(&btree->error_msg, format, ap);
+    va_end(ap);
+}
+
+// Mesmo que `error`, mas coloca a mensagem em `*error_msg`. Usado nas buscas
+// que podem ser feitas por leitores concorrentes, cada um com o seu próprio
+// estado de erro.
+static void error_to(char **error_msg, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    verror(error_msg, format, ap);
     va_end(ap);
 }
 
-// Garante que `fp` estará posicionado em determinado byte offset.
-static inline void position(FILE *fp, uint64_t offset) {
-    if (ftell(fp) != offset)
-        fseek(fp, offset, SEEK_SET);
+// Calcula o byte offset de uma página de acordo com o `rrn`. Vale notar que o
+// RRN 0 não se refere ao byte offset 0, já que a primeira página é o header.
+static inline off_t rrn_offset(BTreeMap *btree, uint32_t rrn) {
+    return (off_t)(btree->page_sz + btree->page_sz * (uint64_t)rrn);
+}
+
+// Copia `size` bytes de `src` para a posição `*ptr` de uma página e avança o
+// ponteiro.
+static inline void encode(uint8_t **ptr, const void *src, size_t size) {
+    memcpy(*ptr, src, size);
+    *ptr += size;
+}
+
+// Copia `size` bytes da posição `*ptr` de uma página para `dst` e avança o
+// ponteiro.
+static inline void decode(const uint8_t **ptr, void *dst, size_t size) {
+    memcpy(dst, *ptr, size);
+    *ptr += size;
+}
+
+// Lê uma página inteira do disco com uma única chamada de sistema.
+static bool read_page(BTreeMap *btree, off_t offset, uint8_t *page) {
+    return pread(btree->fd, page, btree->page_sz, offset) == btree->page_sz;
+}
+
+// Escreve uma página inteira no disco com uma única chamada de sistema.
+static bool write_page(BTreeMap *btree, off_t offset, const uint8_t *page) {
+    return pwrite(btree->fd, page, btree->page_sz, offset) == btree->page_sz;
+}
+
+/* Controle de concorrência */
+
+// Travas compartilhadas pela btree e por todos os seus leitores. `tree` é
+// mantida em modo compartilhado durante cada busca de um leitor e em modo
+// exclusivo durante cada modificação. `cache` protege a estrutura do cache de
+// páginas: os acertos só a tomam em modo compartilhado, e as faltas a tomam em
+// modo exclusivo apenas para ocupar um quadro, depois de ler a página.
+struct BTreeLatch {
+    pthread_rwlock_t tree;
+    pthread_rwlock_t cache;
+};
+
+static BTreeLatch *latch_new() {
+    BTreeLatch *latch = (BTreeLatch *)malloc(sizeof(BTreeLatch));
+    pthread_rwlock_init(&latch->tree, NULL);
+    pthread_rwlock_init(&latch->cache, NULL);
+    return latch;
+}
+
+static void latch_free(BTreeLatch *latch) {
+    pthread_rwlock_destroy(&latch->tree);
+    pthread_rwlock_destroy(&latch->cache);
+    free(latch);
+}
+
+// As funções abaixo não fazem nada enquanto não houver arquivo vinculado, já
+// que as travas só são criadas junto com o vínculo.
+
+static inline void latch_read(BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_rdlock(&btree->latch->tree);
+}
+
+static inline void latch_write(BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_wrlock(&btree->latch->tree);
+}
+
+static inline void latch_release(BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_unlock(&btree->latch->tree);
+}
+
+static inline void cache_lock(const BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_wrlock(&btree->latch->cache);
+}
+
+static inline void cache_lock_shared(const BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_rdlock(&btree->latch->cache);
+}
+
+static inline void cache_unlock(const BTreeMap *btree) {
+    if (btree->latch) pthread_rwlock_unlock(&btree->latch->cache);
+}
+
+/* Cache de páginas */
+
+// Marca o fim de uma lista de quadros.
+#define NO_FRAME -1
+
+// Um quadro do cache de páginas. Os quadros formam listas simplesmente
+// encadeadas para cada bucket da tabela hash que mapeia RRNs para quadros.
+typedef struct {
+    uint32_t rrn;
+    bool     dirty;
+    // Bit de referência do algoritmo CLOCK. É marcado a cada uso, inclusive
+    // pelos acertos que só têm a trava do cache em modo compartilhado, e
+    // limpo pelo ponteiro de despejo.
+    bool     referenced;
+    int32_t  hash_next;
+} Frame;
+
+struct BTreePageCache {
+    uint32_t page_sz;
+    uint32_t n_frames;
+    uint32_t n_used;
+    // Sempre uma potência de 2, para que o bucket seja `rrn & (n_buckets - 1)`.
+    uint32_t n_buckets;
+    int32_t  *buckets;
+    Frame    *frames;
+    // Os conteúdos das páginas, `page_sz` bytes para cada quadro.
+    uint8_t  *pages;
+    // O ponteiro de despejo, que percorre os quadros em círculo.
+    uint32_t hand;
+    BTreeCacheStats stats;
+};
+
+// Cria um cache que utiliza no máximo `budget` bytes para as páginas. Retorna
+// NULL caso não caiba nem mesmo uma página no orçamento.
+static BTreePageCache *cache_new(size_t budget, uint32_t page_sz) {
+    uint32_t n_frames = budget / page_sz;
+    if (n_frames == 0) return NULL;
+
+    uint32_t n_buckets = 1;
+    while (n_buckets < n_frames) n_buckets <<= 1;
+
+    BTreePageCache *cache = (BTreePageCache *)malloc(sizeof(BTreePageCache));
+    *cache = (BTreePageCache) {
+        .page_sz   = page_sz,
+        .n_frames  = n_frames,
+        .n_used    = 0,
+        .n_buckets = n_buckets,
+        .buckets   = (int32_t *)malloc(n_buckets * sizeof(int32_t)),
+        .frames    = (Frame *)malloc(n_frames * sizeof(Frame)),
+        .pages     = (uint8_t *)malloc((size_t)n_frames * page_sz),
+        .hand      = 0,
+        .stats     = { .capacity = n_frames },
+    };
+
+    for (uint32_t i = 0; i < n_buckets; i++)
+        cache->buckets[i] = NO_FRAME;
+
+    return cache;
+}
+
+static void cache_free(BTreePageCache *cache) {
+    free(cache->buckets);
+    free(cache->frames);
+    free(cache->pages);
+    free(cache);
+}
+
+static inline uint8_t *frame_page(BTreePageCache *cache, int32_t frame) {
+    return &cache->pages[(uint64_t)frame * cache->page_sz];
+}
+
+static inline int32_t *bucket_of(BTreePageCache *cache, uint32_t rrn) {
+    return &cache->buckets[rrn & (cache->n_buckets - 1)];
+}
+
+// Encontra o quadro que contém a página `rrn`, ou `NO_FRAME` caso não esteja
+// no cache.
+static int32_t cache_find(BTreePageCache *cache, uint32_t rrn) {
+    int32_t i = *bucket_of(cache, rrn);
+    while (i != NO_FRAME && cache->frames[i].rrn != rrn)
+        i = cache->frames[i].hash_next;
+    return i;
+}
+
+static void hash_remove(BTreePageCache *cache, int32_t frame) {
+    int32_t *link = bucket_of(cache, cache->frames[frame].rrn);
+    while (*link != frame)
+        link = &cache->frames[*link].hash_next;
+    *link = cache->frames[frame].hash_next;
 }
 
-// Garante que `fp` estará posicionado numa determinada página de memória de
-// acordo com o `rrn`. Vale notar que o RRN 0 não se refere ao byte offset 0.
-static inline void position_rrn(FILE *fp, uint32_t rrn) {
-    uint64_t offset = PAGE_SZ + PAGE_SZ * (uint64_t)rrn;
-    position(fp, offset);
+static void hash_insert(BTreePageCache *cache, int32_t frame) {
+    int32_t *bucket = bucket_of(cache, cache->frames[frame].rrn);
+    cache->frames[frame].hash_next = *bucket;
+    *bucket = frame;
 }
 
-static bool read_header(BTreeMap *btree) {
-    position(btree->fp, 0);
+// Escreve a página de um quadro no disco caso ela tenha sido modificada.
+static bool frame_write_back(BTreeMap *btree, int32_t frame) {
+    BTreePageCache *cache = btree->cache;
+    Frame *f = &cache->frames[frame];
+
+    if (!f->dirty) return true;
+
+    ASSERT(write_page(btree, rrn_offset(btree, f->rrn), frame_page(cache, frame)));
+    f->dirty = false;
+    cache->stats.writebacks++;
+
+    return true;
+}
+
+// Obtém um quadro para armazenar a página `rrn`, que não pode estar no cache.
+// Caso o cache esteja cheio, a página despejada (e escrita no disco, se
+// necessário) é a primeira, a partir do ponteiro, que não foi usada desde a
+// última passada dele. Retorna `NO_FRAME` em caso de erro.
+static int32_t cache_acquire(BTreeMap *btree, uint32_t rrn) {
+    BTreePageCache *cache = btree->cache;
+    int32_t frame;
+
+    if (cache->n_used < cache->n_frames) {
+        frame = cache->n_used++;
+    } else {
+        // Os quadros usados ganham uma nova chance. Depois de uma volta
+        // completa todos os bits estão limpos, então a busca sempre termina.
+        while (cache->frames[cache->hand].referenced) {
+            cache->frames[cache->hand].referenced = false;
+            cache->hand = (cache->hand + 1) % cache->n_frames;
+        }
+
+        frame = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->n_frames;
+        if (!frame_write_back(btree, frame)) return NO_FRAME;
+
+        hash_remove(cache, frame);
+        cache->stats.evictions++;
+    }
+
+    cache->frames[frame] = (Frame) {
+        .rrn        = rrn,
+        .dirty      = false,
+        .referenced = true,
+    };
+
+    hash_insert(cache, frame);
+
+    return frame;
+}
+
+// Escreve no disco todas as páginas modificadas que estão no cache.
+static bool cache_flush(BTreeMap *btree) {
+    if (!btree->cache) return true;
+
+    bool ok = true;
+
+    cache_lock(btree);
+    for (int32_t i = 0; ok && i < btree->cache->n_used; i++) {
+        ok = frame_write_back(btree, i);
+    }
+    cache_unlock(btree);
+
+    return ok;
+}
+
+// Endereço da página de um nó no mapeamento do arquivo, ou NULL caso a página
+// esteja além do fim do arquivo.
+static inline const uint8_t *mapped_page(BTreeMap *btree, uint32_t rrn) {
+    off_t offset = rrn_offset(btree, rrn);
+    if ((size_t)offset + btree->page_sz > btree->map_sz) return NULL;
+    return btree->map + offset;
+}
+
+// Lê a página de um nó, passando pelo cache caso ele esteja habilitado.
+static bool read_node_page(BTreeMap *btree, uint32_t rrn, uint8_t *page) {
+    BTreePageCache *cache = btree->cache;
+
+    // Com o arquivo mapeado, a página é copiada sem nenhuma chamada de sistema.
+    if (btree->map) {
+        const uint8_t *mapped = mapped_page(btree, rrn);
+        ASSERT(mapped);
+        memcpy(page, mapped, btree->page_sz);
+        return true;
+    }
+
+    if (!cache) return read_page(btree, rrn_offset(btree, rrn), page);
+
+    // Um acerto não altera a estrutura do cache, então vários leitores podem
+    // copiar páginas ao mesmo tempo. O bit de referência e o contador são
+    // atualizados atomicamente.
+    cache_lock_shared(btree);
+
+    int32_t frame = cache_find(cache, rrn);
+
+    if (frame != NO_FRAME) {
+        memcpy(page, frame_page(cache, frame), btree->page_sz);
+        __atomic_store_n(&cache->frames[frame].referenced, true, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cache->stats.hits, 1, __ATOMIC_RELAXED);
+        cache_unlock(btree);
+        return true;
+    }
+
+    cache_unlock(btree);
+
+    // Uma página fora do cache está atualizada no disco, e só é modificada com
+    // a trava da árvore em modo exclusivo, então é lida sem nenhuma trava do
+    // cache. Só ocupamos um quadro depois que a página foi lida com sucesso.
+    ASSERT(read_page(btree, rrn_offset(btree, rrn), page));
+
+    cache_lock(btree);
+    cache->stats.misses++;
+
+    // Outro leitor pode ter colocado a mesma página no cache enquanto ela era
+    // lida.
+    frame = cache_find(cache, rrn);
+    bool ok = true;
+
+    if (frame != NO_FRAME) {
+        memcpy(page, frame_page(cache, frame), btree->page_sz);
+    } else {
+        frame = cache_acquire(btree, rrn);
+        ok = frame != NO_FRAME;
+        if (ok) memcpy(frame_page(cache, frame), page, btree->page_sz);
+    }
+
+    cache_unlock(btree);
+    return ok;
+}
+
+// Escreve a página de um nó. Com o cache habilitado, a página só é escrita no
+// disco quando for despejada do cache ou em `btree_drop`.
+static bool write_node_page(BTreeMap *btree, uint32_t rrn, const uint8_t *page) {
+    BTreePageCache *cache = btree->cache;
+
+    // O mapeamento é somente leitura.
+    ASSERT(!btree->map);
+
+    if (!cache) return write_page(btree, rrn_offset(btree, rrn), page);
+
+    cache_lock(btree);
+
+    int32_t frame = cache_find(cache, rrn);
+
+    if (frame != NO_FRAME) {
+        cache->frames[frame].referenced = true;
+    } else {
+        frame = cache_acquire(btree, rrn);
+    }
+
+    if (frame != NO_FRAME) {
+        memcpy(frame_page(cache, frame), page, btree->page_sz);
+        cache->frames[frame].dirty = true;
+    }
+
+    cache_unlock(btree);
+    return frame != NO_FRAME;
+}
+
+// Verifica se uma combinação de tamanho de página e ordem é suportada.
+static inline bool valid_layout(uint32_t page_sz, uint32_t order) {
+    return page_sz <= BTREE_MAX_PAGE_SZ
+        && order >= 3
+        && order % 2 == 1
+        && NODE_HEADER_SZ + (order - 1) * ENTRY_SZ <= page_sz;
+}
+
+// Lê o header do arquivo vinculado. Somente com `any_status` um arquivo que não
+// foi fechado corretamente, com status '0', é aceito.
+static bool read_header(BTreeMap *btree, bool any_status) {
+    uint8_t header[HEADER_SZ];
+    ASSERT(pread(btree->fd, header, HEADER_SZ, 0) == HEADER_SZ);
+
+    const uint8_t *ptr = header;
 
     char status;
-    ASSERT(fread(&status, sizeof(char), 1, btree->fp));
-    ASSERT(status == '1');
-    ASSERT(fread(&btree->rrn_root, sizeof( int32_t), 1, btree->fp));
-    ASSERT(fread(&btree->next_rrn, sizeof(uint32_t), 1, btree->fp));
+    decode(&ptr, &status, sizeof(char));
+    ASSERT(status == '1' || (any_status && status == '0'));
+    decode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    decode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+    btree->rrn_committed  = btree->next_rrn;
+    btree->rrn_free       = -1;
+    btree->rrn_last_leaf  = -1;
+    btree->duplicate_keys = false;
+    btree->rrn_shared     = -1;
+    btree->linked_leaves  = false;
+
+    // No formato original, o restante do header é preenchido com '@' e as
+    // páginas têm sempre o mesmo tamanho e ordem.
+    if (memcmp(ptr, "@@@@", 4) == 0) {
+        btree->page_sz = BTREE_LEGACY_PAGE_SZ;
+        btree->order   = LEGACY_ORDER;
+        return true;
+    }
+
+    decode(&ptr, &btree->page_sz, sizeof(uint32_t));
+    decode(&ptr, &btree->order  , sizeof(uint32_t));
+    ASSERT(valid_layout(btree->page_sz, btree->order));
+
+    decode(&ptr, &btree->rrn_free, sizeof(int32_t));
+
+    char keys;
+    decode(&ptr, &keys, sizeof(char));
+    btree->duplicate_keys = keys == DUPLICATE_KEYS;
+
+    // Sem folhas encadeadas, esse campo é preenchido com '@'.
+    char layout;
+    decode(&ptr, &layout, sizeof(char));
+    btree->linked_leaves = layout == LINKED_LEAVES;
+
+    // Somente as árvores com chaves duplicadas possuem a página compartilhada.
+    if (!btree->duplicate_keys) return true;
+    decode(&ptr, &btree->rrn_shared, sizeof(int32_t));
+    ASSERT(btree->rrn_shared < (int32_t)btree->next_rrn);
 
     return true;
 }
 
-static bool read_node(BTreeMap *btree, uint32_t rrn, Node *to_read) {
-    position_rrn(btree->fp, rrn);
+// Decodifica um nó a partir de uma página lida do disco. O formato é o mesmo
+// escrito por `encode_node`.
+static bool decode_node(BTreeMap *btree, const uint8_t *page, Node *node) {
+    const uint8_t *ptr = page;
 
     char is_leaf;
-    ASSERT(fread(&is_leaf, sizeof(char), 1, btree->fp));
+    decode(&ptr, &is_leaf, sizeof(char));
 
     // Converte de char para booleano.
-    to_read->is_leaf = is_leaf == '1';
+    node->is_leaf = is_leaf == '1';
 
-    ASSERT(fread(&to_read->len, sizeof(uint32_t), 1, btree->fp));
-    ASSERT(fread(&to_read->rrn, sizeof(uint32_t), 1, btree->fp));
+    decode(&ptr, &node->len, sizeof(uint32_t));
+    decode(&ptr, &node->rrn, sizeof(uint32_t));
 
-    if (!to_read->is_leaf) {
-        // Se não for uma folha, temos a garantia de que há ao menos um nó filho.
-        ASSERT(fread(&to_read->children[0], sizeof(uint32_t), 1, btree->fp));
-    } else {
-        fseek(btree->fp, sizeof(uint32_t), SEEK_CUR);
-    }
+    // Um nó corrompido poderia fazer com que lêssemos além de `keys`.
+    ASSERT(node->len < btree->order);
 
-    for (int i = 0; i < to_read->len; i++) {
-        ASSERT(fread(&to_read->entries[i].key  , sizeof( int32_t), 1, btree->fp));
-        ASSERT(fread(&to_read->entries[i].value, sizeof(uint64_t), 1, btree->fp));
+    // Nas folhas os RRNs dos filhos são sempre nulos, exceto o primeiro que
+    // guarda a próxima folha quando as folhas são encadeadas.
+    decode(&ptr, &node->children[0], sizeof(uint32_t));
+    node->next = node->is_leaf ? (int32_t)node->children[0] : -1;
 
-        if (!to_read->is_leaf) {
-            ASSERT(fread(&to_read->children[i + 1] , sizeof(uint32_t), 1, btree->fp));
-        } else {
-            fseek(btree->fp, sizeof(uint32_t), SEEK_CUR);
-        }
+    for (int i = 0; i < node->len; i++) {
+        decode(&ptr, &node->keys[i]        , sizeof( int32_t));
+        decode(&ptr, &node->values[i]      , sizeof(uint64_t));
+        decode(&ptr, &node->children[i + 1], sizeof(uint32_t));
     }
 
     return true;
 }
 
-static bool write_header(BTreeMap *btree, char status) {
-    position(btree->fp, 0);
-    ASSERT(fwrite(&status         , sizeof(char)    , 1, btree->fp));
-    ASSERT(fwrite(&btree->rrn_root, sizeof( int32_t), 1, btree->fp));
-    ASSERT(fwrite(&btree->next_rrn, sizeof(uint32_t), 1, btree->fp));
+static bool read_node(BTreeMap *btree, uint32_t rrn, Node *to_read) {
+    // Com o arquivo mapeado, decodifica o nó diretamente do mapeamento.
+    if (btree->map) {
+        const uint8_t *mapped = mapped_page(btree, rrn);
+        ASSERT(mapped);
+        return decode_node(btree, mapped, to_read);
+    }
+
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    ASSERT(read_node_page(btree, rrn, page));
+    return decode_node(btree, page, to_read);
+}
 
-    int n_written = sizeof(char) + sizeof(int32_t) + sizeof(uint32_t);
+static bool write_header(BTreeMap *btree, char status) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+
+    // O espaço que sobra no header é preenchido com lixo ('@').
+    memset(page, '@', btree->page_sz);
+
+    uint8_t *ptr = page;
+    encode(&ptr, &status         , sizeof(char));
+    encode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    encode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+
+    // Arquivos no formato original continuam sem os campos de layout.
+    // Também não possuem a lista de páginas livres, então as páginas que ainda
+    // estiverem nela são perdidas.
+    if (btree->page_sz != BTREE_LEGACY_PAGE_SZ || btree->order != LEGACY_ORDER
+        || btree->duplicate_keys || btree->linked_leaves)
+    {
+        char keys = btree->duplicate_keys ? DUPLICATE_KEYS : UNIQUE_KEYS;
+        encode(&ptr, &btree->page_sz , sizeof(uint32_t));
+        encode(&ptr, &btree->order   , sizeof(uint32_t));
+        encode(&ptr, &btree->rrn_free, sizeof( int32_t));
+        encode(&ptr, &keys           , sizeof(char));
+    }
 
-    for (int i = n_written; i < PAGE_SZ; i++) {
-        ASSERT(fwrite("@", sizeof(char), 1, btree->fp));
+    // Somente as árvores com folhas encadeadas possuem o campo de layout, de
+    // modo que as demais continuam no formato anterior. Com chaves duplicadas,
+    // o campo é seguido pela página compartilhada atual.
+    if (btree->linked_leaves || btree->duplicate_keys) {
+        char layout = btree->linked_leaves ? LINKED_LEAVES : '@';
+        encode(&ptr, &layout, sizeof(char));
     }
 
+    if (btree->duplicate_keys)
+        encode(&ptr, &btree->rrn_shared, sizeof(int32_t));
+
+    return write_page(btree, 0, page);
+}
+
+// Grava as páginas modificadas e então o header. Com cópia na escrita, as
+// páginas novas precisam chegar ao disco antes do header que aponta para elas,
+// e a partir daí passam a pertencer ao snapshot gravado.
+static bool commit(BTreeMap *btree) {
+    ASSERT(cache_flush(btree));
+    if (btree->copy_on_write) ASSERT(fdatasync(btree->fd) == 0);
+    ASSERT(write_header(btree, '1'));
+
+    btree->rrn_committed = btree->next_rrn;
     return true;
 }
 
+// Verifica se o layout da btree permite a cópia na escrita. Com folhas
+// encadeadas, copiar uma folha exigiria copiar também a folha anterior, e as
+// listas de valores de chaves duplicadas são estendidas no lugar.
+static inline bool copy_on_write_supported(const BTreeMap *btree) {
+    return !btree->duplicate_keys && !btree->linked_leaves;
+}
+
 /**
  * Cria um novo `BtreeMap`. Não envolve alocação ou abertura de arquivos.
  *
@@ -139,10 +636,24 @@ static bool write_header(BTreeMap *btree, char status) {
  */
 BTreeMap btree_new() {
     return (BTreeMap) {
-        .fp        = NULL,
-        .error_msg = NULL,
-        .rrn_root  = -1,
-        .next_rrn  = 0,
+        .fd             = -1,
+        .error_msg      = NULL,
+        .rrn_root       = -1,
+        .next_rrn       = 0,
+        .rrn_free       = -1,
+        .rrn_last_leaf  = -1,
+        .page_sz        = BTREE_DEFAULT_PAGE_SZ,
+        .order          = ORDER_FOR_PAGE(BTREE_DEFAULT_PAGE_SZ),
+        .duplicate_keys = false,
+        .rrn_shared     = -1,
+        .linked_leaves  = false,
+        .copy_on_write  = false,
+        .rrn_committed  = 0,
+        .cache_budget   = BTREE_DEFAULT_CACHE_BUDGET,
+        .cache          = NULL,
+        .map            = NULL,
+        .map_sz         = 0,
+        .latch          = NULL,
     };
 }
 
@@ -152,20 +663,35 @@ BTreeMap btree_new() {
  * @param btree - a btree a ser liberada.
  */
 void btree_drop(BTreeMap btree) {
-    if (btree.fp) {
-        // Antes de fechar o arquivo, escreve novamente o header da btree, agora
-        // com status '1'.
-        write_header(&btree, '1');
-        fclose(btree.fp);
+    // Um arquivo mapeado é somente leitura, então nada precisa ser escrito.
+    if (btree.map) {
+        munmap((void *)btree.map, btree.map_sz);
+        close(btree.fd);
+        btree.fd = -1;
     }
 
+    if (btree.fd >= 0) {
+        // Antes de fechar o arquivo, escreve as páginas modificadas que ainda
+        // estão no cache e então o header da btree, agora com status '1'.
+        commit(&btree);
+        close(btree.fd);
+    }
+
+    if (btree.cache)
+        cache_free(btree.cache);
+
+    if (btree.latch)
+        latch_free(btree.latch);
+
     if (btree.error_msg)
         free(btree.error_msg);
 }
 
 /**
  * Carrega a BTree de um arquivo. Essa operação lê apenas o header da BTree. O
- * arquivo precisa já estar criado e possuir ao menos o header disponível.
+ * arquivo precisa já estar criado e possuir ao menos o header disponível. O
+ * tamanho de página e a ordem são lidos do header, e arquivos no formato
+ * original (páginas de 77 bytes) também são aceitos.
  *
  * @param btree - referência mutável da btree que terá o arquivo vinculado.
  * @param fname - nome do arquivo a ser vinculado a essa btree.
@@ -173,512 +699,3312 @@ void btree_drop(BTreeMap btree) {
  *         segundo caso, uma mensagem de erro estará disponível.
  */
 BTreeResult btree_load(BTreeMap *btree, const char *fname) {
-    FILE *fp = fopen(fname, "rb+");
+    int fd = open(fname, O_RDWR);
 
-    if (!fp) {
+    if (fd < 0) {
         error(btree, "failed to open file %s", fname);
         return BTREE_FAIL;
     }
 
-    btree->fp = fp;
+    btree->fd = fd;
 
     // Lê somente o header da BTree.
-    if (!read_header(btree)) {
+    if (!read_header(btree, false)) {
+        // Desvincula o arquivo para que `btree_drop` não sobrescreva o header.
+        close(fd);
+        btree->fd = -1;
         error(btree, "unable to read btree header from file");
         return BTREE_FAIL;
     }
 
+    if (btree->copy_on_write && !copy_on_write_supported(btree)) {
+        close(fd);
+        btree->fd = -1;
+        error(btree, "copy-on-write is not supported by the layout of file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->cache = cache_new(btree->cache_budget, btree->page_sz);
+    btree->latch = latch_new();
+
     return BTREE_OK;
 }
 
 /**
- * Cria um arquivo de BTree e vincula ele a um `BTreeMap`.
+ * Vincula um arquivo de BTree a um `BTreeMap` somente para leitura, mapeando o
+ * arquivo inteiro em memória. Os nós são decodificados diretamente do
+ * mapeamento, sem chamadas de sistema, e as páginas são compartilhadas com o
+ * cache do sistema operacional, inclusive entre processos diferentes. Nesse
+ * modo o cache de páginas da `btree` não é usado e qualquer modificação
+ * resulta em erro.
  *
  * @param btree - referência mutável da btree que terá o arquivo vinculado.
- * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @param fname - nome do arquivo a ser mapeado.
  * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
  *         segundo caso, uma mensagem de erro estará disponível.
  */
-BTreeResult btree_create(BTreeMap *btree, const char *fname) {
-    FILE *fp = fopen(fname, "wb+");
+BTreeResult btree_open_mmap(BTreeMap *btree, const char *fname) {
+    int fd = open(fname, O_RDONLY);
 
-    if (!fp) {
-        error(btree, "failed to create file %s", fname);
+    if (fd < 0) {
+        error(btree, "failed to open file %s", fname);
         return BTREE_FAIL;
     }
 
-    btree->fp = fp;
+    btree->fd = fd;
 
-    if (!write_header(btree, '0')) {
-        error(btree, "failed to create header in file %s", fname);
+    struct stat st;
+    if (!read_header(btree, false) || fstat(fd, &st) < 0 || st.st_size < btree->page_sz) {
+        close(fd);
+        btree->fd = -1;
+        error(btree, "unable to read btree header from file");
         return BTREE_FAIL;
     }
 
-    return BTREE_OK;
-}
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
 
-/**
- * Verifica se a `btree` possui algum erro registrado.
- *
- * @param btree - a btree a ser verificada.
- * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
- */
-bool btree_has_error(BTreeMap *btree) {
-    return btree->error_msg;
+    if (map == MAP_FAILED) {
+        close(fd);
+        btree->fd = -1;
+        error(btree, "failed to map file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->map    = map;
+    btree->map_sz = st.st_size;
+    btree->latch  = latch_new();
+
+    return BTREE_OK;
 }
 
 /**
- * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
- * modificada ou liberada.
+ * Lê do header de um arquivo de BTree apenas a sua configuração: o tamanho de
+ * página e se a árvore aceita chaves duplicadas ou tem as folhas encadeadas.
+ * Diferente de `btree_load`, o arquivo não é vinculado e o header é aceito
+ * mesmo com status '0', de modo que uma BTree que não foi fechada
+ * corretamente pode ser recriada com a mesma configuração por `btree_create`.
  *
- * @param btree - a btree com erro.
- * @return uma string contendo a mensagem de erro.
+ * @param btree - referência mutável da btree, que não pode ter arquivo
+ *                vinculado, onde a configuração é colocada.
+ * @param fname - nome do arquivo cujo header é lido.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
  */
-const char *btree_get_error(BTreeMap *btree) {
-    return btree->error_msg;
-}
-
-// Encontra a posição onde `key` poderia ser inserida em `node`.
-static int key_position(Node node, uint32_t key) {
-    int i;
-    for (i = 0; i < node.len && key > node.entries[i].key; i++);
-    return i;
-}
+BTreeResult btree_read_layout(BTreeMap *btree, const char *fname) {
+    if (btree->fd >= 0) {
+        error(btree, "cannot read the layout into a btree with a linked file");
+        return BTREE_FAIL;
+    }
 
-// Função interna para obter um valor dado uma chave.
-static int64_t get(BTreeMap *btree, Node node, uint32_t key) {
-    // Primeiro, encontra a posição onde `key` seria inserida no nó atual.
-    int i = key_position(node, key);
+    btree->fd = open(fname, O_RDONLY);
 
-    // Se tivermos encontrado a chave procurada, retornamos o valor
-    // correspondente a ela.
-    if (i < node.len && node.entries[i].key == key) {
-        return node.entries[i].value;
+    if (btree->fd < 0) {
+        error(btree, "failed to open file %s", fname);
+        return BTREE_FAIL;
     }
 
-    // Se for um nó interno, lemos o nó filho onde `key` possa ser encontrada e
-    // chamamos `get` recursivamente no nó filho.
-    if (!node.is_leaf) {
-        Node next;
+    bool ok = read_header(btree, true);
+    close(btree->fd);
 
-        if (!read_node(btree, node.children[i], &next)) {
-            error(btree, "failed to read node with RRN %d", node.children[i]);
-            return -1;
-        }
+    // Somente a configuração é mantida, e a btree continua vazia.
+    btree->fd            = -1;
+    btree->rrn_root      = -1;
+    btree->next_rrn      = 0;
+    btree->rrn_free      = -1;
+    btree->rrn_shared    = -1;
+    btree->rrn_committed = 0;
 
-        return get(btree, next, key);
+    if (!ok) {
+        error(btree, "unable to read btree header from file %s", fname);
+        return BTREE_FAIL;
     }
 
-    // `node` é necessáriamente um nó folha, mas não encontramos `key`,
-    // portanto, retornamos -1 sinalizando que `key` não foi encontrada.
-    return -1;
+    return BTREE_OK;
 }
 
 /**
- * Acessa um valor dado uma chave. Esse processo não envolve escritas ao disco,
- * entretanto muda o *file_pointer* da `btree` e por isso ela não se mantém
- * constante.
+ * Cria um arquivo de BTree e vincula ele a um `BTreeMap`. O arquivo usa o
+ * tamanho de página configurado em `btree` (veja `btree_set_page_size`).
  *
- * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
- * @param key - a chave de busca.
- * @return o valor associado à `key` caso `key` esteja contida na btree e -1
- *         caso contrário. Em caso de erro, -1 é retornado e `btree_has_error()`
- *         retorna `true`.
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
  */
-int64_t btree_get(BTreeMap *btree, int32_t key) {
-    // Se a btree não possui arquivo vinculado, erro.
-    if (!btree->fp) {
-        error(btree, "no associated file");
-        return -1;
+BTreeResult btree_create(BTreeMap *btree, const char *fname) {
+    if (btree->copy_on_write && !copy_on_write_supported(btree)) {
+        error(btree, "copy-on-write is not supported with duplicate keys or linked leaves");
+        return BTREE_FAIL;
     }
 
-    // Se não há nó raiz na btree, ela está vazia e `key` não estará contida nela.
-    if (btree->rrn_root < 0) {
-        return -1;
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        error(btree, "failed to create file %s", fname);
+        return BTREE_FAIL;
     }
 
-    // Lemos o nó raiz e chamamos a função `get` interna.
-    Node root;
-    if (!read_node(btree, btree->rrn_root, &root)) {
-        error(btree, "unable to read root");
-        return -1;
+    btree->fd    = fd;
+    btree->latch = latch_new();
+
+    // Com cópia na escrita, a árvore vazia já é um snapshot consistente.
+    if (!write_header(btree, btree->copy_on_write ? '1' : '0')) {
+        error(btree, "failed to create header in file %s", fname);
+        return BTREE_FAIL;
     }
+    btree->rrn_committed = btree->next_rrn;
 
-    return get(btree, root, key);
-}
+    btree->cache = cache_new(btree->cache_budget, btree->page_sz);
 
-// Cria um `Node` contendo uma único par chave-valor.
-static Node node_from_entry(Entry entry, uint32_t rrn) {
-    return (Node) {
-        .is_leaf = true,
-        .len     = 1,
-        .rrn     = rrn,
-        .entries = { entry },
-    };
+    return BTREE_OK;
 }
 
-// Escreve um `Node` para o disco de acordo com o seu RRN.
-static bool write_node(BTreeMap *btree, Node node)  {
-    position_rrn(btree->fp, node.rrn);
-
-    char is_leaf = node.is_leaf ? '1' : '0';
-    ASSERT(fwrite(&is_leaf , sizeof(char), 1, btree->fp));
-    ASSERT(fwrite(&node.len, sizeof(uint32_t), 1, btree->fp));
-    ASSERT(fwrite(&node.rrn, sizeof(uint32_t), 1, btree->fp));
+/**
+ * Define o orçamento de memória do cache de páginas. Caso a `btree` já possua
+ * um arquivo vinculado, as páginas modificadas são escritas no disco e o
+ * cache é recriado com o novo tamanho.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param budget - número máximo de bytes usados pelas páginas em cache. Um
+ *                 orçamento menor que uma página desabilita o cache.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_cache_budget(BTreeMap *btree, size_t budget) {
+    btree->cache_budget = budget;
 
-    if (!node.is_leaf) {
-        // Se não for uma folha, temos a garantia de que há ao menos um nó filho.
-        ASSERT(fwrite(&node.children[0], sizeof(uint32_t), 1, btree->fp));
-    } else {
-        ASSERT(fwrite(&NULL_RRN, sizeof(uint32_t), 1, btree->fp));
-    }
+    // Sem arquivo vinculado, o cache será criado somente no `btree_load` ou
+    // `btree_create`. Com o arquivo mapeado, o cache não é usado.
+    if (btree->fd < 0 || btree->map) return BTREE_OK;
 
-    // Iteramos por todos os pares chave-valor bem como pelos RRNs dos nós
-    // filhos, quando algum valor não está definido, escrevemos apenas 1s.
-    for (int i = 0; i < CAPACITY - 1; i++) {
-        if (i < node.len) {
-            ASSERT(fwrite(&node.entries[i].key  , sizeof( int32_t), 1, btree->fp));
-            ASSERT(fwrite(&node.entries[i].value, sizeof(uint64_t), 1, btree->fp));
-        } else {
-            ASSERT(fwrite(&NULL_RRN, sizeof( int32_t), 1, btree->fp));
-            ASSERT(fwrite(&NULL_RRN, sizeof(uint64_t), 1, btree->fp));
-        }
+    // Nenhum leitor pode estar usando o cache enquanto ele é recriado.
+    latch_write(btree);
 
-        if (!node.is_leaf && i < node.len) {
-            ASSERT(fwrite(&node.children[i + 1], sizeof(uint32_t), 1, btree->fp));
-        } else {
-            ASSERT(fwrite(&NULL_RRN, sizeof(uint32_t), 1, btree->fp));
-        }
+    if (!cache_flush(btree)) {
+        latch_release(btree);
+        error(btree, "failed to write cached pages to disk");
+        return BTREE_FAIL;
     }
 
-    return true;
-}
+    if (btree->cache)
+        cache_free(btree->cache);
+
+    btree->cache = cache_new(budget, btree->page_sz);
 
-// Cria e escreve um nó folha contendo apenas um par chave-valor no próximo RRN
-// disponível.
-static bool write_next_leaf(BTreeMap *btree, Entry entry) {
-    Node leaf = node_from_entry(entry, btree->next_rrn++);
-    return write_node(btree, leaf);
+    latch_release(btree);
+    return BTREE_OK;
 }
 
-// Insere um par chave-valor num nó folha numa determinada posição do nó. Essa
-// função assume que `node->is_leaf` é `true`.
-static void insert_entry_leaf(Node *node, Entry entry, int at) {
-    // Se a inserção deve ser feita no meio do nó, shifta todos os registros
-    // e insere.
+/**
+ * Define o tamanho de página usado por `btree_create`. A ordem da árvore é a
+ * maior ordem ímpar cujo nó ainda caiba numa página. Só pode ser chamada antes
+ * de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param page_sz - o tamanho de cada página em bytes, no máximo
+ *                  `BTREE_MAX_PAGE_SZ`. Com `BTREE_LEGACY_PAGE_SZ` o arquivo
+ *                  criado segue o formato original.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_page_size(BTreeMap *btree, uint32_t page_sz) {
+    if (btree->fd >= 0) {
+        error(btree, "cannot change the page size of a btree with a linked file");
+        return BTREE_FAIL;
+    }
+
+    if (page_sz < NODE_HEADER_SZ || !valid_layout(page_sz, ORDER_FOR_PAGE(page_sz))) {
+        error(btree, "unsupported page size %u", page_sz);
+        return BTREE_FAIL;
+    }
+
+    btree->page_sz = page_sz;
+    btree->order   = ORDER_FOR_PAGE(page_sz);
+
+    return BTREE_OK;
+}
+
+/**
+ * Define se a BTree criada por `btree_create` aceita chaves duplicadas. Nesse
+ * caso, cada chave guarda uma lista com todos os valores inseridos para ela,
+ * lida com `btree_postings_open`, em vez de um único valor. Só pode ser
+ * chamada antes de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param duplicate_keys - se a btree aceita chaves duplicadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_duplicate_keys(BTreeMap *btree, bool duplicate_keys) {
+    if (btree->fd >= 0) {
+        error(btree, "cannot change the key mode of a btree with a linked file");
+        return BTREE_FAIL;
+    }
+
+    btree->duplicate_keys = duplicate_keys;
+    return BTREE_OK;
+}
+
+/**
+ * Define se a BTree criada por `btree_create` é uma árvore B+ com as folhas
+ * encadeadas. Nesse caso, todas as entradas ficam nas folhas, os nós internos
+ * guardam apenas separadores e cada folha aponta para a próxima, de modo que
+ * percorrer as entradas em ordem com um cursor é uma leitura sequencial das
+ * folhas. As remoções não rebalanceiam os nós, e as folhas vazias continuam
+ * encadeadas. Só pode ser chamada antes de vincular um arquivo à `btree`.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param linked_leaves - se a btree tem as folhas encadeadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_linked_leaves(BTreeMap *btree, bool linked_leaves) {
+    if (btree->fd >= 0) {
+        error(btree, "cannot change the layout of a btree with a linked file");
+        return BTREE_FAIL;
+    }
+
+    btree->linked_leaves = linked_leaves;
+    return BTREE_OK;
+}
+
+/**
+ * Define se as inserções na BTree são feitas com cópia na escrita. Nesse modo,
+ * um nó que pertence ao último snapshot gravado no header não é sobrescrito:
+ * ele é escrito numa página nova no fim do arquivo, assim como todos os nós
+ * no caminho até a raiz. A nova raiz só passa a valer quando o header é
+ * gravado, com uma única escrita, por `btree_commit` ou `btree_drop`. Até lá,
+ * quem abrir o arquivo lê o snapshot anterior, que continua intacto.
+ *
+ * As páginas substituídas não voltam para a lista de páginas livres, já que
+ * leitores de snapshots anteriores ainda podem usá-las, e a lista de páginas
+ * livres não é usada nesse modo. Remoções não são suportadas, nem árvores com
+ * chaves duplicadas ou folhas encadeadas. Caso a `btree` já possua um arquivo
+ * vinculado, as modificações pendentes são gravadas antes.
+ *
+ * @param btree - a btree a ser configurada.
+ * @param copy_on_write - se as inserções são feitas com cópia na escrita.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_set_copy_on_write(BTreeMap *btree, bool copy_on_write) {
+    // Sem arquivo vinculado, o layout é verificado no `btree_load` ou
+    // `btree_create`.
+    if (btree->fd < 0) {
+        btree->copy_on_write = copy_on_write;
+        return BTREE_OK;
+    }
+
+    if (btree->map) {
+        error(btree, "btree is read-only");
+        return BTREE_FAIL;
+    }
+
+    if (copy_on_write && !copy_on_write_supported(btree)) {
+        error(btree, "copy-on-write is not supported with duplicate keys or linked leaves");
+        return BTREE_FAIL;
+    }
+
+    // O snapshot protegido é o que está no disco, então as modificações feitas
+    // até aqui precisam ser gravadas antes.
+    latch_write(btree);
+    bool ok = commit(btree);
+    if (ok) btree->copy_on_write = copy_on_write;
+    latch_release(btree);
+
+    if (!ok) {
+        error(btree, "failed to commit btree");
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Grava no disco as páginas modificadas que estão no cache e então o header
+ * da btree, com status '1'. Com cópia na escrita, é a gravação do header que
+ * troca a raiz vista por quem abrir o arquivo.
+ *
+ * @param btree - a btree a ser gravada, que precisa ter um arquivo vinculado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_commit(BTreeMap *btree) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    // Um arquivo mapeado é somente leitura, então não há o que gravar.
+    if (btree->map) return BTREE_OK;
+
+    latch_write(btree);
+    bool ok = commit(btree);
+    latch_release(btree);
+
+    if (!ok) {
+        error(btree, "failed to commit btree");
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Recupera os contadores do cache de páginas da `btree`. Caso o cache esteja
+ * desabilitado, todos os contadores são 0.
+ *
+ * @param btree - a btree a ser consultada.
+ * @return os contadores do cache.
+ */
+BTreeCacheStats btree_cache_stats(const BTreeMap *btree) {
+    if (!btree->cache) return (BTreeCacheStats){ 0 };
+
+    cache_lock(btree);
+    BTreeCacheStats stats = btree->cache->stats;
+    cache_unlock(btree);
+
+    return stats;
+}
+
+/**
+ * Verifica se a `btree` possui algum erro registrado.
+ *
+ * @param btree - a btree a ser verificada.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool btree_has_error(BTreeMap *btree) {
+    return btree->error_msg;
+}
+
+/**
+ * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param btree - a btree com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *btree_get_error(BTreeMap *btree) {
+    return btree->error_msg;
+}
+
+// Encontra a primeira posição de `keys[0..len)`, que está ordenado, cuja chave
+// não é menor que `key`, ou `len` caso não haja. A implementação é escolhida
+// em tempo de compilação: com AVX2 ou SSE2, as chaves são comparadas em blocos
+// de 8 ou 4 e a posição sai da máscara da comparação. Sem eles, é uma busca
+// binária sem desvios, que só depende de movimentações condicionais.
+static inline int lower_bound(const int32_t *keys, int len, int32_t key) {
+#if defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi32(key);
+
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)&keys[i]);
+        // Um bit para cada chave menor que `key`. Como as chaves estão
+        // ordenadas, os bits ligados formam um prefixo da máscara.
+        uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, block)));
+        if (mask != 0xff) return i + __builtin_ctz(~mask);
+    }
+
+    for (; i < len && key > keys[i]; i++);
+    return i;
+#elif defined(__SSE2__)
+    __m128i needle = _mm_set1_epi32(key);
+
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i block = _mm_loadu_si128((const __m128i *)&keys[i]);
+        // Um bit para cada chave menor que `key`. Como as chaves estão
+        // ordenadas, os bits ligados formam um prefixo da máscara.
+        uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, block)));
+        if (mask != 0xf) return i + __builtin_ctz(~mask);
+    }
+
+    for (; i < len && key > keys[i]; i++);
+    return i;
+#else
+    if (len == 0) return 0;
+
+    // A resposta está sempre em `base[0..len]`, e cada passo descarta a metade
+    // inferior ou superior do intervalo.
+    const int32_t *base = keys;
+    while (len > 1) {
+        int half = len / 2;
+        base = base[half - 1] < key ? base + half : base;
+        len -= half;
+    }
+
+    return (base - keys) + (*base < key);
+#endif
+}
+
+// Encontra a posição onde `key` poderia ser inserida em `node`.
+static inline int key_position(const Node *node, int32_t key) {
+    return lower_bound(node->keys, node->len, key);
+}
+
+// Busca o valor guardado nos nós para uma chave. Com chaves duplicadas, esse
+// valor indica onde começa a lista de valores da chave. Como a busca
+// não modifica a `btree`, os erros são colocados em `*error_msg`.
+static int64_t find_value(BTreeMap *btree, int32_t key, char **error_msg) {
+    // Se a btree não possui arquivo vinculado, erro.
+    if (btree->fd < 0) {
+        error_to(error_msg, "no associated file");
+        return -1;
+    }
+
+    // Se não há nó raiz na btree, ela está vazia e `key` não estará contida nela.
+    if (btree->rrn_root < 0) {
+        return -1;
+    }
+
+    // Como os nós podem ser grandes, um único `Node` é reaproveitado durante
+    // toda a descida, começando pela raiz.
+    Node node;
+    if (!read_node(btree, btree->rrn_root, &node)) {
+        error_to(error_msg, "unable to read root");
+        return -1;
+    }
+
+    while (true) {
+        // Primeiro, encontra a posição onde `key` seria inserida no nó atual.
+        int i = key_position(&node, key);
+
+        // Se tivermos encontrado a chave procurada, retornamos o valor
+        // correspondente a ela. Com folhas encadeadas, as entradas dos nós
+        // internos são apenas separadores, iguais à menor chave do filho à
+        // direita, então a busca sempre termina numa folha.
+        bool found = i < node.len && node.keys[i] == key;
+        if (found && (node.is_leaf || !btree->linked_leaves)) {
+            return node.values[i];
+        }
+
+        // `node` é uma folha, mas não encontramos `key`, portanto, retornamos
+        // -1 sinalizando que `key` não foi encontrada.
+        if (node.is_leaf) {
+            return -1;
+        }
+
+        // É um nó interno, então descemos para o nó filho onde `key` possa ser
+        // encontrada.
+        uint32_t child = node.children[found ? i + 1 : i];
+        if (!read_node(btree, child, &node)) {
+            error_to(error_msg, "failed to read node with RRN %d", child);
+            return -1;
+        }
+    }
+}
+
+/**
+ * Acessa um valor dado uma chave. Esse processo não envolve escritas ao disco,
+ * entretanto pode registrar um erro na `btree` e por isso ela não se mantém
+ * constante.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado
+ *                e não aceitar chaves duplicadas.
+ * @param key - a chave de busca.
+ * @return o valor associado à `key` caso `key` esteja contida na btree e -1
+ *         caso contrário. Em caso de erro, -1 é retornado e `btree_has_error()`
+ *         retorna `true`.
+ */
+int64_t btree_get(BTreeMap *btree, int32_t key) {
+    if (btree->duplicate_keys) {
+        error(btree, "btree has duplicate keys, use btree_postings_open instead");
+        return -1;
+    }
+
+    return find_value(btree, key, &btree->error_msg);
+}
+
+/* Busca em lote */
+
+// Uma chave a ser buscada e a sua posição no vetor original.
+typedef struct {
+    int32_t key;
+    size_t  index;
+} Probe;
+
+// Função de comparação de `Probe`s por chave para ser usada com `mergesort`.
+static int32_t compare_probes(void *data, int32_t i, int32_t j) {
+    Probe *probes = (Probe *)data;
+    if (probes[i].key < probes[j].key) return -1;
+    else if (probes[i].key == probes[j].key) return 0;
+    else return 1;
+}
+
+// Busca as chaves ordenadas `probes[0..n)` na subárvore do nó `rrn`. As chaves
+// que descem para o mesmo filho são buscadas juntas, com uma única leitura de
+// cada nó do caminho.
+static bool get_many(BTreeMap *btree, uint32_t rrn, const Probe *probes, size_t n, int64_t *values) {
+    Node node;
+    if (!read_node(btree, rrn, &node)) {
+        error(btree, "failed to read node with RRN %d", rrn);
+        return false;
+    }
+
+    // Como as chaves estão ordenadas, a posição no nó só avança.
+    size_t p = 0;
+    int i = 0;
+
+    while (p < n) {
+        int32_t key = probes[p].key;
+        i += lower_bound(&node.keys[i], node.len - i, key);
+
+        if (i < node.len && node.keys[i] == key) {
+            if (node.is_leaf || !btree->linked_leaves) {
+                values[probes[p++].index] = node.values[i];
+                continue;
+            }
+
+            // É um separador, então `key` está no filho à direita dele.
+            i++;
+        }
+
+        // `key` desceria para o filho `i`, junto de todas as chaves seguintes
+        // menores que a entrada `i`.
+        size_t end = p + 1;
+        while (end < n && (i == node.len || probes[end].key < node.keys[i])) end++;
+
+        if (node.is_leaf) {
+            for (; p < end; p++) values[probes[p].index] = -1;
+        } else {
+            ASSERT(get_many(btree, node.children[i], &probes[p], end - p, values));
+            p = end;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Acessa os valores de várias chaves de uma só vez. As chaves são ordenadas e
+ * a árvore é percorrida uma única vez, de modo que chaves próximas
+ * compartilham a leitura dos nós em comum.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado
+ *                e não aceitar chaves duplicadas.
+ * @param keys - as chaves de busca, em qualquer ordem e possivelmente
+ *               repetidas.
+ * @param n - o número de chaves.
+ * @param values - vetor de `n` posições onde o valor de cada chave é colocado
+ *                 na mesma posição da chave em `keys`, ou -1 caso ela não esteja
+ *                 contida na btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_get_many(BTreeMap *btree, const int32_t *keys, size_t n, int64_t *values) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (btree->duplicate_keys) {
+        error(btree, "btree has duplicate keys, use btree_postings_open instead");
+        return BTREE_FAIL;
+    }
+
+    if (btree->rrn_root < 0) {
+        for (size_t i = 0; i < n; i++) values[i] = -1;
+        return BTREE_OK;
+    }
+
+    if (n == 0) return BTREE_OK;
+
+    Probe *probes = (Probe *)malloc(n * sizeof(Probe));
+    for (size_t i = 0; i < n; i++) {
+        probes[i] = (Probe){ .key = keys[i], .index = i };
+    }
+
+    mergesort(probes, sizeof(Probe), 0, n - 1, compare_probes);
+
+    bool ok = get_many(btree, btree->rrn_root, probes, n, values);
+    free(probes);
+
+    return ok ? BTREE_OK : BTREE_FAIL;
+}
+
+/* Leitores concorrentes */
+
+/**
+ * Cria um leitor da `btree`, que pode ser usado por uma única thread. Cada
+ * thread que busca na btree deve ter o seu próprio leitor. Não envolve
+ * alocação.
+ *
+ * @param btree - a btree a ser lida, que precisa continuar válida enquanto o
+ *                leitor for usado.
+ * @return o leitor criado.
+ */
+BTreeReader btree_reader_new(BTreeMap *btree) {
+    return (BTreeReader) {
+        .btree     = btree,
+        .error_msg = NULL,
+    };
+}
+
+/**
+ * Libera um leitor. A btree lida não é afetada.
+ *
+ * @param reader - o leitor a ser liberado.
+ */
+void btree_reader_drop(BTreeReader reader) {
+    if (reader.error_msg)
+        free(reader.error_msg);
+}
+
+/**
+ * Acessa um valor dado uma chave, assim como `btree_get`, mas podendo ser
+ * chamada por várias threads ao mesmo tempo, cada uma com o seu leitor, e
+ * enquanto outra thread modifica a btree. Os erros são registrados apenas no
+ * leitor.
+ *
+ * @param reader - o leitor da thread, cuja btree precisa ter um arquivo
+ *                 vinculado e não aceitar chaves duplicadas.
+ * @param key - a chave de busca.
+ * @return o valor associado à `key` caso `key` esteja contida na btree e -1
+ *         caso contrário. Em caso de erro, -1 é retornado e
+ *         `btree_reader_has_error()` retorna `true`.
+ */
+int64_t btree_reader_get(BTreeReader *reader, int32_t key) {
+    BTreeMap *btree = reader->btree;
+
+    if (btree->duplicate_keys) {
+        error_to(&reader->error_msg, "btree has duplicate keys, use btree_postings_open instead");
+        return -1;
+    }
+
+    // A descida inteira é feita com a trava da árvore em modo compartilhado,
+    // então a árvore não muda entre a leitura da raiz e a da folha. Ela não
+    // impede que os leitores desçam ao mesmo tempo: os acertos no cache só
+    // tomam a trava dele em modo compartilhado, e as faltas leem o disco sem
+    // nenhuma trava do cache. O escritor só espera pelas descidas em
+    // andamento, que leem no máximo `BTREE_CURSOR_MAX_DEPTH` páginas, e cada
+    // modificação mantém a trava exclusiva apenas durante uma inserção ou
+    // remoção. Travar nó a nó (latch coupling) exigiria uma trava por página
+    // e que as divisões e fusões, que sobem da folha até a raiz, travassem o
+    // caminho inteiro de antemão, o que a inserção recursiva não faz.
+    latch_read(btree);
+    int64_t value = find_value(btree, key, &reader->error_msg);
+    latch_release(btree);
+
+    return value;
+}
+
+/**
+ * Verifica se o leitor possui algum erro registrado.
+ *
+ * @param reader - o leitor a ser verificado.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool btree_reader_has_error(BTreeReader *reader) {
+    return reader->error_msg;
+}
+
+/**
+ * Recupera a mensagem de erro do leitor. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param reader - o leitor com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *btree_reader_get_error(BTreeReader *reader) {
+    return reader->error_msg;
+}
+
+/* Cursor */
+
+// Endereço da entrada `i` dentro da página de um nó.
+static inline const uint8_t *page_entry(const uint8_t *page, int32_t i) {
+    return page + NODE_HEADER_SZ + (size_t)i * ENTRY_SZ;
+}
+
+// Lê a chave da entrada `i` diretamente da página de um nó.
+static inline int32_t page_key(const uint8_t *page, int32_t i) {
+    int32_t key;
+    memcpy(&key, page_entry(page, i), sizeof(int32_t));
+    return key;
+}
+
+// Lê o RRN do filho `i` diretamente da página de um nó. O primeiro filho fica
+// no fim dos campos fixos e os demais no fim de cada entrada.
+static inline uint32_t page_child(const uint8_t *page, int32_t i) {
+    uint32_t rrn;
+    memcpy(&rrn, page_entry(page, i) - sizeof(uint32_t), sizeof(uint32_t));
+    return rrn;
+}
+
+// Invalida o cursor. Sempre retorna `false` por conveniência.
+static inline bool cursor_invalidate(BTreeCursor *cursor) {
+    cursor->valid = false;
+    return false;
+}
+
+// Copia para o cursor a entrada na posição atual do nó do topo da pilha.
+static inline bool cursor_load_entry(BTreeCursor *cursor) {
+    const BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+    const uint8_t *ptr = page_entry(cursor->page, top->pos);
+
+    decode(&ptr, &cursor->key  , sizeof( int32_t));
+    decode(&ptr, &cursor->value, sizeof(uint64_t));
+
+    cursor->valid = true;
+    return true;
+}
+
+// Lê a página do nó `rrn` para o cursor e empilha o nó.
+static bool cursor_push(BTreeCursor *cursor, uint32_t rrn) {
+    BTreeMap *btree = cursor->btree;
+
+    if (cursor->depth == BTREE_CURSOR_MAX_DEPTH) {
+        error(btree, "btree is too deep to be traversed");
+        return false;
+    }
+
+    if (!read_node_page(btree, rrn, cursor->page)) {
+        error(btree, "failed to read node with RRN %d", rrn);
+        return false;
+    }
+
+    const uint8_t *ptr = cursor->page;
+    char is_leaf;
+    uint32_t len;
+    decode(&ptr, &is_leaf, sizeof(char));
+    decode(&ptr, &len    , sizeof(uint32_t));
+
+    // Um nó corrompido poderia fazer com que lêssemos além da página.
+    if (len >= btree->order) {
+        error(btree, "corrupted node with RRN %d", rrn);
+        return false;
+    }
+
+    cursor->stack[cursor->depth++] = (BTreeCursorFrame){
+        .rrn     = rrn,
+        .len     = len,
+        .is_leaf = is_leaf == '1',
+        .pos     = 0,
+    };
+    return true;
+}
+
+// Desempilha o nó do topo e lê novamente a página do nó pai. Retorna `false`
+// caso a pilha tenha ficado vazia ou em caso de erro.
+static bool cursor_pop(BTreeCursor *cursor) {
+    if (--cursor->depth == 0) return false;
+
+    uint32_t rrn = cursor->stack[cursor->depth - 1].rrn;
+    if (!read_node_page(cursor->btree, rrn, cursor->page)) {
+        error(cursor->btree, "failed to read node with RRN %d", rrn);
+        return false;
+    }
+    return true;
+}
+
+// Desce da subárvore `rrn` até a sua menor (`leftmost`) ou maior entrada,
+// empilhando todos os nós do caminho.
+static bool cursor_descend(BTreeCursor *cursor, uint32_t rrn, bool leftmost) {
+    BTreeCursorFrame *top;
+
+    while (true) {
+        ASSERT(cursor_push(cursor, rrn));
+        top = &cursor->stack[cursor->depth - 1];
+        top->pos = leftmost ? 0 : top->len;
+
+        if (top->is_leaf) break;
+
+        rrn = page_child(cursor->page, top->pos);
+    }
+
+    // Somente a raiz de uma árvore vazia pode não ter entradas.
+    ASSERT(top->len > 0);
+    if (!leftmost) top->pos--;
+
+    return true;
+}
+
+// Sobe na pilha até um nó que ainda tenha uma entrada depois do filho pelo
+// qual o cursor desceu, e posiciona o cursor nela.
+static bool cursor_ascend_next(BTreeCursor *cursor) {
+    while (cursor_pop(cursor)) {
+        BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+        if (top->pos < top->len) return cursor_load_entry(cursor);
+    }
+    return cursor_invalidate(cursor);
+}
+
+// Mesmo que `cursor_ascend_next`, mas busca uma entrada antes do filho.
+static bool cursor_ascend_prev(BTreeCursor *cursor) {
+    while (cursor_pop(cursor)) {
+        BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+        if (top->pos > 0) {
+            top->pos--;
+            return cursor_load_entry(cursor);
+        }
+    }
+    return cursor_invalidate(cursor);
+}
+
+// Numa árvore com folhas encadeadas, passa para a primeira entrada das folhas
+// seguintes, pulando as folhas vazias. A folha lida substitui o topo da pilha,
+// então os demais nós da pilha deixam de corresponder ao caminho até ela.
+static bool cursor_next_leaf(BTreeCursor *cursor) {
+    while (true) {
+        // O primeiro filho de uma folha é o RRN da próxima folha.
+        int32_t next = page_child(cursor->page, 0);
+        if (next < 0) return cursor_invalidate(cursor);
+
+        cursor->depth--;
+        if (!cursor_push(cursor, next)) return cursor_invalidate(cursor);
+
+        BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+        if (!top->is_leaf) {
+            error(cursor->btree, "corrupted leaf link to RRN %d", next);
+            return cursor_invalidate(cursor);
+        }
+
+        if (top->len > 0) return cursor_load_entry(cursor);
+    }
+}
+
+// Numa árvore com folhas encadeadas, as folhas não apontam para as anteriores.
+// Então a pilha é refeita descendo da raiz até a entrada atual, e o cursor
+// sobe até um nó que tenha um filho à esquerda do caminho, descendo até a maior
+// entrada desse filho e pulando as folhas vazias.
+static bool cursor_prev_leaf(BTreeCursor *cursor) {
+    int32_t key = cursor->key;
+    uint32_t rrn = cursor->btree->rrn_root;
+    BTreeCursorFrame *top;
+
+    cursor->depth = 0;
+
+    while (true) {
+        if (!cursor_push(cursor, rrn)) return cursor_invalidate(cursor);
+        top = &cursor->stack[cursor->depth - 1];
+
+        // Nos nós internos desce à direita de um separador igual a `key`, e na
+        // folha para na posição da própria entrada atual.
+        for (top->pos = 0; top->pos < top->len; top->pos++) {
+            int32_t k = page_key(cursor->page, top->pos);
+            if (key < k || (top->is_leaf && key == k)) break;
+        }
+
+        if (top->is_leaf) break;
+
+        rrn = page_child(cursor->page, top->pos);
+    }
+
+    while (top->pos == 0) {
+        do {
+            if (!cursor_pop(cursor)) return cursor_invalidate(cursor);
+            top = &cursor->stack[cursor->depth - 1];
+        } while (top->pos == 0);
+
+        top->pos--;
+        rrn = page_child(cursor->page, top->pos);
+
+        while (true) {
+            if (!cursor_push(cursor, rrn)) return cursor_invalidate(cursor);
+            top = &cursor->stack[cursor->depth - 1];
+            top->pos = top->len;
+
+            if (top->is_leaf) break;
+
+            rrn = page_child(cursor->page, top->pos);
+        }
+    }
+
+    top->pos--;
+    return cursor_load_entry(cursor);
+}
+
+/**
+ * Posiciona o cursor na primeira entrada com chave maior ou igual a `key`.
+ * Depois disso, `btree_cursor_next` e `btree_cursor_prev` percorrem as
+ * entradas em ordem de chave. A `btree` não deve ser modificada enquanto o
+ * cursor estiver em uso.
+ *
+ * @param btree - a btree a ser percorrida que precisa ter um arquivo vinculado.
+ * @param cursor - o cursor a ser posicionado.
+ * @param key - a menor chave de interesse.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso não
+ *         haja entrada com chave maior ou igual a `key` ou em caso de erro
+ *         (nesse caso `btree_has_error()` retorna `true`).
+ */
+bool btree_cursor_seek(BTreeMap *btree, BTreeCursor *cursor, int32_t key) {
+    cursor->btree = btree;
+    cursor->depth = 0;
+    cursor->valid = false;
+
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return false;
+    }
+
+    if (btree->rrn_root < 0) return false;
+
+    // Desce como em `btree_get`, mas guardando o caminho percorrido.
+    uint32_t rrn = btree->rrn_root;
+    BTreeCursorFrame *top;
+
+    while (true) {
+        if (!cursor_push(cursor, rrn)) return cursor_invalidate(cursor);
+        top = &cursor->stack[cursor->depth - 1];
+
+        for (top->pos = 0; top->pos < top->len && key > page_key(cursor->page, top->pos); top->pos++);
+
+        bool found = top->pos < top->len && page_key(cursor->page, top->pos) == key;
+        if (found && (top->is_leaf || !btree->linked_leaves))
+            return cursor_load_entry(cursor);
+
+        if (top->is_leaf) break;
+
+        // Com folhas encadeadas, `key` está à direita de um separador igual.
+        if (found) top->pos++;
+
+        rrn = page_child(cursor->page, top->pos);
+    }
+
+    if (top->pos < top->len) return cursor_load_entry(cursor);
+
+    // Todas as chaves da folha são menores que `key`, então a entrada
+    // procurada está na próxima folha ou em algum dos ancestrais.
+    if (btree->linked_leaves) return cursor_next_leaf(cursor);
+    return cursor_ascend_next(cursor);
+}
+
+/**
+ * Avança o cursor para a entrada com a próxima chave.
+ *
+ * @param cursor - um cursor posicionado sobre uma entrada.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso as
+ *         entradas tenham acabado ou em caso de erro. Em ambos os casos o
+ *         cursor deixa de ser válido e precisa ser posicionado novamente.
+ */
+bool btree_cursor_next(BTreeCursor *cursor) {
+    if (!cursor->valid) return false;
+
+    BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+
+    if (!top->is_leaf) {
+        // A próxima entrada é a menor da subárvore à direita da atual.
+        top->pos++;
+        if (!cursor_descend(cursor, page_child(cursor->page, top->pos), true))
+            return cursor_invalidate(cursor);
+
+        return cursor_load_entry(cursor);
+    }
+
+    if (++top->pos < top->len) return cursor_load_entry(cursor);
+
+    // Com folhas encadeadas, a próxima entrada está nas folhas seguintes.
+    if (cursor->btree->linked_leaves) return cursor_next_leaf(cursor);
+    return cursor_ascend_next(cursor);
+}
+
+/**
+ * Recua o cursor para a entrada com a chave anterior.
+ *
+ * @param cursor - um cursor posicionado sobre uma entrada.
+ * @return `true` caso o cursor esteja sobre uma entrada e `false` caso as
+ *         entradas tenham acabado ou em caso de erro. Em ambos os casos o
+ *         cursor deixa de ser válido e precisa ser posicionado novamente.
+ */
+bool btree_cursor_prev(BTreeCursor *cursor) {
+    if (!cursor->valid) return false;
+
+    BTreeCursorFrame *top = &cursor->stack[cursor->depth - 1];
+
+    if (!top->is_leaf) {
+        // A entrada anterior é a maior da subárvore à esquerda da atual.
+        if (!cursor_descend(cursor, page_child(cursor->page, top->pos), false))
+            return cursor_invalidate(cursor);
+
+        return cursor_load_entry(cursor);
+    }
+
+    if (top->pos > 0) {
+        top->pos--;
+        return cursor_load_entry(cursor);
+    }
+
+    if (cursor->btree->linked_leaves) return cursor_prev_leaf(cursor);
+    return cursor_ascend_prev(cursor);
+}
+
+// Codifica um `Node` numa página no mesmo formato em que é armazenado no disco.
+static void encode_node(BTreeMap *btree, const Node *node, uint8_t *page) {
+    uint8_t *ptr = page;
+
+    char is_leaf = node->is_leaf ? '1' : '0';
+    encode(&ptr, &is_leaf  , sizeof(char));
+    encode(&ptr, &node->len, sizeof(uint32_t));
+    encode(&ptr, &node->rrn, sizeof(uint32_t));
+
+    if (!node->is_leaf) {
+        // Se não for uma folha, temos a garantia de que há ao menos um nó filho.
+        encode(&ptr, &node->children[0], sizeof(uint32_t));
+    } else if (btree->linked_leaves) {
+        encode(&ptr, &node->next, sizeof(int32_t));
+    } else {
+        encode(&ptr, &NULL_RRN, sizeof(uint32_t));
+    }
+
+    // Iteramos por todos os pares chave-valor bem como pelos RRNs dos nós
+    // filhos, quando algum valor não está definido, escrevemos apenas 1s.
+    for (int i = 0; i < btree->order - 1; i++) {
+        if (i < node->len) {
+            encode(&ptr, &node->keys[i]  , sizeof( int32_t));
+            encode(&ptr, &node->values[i], sizeof(uint64_t));
+        } else {
+            encode(&ptr, &NULL_RRN, sizeof( int32_t));
+            encode(&ptr, &NULL_RRN, sizeof(uint64_t));
+        }
+
+        if (!node->is_leaf && i < node->len) {
+            encode(&ptr, &node->children[i + 1], sizeof(uint32_t));
+        } else {
+            encode(&ptr, &NULL_RRN, sizeof(uint32_t));
+        }
+    }
+
+    // O espaço que sobra no fim da página é preenchido com lixo ('@').
+    memset(ptr, '@', page + btree->page_sz - ptr);
+}
+
+// Escreve um `Node` para o disco de acordo com o seu RRN.
+static bool write_node(BTreeMap *btree, const Node *node)  {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    encode_node(btree, node, page);
+    return write_node_page(btree, node->rrn, page);
+}
+
+/* Lista de páginas livres */
+
+// Marca uma página que está na lista de páginas livres, no lugar do campo que
+// indica se o nó é folha.
+#define FREE_PAGE '*'
+
+// Aloca a página para um novo nó. Reaproveita a primeira página da lista de
+// páginas livres, se houver alguma, e senão usa a próxima página no fim do
+// arquivo. Com cópia na escrita, as páginas novas são sempre as do fim do
+// arquivo, para que nenhuma página abaixo de `rrn_committed` seja reescrita.
+static bool allocate_rrn(BTreeMap *btree, uint32_t *rrn) {
+    if (btree->rrn_free < 0 || btree->copy_on_write) {
+        *rrn = btree->next_rrn++;
+        return true;
+    }
+
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    ASSERT(read_node_page(btree, btree->rrn_free, page));
+
+    // Uma página livre guarda apenas o RRN da próxima página livre.
+    const uint8_t *ptr = page;
+    char marker;
+    decode(&ptr, &marker, sizeof(char));
+    ASSERT(marker == FREE_PAGE);
+
+    *rrn = btree->rrn_free;
+    decode(&ptr, &btree->rrn_free, sizeof(int32_t));
+
+    return true;
+}
+
+// Coloca a página de um nó que deixou de existir no início da lista de páginas
+// livres.
+static bool free_rrn(BTreeMap *btree, uint32_t rrn) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    memset(page, '@', btree->page_sz);
+
+    uint8_t *ptr = page;
+    char marker = FREE_PAGE;
+    encode(&ptr, &marker         , sizeof(char));
+    encode(&ptr, &btree->rrn_free, sizeof(int32_t));
+
+    ASSERT(write_node_page(btree, rrn, page));
+    btree->rrn_free = rrn;
+
+    return true;
+}
+
+/* Listas de valores de chaves duplicadas */
+
+// Marca uma página que guarda parte da lista de valores de uma chave.
+#define POSTINGS_PAGE '#'
+
+// Bytes ocupados pelos campos fixos de uma página de valores: marcador,
+// quantidade de valores, RRN da próxima página e RRN da última página.
+#define POSTINGS_HEADER_SZ 13
+
+// Quantos valores cabem numa página de valores.
+#define POSTINGS_PER_PAGE(page_sz) (((page_sz) - POSTINGS_HEADER_SZ) / sizeof(uint64_t))
+
+// Marca uma página compartilhada por várias chaves. A página é dividida em
+// fatias de tamanho fixo, e cada fatia guarda os primeiros valores da lista de
+// uma chave. Assim, as listas curtas, que são a maioria, não ocupam uma página
+// inteira cada.
+#define SHARED_PAGE '$'
+
+// Bytes ocupados pelos campos fixos de uma página compartilhada: marcador e
+// quantidade de fatias em uso.
+#define SHARED_HEADER_SZ 5
+
+// Quantos valores cabem numa fatia e os bytes ocupados por ela: quantidade de
+// valores, RRN da primeira página encadeada com os valores que não couberam e
+// os valores. Nas páginas pequenas a fatia é menor, de modo que sempre caiba
+// ao menos uma.
+#define MAX_SLOT_CAP 16
+#define SLOT_CAP(page_sz) \
+    ((((page_sz) - SHARED_HEADER_SZ - 8) / sizeof(uint64_t)) < MAX_SLOT_CAP \
+        ? ((page_sz) - SHARED_HEADER_SZ - 8) / sizeof(uint64_t) : MAX_SLOT_CAP)
+#define SLOT_SZ(page_sz) (8 + SLOT_CAP(page_sz) * sizeof(uint64_t))
+
+// Quantas fatias cabem numa página compartilhada.
+#define SLOTS_PER_PAGE(page_sz) (((page_sz) - SHARED_HEADER_SZ) / SLOT_SZ(page_sz))
+
+// Os campos fixos de uma página de valores. As páginas de uma mesma chave
+// formam uma lista encadeada, e somente a primeira guarda o RRN da última,
+// para que adicionar um valor não precise percorrer a lista.
+typedef struct {
+    uint32_t len;
+    int32_t  next;
+    int32_t  tail;
+} PostingsHeader;
+
+// Endereço do valor `i` dentro de uma página de valores.
+static inline uint8_t *postings_value(uint8_t *page, uint32_t i) {
+    return page + POSTINGS_HEADER_SZ + (size_t)i * sizeof(uint64_t);
+}
+
+static bool decode_postings_header(BTreeMap *btree, const uint8_t *page, PostingsHeader *header) {
+    const uint8_t *ptr = page;
+
+    char marker;
+    decode(&ptr, &marker, sizeof(char));
+    ASSERT(marker == POSTINGS_PAGE);
+
+    decode(&ptr, &header->len , sizeof(uint32_t));
+    decode(&ptr, &header->next, sizeof( int32_t));
+    decode(&ptr, &header->tail, sizeof( int32_t));
+
+    // Uma página corrompida poderia fazer com que lêssemos além dela.
+    ASSERT(header->len <= POSTINGS_PER_PAGE(btree->page_sz));
+
+    return true;
+}
+
+static void encode_postings_header(uint8_t *page, const PostingsHeader *header) {
+    uint8_t *ptr = page;
+
+    char marker = POSTINGS_PAGE;
+    encode(&ptr, &marker      , sizeof(char));
+    encode(&ptr, &header->len , sizeof(uint32_t));
+    encode(&ptr, &header->next, sizeof( int32_t));
+    encode(&ptr, &header->tail, sizeof( int32_t));
+}
+
+// Escreve uma página de valores nova contendo apenas `value`. Se for a primeira
+// página de uma lista, `is_head` deve ser `true`.
+static bool postings_write_new(BTreeMap *btree, uint64_t value, bool is_head, uint32_t *rrn) {
+    ASSERT(allocate_rrn(btree, rrn));
+
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    memset(page, '@', btree->page_sz);
+
+    PostingsHeader header = {
+        .len  = 1,
+        .next = -1,
+        .tail = is_head ? (int32_t)*rrn : -1,
+    };
+    encode_postings_header(page, &header);
+    memcpy(postings_value(page, 0), &value, sizeof(uint64_t));
+
+    return write_node_page(btree, *rrn, page);
+}
+
+// Adiciona `value` ao fim da lista de páginas encadeadas que começa em `head`.
+static bool chain_append(BTreeMap *btree, uint32_t head, uint64_t value) {
+    uint8_t head_page[BTREE_MAX_PAGE_SZ];
+    PostingsHeader head_header;
+    ASSERT(read_node_page(btree, head, head_page));
+    ASSERT(decode_postings_header(btree, head_page, &head_header));
+
+    // Se a lista tiver uma página só, a última página é a própria `head_page`.
+    uint32_t tail = head_header.tail;
+    uint8_t tail_buf[BTREE_MAX_PAGE_SZ];
+    uint8_t *tail_page = head_page;
+    PostingsHeader tail_header = head_header;
+
+    if (tail != head) {
+        tail_page = tail_buf;
+        ASSERT(read_node_page(btree, tail, tail_page));
+        ASSERT(decode_postings_header(btree, tail_page, &tail_header));
+    }
+
+    // Ainda há espaço na última página -> adiciona o valor nela.
+    if (tail_header.len < POSTINGS_PER_PAGE(btree->page_sz)) {
+        memcpy(postings_value(tail_page, tail_header.len), &value, sizeof(uint64_t));
+        tail_header.len++;
+        encode_postings_header(tail_page, &tail_header);
+        return write_node_page(btree, tail, tail_page);
+    }
+
+    // A última página está cheia -> encadeia uma página nova no fim da lista.
+    uint32_t rrn;
+    ASSERT(postings_write_new(btree, value, false, &rrn));
+
+    tail_header.next = rrn;
+    if (tail == head) {
+        tail_header.tail = rrn;
+        encode_postings_header(head_page, &tail_header);
+        return write_node_page(btree, head, head_page);
+    }
+
+    encode_postings_header(tail_page, &tail_header);
+    ASSERT(write_node_page(btree, tail, tail_page));
+
+    head_header.tail = rrn;
+    encode_postings_header(head_page, &head_header);
+    return write_node_page(btree, head, head_page);
+}
+
+// Devolve todas as páginas da lista encadeada que começa em `head` à lista de
+// páginas livres. O primeiro valor da lista é colocado em `first`.
+static bool chain_free(BTreeMap *btree, uint32_t head, int64_t *first) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    PostingsHeader header;
+    int32_t rrn = head;
+
+    while (rrn >= 0) {
+        ASSERT(read_node_page(btree, rrn, page));
+        ASSERT(decode_postings_header(btree, page, &header));
+
+        if (rrn == head) {
+            uint64_t value;
+            memcpy(&value, postings_value(page, 0), sizeof(uint64_t));
+            *first = value;
+        }
+
+        ASSERT(free_rrn(btree, rrn));
+        rrn = header.next;
+    }
+
+    return true;
+}
+
+// Uma fatia de uma página compartilhada. A fatia está livre se `len` for 0.
+typedef struct {
+    uint32_t len;
+    int32_t  overflow;
+} Slot;
+
+// Endereço da fatia `i` dentro de uma página compartilhada.
+static inline uint8_t *slot_at(const BTreeMap *btree, uint8_t *page, uint32_t i) {
+    return page + SHARED_HEADER_SZ + (size_t)i * SLOT_SZ(btree->page_sz);
+}
+
+// Endereço do valor `j` da fatia `i` dentro de uma página compartilhada.
+static inline uint8_t *slot_value(const BTreeMap *btree, uint8_t *page, uint32_t i, uint32_t j) {
+    return slot_at(btree, page, i) + 8 + (size_t)j * sizeof(uint64_t);
+}
+
+// Com chaves duplicadas, o valor de uma entrada é a referência para a fatia
+// onde a lista começa: o RRN da página compartilhada (bits 16 a 47) e a fatia
+// (bits 0 a 15). O valor nunca é negativo, então não se confunde com o -1 das
+// buscas sem resultado.
+static inline uint64_t slot_ref(uint32_t rrn, uint32_t slot) {
+    return (uint64_t)rrn << 16 | slot;
+}
+
+static inline uint32_t slot_ref_rrn(uint64_t ref) {
+    return (ref >> 16) & 0xffffffff;
+}
+
+static inline uint32_t slot_ref_slot(uint64_t ref) {
+    return ref & 0xffff;
+}
+
+// Lê a quantidade de fatias em uso de uma página compartilhada.
+static bool decode_shared_header(BTreeMap *btree, const uint8_t *page, uint32_t *n_used) {
+    const uint8_t *ptr = page;
+
+    char marker;
+    decode(&ptr, &marker, sizeof(char));
+    ASSERT(marker == SHARED_PAGE);
+
+    decode(&ptr, n_used, sizeof(uint32_t));
+    ASSERT(*n_used <= SLOTS_PER_PAGE(btree->page_sz));
+
+    return true;
+}
+
+static void encode_shared_header(uint8_t *page, uint32_t n_used) {
+    uint8_t *ptr = page;
+
+    char marker = SHARED_PAGE;
+    encode(&ptr, &marker, sizeof(char));
+    encode(&ptr, &n_used, sizeof(uint32_t));
+}
+
+static bool decode_slot(const BTreeMap *btree, uint8_t *page, uint32_t i, Slot *slot) {
+    const uint8_t *ptr = slot_at(btree, page, i);
+    decode(&ptr, &slot->len     , sizeof(uint32_t));
+    decode(&ptr, &slot->overflow, sizeof( int32_t));
+
+    // Uma fatia corrompida poderia fazer com que lêssemos além dela.
+    ASSERT(slot->len <= SLOT_CAP(btree->page_sz));
+    return true;
+}
+
+static void encode_slot(const BTreeMap *btree, uint8_t *page, uint32_t i, const Slot *slot) {
+    uint8_t *ptr = slot_at(btree, page, i);
+    encode(&ptr, &slot->len     , sizeof(uint32_t));
+    encode(&ptr, &slot->overflow, sizeof( int32_t));
+}
+
+// Prepara em memória uma página compartilhada com todas as fatias livres.
+static void init_shared_page(BTreeMap *btree, uint8_t *page) {
+    memset(page, '@', btree->page_sz);
+    encode_shared_header(page, 0);
+
+    Slot empty = { .len = 0, .overflow = -1 };
+    for (uint32_t i = 0; i < SLOTS_PER_PAGE(btree->page_sz); i++) {
+        encode_slot(btree, page, i, &empty);
+    }
+}
+
+// Lê a fatia referenciada por `ref` e a página compartilhada que a contém.
+static bool read_slot(BTreeMap *btree, uint64_t ref, uint8_t *page, uint32_t *n_used, Slot *slot) {
+    uint32_t i = slot_ref_slot(ref);
+
+    ASSERT(read_node_page(btree, slot_ref_rrn(ref), page));
+    ASSERT(decode_shared_header(btree, page, n_used));
+    ASSERT(i < SLOTS_PER_PAGE(btree->page_sz));
+    ASSERT(decode_slot(btree, page, i, slot));
+
+    // Uma fatia referenciada nunca está livre.
+    ASSERT(slot->len > 0);
+    return true;
+}
+
+// Cria uma lista de valores contendo apenas `value`, numa fatia livre da
+// página compartilhada atual ou de uma página nova. A referência para a fatia
+// é colocada em `ref`.
+static bool postings_create(BTreeMap *btree, uint64_t value, uint64_t *ref) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    uint32_t per_page = SLOTS_PER_PAGE(btree->page_sz);
+    uint32_t n_used = 0;
+    uint32_t rrn = btree->rrn_shared;
+
+    // A página atual sempre tem uma fatia livre. Sem ela, começa uma nova.
+    if (btree->rrn_shared >= 0) {
+        ASSERT(read_node_page(btree, rrn, page));
+        ASSERT(decode_shared_header(btree, page, &n_used) && n_used < per_page);
+    } else {
+        ASSERT(allocate_rrn(btree, &rrn));
+        init_shared_page(btree, page);
+    }
+
+    uint32_t i = 0;
+    Slot slot;
+    for (; i < per_page; i++) {
+        ASSERT(decode_slot(btree, page, i, &slot));
+        if (slot.len == 0) break;
+    }
+    ASSERT(i < per_page);
+
+    slot = (Slot){ .len = 1, .overflow = -1 };
+    encode_slot(btree, page, i, &slot);
+    memcpy(slot_value(btree, page, i, 0), &value, sizeof(uint64_t));
+    encode_shared_header(page, ++n_used);
+    ASSERT(write_node_page(btree, rrn, page));
+
+    btree->rrn_shared = n_used < per_page ? (int32_t)rrn : -1;
+    *ref = slot_ref(rrn, i);
+
+    return true;
+}
+
+// Adiciona `value` ao fim da lista de valores que começa em `head`. Quando a
+// fatia da lista enche, os próximos valores vão para páginas encadeadas.
+static bool postings_append(BTreeMap *btree, uint64_t head, uint64_t value) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    uint32_t n_used;
+    Slot slot;
+    ASSERT(read_slot(btree, head, page, &n_used, &slot));
+
+    uint32_t i = slot_ref_slot(head);
+
+    if (slot.overflow >= 0) return chain_append(btree, slot.overflow, value);
+
+    if (slot.len < SLOT_CAP(btree->page_sz)) {
+        memcpy(slot_value(btree, page, i, slot.len++), &value, sizeof(uint64_t));
+    } else {
+        uint32_t rrn;
+        ASSERT(postings_write_new(btree, value, true, &rrn));
+        slot.overflow = rrn;
+    }
+
+    encode_slot(btree, page, i, &slot);
+    return write_node_page(btree, slot_ref_rrn(head), page);
+}
+
+// Libera a lista de valores que começa em `head`: a sua fatia e as suas
+// páginas encadeadas. Uma página compartilhada sem fatias em uso volta para a
+// lista de páginas livres. O primeiro valor da lista é colocado em `first`.
+static bool postings_free(BTreeMap *btree, uint64_t head, int64_t *first) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    uint32_t n_used;
+    Slot slot;
+    ASSERT(read_slot(btree, head, page, &n_used, &slot));
+
+    uint64_t value;
+    memcpy(&value, slot_value(btree, page, slot_ref_slot(head), 0), sizeof(uint64_t));
+    *first = value;
+
+    int64_t ignored;
+    if (slot.overflow >= 0) ASSERT(chain_free(btree, slot.overflow, &ignored));
+
+    uint32_t rrn = slot_ref_rrn(head);
+
+    if (--n_used == 0) {
+        if (btree->rrn_shared == (int32_t)rrn) btree->rrn_shared = -1;
+        return free_rrn(btree, rrn);
+    }
+
+    // A fatia liberada será usada pela próxima lista criada.
+    slot = (Slot){ .len = 0, .overflow = -1 };
+    encode_slot(btree, page, slot_ref_slot(head), &slot);
+    encode_shared_header(page, n_used);
+    btree->rrn_shared = rrn;
+
+    return write_node_page(btree, rrn, page);
+}
+
+/**
+ * Prepara a leitura de todos os valores associados a uma chave numa BTree que
+ * aceita chaves duplicadas. Os valores são lidos com `btree_postings_next`, na
+ * ordem em que foram inseridos.
+ *
+ * @param btree - a btree a ser consultada que precisa ter um arquivo vinculado.
+ * @param postings - o leitor da lista de valores.
+ * @param key - a chave de busca.
+ * @return `true` caso `key` esteja contida na btree e `false` caso contrário.
+ *         Em caso de erro, `false` é retornado e `btree_has_error()` retorna
+ *         `true`.
+ */
+bool btree_postings_open(BTreeMap *btree, BTreePostings *postings, int32_t key) {
+    postings->btree = btree;
+    postings->next  = -1;
+    postings->len   = 0;
+    postings->pos   = 0;
+
+    if (!btree->duplicate_keys) {
+        error(btree, "btree does not have duplicate keys, use btree_get instead");
+        return false;
+    }
+
+    int64_t head = find_value(btree, key, &btree->error_msg);
+    if (head < 0) return false;
+
+    // Os primeiros valores estão na fatia, que é lida agora.
+    uint32_t n_used;
+    Slot slot;
+    if (!read_slot(btree, head, postings->page, &n_used, &slot)) {
+        error(btree, "failed to read value list slot of key %d", key);
+        return false;
+    }
+
+    postings->len  = slot.len;
+    postings->next = slot.overflow;
+    postings->base = slot_value(btree, postings->page, slot_ref_slot(head), 0) - postings->page;
+
+    return true;
+}
+
+/**
+ * Avança para o próximo valor da lista, que é colocado em `postings->value`.
+ *
+ * @param postings - o leitor da lista de valores, preparado por
+ *                   `btree_postings_open`.
+ * @return `true` caso haja um próximo valor e `false` caso os valores tenham
+ *         acabado ou em caso de erro.
+ */
+bool btree_postings_next(BTreePostings *postings) {
+    BTreeMap *btree = postings->btree;
+
+    // Lê a próxima página quando os valores da atual acabarem.
+    while (postings->pos == postings->len) {
+        if (postings->next < 0) return false;
+
+        PostingsHeader header;
+        if (!read_node_page(btree, postings->next, postings->page) ||
+            !decode_postings_header(btree, postings->page, &header))
+        {
+            error(btree, "failed to read value list page with RRN %d", postings->next);
+            postings->next = -1;
+            return false;
+        }
+
+        postings->len  = header.len;
+        postings->next = header.next;
+        postings->pos  = 0;
+        postings->base = POSTINGS_HEADER_SZ;
+    }
+
+    const uint8_t *value = postings->page + postings->base + (size_t)postings->pos++ * sizeof(uint64_t);
+    memcpy(&postings->value, value, sizeof(uint64_t));
+    return true;
+}
+
+// Cria e escreve um nó folha contendo apenas um par chave-valor numa página
+// recém alocada. O RRN do nó é colocado em `rrn`.
+static bool write_new_leaf(BTreeMap *btree, Entry entry, uint32_t *rrn) {
+    Node leaf;
+    leaf.is_leaf    = true;
+    leaf.len        = 1;
+    leaf.next       = -1;
+    set_node_entry(&leaf, 0, entry);
+    ASSERT(allocate_rrn(btree, &leaf.rrn));
+
+    *rrn = leaf.rrn;
+    return write_node(btree, &leaf);
+}
+
+// Insere um par chave-valor num nó folha numa determinada posição do nó. Essa
+// função assume que `node->is_leaf` é `true`.
+static void insert_entry_leaf(Node *node, Entry entry, int at) {
+    // Se a inserção deve ser feita no meio do nó, shifta todos os registros
+    // e insere.
+    if (at < node->len) {
+        move_entries(node, at + 1, node, at, node->len - at);
+    }
+
+    set_node_entry(node, at, entry);
+    node->len++;
+}
+
+// Insere um par chave-valor e também o RRN do nó com elementos maiores do que
+// `entry.key` num nó interno numa determinada posição do nó. Essa função assume
+// que `node->is_leaf` é `false`.
+static void insert_entry_inner(Node *node, Entry entry, uint32_t right_rrn, int at) {
+    // Se a inserção deve ser feita no meio do nó, shifta todos os registros
+    // e insere.
     if (at < node->len) {
-        memmove(&node->entries[at + 1], &node->entries[at], (node->len - at) * sizeof(Entry));
+        move_entries(node, at + 1, node, at, node->len - at);
+        memmove(&node->children[at + 2], &node->children[at + 1], (node->len - at) * sizeof(uint32_t));
+    }
+
+    set_node_entry(node, at, entry);
+    node->children[at + 1] = right_rrn;
+    node->len++;
+}
+
+// Um tipo interno que serve somente para representar o comportamento de uma
+// inserção num nó filho. Esse tipo auxiliar ajuda nas funções de inserção.
+typedef struct {
+    // O tipo de inserção que ocorreu
+    enum {
+        INSERT_SPLIT,
+        INSERT_REPLACE,
+        INSERT_FIT,
+        INSERT_FAIL,
+    } type;
+    // A `entry` promovida, somente disponível quando `type = INSERT_SPLIT`
+    Entry entry;
+    // RRN do nó à direita do nó promovido, somente disponível quando `type = INSERT_SPLIT`
+    uint32_t rrn;
+} InsertResult;
+
+// Escreve um nó modificado por uma inserção. Com cópia na escrita, um nó que
+// pertence ao snapshot gravado é escrito numa página nova, e `node->rrn` passa
+// a ser o RRN dela. Cabe ao chamador apontar o pai para a cópia.
+static bool write_node_cow(BTreeMap *btree, Node *node) {
+    if (btree->copy_on_write && node->rrn < btree->rrn_committed) {
+        ASSERT(allocate_rrn(btree, &node->rrn));
+    }
+    return write_node(btree, node);
+}
+
+// Funções que ajudam a criar o tipo `InsertResult`.
+
+static inline InsertResult insertion_fail() {
+    return (InsertResult){ .type = INSERT_FAIL };
+}
+
+static inline InsertResult insertion_split(Entry entry, uint32_t rrn) {
+    return (InsertResult){ .type = INSERT_SPLIT, .entry = entry, .rrn = rrn };
+}
+
+static inline InsertResult insertion_fit() {
+    return (InsertResult){ .type = INSERT_FIT };
+}
+
+static inline InsertResult insertion_replaced(Entry entry) {
+    return (InsertResult){ .type = INSERT_REPLACE, .entry = entry };
+}
+
+// Divide uma folha de uma árvore com folhas encadeadas. Diferente de
+// `node_split`, a entrada na posição `mid` continua na folha criada, que é
+// colocada logo depois de `left` no encadeamento, e somente uma cópia da sua
+// chave é promovida como separador.
+static InsertResult leaf_split(BTreeMap *btree, Node *left, Entry entry, uint32_t mid) {
+    uint32_t order = btree->order;
+
+    Node right;
+    right.is_leaf = true;
+    right.len     = order - mid;
+    right.next    = left->next;
+
+    if (!allocate_rrn(btree, &right.rrn)) {
+        error(btree, "failed to allocate node when inserting entry with key %d", entry.key);
+        return insertion_fail();
+    }
+
+    move_entries(&right, 0, left, mid, right.len);
+
+    left->len  = mid;
+    left->next = right.rrn;
+
+    if (!write_node(btree, left) || !write_node(btree, &right)) {
+        error(btree, "failed to split node when inserting entry with key %d", entry.key);
+        return insertion_fail();
+    }
+
+    Entry separator = { .key = right.keys[0], .value = NULL_RRN };
+    return insertion_split(separator, right.rrn);
+}
+
+// Divide um nó em dois. Cria um novo nó com as chaves maiores do que a chave
+// promovida. Retorna o RRN do nó criado e também a `entry` promovida.
+//
+// Normalmente a chave promovida é a do meio. Com `fill_left`, que indica que
+// `entry` foi inserida no fim do nó mais à direita do seu nível, a árvore está
+// recebendo chaves em ordem crescente e nenhuma outra chave deve cair em
+// `left`, então ele fica o mais cheio possível e o nó criado recebe só o
+// restante.
+static InsertResult node_split(BTreeMap *btree, Node *left, Entry entry, bool fill_left) {
+    uint32_t order = btree->order;
+    assert(left->len == order);
+
+    if (left->is_leaf && btree->linked_leaves)
+        return leaf_split(btree, left, entry, fill_left ? order - 1 : order / 2);
+
+    uint32_t mid = fill_left ? order - 2 : order / 2;
+    Entry promoted = node_entry(left, mid);
+
+    Node right;
+    // O nó a ser criado será um nó folha somente se o nó a ser dividido
+    // também for um nó folha.
+    right.is_leaf = left->is_leaf;
+    right.len     = order - mid - 1;
+
+    if (!allocate_rrn(btree, &right.rrn)) {
+        error(btree, "failed to allocate node when inserting entry with key %d", entry.key);
+        return insertion_fail();
+    }
+
+    move_entries(&right, 0, left, mid + 1, right.len);
+
+    // Se o nó não é uma folha, copia também os filhos à direita da entrada
+    // promovida.
+    if (!right.is_leaf) {
+        memcpy(right.children, &left->children[mid + 1], (right.len + 1) * sizeof(uint32_t));
+    }
+
+    // O nó sendo dividido fica somente com as entradas à esquerda da promovida.
+    left->len = mid;
+
+    // Escreve ambos os nós no disco, tanto o novo nó, quanto o nó já existente
+    // atualizado.
+    if (!write_node_cow(btree, left) || !write_node(btree, &right)) {
+        error(btree, "failed to split node when inserting entry with key %d", entry.key);
+        return insertion_fail();
+    }
+
+    // Como houve um split, retorna o par chave-valor promovido bem como o RRN
+    // do novo nó criado.
+    return insertion_split(promoted, right.rrn);
+}
+
+// Insere um novo par chave-valor na BTree. Essa função assume que o nó raiz já
+// está criado. O nó `head` pode ser modificado. `rightmost` indica se `head` é
+// o último nó do seu nível, ou seja, se a descida sempre seguiu o último filho.
+static InsertResult insert(BTreeMap *btree, Node *head, Entry entry, bool rightmost) {
+    int i = key_position(head, entry.key);
+    bool found = i < head->len && head->keys[i] == entry.key;
+
+    if (found && (head->is_leaf || !btree->linked_leaves)) {
+        // Encontramos outro nó com a mesma chave -> substitui, retorna a anterior.
+        Entry old = node_entry(head, i);
+        set_node_entry(head, i, entry);
+
+        if (!write_node_cow(btree, head)) {
+            error(btree, "failed to replace node entry with key %d", entry.key);
+            return insertion_fail();
+        }
+        // Sinaliza que a chave antiga foi substituída.
+        return insertion_replaced(old);
+    }
+
+    if (head->is_leaf) {
+        // É um nó folha, mas ainda possui espaço disponível -> insere
+        insert_entry_leaf(head, entry, i);
+
+        if (head->len == btree->order) {
+            // É um nó folha que não possui espaço livre -> split. A última
+            // folha passa a ser a folha criada.
+            InsertResult result = node_split(btree, head, entry, rightmost && i == head->len - 1);
+            if (rightmost && result.type == INSERT_SPLIT) btree->rrn_last_leaf = result.rrn;
+            return result;
+        }
+
+        // Atualiza o nó no disco
+        if (!write_node_cow(btree, head)) {
+            error(btree, "failed to write node when inserting entry inplace with key %d", entry.key);
+            return insertion_fail();
+        }
+
+        if (rightmost) btree->rrn_last_leaf = head->rrn;
+        return insertion_fit();
+    }
+
+    // É um nó interno. Com folhas encadeadas, um separador igual à chave
+    // indica que ela está no filho à direita dele.
+    if (found) i++;
+
+    // É um nó interno -> redireciona para o nó filho.
+    Node node;
+    uint32_t node_rrn = head->children[i];
+
+    // Lê o nó filho do disco.
+    if (!read_node(btree, node_rrn, &node)) {
+        error(btree, "failed to read node at RRN %d", node_rrn);
+        return insertion_fail();
+    }
+
+    // Chama a função recursivamente. `result` armazena informações sobre como
+    // foi feita a inserção no nó filho.
+    InsertResult result = insert(btree, &node, entry, rightmost && i == head->len);
+
+    if (result.type == INSERT_FAIL) return result;
+
+    // Com cópia na escrita, o filho pode ter sido escrito numa página nova, e
+    // então o nó atual também é modificado para apontar para ela.
+    bool moved = node.rrn != node_rrn;
+    head->children[i] = node.rrn;
+
+    // Se não houve split, repasse o mesmo resultado.
+    if (result.type != INSERT_SPLIT) {
+        if (moved && !write_node_cow(btree, head)) {
+            error(btree, "failed to write node when copying child at RRN %d", node_rrn);
+            return insertion_fail();
+        }
+        return result;
+    }
+
+    // O nó filho deu split.
+    Entry promoted = result.entry;
+    uint32_t promoted_child = result.rrn;
+
+    // Insere o par chave-valor promovidos no nó atual.
+    insert_entry_inner(head, promoted, promoted_child, i);
+
+    if (head->len == btree->order) {
+        // Não há mais espaço nesse nó -> split
+        return node_split(btree, head, promoted, rightmost && i == head->len - 1);
+    }
+
+    // Ainda há espaço nesse nó -> adiciona entrada
+    if (!write_node_cow(btree, head)) {
+        error(btree, "failed to write node when promoting entry inplace with key %d", promoted.key);
+        return insertion_fail();
+    }
+
+    return insertion_fit();
+}
+
+// Insere um par chave-valor diretamente nos nós da BTree.
+static BTreeResult insert_entry(BTreeMap *btree, int32_t key, uint64_t value) {
+    Entry entry = {
+        .key = key,
+        .value = value,
+    };
+
+    // Se ainda não houver um nó raiz, crie ele.
+    if (btree->rrn_root < 0) {
+        uint32_t rrn;
+        if (!write_new_leaf(btree, entry, &rrn)) {
+            error(btree, "failed to write root node");
+            return BTREE_FAIL;
+        }
+
+        btree->rrn_root = rrn;
+        return BTREE_OK;
+    }
+
+    // Uma chave maior que todas as da árvore sempre desce para a última folha.
+    // Enquanto ela tiver espaço, a entrada é colocada direto no seu fim, sem
+    // ler o caminho desde a raiz, o que torna barata a inserção de chaves em
+    // ordem crescente. Com cópia na escrita, isso só vale enquanto a folha não
+    // pertencer ao snapshot gravado, pois senão o pai também seria copiado.
+    bool last_leaf_shared = btree->copy_on_write && btree->rrn_last_leaf < btree->rrn_committed;
+
+    if (btree->rrn_last_leaf >= 0 && !last_leaf_shared) {
+        Node leaf;
+        if (!read_node(btree, btree->rrn_last_leaf, &leaf)) {
+            error(btree, "failed to read last leaf at RRN %d", btree->rrn_last_leaf);
+            return BTREE_FAIL;
+        }
+
+        if (leaf.len > 0 && key > leaf.keys[leaf.len - 1] && leaf.len + 1 < btree->order) {
+            insert_entry_leaf(&leaf, entry, leaf.len);
+
+            if (!write_node(btree, &leaf)) {
+                error(btree, "failed to write node when inserting entry inplace with key %d", key);
+                return BTREE_FAIL;
+            }
+            return BTREE_OK;
+        }
+    }
+
+    Node root;
+
+    // Lê o nó raiz.
+    if (!read_node(btree, btree->rrn_root, &root)) {
+        error(btree, "failed to read root node at RRN %d", btree->rrn_root);
+        return BTREE_FAIL;
+    }
+
+    // Insere o par chave-valor na btree. Com cópia na escrita, a raiz pode
+    // ter sido escrita numa página nova.
+    InsertResult result = insert(btree, &root, entry, true);
+    if (result.type != INSERT_FAIL) btree->rrn_root = root.rrn;
+
+    // Se o nó raiz deu split, cria uma nova raiz com o par chave-valor
+    // promovido. O nó `root` não é mais necessário e é reaproveitado.
+    if (result.type == INSERT_SPLIT) {
+        Node *new_root = &root;
+        new_root->children[0] = new_root->rrn;
+        new_root->children[1] = result.rrn;
+        set_node_entry(new_root, 0, result.entry);
+        new_root->is_leaf     = false;
+        new_root->len         = 1;
+
+        if (!allocate_rrn(btree, &new_root->rrn) || !write_node(btree, new_root)) {
+            error(btree, "failed to write new root node at RRN %d", new_root->rrn);
+            return BTREE_FAIL;
+        }
+
+        btree->rrn_root = new_root->rrn;
+    }
+
+    if (result.type == INSERT_FAIL) {
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+// Insere um par chave-valor, tratando as listas de valores de chaves
+// duplicadas. É chamada por `btree_insert` com a trava da árvore em modo
+// exclusivo.
+static BTreeResult insert_value(BTreeMap *btree, int32_t key, uint64_t value) {
+    if (btree->map) {
+        error(btree, "btree is read-only");
+        return BTREE_FAIL;
+    }
+
+    if (!btree->duplicate_keys) return insert_entry(btree, key, value);
+
+    int64_t head = find_value(btree, key, &btree->error_msg);
+    if (btree_has_error(btree)) return BTREE_FAIL;
+
+    // A chave ainda não existe -> cria a sua lista de valores.
+    if (head < 0) {
+        uint64_t ref;
+        if (!postings_create(btree, value, &ref)) {
+            error(btree, "failed to create value list for key %d", key);
+            return BTREE_FAIL;
+        }
+        return insert_entry(btree, key, ref);
+    }
+
+    if (!postings_append(btree, head, value)) {
+        error(btree, "failed to append to value list of key %d", key);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Insere um par chave-valor na BTree. Assume que `btree` já possua algum
+ * arquivo vinculado. Caso a btree aceite chaves duplicadas, `value` é
+ * adicionado ao fim da lista de valores de `key`. Outras threads podem buscar
+ * na btree com `BTreeReader`s durante a inserção.
+ *
+ * @param btree - a btree no qual inserir.
+ * @param key - a chave usada para ordenação da btree.
+ * @param value - o valor associado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_insert(BTreeMap *btree, int32_t key, uint64_t value) {
+    latch_write(btree);
+    BTreeResult result = insert_value(btree, key, value);
+    latch_release(btree);
+
+    return result;
+}
+
+/* Remoção */
+
+// Remove a entrada na posição `at` de um nó folha.
+static void remove_entry_leaf(Node *node, int at) {
+    move_entries(node, at, node, at + 1, node->len - at - 1);
+    node->len--;
+}
+
+// Remove a entrada na posição `at` de um nó interno junto do filho à direita
+// dela.
+static void remove_entry_inner(Node *node, int at) {
+    move_entries(node, at, node, at + 1, node->len - at - 1);
+    memmove(&node->children[at + 1], &node->children[at + 2], (node->len - at - 1) * sizeof(uint32_t));
+    node->len--;
+}
+
+// Move a última entrada de `left` para o pai, e a entrada do pai que separa
+// `left` de `child` para o início de `child`.
+static void borrow_from_left(Node *parent, int at, Node *left, Node *child) {
+    move_entries(child, 1, child, 0, child->len);
+    set_node_entry(child, 0, node_entry(parent, at - 1));
+
+    if (!child->is_leaf) {
+        memmove(&child->children[1], &child->children[0], (child->len + 1) * sizeof(uint32_t));
+        child->children[0] = left->children[left->len];
+    }
+    child->len++;
+
+    set_node_entry(parent, at - 1, node_entry(left, left->len - 1));
+    left->len--;
+}
+
+// Move a primeira entrada de `right` para o pai, e a entrada do pai que separa
+// `child` de `right` para o fim de `child`.
+static void borrow_from_right(Node *parent, int at, Node *child, Node *right) {
+    set_node_entry(child, child->len, node_entry(parent, at));
+    if (!child->is_leaf) {
+        child->children[child->len + 1] = right->children[0];
+    }
+    child->len++;
+
+    set_node_entry(parent, at, node_entry(right, 0));
+
+    move_entries(right, 0, right, 1, right->len - 1);
+    if (!right->is_leaf) {
+        memmove(&right->children[0], &right->children[1], right->len * sizeof(uint32_t));
+    }
+    right->len--;
+}
+
+// Junta `right` ao fim de `left` junto da entrada do pai na posição `at` que
+// separa os dois. A página de `right` é devolvida à lista de páginas livres.
+static bool merge_nodes(BTreeMap *btree, Node *parent, int at, Node *left, Node *right) {
+    set_node_entry(left, left->len, node_entry(parent, at));
+    move_entries(left, left->len + 1, right, 0, right->len);
+
+    if (!left->is_leaf) {
+        memcpy(&left->children[left->len + 1], right->children, (right->len + 1) * sizeof(uint32_t));
+    }
+    left->len += right->len + 1;
+
+    remove_entry_inner(parent, at);
+
+    ASSERT(write_node(btree, left));
+    return free_rrn(btree, right->rrn);
+}
+
+// Garante que o filho na posição `at` de `parent` tenha ao menos o número
+// mínimo de entradas depois de uma remoção. Caso não tenha, pega uma entrada
+// emprestada de um irmão que possa ceder uma, ou então junta o filho com um dos
+// irmãos. Os nós modificados são escritos no disco, inclusive `parent`.
+static bool rebalance_child(BTreeMap *btree, Node *parent, int at, Node *child) {
+    uint32_t min_len = btree->order / 2;
+
+    if (child->len >= min_len) return true;
+
+    Node sibling;
+
+    if (at > 0) {
+        ASSERT(read_node(btree, parent->children[at - 1], &sibling));
+
+        if (sibling.len > min_len) {
+            borrow_from_left(parent, at, &sibling, child);
+            ASSERT(write_node(btree, &sibling) && write_node(btree, child));
+        } else {
+            ASSERT(merge_nodes(btree, parent, at - 1, &sibling, child));
+        }
+    } else {
+        ASSERT(read_node(btree, parent->children[at + 1], &sibling));
+
+        if (sibling.len > min_len) {
+            borrow_from_right(parent, at, child, &sibling);
+            ASSERT(write_node(btree, &sibling) && write_node(btree, child));
+        } else {
+            ASSERT(merge_nodes(btree, parent, at, child, &sibling));
+        }
+    }
+
+    return write_node(btree, parent);
+}
+
+// Remove a maior entrada da subárvore de `head` e coloca ela em `removed`.
+static bool remove_max(BTreeMap *btree, Node *head, Entry *removed) {
+    if (head->is_leaf) {
+        *removed = node_entry(head, head->len - 1);
+        head->len--;
+        return write_node(btree, head);
+    }
+
+    Node child;
+    ASSERT(read_node(btree, head->children[head->len], &child));
+    ASSERT(remove_max(btree, &child, removed));
+
+    return rebalance_child(btree, head, head->len, &child);
+}
+
+// O resultado de uma remoção numa subárvore.
+typedef enum {
+    REMOVE_OK,
+    REMOVE_NOT_FOUND,
+    REMOVE_FAIL,
+} RemoveResult;
+
+// Remove a entrada com chave `key` da subárvore de `head` e coloca ela em
+// `removed`. O nó `head` pode ser modificado e, caso fique com menos entradas
+// do que o mínimo, é o chamador que deve rebalanceá-lo.
+static RemoveResult remove_key(BTreeMap *btree, Node *head, int32_t key, Entry *removed) {
+    int i = key_position(head, key);
+    bool found = i < head->len && head->keys[i] == key;
+
+    if (head->is_leaf) {
+        if (!found) return REMOVE_NOT_FOUND;
+
+        *removed = node_entry(head, i);
+        remove_entry_leaf(head, i);
+
+        if (!write_node(btree, head)) {
+            error(btree, "failed to write node when removing entry with key %d", key);
+            return REMOVE_FAIL;
+        }
+        return REMOVE_OK;
+    }
+
+    Node child;
+    if (!read_node(btree, head->children[i], &child)) {
+        error(btree, "failed to read node at RRN %d", head->children[i]);
+        return REMOVE_FAIL;
+    }
+
+    if (found) {
+        // A entrada está num nó interno -> é substituída pela sua antecessora,
+        // a maior entrada da subárvore à esquerda, que está numa folha.
+        *removed = node_entry(head, i);
+
+        Entry predecessor;
+        if (!remove_max(btree, &child, &predecessor)) {
+            error(btree, "failed to remove predecessor of key %d", key);
+            return REMOVE_FAIL;
+        }
+        set_node_entry(head, i, predecessor);
+    } else {
+        RemoveResult result = remove_key(btree, &child, key, removed);
+        if (result != REMOVE_OK) return result;
+    }
+
+    // Quando a entrada estava em `head`, ele já foi modificado e precisa ser
+    // escrito mesmo que o filho não precise ser rebalanceado.
+    if (!rebalance_child(btree, head, i, &child) || (found && !write_node(btree, head))) {
+        error(btree, "failed to rebalance node at RRN %d", child.rrn);
+        return REMOVE_FAIL;
+    }
+
+    return REMOVE_OK;
+}
+
+// Remove uma chave de uma árvore com folhas encadeadas. A entrada é removida
+// apenas da sua folha, sem rebalancear os nós: os separadores continuam
+// delimitando as chaves de cada filho mesmo que deixem de existir nas folhas.
+// Uma folha que fica vazia continua no encadeamento, exceto a raiz.
+static int64_t remove_from_leaf(BTreeMap *btree, int32_t key) {
+    Node node;
+    if (!read_node(btree, btree->rrn_root, &node)) {
+        error(btree, "failed to read root node at RRN %d", btree->rrn_root);
+        return -1;
+    }
+
+    while (!node.is_leaf) {
+        int i = key_position(&node, key);
+        if (i < node.len && node.keys[i] == key) i++;
+
+        uint32_t child = node.children[i];
+        if (!read_node(btree, child, &node)) {
+            error(btree, "failed to read node at RRN %d", child);
+            return -1;
+        }
+    }
+
+    int i = key_position(&node, key);
+    if (i == node.len || node.keys[i] != key) return -1;
+
+    int64_t value = node.values[i];
+    remove_entry_leaf(&node, i);
+
+    if (node.len == 0 && node.rrn == btree->rrn_root) {
+        btree->rrn_root = -1;
+
+        if (!free_rrn(btree, node.rrn)) {
+            error(btree, "failed to free root node at RRN %d", node.rrn);
+            return -1;
+        }
+    } else if (!write_node(btree, &node)) {
+        error(btree, "failed to write node when removing entry with key %d", key);
+        return -1;
+    }
+
+    return value;
+}
+
+// Remove uma chave dos nós da BTree e retorna o valor guardado para ela.
+static int64_t remove_entry(BTreeMap *btree, int32_t key) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return -1;
+    }
+
+    if (btree->rrn_root < 0) return -1;
+
+    // A remoção pode liberar a última folha.
+    btree->rrn_last_leaf = -1;
+
+    if (btree->linked_leaves) return remove_from_leaf(btree, key);
+
+    Node root;
+    if (!read_node(btree, btree->rrn_root, &root)) {
+        error(btree, "failed to read root node at RRN %d", btree->rrn_root);
+        return -1;
+    }
+
+    Entry removed;
+    RemoveResult result = remove_key(btree, &root, key, &removed);
+    if (result != REMOVE_OK) return -1;
+
+    // A raiz pode ficar com menos entradas que o mínimo. Somente quando fica
+    // vazia, o seu único filho passa a ser a raiz, ou a árvore fica vazia.
+    if (root.len == 0) {
+        btree->rrn_root = root.is_leaf ? -1 : (int32_t)root.children[0];
+
+        if (!free_rrn(btree, root.rrn)) {
+            error(btree, "failed to free root node at RRN %d", root.rrn);
+            return -1;
+        }
+    }
+
+    return removed.value;
+}
+
+/**
+ * Remove uma chave da BTree. Os nós que ficarem com menos entradas do que o
+ * mínimo pegam entradas emprestadas dos irmãos ou são juntados a eles, e as
+ * páginas que deixarem de ser usadas são reaproveitadas em inserções futuras.
+ * Com folhas encadeadas, a entrada é apenas retirada da sua folha. Não é
+ * suportada com cópia na escrita.
+ *
+ * @param btree - a btree da qual remover, que precisa ter um arquivo vinculado.
+ * @param key - a chave a ser removida.
+ * @return o valor que estava associado à `key` caso `key` estivesse contida na
+ *         btree e -1 caso contrário. Com chaves duplicadas, todos os valores de
+ *         `key` são removidos e o primeiro deles é retornado. Em caso de erro,
+ *         -1 é retornado e `btree_has_error()` retorna `true`. Outras
+ *         threads podem buscar na btree com `BTreeReader`s durante a remoção.
+ */
+int64_t btree_remove(BTreeMap *btree, int32_t key) {
+    if (btree->map) {
+        error(btree, "btree is read-only");
+        return -1;
+    }
+
+    // Rebalancear os nós modificaria também os irmãos, que precisariam ser
+    // copiados junto com o caminho até a raiz.
+    if (btree->copy_on_write) {
+        error(btree, "removal is not supported with copy-on-write");
+        return -1;
+    }
+
+    latch_write(btree);
+
+    int64_t value = remove_entry(btree, key);
+
+    if (btree->duplicate_keys && value >= 0) {
+        uint64_t head = value;
+        if (!postings_free(btree, head, &value)) {
+            error(btree, "failed to free value list of key %d", key);
+            value = -1;
+        }
+    }
+
+    latch_release(btree);
+    return value;
+}
+
+/* Carregamento em massa */
+
+// Número máximo de entradas numa subárvore de altura `height` (0 para uma
+// folha) quando cada nó possui `per_node` entradas.
+static uint64_t subtree_capacity(uint32_t per_node, uint32_t height) {
+    uint64_t cap = per_node;
+    for (uint32_t h = 0; h < height; h++)
+        cap = (per_node + 1) * cap + per_node;
+    return cap;
+}
+
+// Constrói uma subárvore de altura `height` contendo exatamente os pares
+// `pairs[0..n)`. As entradas são distribuídas igualmente entre os filhos e os
+// nós são escritos em pós-ordem, de modo que os RRNs são alocados e escritos
+// sequencialmente. Exceto a raiz da árvore (`is_root`), todos os nós ficam com
+// ao menos o número mínimo de entradas que as remoções esperam. O RRN da raiz
+// da subárvore é colocado em `rrn`.
+static bool bulk_build(
+    BTreeMap *btree,
+    const BTreePair *pairs,
+    uint64_t n,
+    uint32_t height,
+    uint32_t per_node,
+    bool is_root,
+    uint32_t *rrn
+) {
+    ASSERT(n > 0);
+
+    Node node;
+
+    if (height == 0) {
+        node.is_leaf = true;
+        node.len     = n;
+
+        for (uint64_t i = 0; i < n; i++) {
+            set_node_entry(&node, i, (Entry){ .key = pairs[i].key, .value = pairs[i].value });
+        }
+    } else {
+        // Usa o menor número de filhos tal que cada um caiba numa subárvore de
+        // altura `height - 1`. Cada filho é separado do próximo por uma entrada
+        // que fica nesse nó.
+        uint64_t child_cap  = subtree_capacity(per_node, height - 1);
+        uint64_t n_children = (n + 1 + child_cap) / (child_cap + 1);
+
+        // Mas cada filho precisa ter entre o mínimo e o máximo de entradas de
+        // uma subárvore dessa altura, e esse nó, entre o mínimo e o máximo de
+        // filhos.
+        uint32_t min_len   = btree->order / 2;
+        uint64_t child_min = subtree_capacity(min_len, height - 1);
+        uint64_t child_max = subtree_capacity(btree->order - 1, height - 1);
+
+        uint64_t lo = (n + 1 + child_max) / (child_max + 1);
+        uint64_t hi = (n + 1) / (child_min + 1);
+        if (lo < (is_root ? 2 : min_len + 1)) lo = is_root ? 2 : min_len + 1;
+        if (hi > btree->order) hi = btree->order;
+        ASSERT(lo <= hi);
+
+        if (n_children < lo) n_children = lo;
+        if (n_children > hi) n_children = hi;
+
+        uint64_t remaining = n - (n_children - 1);
+        uint64_t base      = remaining / n_children;
+        uint64_t extra     = remaining % n_children;
+
+        node.is_leaf = false;
+        node.len     = n_children - 1;
+
+        uint64_t at = 0;
+        for (uint64_t c = 0; c < n_children; c++) {
+            uint64_t count = base + (c < extra);
+            ASSERT(bulk_build(btree, &pairs[at], count, height - 1, per_node, false, &node.children[c]));
+            at += count;
+
+            if (c + 1 < n_children) {
+                set_node_entry(&node, c, (Entry){ .key = pairs[at].key, .value = pairs[at].value });
+                at++;
+            }
+        }
+    }
+
+    node.rrn = btree->next_rrn++;
+    ASSERT(write_node(btree, &node));
+
+    *rrn = node.rrn;
+    return true;
+}
+
+// Constrói uma árvore com folhas encadeadas contendo os pares `pairs[0..n)`.
+// As folhas são escritas primeiro, em sequência, de modo que cada uma aponta
+// para a página seguinte. Depois, cada nível de nós internos é construído a
+// partir do nível de baixo até restar somente a raiz, cujo RRN é colocado em
+// `rrn`.
+static bool bulk_build_linked(
+    BTreeMap *btree,
+    const BTreePair *pairs,
+    uint64_t n,
+    uint32_t per_node,
+    uint32_t *rrn
+) {
+    Node node;
+
+    // A menor chave da subárvore e o RRN de cada nó do nível atual.
+    uint64_t n_level = (n + per_node - 1) / per_node;
+    BTreePair *level = (BTreePair *)malloc(n_level * sizeof(BTreePair));
+
+    uint64_t base  = n / n_level;
+    uint64_t extra = n % n_level;
+    uint64_t at    = 0;
+
+    for (uint64_t l = 0; l < n_level; l++) {
+        node.is_leaf = true;
+        node.len     = base + (l < extra);
+        node.rrn     = btree->next_rrn++;
+        node.next    = l + 1 < n_level ? (int32_t)node.rrn + 1 : -1;
+
+        for (uint32_t i = 0; i < node.len; i++) {
+            set_node_entry(&node, i, (Entry){ .key = pairs[at + i].key, .value = pairs[at + i].value });
+        }
+
+        level[l] = (BTreePair){ .key = pairs[at].key, .value = node.rrn };
+        at += node.len;
+
+        if (!write_node(btree, &node)) {
+            free(level);
+            return false;
+        }
+    }
+
+    // Cada nó interno tem até `per_node + 1` filhos, e o separador entre dois
+    // filhos é a menor chave do filho à direita. Como cada nó ocupa a posição
+    // do seu primeiro filho ou uma anterior, o nível é reescrito no mesmo vetor.
+    while (n_level > 1) {
+        uint64_t n_parents = (n_level + per_node) / (per_node + 1);
+
+        base  = n_level / n_parents;
+        extra = n_level % n_parents;
+        at    = 0;
+
+        for (uint64_t p = 0; p < n_parents; p++) {
+            uint64_t count = base + (p < extra);
+
+            node.is_leaf = false;
+            node.len     = count - 1;
+            node.rrn     = btree->next_rrn++;
+
+            for (uint64_t c = 0; c < count; c++) {
+                node.children[c] = level[at + c].value;
+                if (c > 0) set_node_entry(&node, c - 1, (Entry){ .key = level[at + c].key, .value = NULL_RRN });
+            }
+
+            level[p] = (BTreePair){ .key = level[at].key, .value = node.rrn };
+            at += count;
+
+            if (!write_node(btree, &node)) {
+                free(level);
+                return false;
+            }
+        }
+
+        n_level = n_parents;
+    }
+
+    *rrn = level[0].value;
+    free(level);
+
+    return true;
+}
+
+// Escreve em sequência as listas de valores de cada chave de `pairs`, que está
+// ordenado. Os primeiros valores de cada chave ocupam a próxima fatia das
+// páginas compartilhadas, e os que não couberem, páginas encadeadas logo em
+// seguida. Para cada chave, coloca em `heads` um par com a chave e a
+// referência para a sua fatia, e em `n_heads` o número de chaves.
+static bool bulk_write_postings(
+    BTreeMap *btree,
+    const BTreePair *pairs,
+    size_t n,
+    BTreePair *heads,
+    size_t *n_heads
+) {
+    uint32_t per_page = POSTINGS_PER_PAGE(btree->page_sz);
+    uint32_t per_shared = SLOTS_PER_PAGE(btree->page_sz);
+    size_t   slot_cap   = SLOT_CAP(btree->page_sz);
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+    uint8_t shared[BTREE_MAX_PAGE_SZ];
+
+    // A página compartilhada sendo preenchida, que só é escrita quando enche.
+    uint32_t rrn_shared = 0;
+    uint32_t n_used = per_shared;
+
+    *n_heads = 0;
+
+    for (size_t begin = 0, end; begin < n; begin = end) {
+        for (end = begin + 1; end < n && pairs[end].key == pairs[begin].key; end++);
+
+        if (n_used == per_shared) {
+            rrn_shared = btree->next_rrn++;
+            init_shared_page(btree, shared);
+            n_used = 0;
+        }
+
+        size_t   in_slot = end - begin < slot_cap ? end - begin : slot_cap;
+        size_t   rest    = end - begin - in_slot;
+        uint32_t n_pages = (rest + per_page - 1) / per_page;
+        uint32_t head    = btree->next_rrn;
+
+        Slot slot = {
+            .len      = in_slot,
+            .overflow = n_pages > 0 ? (int32_t)head : -1,
+        };
+        encode_slot(btree, shared, n_used, &slot);
+        for (uint32_t i = 0; i < in_slot; i++) {
+            memcpy(slot_value(btree, shared, n_used, i), &pairs[begin + i].value, sizeof(uint64_t));
+        }
+
+        for (uint32_t p = 0; p < n_pages; p++) {
+            uint32_t rrn   = btree->next_rrn++;
+            size_t   first = begin + in_slot + (size_t)p * per_page;
+
+            PostingsHeader header = {
+                .len  = (end - first < per_page) ? end - first : per_page,
+                .next = p + 1 < n_pages ? (int32_t)rrn + 1 : -1,
+                .tail = p == 0 ? (int32_t)(head + n_pages - 1) : -1,
+            };
+
+            memset(page, '@', btree->page_sz);
+            encode_postings_header(page, &header);
+            for (uint32_t i = 0; i < header.len; i++) {
+                memcpy(postings_value(page, i), &pairs[first + i].value, sizeof(uint64_t));
+            }
+
+            ASSERT(write_node_page(btree, rrn, page));
+        }
+
+        heads[(*n_heads)++] = (BTreePair){ .key = pairs[begin].key, .value = slot_ref(rrn_shared, n_used) };
+
+        encode_shared_header(shared, ++n_used);
+        if (n_used == per_shared) ASSERT(write_node_page(btree, rrn_shared, shared));
+    }
+
+    // A última página compartilhada recebe as próximas listas criadas.
+    if (n_used < per_shared) {
+        ASSERT(write_node_page(btree, rrn_shared, shared));
+        btree->rrn_shared = rrn_shared;
+    }
+
+    return true;
+}
+
+/**
+ * Constrói a BTree de baixo para cima a partir de pares ordenados. Os nós são
+ * preenchidos até `fill_factor` da sua capacidade e escritos em sequência no
+ * arquivo, sem os splits que ocorreriam com `btree_insert`. Assume que `btree`
+ * já possua algum arquivo vinculado e que esteja vazia.
+ *
+ * @param btree - a btree a ser construída.
+ * @param pairs - os pares chave-valor em ordem estritamente crescente de chave.
+ *                Caso a btree aceite chaves duplicadas, chaves iguais podem ser
+ *                consecutivas e os seus valores são mantidos na mesma ordem.
+ * @param n - o número de pares.
+ * @param fill_factor - fração de cada nó a ser ocupada, no intervalo (0, 1].
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_bulk_load(BTreeMap *btree, const BTreePair *pairs, size_t n, double fill_factor) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (btree->map) {
+        error(btree, "btree is read-only");
+        return BTREE_FAIL;
+    }
+
+    if (btree->rrn_root >= 0) {
+        error(btree, "bulk loading is only possible into an empty btree");
+        return BTREE_FAIL;
+    }
+
+    if (!(fill_factor > 0 && fill_factor <= 1)) {
+        error(btree, "invalid fill factor %f", fill_factor);
+        return BTREE_FAIL;
+    }
+
+    // Com chaves duplicadas, chaves iguais podem ser consecutivas.
+    for (size_t i = 1; i < n; i++) {
+        if (pairs[i - 1].key > pairs[i].key || (pairs[i - 1].key == pairs[i].key && !btree->duplicate_keys)) {
+            error(btree, "keys must be unique and sorted, but %d comes before %d",
+                  pairs[i - 1].key, pairs[i].key);
+            return BTREE_FAIL;
+        }
+    }
+
+    if (n == 0) return BTREE_OK;
+
+    latch_write(btree);
+
+    // Numa btree vazia nenhuma página está em uso, então o arquivo é reescrito
+    // desde o início, em sequência, descartando a lista de páginas livres. Com
+    // cópia na escrita, as páginas do snapshot gravado são preservadas e a
+    // árvore é escrita depois delas.
+    if (!btree->copy_on_write) btree->next_rrn = 0;
+    btree->rrn_free   = -1;
+    btree->rrn_shared = -1;
+
+    // Com chaves duplicadas, as listas de valores são escritas primeiro e os
+    // nós passam a guardar apenas uma entrada por chave.
+    BTreePair *heads = NULL;
+    if (btree->duplicate_keys) {
+        heads = (BTreePair *)malloc(n * sizeof(BTreePair));
+
+        if (!bulk_write_postings(btree, pairs, n, heads, &n)) {
+            latch_release(btree);
+            free(heads);
+            error(btree, "failed to write value list at RRN %d during bulk load", btree->next_rrn - 1);
+            return BTREE_FAIL;
+        }
+        pairs = heads;
+    }
+
+    // Número de entradas por nó. Com ao menos duas entradas por nó, a
+    // distribuição de `bulk_build` nunca produz um nó vazio.
+    uint32_t per_node = fill_factor * (btree->order - 1);
+    if (per_node < 2) per_node = 2;
+
+    uint32_t rrn_root;
+    bool ok;
+
+    if (btree->linked_leaves) {
+        ok = bulk_build_linked(btree, pairs, n, per_node, &rrn_root);
+    } else {
+        // A menor altura em que todas as entradas cabem. Uma raiz interna tem
+        // ao menos dois filhos, então com poucas entradas para isso a árvore
+        // fica mais baixa e os nós, mais cheios que `fill_factor`.
+        uint32_t height = 0;
+        while (subtree_capacity(per_node, height) < n) height++;
+        while (height > 0 && n + 1 < 2 * (subtree_capacity(btree->order / 2, height - 1) + 1)) height--;
+
+        ok = bulk_build(btree, pairs, n, height, per_node, true, &rrn_root);
+    }
+
+    if (heads) free(heads);
+
+    if (ok) btree->rrn_root = rrn_root;
+    latch_release(btree);
+
+    if (!ok) {
+        error(btree, "failed to write node at RRN %d during bulk load", btree->next_rrn - 1);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/* Funcionalidades adicionais */
+
+// Imprime um único nó da árvore.
+static void print_node(const Node *node) {
+    printf("[%d]{ %d: %ld", node->rrn, node->keys[0], node->values[0]);
+    for (int i = 1; i < node->len; i++) {
+        printf(", %d: %ld", node->keys[i], node->values[i]);
+    }
+    printf(" }");
+}
+
+// Os RRNs dos nós de um nível da árvore, da esquerda para a direita.
+typedef struct {
+    uint32_t *rrns;
+    size_t    len;
+    size_t    cap;
+} Level;
+
+static void level_push(Level *level, uint32_t rrn) {
+    if (level->len == level->cap) {
+        level->cap  = level->cap ? 2 * level->cap : 16;
+        level->rrns = (uint32_t *)realloc(level->rrns, level->cap * sizeof(uint32_t));
+    }
+    level->rrns[level->len++] = rrn;
+}
+
+// Coloca os filhos de `node` no fim do nível de baixo.
+static void level_push_children(Level *below, const Node *node) {
+    if (node->is_leaf) return;
+
+    for (int i = 0; i < node->len + 1; i++) {
+        level_push(below, node->children[i]);
     }
+}
 
-    node->entries[at] = entry;
-    node->len++;
+// Conta as páginas da lista de páginas livres.
+static bool count_free_pages(BTreeMap *btree, uint32_t *n_free) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+
+    *n_free = 0;
+    for (int32_t rrn = btree->rrn_free; rrn >= 0; (*n_free)++) {
+        // Uma lista maior que o arquivo só pode ter um ciclo.
+        ASSERT(*n_free < btree->next_rrn);
+        ASSERT(read_node_page(btree, rrn, page));
+
+        const uint8_t *ptr = page;
+        char marker;
+        decode(&ptr, &marker, sizeof(char));
+        ASSERT(marker == FREE_PAGE);
+
+        decode(&ptr, &rrn, sizeof(int32_t));
+    }
+
+    return true;
 }
 
-// Insere um par chave-valor e também o RRN do nó com elementos maiores do que
-// `entry.key` num nó interno numa determinada posição do nó. Essa função assume
-// que `node->is_leaf` é `false`.
-static void insert_entry_inner(Node *node, Entry entry, uint32_t right_rrn, int at) {
-    // Se a inserção deve ser feita no meio do nó, shifta todos os registros
-    // e insere.
-    if (at < node->len) {
-        memmove(&node->entries[at + 1] , &node->entries[at]     , (node->len - at) * sizeof(Entry));
-        memmove(&node->children[at + 2], &node->children[at + 1], (node->len - at) * sizeof(uint32_t));
+// Conta as páginas das listas de valores das entradas de `node` que ainda não
+// foram vistas. Várias chaves compartilham a mesma página, então as páginas já
+// contadas ficam marcadas em `seen`.
+static bool count_postings_pages(BTreeMap *btree, const Node *node, uint8_t *seen, uint32_t *n_postings) {
+    uint8_t page[BTREE_MAX_PAGE_SZ];
+
+    for (int i = 0; i < node->len; i++) {
+        uint64_t ref = node->values[i];
+        uint32_t rrn = slot_ref_rrn(ref);
+        ASSERT(rrn < btree->next_rrn);
+
+        uint32_t n_used;
+        Slot slot;
+        ASSERT(read_slot(btree, ref, page, &n_used, &slot));
+        if (!seen[rrn]) (*n_postings)++;
+        seen[rrn] = 1;
+
+        // As páginas encadeadas pertencem a uma única lista.
+        PostingsHeader header;
+        for (int32_t next = slot.overflow; next >= 0; next = header.next) {
+            ASSERT(next < (int32_t)btree->next_rrn && !seen[next]);
+            ASSERT(read_node_page(btree, next, page));
+            ASSERT(decode_postings_header(btree, page, &header));
+            seen[next] = 1;
+            (*n_postings)++;
+        }
     }
 
-    node->entries[at] = entry;
-    node->children[at + 1] = right_rrn;
-    node->len++;
+    return true;
 }
 
-// Um tipo interno que serve somente para representar o comportamento de uma
-// inserção num nó filho. Esse tipo auxiliar ajuda nas funções de inserção.
-typedef struct {
-    // O tipo de inserção que ocorreu
-    enum {
-        INSERT_SPLIT,
-        INSERT_REPLACE,
-        INSERT_FIT,
-        INSERT_FAIL,
-    } type;
-    // A `entry` promovida, somente disponível quando `type = INSERT_SPLIT`
-    Entry entry;
-    // RRN do nó à direita do nó promovido, somente disponível quando `type = INSERT_SPLIT`
-    uint32_t rrn;
-} InsertResult;
+// Percorre a árvore nível por nível acumulando as estatísticas em `stats`, que
+// já possui os campos que não dependem dos nós. Com chaves duplicadas, as
+// páginas das listas de valores também são contadas, marcadas em `seen`.
+static bool collect_stats(BTreeMap *btree, BTreeStats *stats, uint8_t *seen) {
+    if (btree->rrn_root < 0) return true;
 
-// Funções que ajudam a criar o tipo `InsertResult`.
+    Level level = { 0 };
+    Level below = { 0 };
+    level_push(&level, btree->rrn_root);
 
-static inline InsertResult insertion_fail() {
-    return (InsertResult){ .type = INSERT_FAIL };
+    uint64_t n_entries = 0;
+    bool ok = true;
+
+    while (ok && level.len > 0) {
+        if (stats->height == BTREE_CURSOR_MAX_DEPTH) {
+            ok = false;
+            break;
+        }
+
+        stats->level_nodes[stats->height++] = level.len;
+        stats->n_nodes += level.len;
+
+        for (size_t i = 0; ok && i < level.len; i++) {
+            Node node;
+            ok = read_node(btree, level.rrns[i], &node);
+            if (!ok || node.len == 0) continue;
+
+            n_entries += node.len;
+            level_push_children(&below, &node);
+
+            // Com folhas encadeadas, as entradas dos nós internos são apenas
+            // cópias de chaves que estão nas folhas.
+            if (!node.is_leaf && btree->linked_leaves) continue;
+
+            if (seen) ok = count_postings_pages(btree, &node, seen, &stats->postings_pages);
+
+            int32_t min = node.keys[0];
+            int32_t max = node.keys[node.len - 1];
+            if (stats->n_keys == 0 || min < stats->min_key) stats->min_key = min;
+            if (stats->n_keys == 0 || max > stats->max_key) stats->max_key = max;
+            stats->n_keys += node.len;
+        }
+
+        // O nível de baixo passa a ser o atual, e o vetor do nível atual é
+        // reaproveitado.
+        Level tmp = level;
+        level     = below;
+        below     = tmp;
+        below.len = 0;
+    }
+
+    free(level.rrns);
+    free(below.rrns);
+
+    // Uma árvore cuja raiz não pode ser lida não possui nós contados.
+    if (stats->n_nodes > 0)
+        stats->fill_factor = (double)n_entries / ((double)stats->n_nodes * (btree->order - 1));
+
+    return ok;
 }
 
-static inline InsertResult insertion_split(Entry entry, uint32_t rrn) {
-    return (InsertResult){ .type = INSERT_SPLIT, .entry = entry, .rrn = rrn };
+/**
+ * Calcula as estatísticas da estrutura da `btree`, como a altura, o número de
+ * nós de cada nível e a ocupação média dos nós. Todos os nós alcançáveis a
+ * partir da raiz, as listas de valores das chaves duplicadas e a lista de
+ * páginas livres são lidos.
+ *
+ * @param btree - a btree a ser consultada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param stats - referência mutável para onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult btree_stats(BTreeMap *btree, BTreeStats *stats) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    *stats = (BTreeStats){
+        .page_sz = btree->page_sz,
+        .order   = btree->order,
+    };
+
+    latch_read(btree);
+    stats->n_pages = btree->next_rrn;
+
+    uint8_t *seen = NULL;
+    if (btree->duplicate_keys) seen = (uint8_t *)calloc(stats->n_pages + 1, sizeof(uint8_t));
+
+    bool free_ok  = count_free_pages(btree, &stats->free_pages);
+    bool nodes_ok = free_ok && (!btree->duplicate_keys || seen) && collect_stats(btree, stats, seen);
+    latch_release(btree);
+    free(seen);
+
+    if (!free_ok) {
+        error(btree, "failed to read the free page list");
+        return BTREE_FAIL;
+    }
+
+    if (!nodes_ok) {
+        error(btree, "failed to read the nodes at level %d", stats->height);
+        return BTREE_FAIL;
+    }
+
+    // As páginas que não são alcançadas pela árvore nem estão livres, como os
+    // nós substituídos com cópia na escrita e as páginas liberadas por versões
+    // que não mantinham a lista livre, são órfãs.
+    uint32_t used = stats->n_nodes + stats->free_pages + stats->postings_pages;
+    stats->orphan_pages = used < stats->n_pages ? stats->n_pages - used : 0;
+
+    return BTREE_OK;
 }
 
-static inline InsertResult insertion_fit() {
-    return (InsertResult){ .type = INSERT_FIT };
+/* Verificação */
+
+// O que foi encontrado numa página durante a verificação. Para os nós
+// internos, as chaves e os filhos ficam em vetores compartilhados por todos
+// eles a partir de `at`, de modo que as relações entre os nós são verificadas
+// em memória, sem ler as páginas novamente.
+typedef struct {
+    // O marcador da página: `FREE_PAGE`, `POSTINGS_PAGE`, `SHARED_PAGE`, '0'
+    // para os nós internos, '1' para as folhas ou 0 caso a página seja
+    // inválida.
+    char     kind;
+    bool     reachable;
+    uint32_t len;
+    size_t   at;
+    // A próxima página da lista livre, da lista de valores ou das folhas.
+    int32_t  next;
+    // A menor e a maior chave da subárvore, calculadas depois de percorrer as
+    // páginas. Não são válidas caso a subárvore não tenha chaves.
+    bool     has_keys;
+    int32_t  min;
+    int32_t  max;
+} PageCheck;
+
+// O estado da verificação de uma btree.
+typedef struct {
+    BTreeMap  *btree;
+    BTreeCheck *report;
+    PageCheck *pages;
+    int32_t   *keys;
+    uint32_t  *children;
+    size_t     len;
+    size_t     cap;
+} Checker;
+
+// Registra um problema encontrado na verificação. Somente a descrição do
+// primeiro é mantida, como mensagem de erro da btree.
+static void problem(Checker *checker, const char *format, ...) {
+    if (checker->report->n_problems++ > 0) return;
+
+    va_list ap;
+    va_start(ap, format);
+    verror(&checker->btree->error_msg, format, ap);
+    va_end(ap);
 }
 
-static inline InsertResult insertion_replaced(Entry entry) {
-    return (InsertResult){ .type = INSERT_REPLACE, .entry = entry };
+// Guarda as chaves e os filhos de um nó interno nos vetores do `checker`.
+static void checker_push_inner(Checker *checker, const Node *node) {
+    if (checker->len + node->len + 1 > checker->cap) {
+        while (checker->len + node->len + 1 > checker->cap)
+            checker->cap = checker->cap ? 2 * checker->cap : 256;
+
+        checker->keys     = (int32_t  *)realloc(checker->keys    , checker->cap * sizeof( int32_t));
+        checker->children = (uint32_t *)realloc(checker->children, checker->cap * sizeof(uint32_t));
+    }
+
+    checker->pages[node->rrn].at = checker->len;
+    memcpy(&checker->keys[checker->len]    , node->keys    , node->len * sizeof( int32_t));
+    memcpy(&checker->children[checker->len], node->children, (node->len + 1) * sizeof(uint32_t));
+    checker->len += node->len + 1;
 }
 
-// Divide um nó em dois. Cria um novo nó com as chaves maiores do que a chave
-// do meio. Retorna o RRN do nó criado e também a `entry` promovida.
-static InsertResult node_split(BTreeMap *btree, Node left, Entry entry) {
-    assert(left.len == CAPACITY);
-
-    Entry promoted = left.entries[CAPACITY / 2];
-
-    Node right = {
-        // O nó a ser criado será um nó folha somente se o nó a ser dividido
-        // também for um nó folha.
-        .is_leaf = left.is_leaf,
-        .len     = CAPACITY / 2,
-        .rrn     = btree->next_rrn++,
-    };
+// Verifica um nó isoladamente: o seu RRN, a ordem das chaves e os limites dos
+// RRNs para os quais ele aponta.
+static void check_node(Checker *checker, const Node *node, uint32_t rrn) {
+    BTreeMap *btree = checker->btree;
+    PageCheck *page = &checker->pages[rrn];
 
-    memcpy(right.entries, &left.entries[CAPACITY / 2] + 1, (CAPACITY / 2) * sizeof(Entry));
+    page->kind = node->is_leaf ? '1' : '0';
+    page->len  = node->len;
+    page->next = node->next;
 
-    // Se o nó não é uma folha, copia também a metade superior dos filhos do nó
-    // sendo dividido.
-    if (!right.is_leaf) {
-        memcpy(right.children, &left.children[(CAPACITY + 1) / 2], ((CAPACITY + 1) / 2) * sizeof(uint32_t));
+    if (node->rrn != rrn)
+        problem(checker, "node at RRN %u says it is at RRN %u", rrn, node->rrn);
+
+    for (uint32_t i = 1; i < node->len; i++) {
+        if (node->keys[i - 1] >= node->keys[i])
+            problem(checker, "keys %d and %d of node at RRN %u are out of order",
+                    node->keys[i - 1], node->keys[i], rrn);
     }
 
-    // O nó sendo dividido passa a ter a metade da capacidade anterior.
-    left.len = CAPACITY / 2;
+    if (node->is_leaf) {
+        if (btree->linked_leaves && node->next >= (int32_t)btree->next_rrn)
+            problem(checker, "leaf at RRN %u links to RRN %d past the end", rrn, node->next);
+        return;
+    }
 
-    // Escreve ambos os nós no disco, tanto o novo nó, quanto o nó já existente
-    // atualizado.
-    if (!write_node(btree, left) || !write_node(btree, right)) {
-        error(btree, "failed to split node when inserting entry with key %d", entry.key);
-        return insertion_fail();
+    for (uint32_t i = 0; i <= node->len; i++) {
+        if (node->children[i] >= btree->next_rrn)
+            problem(checker, "node at RRN %u points to child %u past the end", rrn, node->children[i]);
     }
 
-    // Como houve um split, retorna o par chave-valor promovido bem como o RRN
-    // do novo nó criado.
-    return insertion_split(promoted, right.rrn);
+    checker_push_inner(checker, node);
 }
 
-// Insere um novo par chave-valor na BTree. Essa função assume que o nó raiz já
-// está criado.
-static InsertResult insert(BTreeMap *btree, Node head, Entry entry) {
-    int i = key_position(head, entry.key);
+// Lê todas as páginas do arquivo em sequência, classificando cada uma e
+// verificando o que não depende das outras páginas.
+static void check_pages(Checker *checker) {
+    BTreeMap *btree = checker->btree;
+    uint8_t page[BTREE_MAX_PAGE_SZ];
 
-    if (head.is_leaf) {
-        // É um nó folha, mas ainda possui espaço disponível -> insere
-        insert_entry_leaf(&head, entry, i);
+    for (uint32_t rrn = 0; rrn < btree->next_rrn; rrn++) {
+        PageCheck *info = &checker->pages[rrn];
 
-        if (head.len == CAPACITY) {
-            // É um nó folha que não possui espaço livre -> split
-            return node_split(btree, head, entry);
+        if (!read_node_page(btree, rrn, page)) {
+            problem(checker, "failed to read page at RRN %u", rrn);
+            continue;
         }
 
-        // Atualiza o nó no disco
-        if (!write_node(btree, head)) {
-            error(btree, "failed to write node when inserting entry inplace with key %d", entry.key);
-            return insertion_fail();
+        const uint8_t *ptr = page;
+        char marker;
+        decode(&ptr, &marker, sizeof(char));
+
+        if (marker == FREE_PAGE) {
+            info->kind = FREE_PAGE;
+            decode(&ptr, &info->next, sizeof(int32_t));
+            checker->report->free_pages++;
+            continue;
         }
 
-        return insertion_fit();
-    }
+        if (marker == POSTINGS_PAGE) {
+            PostingsHeader header;
+            if (!decode_postings_header(btree, page, &header)) {
+                problem(checker, "value list page at RRN %u is too long", rrn);
+                continue;
+            }
 
-    // É um nó interno.
+            info->kind = POSTINGS_PAGE;
+            info->next = header.next;
+            checker->report->postings_pages++;
 
-    if (i < head.len && head.entries[i].key == entry.key) {
-        // Encontramos outro nó com a mesma chave -> substitui, retorna a anterior.
-        Entry old = head.entries[i];
-        head.entries[i] = entry;
+            if (header.next >= (int32_t)btree->next_rrn || header.tail >= (int32_t)btree->next_rrn)
+                problem(checker, "value list page at RRN %u links past the end", rrn);
+            continue;
+        }
 
-        if (!write_node(btree, head)) {
-            error(btree, "failed to replace node entry with key %d", entry.key);
-            return insertion_fail();
+        if (marker == SHARED_PAGE) {
+            uint32_t n_used;
+            if (!decode_shared_header(btree, page, &n_used)) {
+                problem(checker, "shared value list page at RRN %u has too many slots", rrn);
+                continue;
+            }
+
+            info->kind = SHARED_PAGE;
+            info->len  = n_used;
+            checker->report->postings_pages++;
+
+            // A quantidade de fatias em uso deve corresponder às fatias não
+            // vazias.
+            uint32_t n_slots = 0;
+            for (uint32_t i = 0; i < SLOTS_PER_PAGE(btree->page_sz); i++) {
+                Slot slot;
+                if (!decode_slot(btree, page, i, &slot)) {
+                    problem(checker, "slot %u of shared value list page at RRN %u is too long", i, rrn);
+                    continue;
+                }
+
+                if (slot.len > 0) n_slots++;
+                if (slot.overflow >= (int32_t)btree->next_rrn)
+                    problem(checker, "slot %u of shared value list page at RRN %u links past the end", i, rrn);
+            }
+
+            if (n_slots != n_used)
+                problem(checker, "shared value list page at RRN %u has %u slots in use instead of %u",
+                        rrn, n_slots, n_used);
+            continue;
         }
-        // Sinaliza que a chave antiga foi substituída.
-        return insertion_replaced(old);
-    }
 
-    // É um nó interno -> redireciona para o nó filho.
-    Node node;
-    uint32_t node_rrn = head.children[i];
+        Node node;
+        if ((marker != '0' && marker != '1') || !decode_node(btree, page, &node)) {
+            problem(checker, "page at RRN %u is neither a node nor a free or value list page", rrn);
+            continue;
+        }
 
-    // Lê o nó filho do disco.
-    if (!read_node(btree, node_rrn, &node)) {
-        error(btree, "failed to read node at RRN %d", node_rrn);
-        return insertion_fail();
+        checker->report->node_pages++;
+        check_node(checker, &node, rrn);
     }
+}
 
-    // Chama a função recursivamente. `result` armazena informações sobre como
-    // foi feita a inserção no nó filho.
-    InsertResult result = insert(btree, node, entry);
+// Verifica que a lista de páginas livres só passa por páginas livres e não
+// possui ciclos.
+static void check_free_list(Checker *checker) {
+    BTreeMap *btree = checker->btree;
+    uint32_t n_free = 0;
 
-    // Se não houve split, repasse o mesmo resultado.
-    if (result.type != INSERT_SPLIT) return result;
+    for (int32_t rrn = btree->rrn_free; rrn >= 0; rrn = checker->pages[rrn].next) {
+        if (rrn >= (int32_t)btree->next_rrn || checker->pages[rrn].kind != FREE_PAGE) {
+            problem(checker, "free page list reaches RRN %d, which is not a free page", rrn);
+            return;
+        }
 
-    // O nó filho deu split.
-    Entry promoted = result.entry;
-    uint32_t promoted_child = result.rrn;
+        // Uma lista maior que o arquivo só pode ter um ciclo.
+        if (++n_free > btree->next_rrn) {
+            problem(checker, "free page list has a cycle");
+            return;
+        }
+    }
+}
 
-    // Insere o par chave-valor promovidos no nó atual.
-    insert_entry_inner(&head, promoted, promoted_child, i);
+// Atualiza o intervalo de chaves de `to` para incluir o de `from`.
+static inline void merge_range(PageCheck *to, bool has_keys, int32_t min, int32_t max) {
+    if (!has_keys) return;
 
-    if (head.len == CAPACITY) {
-        // Não há mais espaço nesse nó -> split
-        return node_split(btree, head, promoted);
-    }
+    if (!to->has_keys || min < to->min) to->min = min;
+    if (!to->has_keys || max > to->max) to->max = max;
+    to->has_keys = true;
+}
 
-    // Ainda há espaço nesse nó -> adiciona entrada
-    if (!write_node(btree, head)) {
-        error(btree, "failed to write node when promoting entry inplace with key %d", promoted.key);
-        return insertion_fail();
+// Percorre em memória os nós alcançáveis a partir da raiz, nível por nível.
+// Cada nó deve ser alcançado uma única vez e todas as folhas devem estar no
+// mesmo nível. Depois, de baixo para cima, verifica que os separadores de cada
+// nó interno delimitam as chaves dos seus filhos. Os nós alcançáveis são
+// colocados em `order`, na ordem em que foram alcançados.
+static void check_tree(Checker *checker, Level *order) {
+    BTreeMap *btree = checker->btree;
+    if (btree->rrn_root < 0) return;
+
+    if (btree->rrn_root >= (int32_t)btree->next_rrn || !checker->pages[btree->rrn_root].kind
+        || checker->pages[btree->rrn_root].kind == FREE_PAGE
+        || checker->pages[btree->rrn_root].kind == POSTINGS_PAGE
+        || checker->pages[btree->rrn_root].kind == SHARED_PAGE)
+    {
+        problem(checker, "root at RRN %d is not a node", btree->rrn_root);
+        return;
     }
 
-    return insertion_fit();
-}
+    checker->pages[btree->rrn_root].reachable = true;
+    level_push(order, btree->rrn_root);
 
-/**
- * Insere um par chave-valor na BTree. Assume que `btree` já possua algum
- * arquivo vinculado.
- *
- * @param btree - a btree no qual inserir.
- * @param key - a chave usada para ordenação da btree.
- * @param value - o valor associado.
- * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
- *         segundo caso, uma mensagem de erro estará disponível.
- */
-BTreeResult btree_insert(BTreeMap *btree, int32_t key, uint64_t value) {
-    Entry entry = {
-        .key = key,
-        .value = value,
-    };
+    // Início do nível atual em `order` e a profundidade das folhas, que é
+    // conhecida depois da primeira folha.
+    size_t level_start = 0;
+    uint32_t depth = 0;
+    int64_t leaf_depth = -1;
 
-    // Se ainda não houver um nó raiz, crie ele.
-    if (btree->rrn_root < 0) {
-        btree->rrn_root = btree->next_rrn;
-        if (!write_next_leaf(btree, entry)) {
-            error(btree, "failed to write root node at RRN %d", btree->next_rrn);
-            return BTREE_FAIL;
+    while (level_start < order->len) {
+        size_t level_end = order->len;
+
+        for (size_t i = level_start; i < level_end; i++) {
+            uint32_t rrn = order->rrns[i];
+            PageCheck *node = &checker->pages[rrn];
+
+            if (node->kind == '1') {
+                if (leaf_depth < 0) leaf_depth = depth;
+                if (leaf_depth != depth)
+                    problem(checker, "leaf at RRN %u is at depth %u instead of %ld", rrn, depth, leaf_depth);
+
+                checker->report->n_keys += node->len;
+                continue;
+            }
+
+            for (uint32_t j = 0; j <= node->len; j++) {
+                uint32_t child = checker->children[node->at + j];
+                if (child >= btree->next_rrn) continue;
+
+                PageCheck *info = &checker->pages[child];
+                if (info->kind != '0' && info->kind != '1') {
+                    problem(checker, "node at RRN %u points to RRN %u, which is not a node", rrn, child);
+                } else if (info->reachable) {
+                    problem(checker, "node at RRN %u is reached more than once", child);
+                } else {
+                    info->reachable = true;
+                    level_push(order, child);
+                }
+            }
+
+            // Com folhas encadeadas, as chaves dos nós internos são apenas
+            // separadores.
+            if (!btree->linked_leaves) checker->report->n_keys += node->len;
         }
 
-        return BTREE_OK;
+        level_start = level_end;
+        depth++;
     }
 
-    Node root;
+    // Os filhos sempre são alcançados depois dos pais, então percorrer `order`
+    // de trás para frente calcula os intervalos das subárvores de baixo para
+    // cima.
+    for (size_t i = order->len; i-- > 0;) {
+        uint32_t rrn = order->rrns[i];
+        PageCheck *node = &checker->pages[rrn];
 
-    // Lê o nó raiz.
-    if (!read_node(btree, btree->rrn_root, &root)) {
-        error(btree, "failed to read root node at RRN %d", btree->rrn_root);
-        return BTREE_FAIL;
-    }
+        if (node->kind == '1') continue;
 
-    // Insere o par chave-valor na btree.
-    InsertResult result = insert(btree, root, entry);
+        const int32_t  *keys     = &checker->keys[node->at];
+        const uint32_t *children = &checker->children[node->at];
 
-    // Se o nó raiz deu split, cria uma nova raiz com o par chave-valor
-    // promovido.
-    if (result.type == INSERT_SPLIT) {
-        Node new_root = {
-            .is_leaf  = false,
-            .len      = 1,
-            .rrn      = btree->next_rrn++,
-            .entries  = { result.entry },
-            .children = { root.rrn, result.rrn },
-        };
+        for (uint32_t j = 0; j <= node->len; j++) {
+            if (children[j] >= btree->next_rrn) continue;
+            PageCheck *child = &checker->pages[children[j]];
+            if (!child->has_keys) continue;
 
-        if (!write_node(btree, new_root)) {
-            error(btree, "failed to write new root node at RRN %d", new_root.rrn);
-            return BTREE_FAIL;
+            // Com folhas encadeadas, a chave igual ao separador fica à direita
+            // dele.
+            bool above = j == 0        || child->min > keys[j - 1] || (btree->linked_leaves && child->min == keys[j - 1]);
+            bool below = j == node->len || child->max < keys[j];
+
+            if (!above || !below)
+                problem(checker, "keys of node at RRN %u are outside the range given by its parent at RRN %u",
+                        children[j], rrn);
+
+            merge_range(node, true, child->min, child->max);
         }
 
-        btree->rrn_root = new_root.rrn;
+        if (!btree->linked_leaves && node->len > 0)
+            merge_range(node, true, keys[0], keys[node->len - 1]);
     }
+}
 
-    if (result.type == INSERT_FAIL) {
-        return BTREE_FAIL;
-    }
+// Percorre as chaves e os valores dos nós alcançáveis, lendo os nós novamente
+// em ordem de RRN. Com chaves duplicadas, percorre também as listas de valores.
+// Cada valor é passado para `check_value`, caso haja.
+static bool check_values(Checker *checker, BTreeCheckFunc *check_value, void *data) {
+    BTreeMap *btree = checker->btree;
+    uint8_t page[BTREE_MAX_PAGE_SZ];
 
-    return BTREE_OK;
-}
+    for (uint32_t rrn = 0; rrn < btree->next_rrn; rrn++) {
+        PageCheck *info = &checker->pages[rrn];
+        if (!info->reachable) continue;
 
-/* Funcionalidades adicionais */
+        // Com folhas encadeadas, os valores ficam somente nas folhas.
+        if (info->kind == '0' && btree->linked_leaves) continue;
 
-// Imprime um único nó da árvore.
-static void print_node(Node node) {
-    printf("[%d]{ %d: %ld", node.rrn, node.entries[0].key, node.entries[0].value);
-    for (int i = 1; i < node.len; i++) {
-        printf(", %d: %ld", node.entries[i].key, node.entries[i].value);
+        Node node;
+        ASSERT(read_node(btree, rrn, &node));
+
+        for (uint32_t i = 0; i < node.len; i++) {
+            if (!btree->duplicate_keys) {
+                checker->report->n_values++;
+                if (check_value && !check_value(node.keys[i], node.values[i], data))
+                    problem(checker, "value %lu of key %d is invalid", node.values[i], node.keys[i]);
+                continue;
+            }
+
+            // O valor é a fatia onde começa a lista de valores da chave, que
+            // continua nas páginas encadeadas a partir de `overflow`.
+            int64_t head = node.values[i];
+            uint32_t rrn  = slot_ref_rrn(head);
+            uint32_t slot = slot_ref_slot(head);
+
+            uint32_t n_used;
+            Slot info;
+            if (rrn >= btree->next_rrn || checker->pages[rrn].kind != SHARED_PAGE
+                || slot >= SLOTS_PER_PAGE(btree->page_sz)
+                || !read_slot(btree, head, page, &n_used, &info))
+            {
+                problem(checker, "value list of key %d starts at slot %u of RRN %u, which is not in use",
+                        node.keys[i], slot, rrn);
+                continue;
+            }
+
+            for (uint32_t j = 0; j < info.len; j++) {
+                uint64_t value;
+                memcpy(&value, slot_value(btree, page, slot, j), sizeof(uint64_t));
+
+                checker->report->n_values++;
+                if (check_value && !check_value(node.keys[i], value, data))
+                    problem(checker, "value %lu of key %d is invalid", value, node.keys[i]);
+            }
+
+            head = info.overflow;
+
+            uint32_t n_pages = 0;
+            while (head >= 0) {
+                if (head >= btree->next_rrn || checker->pages[head].kind != POSTINGS_PAGE) {
+                    problem(checker, "value list of key %d reaches RRN %ld, which is not a value list page",
+                            node.keys[i], head);
+                    break;
+                }
+
+                if (++n_pages > btree->next_rrn) {
+                    problem(checker, "value list of key %d has a cycle", node.keys[i]);
+                    break;
+                }
+
+                PostingsHeader header;
+                ASSERT(read_node_page(btree, head, page) && decode_postings_header(btree, page, &header));
+
+                for (uint32_t j = 0; j < header.len; j++) {
+                    uint64_t value;
+                    memcpy(&value, postings_value(page, j), sizeof(uint64_t));
+
+                    checker->report->n_values++;
+                    if (check_value && !check_value(node.keys[i], value, data))
+                        problem(checker, "value %lu of key %d is invalid", value, node.keys[i]);
+                }
+
+                head = header.next;
+            }
+        }
     }
-    printf(" }");
+
+    return true;
 }
 
 /**
- * Imprime os conteúdos da `btree`.
- * ATENÇÃO: Essa função causará undefined behavior caso possua um nível com
- * mais de 10000 nós.
+ * Verifica a consistência da `btree`. Todas as páginas do arquivo são lidas uma
+ * única vez, em sequência, e as relações entre os nós são verificadas em
+ * memória: a ordem das chaves dentro de cada nó e em relação aos separadores
+ * dos pais, os limites de todos os RRNs em relação a `next_rrn`, que cada nó
+ * seja alcançado uma única vez a partir da raiz, que as folhas estejam no mesmo
+ * nível e que a lista de páginas livres não tenha ciclos. Depois, os nós
+ * alcançáveis são lidos novamente para que cada valor seja verificado.
  *
- * @param btree - a btree a ser impressa. Essa função não causa escritas ao
- *                disco, mas utiliza de `fseek` o que modifica `btree`.
+ * @param btree - a btree a ser verificada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param report - referência mutável para onde o resultado é colocado.
+ * @param check_value - função que verifica cada par chave-valor, ou NULL.
+ * @param data - argumento repassado para `check_value`.
+ * @return `BTREE_OK` caso nenhum problema seja encontrado e `BTREE_FAIL` caso
+ *         contrário ou em caso de erro. Em ambos os casos de falha, uma
+ *         mensagem de erro estará disponível.
  */
-void btree_print(BTreeMap *btree) {
+BTreeResult btree_check(BTreeMap *btree, BTreeCheck *report, BTreeCheckFunc *check_value, void *data) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    *report = (BTreeCheck){ .n_pages = btree->next_rrn };
+
+    Checker checker = {
+        .btree  = btree,
+        .report = report,
+        .pages  = (PageCheck *)calloc(btree->next_rrn + 1, sizeof(PageCheck)),
+    };
+    Level order = { 0 };
+
+    latch_read(btree);
+
+    check_pages(&checker);
+    check_free_list(&checker);
+    check_tree(&checker, &order);
+
+    report->orphan_pages = report->node_pages - order.len;
+
+    // Os valores só são verificados numa árvore bem formada.
+    bool ok = report->n_problems > 0 || check_values(&checker, check_value, data);
 
-#define Q_SZ 10000
+    latch_release(btree);
 
-#define PUSH(val)                   \
-    do {                            \
-        queue[end] = (val);         \
-        end = (end + 1) % Q_SZ;     \
-    } while (0)
+    free(checker.pages);
+    free(checker.keys);
+    free(checker.children);
+    free(order.rrns);
 
-#define POP(var)                    \
-    do {                            \
-        (var) = queue[start];       \
-        start = (start + 1) % Q_SZ; \
-    } while (0)
+    if (!ok) {
+        error(btree, "failed to read the nodes while checking values");
+        return BTREE_FAIL;
+    }
 
-    int32_t queue[Q_SZ];
-    uint32_t start = 0;
-    uint32_t end = 0;
+    return report->n_problems == 0 ? BTREE_OK : BTREE_FAIL;
+}
 
+/**
+ * Imprime os conteúdos da `btree`, um nível por linha.
+ *
+ * @param btree - a btree a ser impressa. Essa função não causa escritas ao
+ *                disco nem modifica `btree`.
+ */
+void btree_print(BTreeMap *btree) {
     if (btree->rrn_root < 0) {
         printf("[ empty ]\n");
         return;
     }
 
-    PUSH(btree->rrn_root);
-    PUSH(-1);
+    Level level = { 0 };
+    Level below = { 0 };
+    level_push(&level, btree->rrn_root);
 
-    while (start != end) {
-        int32_t rrn;
-        POP(rrn);
+    while (level.len > 0) {
+        for (size_t i = 0; i < level.len; i++) {
+            Node node;
 
-        // Marca que chegamos no fim de um nível da árvore.
-        if (rrn == -1) {
-            printf("\n");
-            if (start != end) PUSH(-1);
-            continue;
-        }
+            if (!read_node(btree, level.rrns[i], &node)) {
+                fprintf(stderr, "Print Error: failed to read node at RRN %d\n", level.rrns[i]);
+                free(level.rrns);
+                free(below.rrns);
+                return;
+            }
 
-        Node node;
+            print_node(&node);
+            printf(" ");
 
-        if (!read_node(btree, rrn, &node)) {
-            fprintf(stderr, "Print Error: failed to read node at RRN %d\n", rrn);
-            return;
+            level_push_children(&below, &node);
         }
 
-        print_node(node);
-        printf(" ");
+        printf("\n");
 
-        if (!node.is_leaf) {
-            for (int i = 0; i < node.len + 1; i++) {
-                PUSH(node.children[i]);
-            }
-        }
+        Level tmp = level;
+        level     = below;
+        below     = tmp;
+        below.len = 0;
     }
 
-#undef Q_SZ
-#undef PUSH
-#undef POP
-
+    free(level.rrns);
+    free(below.rrns);
 }
@@ -0,0 +1,711 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <utils.h>
+#include <hash_index.h>
+
+// Identificador gravado logo após o status, que diferencia um índice hash de
+// uma BTree. Numa BTree, esses bytes são o RRN da raiz.
+#define MAGIC           "HASH"
+#define MAGIC_SZ        4
+
+// Bytes ocupados pelos campos do header: status, identificador, profundidade
+// global, próximo RRN, RRN e número de páginas do diretório e número de chaves.
+#define HEADER_SZ       29
+
+// Bytes ocupados pelos campos fixos de um bucket: profundidade local e número
+// de pares.
+#define BUCKET_HEADER_SZ 8
+
+// Número máximo de pares num bucket. As chaves e os valores ficam em vetores
+// separados na página, as chaves primeiro, de modo que a busca numa página
+// percorre somente as chaves.
+#define BUCKET_CAP ((HASH_INDEX_PAGE_SZ - BUCKET_HEADER_SZ) / (sizeof(int32_t) + sizeof(uint64_t)))
+
+// Offset do vetor de valores dentro da página de um bucket.
+#define VALUES_OFFSET (BUCKET_HEADER_SZ + BUCKET_CAP * sizeof(int32_t))
+
+// Macro simples para prevenir repetição no código
+#define ASSERT(expr) \
+    if (!(expr)) return false
+
+// Um bucket decodificado.
+typedef struct {
+    uint32_t rrn;
+    // Número de bits do hash compartilhados por todas as chaves do bucket.
+    uint32_t local_depth;
+    uint32_t len;
+    int32_t  keys[BUCKET_CAP];
+    uint64_t values[BUCKET_CAP];
+} Bucket;
+
+// Mesmo que `error` mas funciona com argumentos variáveis
+static void verror(HashIndex *index, const char *format, va_list ap) {
+    if (index->error_msg) free(index->error_msg);
+    index->error_msg = alloc_vsprintf(format, ap);
+}
+
+// Coloca uma determinada mensagem de erro no `index`. O formato dos argumentos
+// de formatação é o mesmo da função `printf`.
+static void error(HashIndex *index, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    verror(index, format, ap);
+    va_end(ap);
+}
+
+// Calcula o byte offset de uma página de acordo com o `rrn`. A primeira página
+// é o header.
+static inline off_t rrn_offset(uint32_t rrn) {
+    return (off_t)HASH_INDEX_PAGE_SZ * ((uint64_t)rrn + 1);
+}
+
+static inline void encode(uint8_t **ptr, const void *src, size_t size) {
+    memcpy(*ptr, src, size);
+    *ptr += size;
+}
+
+static inline void decode(const uint8_t **ptr, void *dst, size_t size) {
+    memcpy(dst, *ptr, size);
+    *ptr += size;
+}
+
+// Espalha os bits da chave, com o finalizador do MurmurHash3. Como é uma
+// bijeção, chaves distintas sempre têm hashes distintos.
+static inline uint32_t hash_key(int32_t key) {
+    uint32_t h = (uint32_t)key;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Os `depth` bits menos significativos de `h`.
+static inline uint32_t low_bits(uint32_t h, uint32_t depth) {
+    return h & ((1u << depth) - 1);
+}
+
+static inline uint32_t dir_len(const HashIndex *index) {
+    return 1u << index->global_depth;
+}
+
+// Número de páginas ocupadas por um diretório de profundidade `depth`.
+static inline uint32_t dir_pages_for(uint32_t depth) {
+    size_t size = ((size_t)1 << depth) * sizeof(uint32_t);
+    return (size + HASH_INDEX_PAGE_SZ - 1) / HASH_INDEX_PAGE_SZ;
+}
+
+/* Leitura e escrita */
+
+// Lê um bucket do disco com uma única chamada de sistema. Somente os pares
+// ocupados são decodificados.
+static bool read_bucket(HashIndex *index, uint32_t rrn, Bucket *bucket) {
+    uint8_t page[HASH_INDEX_PAGE_SZ];
+    ASSERT(pread(index->fd, page, HASH_INDEX_PAGE_SZ, rrn_offset(rrn)) == HASH_INDEX_PAGE_SZ);
+
+    const uint8_t *ptr = page;
+    bucket->rrn = rrn;
+    decode(&ptr, &bucket->local_depth, sizeof(uint32_t));
+    decode(&ptr, &bucket->len        , sizeof(uint32_t));
+
+    // Uma página corrompida não pode fazer com que lêssemos fora dela.
+    ASSERT(bucket->local_depth <= HASH_INDEX_MAX_DEPTH && bucket->len <= BUCKET_CAP);
+
+    memcpy(bucket->keys  , page + BUCKET_HEADER_SZ, bucket->len * sizeof(int32_t));
+    memcpy(bucket->values, page + VALUES_OFFSET   , bucket->len * sizeof(uint64_t));
+
+    return true;
+}
+
+static bool write_bucket(HashIndex *index, const Bucket *bucket) {
+    uint8_t page[HASH_INDEX_PAGE_SZ];
+
+    // O espaço que sobra na página é preenchido com lixo ('@').
+    memset(page, '@', HASH_INDEX_PAGE_SZ);
+
+    uint8_t *ptr = page;
+    encode(&ptr, &bucket->local_depth, sizeof(uint32_t));
+    encode(&ptr, &bucket->len        , sizeof(uint32_t));
+
+    memcpy(page + BUCKET_HEADER_SZ, bucket->keys  , bucket->len * sizeof(int32_t));
+    memcpy(page + VALUES_OFFSET   , bucket->values, bucket->len * sizeof(uint64_t));
+
+    return pwrite(index->fd, page, HASH_INDEX_PAGE_SZ, rrn_offset(bucket->rrn)) == HASH_INDEX_PAGE_SZ;
+}
+
+// Posição de `key` no bucket, ou -1 caso ela não esteja nele.
+static int bucket_find(const Bucket *bucket, int32_t key) {
+    for (uint32_t i = 0; i < bucket->len; i++) {
+        if (bucket->keys[i] == key) return i;
+    }
+    return -1;
+}
+
+// Lê o header, que só é aceito com status '1'.
+static bool read_header(HashIndex *index) {
+    uint8_t header[HEADER_SZ];
+    ASSERT(pread(index->fd, header, HEADER_SZ, 0) == HEADER_SZ);
+
+    const uint8_t *ptr = header;
+
+    char status;
+    decode(&ptr, &status, sizeof(char));
+    ASSERT(status == '1' && memcmp(ptr, MAGIC, MAGIC_SZ) == 0);
+    ptr += MAGIC_SZ;
+
+    decode(&ptr, &index->global_depth, sizeof(uint32_t));
+    decode(&ptr, &index->next_rrn    , sizeof(uint32_t));
+    decode(&ptr, &index->dir_rrn     , sizeof(uint32_t));
+    decode(&ptr, &index->dir_pages   , sizeof(uint32_t));
+    decode(&ptr, &index->n_keys      , sizeof(uint64_t));
+
+    ASSERT(index->global_depth <= HASH_INDEX_MAX_DEPTH);
+    ASSERT(index->dir_pages >= dir_pages_for(index->global_depth));
+    ASSERT((uint64_t)index->dir_rrn + index->dir_pages <= index->next_rrn);
+
+    return true;
+}
+
+static bool write_header(HashIndex *index, char status) {
+    uint8_t page[HASH_INDEX_PAGE_SZ];
+
+    // O espaço que sobra no header é preenchido com lixo ('@').
+    memset(page, '@', HASH_INDEX_PAGE_SZ);
+
+    uint8_t *ptr = page;
+    encode(&ptr, &status             , sizeof(char));
+    encode(&ptr, MAGIC               , MAGIC_SZ);
+    encode(&ptr, &index->global_depth, sizeof(uint32_t));
+    encode(&ptr, &index->next_rrn    , sizeof(uint32_t));
+    encode(&ptr, &index->dir_rrn     , sizeof(uint32_t));
+    encode(&ptr, &index->dir_pages   , sizeof(uint32_t));
+    encode(&ptr, &index->n_keys      , sizeof(uint64_t));
+
+    return pwrite(index->fd, page, HASH_INDEX_PAGE_SZ, 0) == HASH_INDEX_PAGE_SZ;
+}
+
+// Lê o diretório inteiro com uma única chamada de sistema.
+static bool read_dir(HashIndex *index) {
+    size_t size = dir_len(index) * sizeof(uint32_t);
+    index->dir = (uint32_t *)malloc(size);
+
+    ASSERT(pread(index->fd, index->dir, size, rrn_offset(index->dir_rrn)) == size);
+
+    for (uint32_t i = 0; i < dir_len(index); i++) {
+        ASSERT(index->dir[i] < index->next_rrn);
+    }
+
+    return true;
+}
+
+// Escreve o diretório no arquivo. Caso ele tenha crescido além das páginas
+// reservadas, é escrito no fim do arquivo e as páginas anteriores deixam de
+// ser usadas.
+static bool write_dir(HashIndex *index) {
+    uint32_t n_pages = dir_pages_for(index->global_depth);
+    if (n_pages > index->dir_pages) {
+        index->dir_rrn    = index->next_rrn;
+        index->dir_pages  = n_pages;
+        index->next_rrn  += n_pages;
+    }
+
+    size_t size = dir_len(index) * sizeof(uint32_t);
+    return pwrite(index->fd, index->dir, size, rrn_offset(index->dir_rrn)) == size;
+}
+
+// Antes da primeira modificação o header passa a ter status '0', de modo que
+// um índice que não foi fechado corretamente é reconhecido.
+static bool mark_dirty(HashIndex *index) {
+    if (index->dirty) return true;
+
+    ASSERT(write_header(index, '0'));
+    index->dirty = true;
+    return true;
+}
+
+// Divide um bucket cheio, alcançado pela posição `slot` do diretório, pelo
+// próximo bit do hash. Caso o bucket já use todos os bits do diretório, o
+// diretório dobra de tamanho antes. As chaves cujo bit é 1 vão para um bucket
+// novo, no fim do arquivo.
+static bool split_bucket(HashIndex *index, Bucket *bucket, uint32_t slot) {
+    if (bucket->local_depth == index->global_depth) {
+        if (index->global_depth == HASH_INDEX_MAX_DEPTH) {
+            error(index, "bucket at RRN %u cannot be split any further", bucket->rrn);
+            return false;
+        }
+
+        // A segunda metade do diretório é uma cópia da primeira, já que o bit
+        // novo ainda não distingue nenhum bucket.
+        uint32_t len = dir_len(index);
+        index->dir = (uint32_t *)realloc(index->dir, 2 * len * sizeof(uint32_t));
+        memcpy(index->dir + len, index->dir, len * sizeof(uint32_t));
+        index->global_depth++;
+    }
+
+    uint32_t bit = 1u << bucket->local_depth;
+
+    Bucket sibling;
+    sibling.rrn         = index->next_rrn++;
+    sibling.local_depth = ++bucket->local_depth;
+    sibling.len         = 0;
+
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < bucket->len; i++) {
+        if (hash_key(bucket->keys[i]) & bit) {
+            sibling.keys[sibling.len]     = bucket->keys[i];
+            sibling.values[sibling.len++] = bucket->values[i];
+        } else {
+            bucket->keys[len]     = bucket->keys[i];
+            bucket->values[len++] = bucket->values[i];
+        }
+    }
+    bucket->len = len;
+
+    // As posições que apontavam para o bucket e têm o bit novo passam a apontar
+    // para o bucket novo.
+    uint32_t base = low_bits(slot, sibling.local_depth - 1) | bit;
+    for (uint32_t i = base; i < dir_len(index); i += bit << 1)
+        index->dir[i] = sibling.rrn;
+
+    if (!write_bucket(index, &sibling) || !write_bucket(index, bucket)) {
+        error(index, "failed to write buckets when splitting bucket at RRN %u", bucket->rrn);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Cria um novo `HashIndex`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return um índice ainda sem arquivo vinculado.
+ */
+HashIndex hash_index_new() {
+    return (HashIndex) {
+        .fd           = -1,
+        .error_msg    = NULL,
+        .global_depth = 0,
+        .next_rrn     = 0,
+        .dir_rrn      = 0,
+        .dir_pages    = 0,
+        .n_keys       = 0,
+        .dir          = NULL,
+        .dirty        = false,
+    };
+}
+
+/**
+ * Libera o `HashIndex` inclusive fechando algum arquivo vinculado. Caso o
+ * índice tenha sido modificado, escreve o diretório e o header, agora com
+ * status '1'.
+ *
+ * @param index - o índice a ser liberado.
+ */
+void hash_index_drop(HashIndex index) {
+    if (index.fd >= 0) {
+        // O header só volta a ter status '1' caso o diretório tenha sido
+        // escrito.
+        if (index.dirty && write_dir(&index))
+            write_header(&index, '1');
+
+        close(index.fd);
+    }
+
+    if (index.dir)
+        free(index.dir);
+
+    if (index.error_msg)
+        free(index.error_msg);
+}
+
+/**
+ * Verifica se um arquivo contém um índice hash, criado por
+ * `hash_index_create`, independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja um índice hash e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool hash_index_detect(const char *fname) {
+    int fd = open(fname, O_RDONLY);
+    ASSERT(fd >= 0);
+
+    uint8_t header[1 + MAGIC_SZ];
+    bool is_hash = pread(fd, header, sizeof(header), 0) == sizeof(header)
+                && memcmp(header + 1, MAGIC, MAGIC_SZ) == 0;
+
+    close(fd);
+    return is_hash;
+}
+
+/**
+ * Carrega o índice de um arquivo, lendo o header e o diretório. O arquivo
+ * precisa já estar criado por `hash_index_create`.
+ *
+ * @param index - referência mutável do índice que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a esse índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_load(HashIndex *index, const char *fname) {
+    int fd = open(fname, O_RDWR);
+
+    if (fd < 0) {
+        error(index, "failed to open file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    index->fd = fd;
+
+    if (!read_header(index) || !read_dir(index)) {
+        // Desvincula o arquivo para que `hash_index_drop` não sobrescreva o
+        // header.
+        close(fd);
+        index->fd = -1;
+        error(index, "unable to read hash index header from file");
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Cria um arquivo de índice hash vazio e vincula ele a um `HashIndex`.
+ *
+ * @param index - referência mutável do índice que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a esse índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_create(HashIndex *index, const char *fname) {
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        error(index, "failed to create file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    // Um índice vazio tem um único bucket, apontado pela única posição do
+    // diretório.
+    index->fd           = fd;
+    index->global_depth = 0;
+    index->next_rrn     = 1;
+    index->dir_rrn      = 0;
+    index->dir_pages    = 0;
+    index->n_keys       = 0;
+    index->dir          = (uint32_t *)malloc(sizeof(uint32_t));
+    index->dir[0]       = 0;
+    index->dirty        = true;
+
+    Bucket bucket = { .rrn = 0, .local_depth = 0, .len = 0 };
+
+    if (!write_header(index, '0') || !write_bucket(index, &bucket)) {
+        error(index, "failed to create header in file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Acessa um valor dado uma chave, com a leitura de uma única página.
+ *
+ * @param index - o índice a ser utilizado que precisa ter um arquivo
+ *                vinculado.
+ * @param key - a chave de busca.
+ * @return o valor associado à `key` caso `key` esteja contida no índice e -1
+ *         caso contrário. Em caso de erro, -1 é retornado e
+ *         `hash_index_has_error()` retorna `true`.
+ */
+int64_t hash_index_get(HashIndex *index, int32_t key) {
+    int64_t value;
+    return hash_index_get_many(index, &key, 1, &value) == BTREE_OK ? value : -1;
+}
+
+/**
+ * Mesmo que `hash_index_get` para várias chaves de uma vez. Chaves seguidas que
+ * caem no mesmo bucket compartilham a leitura da página.
+ *
+ * @param index - o índice a ser utilizado que precisa ter um arquivo
+ *                vinculado.
+ * @param keys - as chaves de busca, em qualquer ordem e possivelmente
+ *               repetidas.
+ * @param n - o número de chaves.
+ * @param values - vetor de `n` posições onde o valor de cada chave é colocado
+ *                 na mesma posição da chave em `keys`, ou -1 caso ela não esteja
+ *                 contida no índice.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_get_many(HashIndex *index, const int32_t *keys, size_t n, int64_t *values) {
+    if (index->fd < 0) {
+        error(index, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    Bucket bucket;
+    bool loaded = false;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t rrn = index->dir[low_bits(hash_key(keys[i]), index->global_depth)];
+
+        if (!loaded || bucket.rrn != rrn) {
+            if (!read_bucket(index, rrn, &bucket)) {
+                error(index, "failed to read bucket at RRN %u", rrn);
+                return BTREE_FAIL;
+            }
+            loaded = true;
+        }
+
+        int pos = bucket_find(&bucket, keys[i]);
+        values[i] = pos < 0 ? -1 : (int64_t)bucket.values[pos];
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Insere um par chave-valor no índice. Caso a chave já exista, o seu valor é
+ * substituído.
+ *
+ * @param index - o índice no qual inserir, que precisa ter um arquivo
+ *                vinculado.
+ * @param key - a chave.
+ * @param value - o valor associado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_insert(HashIndex *index, int32_t key, uint64_t value) {
+    if (index->fd < 0) {
+        error(index, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (!mark_dirty(index)) {
+        error(index, "failed to write hash index header");
+        return BTREE_FAIL;
+    }
+
+    uint32_t h = hash_key(key);
+    Bucket bucket;
+
+    // Cada divisão libera espaço no bucket da chave ou aumenta a sua
+    // profundidade, então o laço termina.
+    while (true) {
+        uint32_t slot = low_bits(h, index->global_depth);
+        uint32_t rrn  = index->dir[slot];
+
+        if (!read_bucket(index, rrn, &bucket)) {
+            error(index, "failed to read bucket at RRN %u", rrn);
+            return BTREE_FAIL;
+        }
+
+        int pos = bucket_find(&bucket, key);
+        if (pos >= 0) {
+            bucket.values[pos] = value;
+            break;
+        }
+
+        if (bucket.len < BUCKET_CAP) {
+            bucket.keys[bucket.len]     = key;
+            bucket.values[bucket.len++] = value;
+            index->n_keys++;
+            break;
+        }
+
+        if (!split_bucket(index, &bucket, slot))
+            return BTREE_FAIL;
+    }
+
+    if (!write_bucket(index, &bucket)) {
+        error(index, "failed to write bucket when inserting key %d", key);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/* Estatísticas e verificação */
+
+// Registra um problema encontrado na verificação. Somente a descrição do
+// primeiro é mantida, como mensagem de erro do índice.
+static void problem(HashIndex *index, HashIndexStats *report, const char *format, ...) {
+    if (report->n_problems++ > 0) return;
+
+    va_list ap;
+    va_start(ap, format);
+    verror(index, format, ap);
+    va_end(ap);
+}
+
+static int compare_keys(const void *a, const void *b) {
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Verifica um bucket, cuja primeira posição no diretório é `first` e que é
+// apontado por `n_slots` posições.
+static void check_bucket(HashIndex *index, HashIndexStats *report, const Bucket *bucket,
+                         uint32_t first, uint32_t n_slots, BTreeCheckFunc *check, void *data)
+{
+    uint32_t depth = bucket->local_depth;
+    uint32_t base  = low_bits(first, depth);
+
+    if (bucket->rrn >= index->dir_rrn && bucket->rrn < index->dir_rrn + index->dir_pages)
+        problem(index, report, "bucket at RRN %u overlaps the directory", bucket->rrn);
+
+    // Um bucket de profundidade `depth` é apontado exatamente pelas posições
+    // cujos `depth` bits menos significativos são os do bucket.
+    if (depth > index->global_depth || n_slots != 1u << (index->global_depth - depth)) {
+        problem(index, report, "bucket at RRN %u has depth %u but %u directory slots",
+                bucket->rrn, depth, n_slots);
+        return;
+    }
+
+    for (uint32_t i = base; i < dir_len(index); i += 1u << depth) {
+        if (index->dir[i] != bucket->rrn)
+            problem(index, report, "directory slot %u should point to bucket at RRN %u", i, bucket->rrn);
+    }
+
+    int32_t sorted[BUCKET_CAP];
+    for (uint32_t i = 0; i < bucket->len; i++) {
+        int32_t key = bucket->keys[i];
+        if (low_bits(hash_key(key), depth) != base)
+            problem(index, report, "key %d does not belong to bucket at RRN %u", key, bucket->rrn);
+
+        if (check && !check(key, bucket->values[i], data))
+            problem(index, report, "invalid value %lu for key %d", bucket->values[i], key);
+
+        sorted[i] = key;
+    }
+
+    qsort(sorted, bucket->len, sizeof(int32_t), compare_keys);
+    for (uint32_t i = 1; i < bucket->len; i++) {
+        if (sorted[i - 1] == sorted[i])
+            problem(index, report, "key %d is repeated in bucket at RRN %u", sorted[i], bucket->rrn);
+    }
+}
+
+// Percorre cada bucket do índice uma vez, a partir do diretório, preenchendo
+// `report`. Os buckets só são verificados caso `verify` seja verdadeiro.
+static bool walk_buckets(HashIndex *index, HashIndexStats *report, bool verify, BTreeCheckFunc *check, void *data) {
+    *report = (HashIndexStats) {
+        .global_depth = index->global_depth,
+        .n_pages      = index->next_rrn,
+        .dir_pages    = index->dir_pages,
+    };
+
+    // Número de posições do diretório que apontam para cada bucket e a
+    // primeira delas.
+    uint32_t *n_slots = (uint32_t *)calloc(index->next_rrn, sizeof(uint32_t));
+    uint32_t *first   = (uint32_t *)malloc(index->next_rrn * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < dir_len(index); i++) {
+        uint32_t rrn = index->dir[i];
+        if (n_slots[rrn]++ == 0) first[rrn] = i;
+    }
+
+    bool ok = true;
+    Bucket bucket;
+
+    for (uint32_t rrn = 0; ok && rrn < index->next_rrn; rrn++) {
+        if (n_slots[rrn] == 0) continue;
+
+        if (!read_bucket(index, rrn, &bucket)) {
+            error(index, "failed to read bucket at RRN %u", rrn);
+            ok = false;
+            break;
+        }
+
+        report->n_buckets++;
+        report->n_keys += bucket.len;
+
+        if (verify)
+            check_bucket(index, report, &bucket, first[rrn], n_slots[rrn], check, data);
+    }
+
+    free(n_slots);
+    free(first);
+
+    if (report->n_buckets > 0)
+        report->fill_factor = (double)report->n_keys / ((double)report->n_buckets * BUCKET_CAP);
+
+    if (ok && verify && report->n_keys != index->n_keys)
+        problem(index, report, "header has %lu keys but the buckets have %lu", index->n_keys, report->n_keys);
+
+    return ok;
+}
+
+/**
+ * Calcula as estatísticas da estrutura do índice, lendo cada bucket uma vez.
+ *
+ * @param index - o índice, que precisa ter um arquivo vinculado.
+ * @param stats - onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_stats(HashIndex *index, HashIndexStats *stats) {
+    if (index->fd < 0) {
+        error(index, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    return walk_buckets(index, stats, false, NULL, NULL) ? BTREE_OK : BTREE_FAIL;
+}
+
+/**
+ * Verifica a consistência do índice: que cada bucket é apontado exatamente
+ * pelas posições do diretório correspondentes à sua profundidade, que as
+ * chaves de cada bucket pertencem a ele e não se repetem, e que o número de
+ * chaves confere com o header. Opcionalmente, `check` é chamada com cada par
+ * chave-valor.
+ *
+ * @param index - o índice, que precisa ter um arquivo vinculado.
+ * @param report - onde as estatísticas e o número de problemas são colocados.
+ * @param check - função que valida cada par, ou NULL.
+ * @param data - argumento repassado para `check`.
+ * @return `BTREE_OK` caso o índice esteja consistente e `BTREE_FAIL` caso
+ *         contrário ou em caso de erro. Em ambos os casos de falha, uma
+ *         mensagem de erro estará disponível.
+ */
+BTreeResult hash_index_check(HashIndex *index, HashIndexStats *report, BTreeCheckFunc *check, void *data) {
+    if (index->fd < 0) {
+        error(index, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (!walk_buckets(index, report, true, check, data))
+        return BTREE_FAIL;
+
+    return report->n_problems == 0 ? BTREE_OK : BTREE_FAIL;
+}
+
+/**
+ * Verifica se o `index` possui algum erro registrado.
+ *
+ * @param index - o índice a ser verificado.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool hash_index_has_error(HashIndex *index) {
+    return index->error_msg;
+}
+
+/**
+ * Recupera a mensagem de erro do `index`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param index - o índice com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *hash_index_get_error(HashIndex *index) {
+    return index->error_msg;
+}
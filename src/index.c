@@ -3,14 +3,38 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <external.h>
 #include <index.h>
 #include <btree.h>
+#include <str_btree.h>
+#include <hash_index.h>
+#include <rec_btree.h>
+#include <bloom.h>
 #include <bin.h>
 #include <csv.h>
 #include <parsing.h>
 #include <common.h>
+#include <utils.h>
+
+// Imprime a mensagem de erro de `handle_error` e fecha o arquivo `to_close`.
+static inline void vhandle_error(FILE *to_close, const char *format, va_list ap) {
+#ifdef DEBUG
+    if (format) {
+        fprintf(stderr, "Error: ");
+        vfprintf(stderr, format, ap);
+        fprintf(stderr, ".\n");
+    } else {
+        fprintf(stderr, "Error: unexpected.\n");
+    }
+#else
+    printf(ERROR_FOUND);
+#endif
+
+    if(to_close)
+        fclose(to_close);
+}
 
 // Trata erros das funções que trabalham com um arquivo binário e uma btree.
 // Quando compilado com -DDEBUG, imprime uma mensagem de erro descritiva, se não
@@ -26,230 +50,1642 @@ static inline bool handle_error(FILE *to_close, BTreeMap failed_btree, const cha
     va_start(ap, format);
 
 #ifdef DEBUG
-    if (btree_has_error(&failed_btree)) {
-        fprintf(stderr, "Error: %s.\n", btree_get_error(&failed_btree));
+    if (btree_has_error(&failed_btree)) {
+        fprintf(stderr, "Error: %s.\n", btree_get_error(&failed_btree));
+    }
+#endif
+
+    btree_drop(failed_btree);
+    vhandle_error(to_close, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
+// Mesmo que `handle_error`, para as funções que não abrem nenhuma btree.
+static inline bool handle_error_file(FILE *to_close, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+    vhandle_error(to_close, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
+// Mesmo que `handle_error`, mas libera uma `StrBTreeMap`.
+static inline bool handle_error_str(FILE *to_close, StrBTreeMap failed_btree, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+#ifdef DEBUG
+    if (str_btree_has_error(&failed_btree)) {
+        fprintf(stderr, "Error: %s.\n", str_btree_get_error(&failed_btree));
+    }
+#endif
+
+    str_btree_drop(failed_btree);
+    vhandle_error(to_close, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
+// Mesmo que `handle_error`, mas libera um `HashIndex`.
+static inline bool handle_error_hash(FILE *to_close, HashIndex failed_index, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+#ifdef DEBUG
+    if (hash_index_has_error(&failed_index)) {
+        fprintf(stderr, "Error: %s.\n", hash_index_get_error(&failed_index));
+    }
+#endif
+
+    hash_index_drop(failed_index);
+    vhandle_error(to_close, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
+// Mesmo que `handle_error`, mas libera uma `RecBTreeMap`.
+static inline bool handle_error_rec(FILE *to_close, RecBTreeMap failed_btree, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+#ifdef DEBUG
+    if (rec_btree_has_error(&failed_btree)) {
+        fprintf(stderr, "Error: %s.\n", rec_btree_get_error(&failed_btree));
+    }
+#endif
+
+    rec_btree_drop(failed_btree);
+    vhandle_error(to_close, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
+// Vetor dinâmico de pares chave-valor que serão inseridos no índice.
+typedef struct {
+    BTreePair *pairs;
+    size_t len;
+    size_t capacity;
+} PairVec;
+
+static PairVec pair_vec_with_capacity(size_t capacity) {
+    if (capacity == 0) capacity = 1;
+
+    return (PairVec) {
+        .pairs    = (BTreePair *)malloc(capacity * sizeof(BTreePair)),
+        .len      = 0,
+        .capacity = capacity,
+    };
+}
+
+static void pair_vec_push(PairVec *vec, int32_t key, uint64_t value) {
+    if (vec->len == vec->capacity) {
+        vec->capacity *= 2;
+        vec->pairs = (BTreePair *)realloc(vec->pairs, vec->capacity * sizeof(BTreePair));
+    }
+
+    vec->pairs[vec->len++] = (BTreePair){ .key = key, .value = value };
+}
+
+// Função de comparação de pares por chave para ser usada com `mergesort`.
+static int32_t compare_pairs(void *data, int32_t i, int32_t j) {
+    BTreePair *pairs = (BTreePair *)data;
+    if (pairs[i].key < pairs[j].key) return -1;
+    else if (pairs[i].key == pairs[j].key) return 0;
+    else return 1;
+}
+
+// Ordena os pares coletados do arquivo de dados e carrega eles na `btree` de
+// uma só vez. Como `mergesort` é estável, quando há chaves repetidas mantemos
+// o último registro do arquivo, assim como aconteceria inserindo um por um.
+// Caso a `btree` aceite chaves duplicadas, todos são mantidos na ordem do
+// arquivo.
+static bool bulk_load_pairs(BTreeMap *btree, PairVec *vec) {
+    if (vec->len > 1)
+        mergesort(vec->pairs, sizeof(BTreePair), 0, vec->len - 1, compare_pairs);
+
+    size_t n_unique = 0;
+    for (size_t i = 0; i < vec->len; i++) {
+        if (!btree->duplicate_keys && n_unique > 0 && vec->pairs[n_unique - 1].key == vec->pairs[i].key)
+            n_unique--;
+        vec->pairs[n_unique++] = vec->pairs[i];
+    }
+
+    bool ok = btree_bulk_load(btree, vec->pairs, n_unique, BTREE_DEFAULT_FILL_FACTOR) == BTREE_OK;
+    free(vec->pairs);
+
+    return ok;
+}
+
+// Escreve o filtro de Bloom que acompanha o índice `index_fname` com as chaves
+// de `vec`. O filtro é dimensionado com folga para as inserções futuras.
+static bool write_index_filter(const char *index_fname, const PairVec *vec) {
+    BloomFilter filter = bloom_with_capacity(2 * vec->len);
+
+    for (size_t i = 0; i < vec->len; i++)
+        bloom_add(&filter, vec->pairs[i].key);
+
+    bool ok = bloom_save(&filter, index_fname);
+    bloom_drop(filter);
+
+    return ok;
+}
+
+/*
+* Cria um arquivo de indice arvore-B para o arquivo de dados veiculo
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_vehicle_create(const char *bin_fname, const char *index_fname) {
+    BTreeMap btree = btree_new();
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    if (btree_create(&btree, index_fname) != BTREE_OK)
+        return handle_error(bin_fp, btree, NULL);
+
+    DBVehicleHeader header;
+    if (!read_header_vehicle(bin_fp, &header))
+        return handle_error(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
+
+    DBVehicleRegister reg;
+
+    uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
+    uint64_t offset = ftell(bin_fp);
+
+    PairVec vec = pair_vec_with_capacity(header.meta.nroRegistros);
+
+    // Le todos os registros de veiculos do arquivo binario e guarda a chave dos
+    // que nao estiverem marcados como removidos para construir a arvore-B
+    for (int i = 0; i < total_register; i++){
+        if (!read_vehicle_register(bin_fp, &reg)) {
+            free(vec.pairs);
+            return handle_error(bin_fp, btree, "failed to read vehicle register");
+        }
+
+        if (reg.removido == '1')
+            pair_vec_push(&vec, convertePrefixo(reg.prefixo), offset);
+
+        free(reg.modelo);
+        free(reg.categoria);
+
+        offset = ftell(bin_fp);
+    }
+
+    if (!write_index_filter(index_fname, &vec)) {
+        free(vec.pairs);
+        return handle_error(bin_fp, btree, "failed to write bloom filter of %s", index_fname);
+    }
+
+    if (!bulk_load_pairs(&btree, &vec))
+        return handle_error(bin_fp, btree, NULL);
+
+    btree_drop(btree);
+    fclose(bin_fp);
+
+    return true;
+}
+
+/*
+* Cria um arquivo de indice arvore-B para o arquivo de dados linhas de onibus
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @params linked_leaves - se o indice e uma arvore B+ com as folhas encadeadas
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+static bool create_bus_line_index(const char *bin_fname, const char *index_fname, bool linked_leaves) {
+    BTreeMap btree = btree_new();
+    btree_set_linked_leaves(&btree, linked_leaves);
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    if (btree_create(&btree, index_fname) != BTREE_OK)
+        return handle_error(bin_fp, btree, NULL);
+
+    DBBusLineHeader header;
+    if (!read_header_bus_line(bin_fp, &header))
+        return handle_error(bin_fp, btree, "failed to read bus line header from %s", bin_fname);
+
+    DBBusLineRegister reg;
+
+    uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
+    uint64_t offset = ftell(bin_fp);
+
+    PairVec vec = pair_vec_with_capacity(header.meta.nroRegistros);
+
+    // Le todos os registros de linhas de onibus do arquivo binario e guarda a
+    // chave dos que nao estiverem marcados como removidos para construir a
+    // arvore-B
+    for (int i = 0; i < total_register; i++){
+        if (!read_bus_line_register(bin_fp, &reg)) {
+            free(vec.pairs);
+            return handle_error(bin_fp, btree, "failed to read bus line register");
+        }
+
+        if (reg.removido == '1')
+            pair_vec_push(&vec, reg.codLinha, offset);
+
+        free(reg.nomeLinha);
+        free(reg.corLinha);
+
+        offset = ftell(bin_fp);
+    }
+
+    if (!write_index_filter(index_fname, &vec)) {
+        free(vec.pairs);
+        return handle_error(bin_fp, btree, "failed to write bloom filter of %s", index_fname);
+    }
+
+    if (!bulk_load_pairs(&btree, &vec))
+        return handle_error(bin_fp, btree, NULL);
+
+    btree_drop(btree);
+    fclose(bin_fp);
+
+    return true;
+}
+
+/*
+* Cria um arquivo de indice arvore-B para o arquivo de dados linhas de onibus
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_bus_line_create(const char *bin_fname, const char *index_fname) {
+    return create_bus_line_index(bin_fname, index_fname, false);
+}
+
+/*
+* Cria um arquivo de indice arvore B+ para o arquivo de dados linhas de onibus,
+* cujas folhas encadeadas permitem percorrer as linhas em ordem de codLinha
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indice arvore B+
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_bus_line_ordered_create(const char *bin_fname, const char *index_fname) {
+    return create_bus_line_index(bin_fname, index_fname, true);
+}
+
+/*
+* Cria um arquivo de indice arvore-B com chaves duplicadas para o campo codLinha do arquivo de dados veiculo
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_vehicle_line_create(const char *bin_fname, const char *index_fname) {
+    BTreeMap btree = btree_new();
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    // Vários veículos podem ter o mesmo codLinha, então cada chave guarda a
+    // lista de offsets de todos eles.
+    btree_set_duplicate_keys(&btree, true);
+
+    if (btree_create(&btree, index_fname) != BTREE_OK)
+        return handle_error(bin_fp, btree, NULL);
+
+    DBVehicleHeader header;
+    if (!read_header_vehicle(bin_fp, &header))
+        return handle_error(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
+
+    DBVehicleRegister reg;
+
+    uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
+    uint64_t offset = ftell(bin_fp);
+
+    PairVec vec = pair_vec_with_capacity(header.meta.nroRegistros);
+
+    for (int i = 0; i < total_register; i++){
+        if (!read_vehicle_register(bin_fp, &reg)) {
+            free(vec.pairs);
+            return handle_error(bin_fp, btree, "failed to read vehicle register");
+        }
+
+        if (reg.removido == '1')
+            pair_vec_push(&vec, reg.codLinha, offset);
+
+        free(reg.modelo);
+        free(reg.categoria);
+
+        offset = ftell(bin_fp);
+    }
+
+    if (!write_index_filter(index_fname, &vec)) {
+        free(vec.pairs);
+        return handle_error(bin_fp, btree, "failed to write bloom filter of %s", index_fname);
+    }
+
+    if (!bulk_load_pairs(&btree, &vec))
+        return handle_error(bin_fp, btree, NULL);
+
+    btree_drop(btree);
+    fclose(bin_fp);
+
+    return true;
+}
+
+// Cria um índice hash de um arquivo de dados, com a mesma chave do índice
+// árvore-B criado por `index_vehicle_create` ou `index_bus_line_create`. Os
+// registros são inseridos na ordem do arquivo, então quando há chaves
+// repetidas o índice guarda o último, assim como a árvore-B.
+static bool create_hash_index(const char *bin_fname, const char *index_fname, bool vehicle) {
+    HashIndex index = hash_index_new();
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error_hash(bin_fp, index, "failed to open file %s", bin_fname);
+
+    if (hash_index_create(&index, index_fname) != BTREE_OK)
+        return handle_error_hash(bin_fp, index, NULL);
+
+    DBMeta meta;
+    bool read = false;
+
+    if (vehicle) {
+        DBVehicleHeader header;
+        read = read_header_vehicle(bin_fp, &header);
+        meta = header.meta;
+    } else {
+        DBBusLineHeader header;
+        read = read_header_bus_line(bin_fp, &header);
+        meta = header.meta;
+    }
+
+    if (!read)
+        return handle_error_hash(bin_fp, index, "failed to read header from %s", bin_fname);
+
+    uint32_t total_register = meta.nroRegistros + meta.nroRegRemovidos;
+    uint64_t offset = ftell(bin_fp);
+
+    for (int i = 0; i < total_register; i++) {
+        bool removed;
+        int32_t key;
+
+        if (vehicle) {
+            DBVehicleRegister reg;
+            if (!read_vehicle_register(bin_fp, &reg))
+                return handle_error_hash(bin_fp, index, "failed to read vehicle register");
+
+            removed = reg.removido != '1';
+            key = convertePrefixo(reg.prefixo);
+            vehicle_drop(reg);
+        } else {
+            DBBusLineRegister reg;
+            if (!read_bus_line_register(bin_fp, &reg))
+                return handle_error_hash(bin_fp, index, "failed to read bus line register");
+
+            removed = reg.removido != '1';
+            key = reg.codLinha;
+            bus_line_drop(reg);
+        }
+
+        if (!removed && hash_index_insert(&index, key, offset) != BTREE_OK)
+            return handle_error_hash(bin_fp, index, NULL);
+
+        offset = ftell(bin_fp);
+    }
+
+    hash_index_drop(index);
+    fclose(bin_fp);
+
+    return true;
+}
+
+/*
+* Cria um arquivo de indice hash para o arquivo de dados veiculo, que pode ser usado no lugar do indice arvore-B
+* criado por index_vehicle_create nas buscas por prefixo
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indice hash
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_vehicle_hash_create(const char *bin_fname, const char *index_fname) {
+    return create_hash_index(bin_fname, index_fname, true);
+}
+
+/*
+* Cria um arquivo de indice hash para o arquivo de dados linhas de onibus, que pode ser usado no lugar do indice
+* arvore-B criado por index_bus_line_create nas buscas por codLinha
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indice hash
+* @returns um valor booleano - true se for criado, false se der algum erro
+*/
+bool index_bus_line_hash_create(const char *bin_fname, const char *index_fname) {
+    return create_hash_index(bin_fname, index_fname, false);
+}
+
+// Codifica e insere um registro de linha de ônibus numa tabela organizada por
+// índice, com chave codLinha.
+static bool rec_btree_insert_bus_line(RecBTreeMap *btree, const DBBusLineRegister *reg) {
+    uint8_t record[REC_BTREE_MAX_RECORD_SZ];
+    uint32_t len = encode_bus_line_register(reg, record, REC_BTREE_MAX_RECORD_SZ);
+
+    if (len == 0) {
+        btree->error_msg = alloc_sprintf("bus line %d is too large for a clustered index", reg->codLinha);
+        return false;
+    }
+
+    return rec_btree_insert(btree, reg->codLinha, record, len) == BTREE_OK;
+}
+
+// Vetor dinâmico de registros codificados que serão carregados numa tabela
+// organizada por índice. Os bytes de todos os registros ficam em `bytes`, que
+// pode ser realocado, então os ponteiros dos registros só são preenchidos por
+// `bulk_load_records`, a partir de `offsets`.
+typedef struct {
+    RecBTreeRecord *records;
+    size_t *offsets;
+    size_t len;
+    size_t capacity;
+    uint8_t *bytes;
+    size_t bytes_len;
+    size_t bytes_capacity;
+} RecordVec;
+
+static RecordVec record_vec_with_capacity(size_t capacity) {
+    if (capacity == 0) capacity = 1;
+
+    return (RecordVec) {
+        .records        = (RecBTreeRecord *)malloc(capacity * sizeof(RecBTreeRecord)),
+        .offsets        = (size_t *)malloc(capacity * sizeof(size_t)),
+        .len            = 0,
+        .capacity       = capacity,
+        .bytes          = (uint8_t *)malloc(REC_BTREE_MAX_RECORD_SZ),
+        .bytes_len      = 0,
+        .bytes_capacity = REC_BTREE_MAX_RECORD_SZ,
+    };
+}
+
+static void record_vec_drop(RecordVec vec) {
+    free(vec.records);
+    free(vec.offsets);
+    free(vec.bytes);
+}
+
+// Codifica e adiciona um registro de linha de ônibus ao vetor, com chave
+// codLinha. Retorna `false` caso o registro seja grande demais.
+static bool record_vec_push_bus_line(RecordVec *vec, const DBBusLineRegister *reg) {
+    if (vec->len == vec->capacity) {
+        vec->capacity *= 2;
+        vec->records = (RecBTreeRecord *)realloc(vec->records, vec->capacity * sizeof(RecBTreeRecord));
+        vec->offsets = (size_t *)realloc(vec->offsets, vec->capacity * sizeof(size_t));
+    }
+
+    if (vec->bytes_capacity - vec->bytes_len < REC_BTREE_MAX_RECORD_SZ) {
+        vec->bytes_capacity *= 2;
+        vec->bytes = (uint8_t *)realloc(vec->bytes, vec->bytes_capacity);
+    }
+
+    uint32_t len = encode_bus_line_register(reg, vec->bytes + vec->bytes_len, REC_BTREE_MAX_RECORD_SZ);
+    if (len == 0) return false;
+
+    vec->offsets[vec->len]   = vec->bytes_len;
+    vec->records[vec->len++] = (RecBTreeRecord){ .key = reg->codLinha, .len = len, .record = NULL };
+    vec->bytes_len += len;
+
+    return true;
+}
+
+// Função de comparação de registros por chave para ser usada com `mergesort`.
+static int32_t compare_records(void *data, int32_t i, int32_t j) {
+    RecBTreeRecord *records = (RecBTreeRecord *)data;
+    if (records[i].key < records[j].key) return -1;
+    else if (records[i].key == records[j].key) return 0;
+    else return 1;
+}
+
+// Ordena os registros coletados do arquivo de dados e carrega eles na `btree`
+// de uma só vez, como `bulk_load_pairs`. Quando há chaves repetidas, mantemos
+// o último registro do arquivo, assim como aconteceria inserindo um por um.
+static bool bulk_load_records(RecBTreeMap *btree, RecordVec *vec) {
+    for (size_t i = 0; i < vec->len; i++) {
+        vec->records[i].record = vec->bytes + vec->offsets[i];
+    }
+
+    if (vec->len > 1)
+        mergesort(vec->records, sizeof(RecBTreeRecord), 0, vec->len - 1, compare_records);
+
+    size_t n_unique = 0;
+    for (size_t i = 0; i < vec->len; i++) {
+        if (n_unique > 0 && vec->records[n_unique - 1].key == vec->records[i].key)
+            n_unique--;
+        vec->records[n_unique++] = vec->records[i];
+    }
+
+    return rec_btree_bulk_load(btree, vec->records, n_unique, BTREE_DEFAULT_FILL_FACTOR) == BTREE_OK;
+}
+
+/*
+* Cria uma tabela organizada por indice para o arquivo de dados linhas de onibus, cujas folhas guardam os proprios
+* registros das linhas nao removidas. Pode ser usada no lugar do indice arvore-B criado por index_bus_line_create nas
+* buscas por codLinha e na juncao, que entao nao leem o arquivo de linhas
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario da tabela organizada por indice
+* @returns um valor booleano - true se for criada, false se der algum erro
+*/
+bool index_bus_line_clustered_create(const char *bin_fname, const char *index_fname) {
+    RecBTreeMap btree = rec_btree_new();
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error_rec(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    if (rec_btree_create(&btree, index_fname) != BTREE_OK)
+        return handle_error_rec(bin_fp, btree, NULL);
+
+    DBBusLineHeader header;
+    if (!read_header_bus_line(bin_fp, &header))
+        return handle_error_rec(bin_fp, btree, "failed to read header from %s", bin_fname);
+
+    uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
+    RecordVec vec = record_vec_with_capacity(header.meta.nroRegistros);
+
+    for (int i = 0; i < total_register; i++) {
+        DBBusLineRegister reg;
+        if (!read_bus_line_register(bin_fp, &reg)) {
+            record_vec_drop(vec);
+            return handle_error_rec(bin_fp, btree, "failed to read bus line register");
+        }
+
+        bool ok = reg.removido != '1' || record_vec_push_bus_line(&vec, &reg);
+        int32_t code = reg.codLinha;
+        bus_line_drop(reg);
+
+        if (!ok) {
+            record_vec_drop(vec);
+            return handle_error_rec(bin_fp, btree, "bus line %d is too large for a clustered index", code);
+        }
+    }
+
+    // Os registros são ordenados e escritos em sequência, sem as divisões de
+    // nós das inserções uma a uma.
+    bool ok = bulk_load_records(&btree, &vec);
+    record_vec_drop(vec);
+
+    if (!ok)
+        return handle_error_rec(bin_fp, btree, NULL);
+
+    rec_btree_drop(btree);
+    fclose(bin_fp);
+
+    return true;
+}
+
+// Busca a linha de ônibus `key` numa tabela organizada por índice, que já
+// contém o registro inteiro. `found` indica se ela foi encontrada, e nesse caso
+// o registro é colocado em `reg`. Em caso de erro, o erro já é impresso e
+// `false` é retornado.
+static bool rec_btree_get_bus_line(const char *index_fname, int32_t key, DBBusLineRegister *reg, bool *found) {
+    RecBTreeMap btree = rec_btree_new();
+
+    if (rec_btree_load(&btree, index_fname) != BTREE_OK)
+        return handle_error_rec(NULL, btree, NULL);
+
+    uint8_t record[REC_BTREE_MAX_RECORD_SZ];
+    int32_t len = rec_btree_get(&btree, key, record);
+
+    if (rec_btree_has_error(&btree))
+        return handle_error_rec(NULL, btree, NULL);
+
+    *found = len >= 0;
+    if (*found && !decode_bus_line_register(record, len, reg))
+        return handle_error_rec(NULL, btree, "failed to decode bus line register %d", key);
+
+    rec_btree_drop(btree);
+    return true;
+}
+
+// Busca `key` no índice de chaves únicas `index_fname`, que pode ser uma
+// árvore-B ou um índice hash, e coloca em `off` o valor encontrado ou -1. Num
+// índice hash a busca lê uma única página, então o filtro de Bloom só é usado
+// com a árvore-B. Em caso de erro, o erro já é impresso e `false` é retornado.
+static bool index_get(const char *index_fname, int32_t key, int64_t *off) {
+    if (hash_index_detect(index_fname)) {
+        HashIndex index = hash_index_new();
+
+        if (hash_index_load(&index, index_fname) != BTREE_OK)
+            return handle_error_hash(NULL, index, NULL);
+
+        *off = hash_index_get(&index, key);
+        if (hash_index_has_error(&index))
+            return handle_error_hash(NULL, index, NULL);
+
+        hash_index_drop(index);
+        return true;
+    }
+
+    BTreeMap btree = btree_new();
+
+    if (btree_open_mmap(&btree, index_fname) != BTREE_OK)
+        return handle_error(NULL, btree, NULL);
+
+    // O filtro de Bloom descarta a maioria das chaves inexistentes sem descer
+    // na árvore.
+    BloomFilter filter;
+    bloom_load(&filter, index_fname);
+
+    *off = bloom_may_contain(&filter, key) ? btree_get(&btree, key) : -1;
+    bloom_drop(filter);
+
+    if (btree_has_error(&btree))
+        return handle_error(NULL, btree, NULL);
+
+    btree_drop(btree);
+    return true;
+}
+
+/*
+* Recupera os regstros buscados de um determinado arquivo de dados veiculo usando o indice arvore-B
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indices arvore-B ou hash
+* @params prefixo[6] - valor do campo prefixo em que sera feita a busca
+* @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+*/
+bool search_for_vehicle(const char *bin_fname, const char *index_fname, const char prefixo[6]) {
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error_file(bin_fp, "failed to open file %s", bin_fname);
+
+    DBVehicleHeader header;
+    if (!read_header_vehicle(bin_fp, &header))
+        return handle_error_file(bin_fp, "failed to read vehicle register from %s", bin_fname);
+
+    int64_t off;
+    if (!index_get(index_fname, convertePrefixo((char *)prefixo), &off)) {
+        fclose(bin_fp);
+        return false;
+    }
+
+    // Verifica se o valor buscado contem algum resultado. Em caso positivo
+    // exibe os valores buscados, em caso contrario exibe uma mensagem de erro
+    if (off < 0) {
+        printf(NO_REGISTER);
+    } else {
+        fseek(bin_fp, off, SEEK_SET);
+
+        DBVehicleRegister reg;
+        if (!read_vehicle_register(bin_fp, &reg))
+            return handle_error_file(bin_fp, "failed to read vehicle register");
+
+        print_vehicle(stdout, &reg, &header);
+        vehicle_drop(reg);
+    }
+
+    fclose(bin_fp);
+
+    return true;
+}
+
+/*
+* Recupera os regstros buscados de um determinado arquivo de dados lnhas de onibus usando o indice arvore-B
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indices arvore-B, hash ou da tabela organizada por indice
+* @params code - valor do campo cdigo em que sera feita a busca
+* @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+*/
+bool search_for_bus_line(const char *bin_fname, const char *index_fname, uint32_t code) {
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error_file(bin_fp, "failed to open file %s", bin_fname);
+
+    DBBusLineHeader header;
+    if (!read_header_bus_line(bin_fp, &header))
+        return handle_error_file(bin_fp, "failed to read bus line header from %s", bin_fname);
+
+    // A tabela organizada por índice já contém o registro, então o arquivo de
+    // dados só é usado pelo seu header.
+    if (rec_btree_detect(index_fname)) {
+        DBBusLineRegister reg;
+        bool found;
+        bool ok = rec_btree_get_bus_line(index_fname, code, &reg, &found);
+
+        if (ok && found) {
+            print_bus_line(stdout, &reg, &header);
+            bus_line_drop(reg);
+        } else if (ok) {
+            printf(NO_REGISTER);
+        }
+
+        fclose(bin_fp);
+        return ok;
+    }
+
+    int64_t off;
+    if (!index_get(index_fname, code, &off)) {
+        fclose(bin_fp);
+        return false;
+    }
+
+    // Verifica se o valor buscado contem algum resultado. Em caso positivo
+    // exibe os valores buscados, em caso contrario exibe uma mensagem de erro
+    if (off < 0) {
+        printf(NO_REGISTER);
+    } else {
+        fseek(bin_fp, off, SEEK_SET);
+
+        DBBusLineRegister reg;
+        if (!read_bus_line_register(bin_fp, &reg))
+            return handle_error_file(bin_fp, "failed to read bus line register");
+
+        print_bus_line(stdout, &reg, &header);
+        bus_line_drop(reg);
+    }
+
+    fclose(bin_fp);
+    return true;
+}
+
+/*
+* Recupera todos os veiculos de uma linha usando o indice arvore-B de codLinha com chaves duplicadas
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indice criado por index_vehicle_line_create
+* @params code - valor do campo codLinha em que sera feita a busca
+* @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
+*/
+bool search_for_vehicles_of_line(const char *bin_fname, const char *index_fname, int32_t code) {
+    BTreeMap btree = btree_new();
+
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    DBVehicleHeader header;
+    if (!read_header_vehicle(bin_fp, &header))
+        return handle_error(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
+
+    if (btree_open_mmap(&btree, index_fname) != BTREE_OK)
+        return handle_error(bin_fp, btree, NULL);
+
+    // Uma linha sem veículos é descartada pelo filtro de Bloom sem descer na
+    // árvore.
+    BloomFilter filter;
+    bloom_load(&filter, index_fname);
+
+    BTreePostings postings;
+    bool found = bloom_may_contain(&filter, code) && btree_postings_open(&btree, &postings, code);
+    bloom_drop(filter);
+
+    // Os offsets estão na ordem do arquivo, então os veículos são exibidos na
+    // mesma ordem que numa busca sequencial.
+    int n_matching = 0;
+    while (found && btree_postings_next(&postings)) {
+        fseek(bin_fp, postings.value, SEEK_SET);
+
+        DBVehicleRegister reg;
+        if (!read_vehicle_register(bin_fp, &reg))
+            return handle_error(bin_fp, btree, "failed to read vehicle register");
+
+        if (reg.removido == '1') {
+            print_vehicle(stdout, &reg, &header);
+            printf("\n");
+            n_matching++;
+        }
+        vehicle_drop(reg);
+    }
+
+    if (btree_has_error(&btree))
+        return handle_error(bin_fp, btree, NULL);
+
+    if (n_matching == 0)
+        printf(NO_REGISTER);
+
+    btree_drop(btree);
+    fclose(bin_fp);
+
+    return true;
+}
+
+// Mesmo que `print_index_stats` para um índice hash.
+static bool print_hash_index_stats(const char *index_fname) {
+    HashIndex index = hash_index_new();
+
+    if (hash_index_load(&index, index_fname) != BTREE_OK)
+        return handle_error_hash(NULL, index, NULL);
+
+    HashIndexStats stats;
+    if (hash_index_stats(&index, &stats) != BTREE_OK)
+        return handle_error_hash(NULL, index, NULL);
+
+    printf("page_size %u\n", HASH_INDEX_PAGE_SZ);
+    printf("global_depth %u\n", stats.global_depth);
+    printf("buckets %u\n", stats.n_buckets);
+    printf("keys %lu\n", stats.n_keys);
+    printf("fill_factor %.4f\n", stats.fill_factor);
+    printf("pages %u\n", stats.n_pages);
+    printf("directory_pages %u\n", stats.dir_pages);
+
+    hash_index_drop(index);
+    return true;
+}
+
+// Mesmo que `print_index_stats` para uma tabela organizada por índice. As
+// chaves são contadas percorrendo as folhas.
+static bool print_rec_btree_stats(const char *index_fname) {
+    RecBTreeMap btree = rec_btree_new();
+
+    if (rec_btree_load(&btree, index_fname) != BTREE_OK)
+        return handle_error_rec(NULL, btree, NULL);
+
+    RecBTreeCursor *cursor = malloc(sizeof(RecBTreeCursor));
+    uint64_t n_keys = 0, n_bytes = 0;
+
+    bool ok = rec_btree_cursor_first(&btree, cursor);
+    while (ok && rec_btree_cursor_next(cursor)) {
+        n_keys++;
+        n_bytes += cursor->len;
+    }
+    free(cursor);
+
+    if (!ok || rec_btree_has_error(&btree))
+        return handle_error_rec(NULL, btree, NULL);
+
+    printf("page_size %u\n", REC_BTREE_PAGE_SZ);
+    printf("keys %lu\n", n_keys);
+    printf("record_bytes %lu\n", n_bytes);
+    printf("pages %u\n", btree.next_rrn);
+
+    rec_btree_drop(btree);
+    return true;
+}
+
+// Mesmo que `print_index_stats` para um índice com chaves de texto.
+static bool print_str_btree_stats(const char *index_fname) {
+    StrBTreeMap btree = str_btree_new();
+
+    if (str_btree_load_read_only(&btree, index_fname) != BTREE_OK)
+        return handle_error_str(NULL, btree, NULL);
+
+    StrBTreeStats stats;
+    if (str_btree_stats(&btree, &stats) != BTREE_OK)
+        return handle_error_str(NULL, btree, NULL);
+
+    printf("page_size %u\n", STR_BTREE_PAGE_SZ);
+    printf("field %s\n", btree.label);
+    printf("height %u\n", stats.height);
+    printf("nodes %u\n", stats.n_pages);
+    printf("leaf_nodes %u\n", stats.leaf_nodes);
+    printf("keys %lu\n", stats.n_keys);
+    printf("values %lu\n", stats.n_values);
+    printf("fill_factor %.4f\n", stats.fill_factor);
+    printf("pages %u\n", stats.n_pages);
+
+    str_btree_drop(btree);
+    return true;
+}
+
+/*
+* Imprime as estatisticas da estrutura de um indice, de qualquer um dos tipos, uma por linha no formato "campo valor"
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se as estatisticas forem impressas, false se ocorrer algum erro
+*/
+bool print_index_stats(const char *index_fname) {
+    if (hash_index_detect(index_fname))
+        return print_hash_index_stats(index_fname);
+
+    if (rec_btree_detect(index_fname))
+        return print_rec_btree_stats(index_fname);
+
+    if (str_btree_detect(index_fname))
+        return print_str_btree_stats(index_fname);
+
+    BTreeMap btree = btree_new();
+
+    if (btree_open_mmap(&btree, index_fname) != BTREE_OK)
+        return handle_error(NULL, btree, NULL);
+
+    BTreeStats stats;
+    if (btree_stats(&btree, &stats) != BTREE_OK)
+        return handle_error(NULL, btree, NULL);
+
+    printf("page_size %u\n", stats.page_sz);
+    printf("order %u\n", stats.order);
+    printf("height %u\n", stats.height);
+    for (uint32_t i = 0; i < stats.height; i++)
+        printf("level_nodes %u %u\n", i, stats.level_nodes[i]);
+    printf("nodes %u\n", stats.n_nodes);
+    printf("keys %lu\n", stats.n_keys);
+    printf("fill_factor %.4f\n", stats.fill_factor);
+    printf("pages %u\n", stats.n_pages);
+    printf("free_pages %u\n", stats.free_pages);
+    printf("postings_pages %u\n", stats.postings_pages);
+    printf("orphan_pages %u\n", stats.orphan_pages);
+
+    // Uma árvore vazia não possui intervalo de chaves.
+    if (stats.n_keys > 0) {
+        printf("min_key %d\n", stats.min_key);
+        printf("max_key %d\n", stats.max_key);
+    }
+
+    btree_drop(btree);
+    return true;
+}
+
+// Funções que recuperam um campo de texto de um registro, usadas nos índices
+// de campos de texto. O campo é NULL quando o seu valor é nulo.
+typedef const char *(*VehicleField)(const DBVehicleRegister *reg);
+typedef const char *(*BusLineField)(const DBBusLineRegister *reg);
+
+static const char *vehicle_modelo(const DBVehicleRegister *reg)     { return reg->modelo; }
+static const char *vehicle_categoria(const DBVehicleRegister *reg)  { return reg->categoria; }
+static const char *bus_line_nome(const DBBusLineRegister *reg)      { return reg->nomeLinha; }
+static const char *bus_line_cor(const DBBusLineRegister *reg)       { return reg->corLinha; }
+
+// Encontra a função que recupera o campo de texto `field` de um veículo, ou
+// NULL caso o campo não possa ser indexado.
+static VehicleField vehicle_string_field(const char *field) {
+    if (strcmp(field, "modelo") == 0) return vehicle_modelo;
+    if (strcmp(field, "categoria") == 0) return vehicle_categoria;
+    return NULL;
+}
+
+// Encontra a função que recupera o campo de texto `field` de uma linha de
+// ônibus, ou NULL caso o campo não possa ser indexado.
+static BusLineField bus_line_string_field(const char *field) {
+    if (strcmp(field, "nomeLinha") == 0) return bus_line_nome;
+    if (strcmp(field, "corLinha") == 0) return bus_line_cor;
+    return NULL;
+}
+
+// Argumentos das funções que verificam os valores de um índice.
+typedef struct {
+    FILE *bin_fp;
+    // Os offsets do primeiro registro e do fim do último.
+    uint64_t first_offset;
+    uint64_t end_offset;
+    // Se as chaves são o codLinha dos veículos em vez do hash do prefixo.
+    bool by_line;
+} CheckArgs;
+
+// Verifica que `offset` aponta para um veículo não removido cuja chave é `key`.
+static bool check_vehicle_offset(int32_t key, uint64_t offset, CheckArgs *args) {
+    if (offset < args->first_offset || offset >= args->end_offset)
+        return false;
+
+    fseek(args->bin_fp, offset, SEEK_SET);
+
+    DBVehicleRegister reg;
+    if (!read_vehicle_register(args->bin_fp, &reg))
+        return false;
+
+    int32_t reg_key = args->by_line ? reg.codLinha : convertePrefixo(reg.prefixo);
+    bool ok = reg.removido == '1' && reg_key == key;
+    vehicle_drop(reg);
+
+    return ok;
+}
+
+// Verifica que `offset` aponta para uma linha de ônibus não removida cuja chave
+// é `key`.
+static bool check_bus_line_offset(int32_t key, uint64_t offset, CheckArgs *args) {
+    if (offset < args->first_offset || offset >= args->end_offset)
+        return false;
+
+    fseek(args->bin_fp, offset, SEEK_SET);
+
+    DBBusLineRegister reg;
+    if (!read_bus_line_register(args->bin_fp, &reg))
+        return false;
+
+    bool ok = reg.removido == '1' && reg.codLinha == key;
+    bus_line_drop(reg);
+
+    return ok;
+}
+
+// Recria um índice inconsistente com o carregamento em massa, usando a mesma
+// configuração que estiver no header do índice, ou a padrão caso ele não possa
+// ser lido.
+static bool rebuild_index(const char *bin_fname, const char *index_fname, bool vehicle) {
+    if (hash_index_detect(index_fname))
+        return create_hash_index(bin_fname, index_fname, vehicle);
+
+    if (rec_btree_detect(index_fname)) {
+        if (vehicle)
+            return handle_error_rec(NULL, rec_btree_new(), "clustered index %s holds bus lines", index_fname);
+
+        return index_bus_line_clustered_create(bin_fname, index_fname);
+    }
+
+    // O campo indexado é recuperado do header, e o índice só é recriado caso
+    // ele seja um campo de texto do arquivo de dados.
+    if (str_btree_detect(index_fname)) {
+        char field[STR_BTREE_MAX_LABEL_SZ + 1];
+        bool known = str_btree_read_label(index_fname, field)
+                  && (vehicle ? vehicle_string_field(field) != NULL : bus_line_string_field(field) != NULL);
+
+        if (!known)
+            return handle_error_str(NULL, str_btree_new(), "index %s does not hold a text field of %s", index_fname, bin_fname);
+
+        if (vehicle)
+            return index_vehicle_string_create(bin_fname, index_fname, field);
+
+        return index_bus_line_string_create(bin_fname, index_fname, field);
+    }
+
+    // Um arquivo que não é de nenhum dos tipos de índice não é sobrescrito.
+    BTreeMap layout = btree_new();
+    if (btree_read_layout(&layout, index_fname) != BTREE_OK)
+        return handle_error(NULL, layout, "%s is not a known index type", index_fname);
+
+    bool duplicate_keys = layout.duplicate_keys;
+    bool linked_leaves  = layout.linked_leaves;
+    btree_drop(layout);
+
+    if (!vehicle)
+        return create_bus_line_index(bin_fname, index_fname, linked_leaves);
+
+    if (duplicate_keys)
+        return index_vehicle_line_create(bin_fname, index_fname);
+
+    return index_vehicle_create(bin_fname, index_fname);
+}
+
+// Verifica um índice hash com a função `check` e imprime o resultado da mesma
+// forma que `check_index`. Retorna se o índice está consistente, o que não
+// acontece caso ele não tenha sido fechado corretamente.
+static bool check_hash_index(const char *index_fname, BTreeCheckFunc *check, CheckArgs *args) {
+    HashIndex index = hash_index_new();
+
+    if (hash_index_load(&index, index_fname) != BTREE_OK) {
+        hash_index_drop(index);
+        return false;
+    }
+
+    HashIndexStats report;
+    bool consistent = hash_index_check(&index, &report, check, args) == BTREE_OK;
+
+    printf("pages %u\n", report.n_pages);
+    printf("buckets %u\n", report.n_buckets);
+    printf("directory_pages %u\n", report.dir_pages);
+    printf("keys %lu\n", report.n_keys);
+    printf("problems %u\n", report.n_problems);
+
+#ifdef DEBUG
+    if (!consistent) {
+        fprintf(stderr, "Error: %s.\n", hash_index_get_error(&index));
     }
+#endif
 
-    if (format) {
-        fprintf(stderr, "Error: ");
-        vfprintf(stderr, format, ap);
-        fprintf(stderr, ".\n");
+    hash_index_drop(index);
+    return consistent;
+}
+
+// Verifica uma tabela organizada por índice percorrendo as folhas em ordem:
+// as chaves precisam ser crescentes e cada registro precisa ser uma linha de
+// ônibus não removida cujo codLinha é a chave. Imprime o resultado da mesma
+// forma que `check_index` e retorna se a tabela está consistente, o que não
+// acontece caso ela não tenha sido fechada corretamente.
+static bool check_rec_btree(const char *index_fname) {
+    RecBTreeMap btree = rec_btree_new();
+
+    if (rec_btree_load(&btree, index_fname) != BTREE_OK) {
+        rec_btree_drop(btree);
+        return false;
+    }
+
+    RecBTreeCursor *cursor = malloc(sizeof(RecBTreeCursor));
+    uint64_t n_keys = 0;
+    uint32_t n_problems = 0;
+    int64_t last_key = INT64_MIN;
+
+    bool ok = rec_btree_cursor_first(&btree, cursor);
+    while (ok && rec_btree_cursor_next(cursor)) {
+        DBBusLineRegister reg;
+        bool valid = decode_bus_line_register(cursor->record, cursor->len, &reg);
+
+        if (!valid || reg.removido != '1' || reg.codLinha != cursor->key || cursor->key <= last_key)
+            n_problems++;
+
+        if (valid) bus_line_drop(reg);
+
+        last_key = cursor->key;
+        n_keys++;
+    }
+    free(cursor);
+
+    // Uma folha que não pode ser lida interrompe o percurso.
+    if (!ok || rec_btree_has_error(&btree))
+        n_problems++;
+
+    printf("pages %u\n", btree.next_rrn);
+    printf("keys %lu\n", n_keys);
+    printf("problems %u\n", n_problems);
+
+#ifdef DEBUG
+    if (rec_btree_has_error(&btree)) {
+        fprintf(stderr, "Error: %s.\n", rec_btree_get_error(&btree));
+    }
+#endif
+
+    rec_btree_drop(btree);
+    return n_problems == 0;
+}
+
+// Verifica que `offset` aponta para um registro não removido cujo campo de
+// texto, truncado assim como as chaves do índice, é a chave atual do `cursor`.
+// Somente um de `vehicle_field` e `bus_line_field` não é NULL.
+static bool check_string_offset(
+    const StrBTreeCursor *cursor,
+    VehicleField vehicle_field,
+    BusLineField bus_line_field,
+    CheckArgs *args
+) {
+    if (cursor->value < args->first_offset || cursor->value >= args->end_offset)
+        return false;
+
+    fseek(args->bin_fp, cursor->value, SEEK_SET);
+
+    DBVehicleRegister vehicle;
+    DBBusLineRegister bus_line;
+    char removido;
+    const char *field;
+
+    if (vehicle_field) {
+        if (!read_vehicle_register(args->bin_fp, &vehicle)) return false;
+        removido = vehicle.removido;
+        field    = vehicle_field(&vehicle);
     } else {
-        fprintf(stderr, "Error: unexpected.\n");
+        if (!read_bus_line_register(args->bin_fp, &bus_line)) return false;
+        removido = bus_line.removido;
+        field    = bus_line_field(&bus_line);
+    }
+
+    size_t len = field ? strnlen(field, STR_BTREE_MAX_KEY_SZ) : 0;
+    bool ok = removido == '1' && field && len == cursor->key_len && memcmp(field, cursor->key, len) == 0;
+
+    if (vehicle_field) vehicle_drop(vehicle);
+    else bus_line_drop(bus_line);
+
+    return ok;
+}
+
+// Verifica um índice com chaves de texto percorrendo todos os pares em ordem:
+// eles precisam ser crescentes, pela chave e depois pelo offset, e cada offset
+// precisa passar por `check_string_offset`. Imprime o resultado da mesma forma
+// que `check_index` e retorna se o índice está consistente, o que não acontece
+// caso ele não tenha sido fechado corretamente ou o campo indexado não seja do
+// arquivo de dados.
+static bool check_str_btree(const char *index_fname, bool vehicle, CheckArgs *args) {
+    StrBTreeMap btree = str_btree_new();
+
+    if (str_btree_load_read_only(&btree, index_fname) != BTREE_OK) {
+        str_btree_drop(btree);
+        return false;
+    }
+
+    VehicleField vehicle_field  = vehicle ? vehicle_string_field(btree.label) : NULL;
+    BusLineField bus_line_field = vehicle ? NULL : bus_line_string_field(btree.label);
+
+    if (!vehicle_field && !bus_line_field) {
+        str_btree_drop(btree);
+        return false;
+    }
+
+    StrBTreeCursor *cursor = malloc(sizeof(StrBTreeCursor));
+    uint64_t n_keys = 0, n_values = 0;
+    uint32_t n_problems = 0;
+
+    char     last_key[STR_BTREE_MAX_KEY_SZ];
+    uint32_t last_len   = 0;
+    uint64_t last_value = 0;
+
+    bool ok = str_btree_cursor_first(&btree, cursor);
+    while (ok && str_btree_cursor_next(cursor)) {
+        uint32_t min_len = cursor->key_len < last_len ? cursor->key_len : last_len;
+        int cmp = memcmp(cursor->key, last_key, min_len);
+        if (cmp == 0) cmp = (int)cursor->key_len - (int)last_len;
+
+        // Uma chave nova começa a cada mudança, e os pares nunca diminuem.
+        if (n_values == 0 || cmp != 0) n_keys++;
+        if (n_values > 0 && (cmp < 0 || (cmp == 0 && cursor->value <= last_value)))
+            n_problems++;
+
+        if (!check_string_offset(cursor, vehicle_field, bus_line_field, args))
+            n_problems++;
+
+        memcpy(last_key, cursor->key, cursor->key_len);
+        last_len   = cursor->key_len;
+        last_value = cursor->value;
+        n_values++;
+    }
+    free(cursor);
+
+    // Uma folha que não pode ser lida interrompe o percurso.
+    if (!ok || str_btree_has_error(&btree))
+        n_problems++;
+
+    printf("pages %u\n", btree.next_rrn);
+    printf("field %s\n", btree.label);
+    printf("keys %lu\n", n_keys);
+    printf("values %lu\n", n_values);
+    printf("problems %u\n", n_problems);
+
+#ifdef DEBUG
+    if (str_btree_has_error(&btree)) {
+        fprintf(stderr, "Error: %s.\n", str_btree_get_error(&btree));
     }
-#else
-    printf(ERROR_FOUND);
 #endif
 
-    btree_drop(failed_btree);
-    if(to_close)
-        fclose(to_close);
+    str_btree_drop(btree);
+    return n_problems == 0;
+}
 
-    va_end(ap);
+/*
+* Verifica um indice arvore-B de um arquivo de dados e o recria caso ele esteja inconsistente ou nao tenha sido fechado
+* corretamente. Imprime o resultado da verificacao, um por linha no formato "campo valor"
+* @params bin_fname - nome do arquivo binario de dados
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @params vehicle - se o arquivo de dados e de veiculos, e nao de linhas de onibus
+* @returns um valor booleano - true se o indice estiver consistente ou for recriado, false se ocorrer algum erro
+*/
+static bool check_index(const char *bin_fname, const char *index_fname, bool vehicle) {
+    BTreeMap btree = btree_new();
 
-    return false;
+    FILE *bin_fp = fopen(bin_fname, "rb");
+
+    if (!bin_fp)
+        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+
+    DBMeta meta;
+    bool read = false;
+
+    if (vehicle) {
+        DBVehicleHeader header;
+        read = read_header_vehicle(bin_fp, &header);
+        meta = header.meta;
+    } else {
+        DBBusLineHeader header;
+        read = read_header_bus_line(bin_fp, &header);
+        meta = header.meta;
+    }
+
+    if (!read)
+        return handle_error(bin_fp, btree, "failed to read header from %s", bin_fname);
+
+    CheckArgs args = {
+        .bin_fp       = bin_fp,
+        .first_offset = ftell(bin_fp),
+        .end_offset   = meta.byteProxReg,
+    };
+
+    BTreeCheckFunc *check = vehicle ? (BTreeCheckFunc *)check_vehicle_offset
+                                    : (BTreeCheckFunc *)check_bus_line_offset;
+
+    // Um índice que não foi fechado corretamente possui status '0' e não pode
+    // ser aberto, então é recriado sem ser verificado.
+    BTreeCheck report;
+    bool is_hash    = hash_index_detect(index_fname);
+    bool is_rec     = !is_hash && rec_btree_detect(index_fname);
+    bool is_str     = !is_hash && !is_rec && str_btree_detect(index_fname);
+    bool opened     = !is_hash && !is_rec && !is_str && btree_open_mmap(&btree, index_fname) == BTREE_OK;
+    bool consistent = is_hash ? check_hash_index(index_fname, check, &args)
+                    : is_rec  ? !vehicle && check_rec_btree(index_fname)
+                    : is_str  ? check_str_btree(index_fname, vehicle, &args)
+                              : false;
+
+    if (opened) {
+        args.by_line = btree.duplicate_keys;
+        consistent = btree_check(&btree, &report, check, &args) == BTREE_OK;
+
+        printf("pages %u\n", report.n_pages);
+        printf("node_pages %u\n", report.node_pages);
+        printf("free_pages %u\n", report.free_pages);
+        printf("postings_pages %u\n", report.postings_pages);
+        printf("orphan_pages %u\n", report.orphan_pages);
+        printf("keys %lu\n", report.n_keys);
+        printf("values %lu\n", report.n_values);
+        printf("problems %u\n", report.n_problems);
+    }
+
+#ifdef DEBUG
+    if (!consistent && !is_hash && !is_rec && !is_str) {
+        fprintf(stderr, "Error: %s.\n", btree_get_error(&btree));
+    }
+#endif
+
+    btree_drop(btree);
+    fclose(bin_fp);
+
+    if (consistent) {
+        printf("status ok\n");
+        return true;
+    }
+
+    if (!rebuild_index(bin_fname, index_fname, vehicle))
+        return false;
+
+    printf("status rebuilt\n");
+    return true;
 }
 
 /*
-* Cria um arquivo de indice arvore-B para o arquivo de dados veiculo
+* Verifica um indice do arquivo de dados veiculo, criado por index_vehicle_create, index_vehicle_line_create,
+* index_vehicle_hash_create ou index_vehicle_string_create, e o recria caso esteja inconsistente
+* @params bin_fname - nome do arquivo binario veiculos
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se o indice estiver consistente ou for recriado, false se ocorrer algum erro
+*/
+bool check_vehicle_index(const char *bin_fname, const char *index_fname) {
+    return check_index(bin_fname, index_fname, true);
+}
+
+/*
+* Verifica um indice do arquivo de dados linhas de onibus, criado por index_bus_line_create,
+* index_bus_line_ordered_create, index_bus_line_hash_create, index_bus_line_clustered_create ou
+* index_bus_line_string_create, e o recria caso esteja inconsistente
+* @params bin_fname - nome do arquivo binario linhas de onibus
+* @params index_fname - nome do arquivo binario de indice arvore-B
+* @returns um valor booleano - true se o indice estiver consistente ou for recriado, false se ocorrer algum erro
+*/
+bool check_bus_line_index(const char *bin_fname, const char *index_fname) {
+    return check_index(bin_fname, index_fname, false);
+}
+
+/*
+* Cria um arquivo de indice arvore-B com chaves de texto para um campo de texto do arquivo de dados veiculo
 * @params bin_fname - nome do arquivo binario veiculos
 * @params index_fname - nome do arquivo binario de indice arvore-B
+* @params field - o campo indexado, "modelo" ou "categoria"
 * @returns um valor booleano - true se for criado, false se der algum erro
 */
-bool index_vehicle_create(const char *bin_fname, const char *index_fname) {
-    BTreeMap btree = btree_new();
+bool index_vehicle_string_create(const char *bin_fname, const char *index_fname, const char *field) {
+    StrBTreeMap btree = str_btree_new();
+
+    VehicleField get_field = vehicle_string_field(field);
+    if (!get_field)
+        return handle_error_str(NULL, btree, "field %s cannot be indexed", field);
 
     FILE *bin_fp = fopen(bin_fname, "rb");
 
     if (!bin_fp)
-        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to open file %s", bin_fname);
 
-    if (btree_create(&btree, index_fname) != BTREE_OK)
-        return handle_error(bin_fp, btree, NULL);
+    if (str_btree_create(&btree, index_fname, field) != BTREE_OK)
+        return handle_error_str(bin_fp, btree, NULL);
 
     DBVehicleHeader header;
     if (!read_header_vehicle(bin_fp, &header))
-        return handle_error(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
 
     DBVehicleRegister reg;
 
     uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
     uint64_t offset = ftell(bin_fp);
 
-    // Le todos os registros de veiculos do arquivo binario e se nao estiver marcado como removido os insere na arvore-B
+    // Registros com o campo nulo não entram no índice.
     for (int i = 0; i < total_register; i++){
         if (!read_vehicle_register(bin_fp, &reg))
-            return handle_error(bin_fp, btree, "failed to read vehicle register");
+            return handle_error_str(bin_fp, btree, "failed to read vehicle register");
 
-        if (reg.removido == '1') {
-            int32_t hash = convertePrefixo(reg.prefixo);
-            if (btree_insert(&btree, hash, offset) != BTREE_OK)
-                return handle_error(bin_fp, btree, NULL);
-        }
+        const char *key = get_field(&reg);
+        bool ok = reg.removido != '1' || !key || str_btree_insert(&btree, key, offset) == BTREE_OK;
+        vehicle_drop(reg);
 
-        free(reg.modelo);
-        free(reg.categoria);
+        if (!ok)
+            return handle_error_str(bin_fp, btree, NULL);
 
         offset = ftell(bin_fp);
     }
 
-    btree_drop(btree);
+    str_btree_drop(btree);
     fclose(bin_fp);
 
     return true;
 }
 
 /*
-* Cria um arquivo de indice arvore-B para o arquivo de dados linhas de onibus
+* Cria um arquivo de indice arvore-B com chaves de texto para um campo de texto do arquivo de dados linhas de onibus
 * @params bin_fname - nome do arquivo binario linhas de onibus
 * @params index_fname - nome do arquivo binario de indice arvore-B
+* @params field - o campo indexado, "nomeLinha" ou "corLinha"
 * @returns um valor booleano - true se for criado, false se der algum erro
 */
-bool index_bus_line_create(const char *bin_fname, const char *index_fname) {
-    BTreeMap btree = btree_new();
+bool index_bus_line_string_create(const char *bin_fname, const char *index_fname, const char *field) {
+    StrBTreeMap btree = str_btree_new();
+
+    BusLineField get_field = bus_line_string_field(field);
+    if (!get_field)
+        return handle_error_str(NULL, btree, "field %s cannot be indexed", field);
 
     FILE *bin_fp = fopen(bin_fname, "rb");
 
     if (!bin_fp)
-        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to open file %s", bin_fname);
 
-    if (btree_create(&btree, index_fname) != BTREE_OK)
-        return handle_error(bin_fp, btree, NULL);
+    if (str_btree_create(&btree, index_fname, field) != BTREE_OK)
+        return handle_error_str(bin_fp, btree, NULL);
 
     DBBusLineHeader header;
     if (!read_header_bus_line(bin_fp, &header))
-        return handle_error(bin_fp, btree, "failed to read bus line header from %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to read bus line header from %s", bin_fname);
 
     DBBusLineRegister reg;
 
     uint32_t total_register = header.meta.nroRegistros + header.meta.nroRegRemovidos;
     uint64_t offset = ftell(bin_fp);
 
-    // Le todos os registros de linhas de onibus do arquivo binario e se nao estiver marcado como removido os insere na arvore-B
+    // Registros com o campo nulo não entram no índice.
     for (int i = 0; i < total_register; i++){
         if (!read_bus_line_register(bin_fp, &reg))
-            return handle_error(bin_fp, btree, "failed to read bus line register");
+            return handle_error_str(bin_fp, btree, "failed to read bus line register");
 
-        if (reg.removido == '1') {
-            if (btree_insert(&btree, reg.codLinha, offset) != BTREE_OK)
-                return handle_error(bin_fp, btree, NULL);
-        }
+        const char *key = get_field(&reg);
+        bool ok = reg.removido != '1' || !key || str_btree_insert(&btree, key, offset) == BTREE_OK;
+        bus_line_drop(reg);
 
-        free(reg.nomeLinha);
-        free(reg.corLinha);
+        if (!ok)
+            return handle_error_str(bin_fp, btree, NULL);
 
         offset = ftell(bin_fp);
     }
 
-    btree_drop(btree);
+    str_btree_drop(btree);
     fclose(bin_fp);
 
     return true;
 }
 
 /*
-* Recupera os regstros buscados de um determinado arquivo de dados veiculo usando o indice arvore-B
+* Recupera os veiculos cujo campo de texto e igual a um valor usando o indice arvore-B com chaves de texto.
+* Exibe o mesmo que select_from_vehicle_where, sem percorrer o arquivo de dados inteiro
 * @params bin_fname - nome do arquivo binario veiculos
-* @params index_fname - nome do arquivo binario de indices arvore-B
-* @params prefixo[6] - valor do campo prefixo em que sera feita a busca
+* @params index_fname - nome do arquivo binario de indice criado por index_vehicle_string_create
+* @params field - o campo indexado
+* @params value - valor do campo em que sera feita a busca
 * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
 */
-bool search_for_vehicle(const char *bin_fname, const char *index_fname, const char prefixo[6]) {
-    BTreeMap btree = btree_new();
+bool search_for_vehicles_where(const char *bin_fname, const char *index_fname, const char *field, const char *value) {
+    StrBTreeMap btree = str_btree_new();
+
+    VehicleField get_field = vehicle_string_field(field);
+    if (!get_field)
+        return handle_error_str(NULL, btree, "field %s is not indexed", field);
 
     FILE *bin_fp = fopen(bin_fname, "rb");
 
     if (!bin_fp)
-        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to open file %s", bin_fname);
 
     DBVehicleHeader header;
     if (!read_header_vehicle(bin_fp, &header))
-        return handle_error(bin_fp, btree, "failed to read vehicle register from %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to read vehicle header from %s", bin_fname);
 
-    if (btree_load(&btree, index_fname) != BTREE_OK)
-        return handle_error(bin_fp, btree, NULL);
+    if (str_btree_load_read_only(&btree, index_fname) != BTREE_OK)
+        return handle_error_str(bin_fp, btree, NULL);
 
-    int32_t hash = convertePrefixo((char *)prefixo);
-    int64_t off = btree_get(&btree, hash);
+    // O índice precisa ter sido criado para o campo buscado.
+    if (strcmp(btree.label, field) != 0)
+        return handle_error_str(bin_fp, btree, "index %s holds field %s, not %s", index_fname, btree.label, field);
 
-    if (btree_has_error(&btree))
-        return handle_error(bin_fp, btree, NULL);
+    StrBTreeValues values;
+    str_btree_values_open(&btree, &values, value);
 
-    // Verifica se o valor buscado contem algum resultado. Em caso positivo
-    // exibe os valores buscados, em caso contrario exibe uma mensagem de erro
-    if (off < 0) {
-        printf(NO_REGISTER);
-    } else {
-        fseek(bin_fp, off, SEEK_SET);
+    // Os offsets estão em ordem crescente, então os veículos são exibidos na
+    // mesma ordem que numa busca sequencial. Como chaves muito longas são
+    // truncadas no índice, o campo de cada registro ainda é comparado.
+    int n_matching = 0;
+    while (str_btree_values_next(&values)) {
+        fseek(bin_fp, values.value, SEEK_SET);
 
         DBVehicleRegister reg;
         if (!read_vehicle_register(bin_fp, &reg))
-            return handle_error(bin_fp, btree, "failed to read vehicle register");
+            return handle_error_str(bin_fp, btree, "failed to read vehicle register");
 
-        print_vehicle(stdout, &reg, &header);
+        const char *key = get_field(&reg);
+        if (reg.removido == '1' && key && strcmp(key, value) == 0) {
+            print_vehicle(stdout, &reg, &header);
+            printf("\n");
+            n_matching++;
+        }
         vehicle_drop(reg);
     }
 
-    btree_drop(btree);
+    if (str_btree_has_error(&btree))
+        return handle_error_str(bin_fp, btree, NULL);
+
+    if (n_matching == 0)
+        printf(NO_REGISTER);
+
+    str_btree_drop(btree);
     fclose(bin_fp);
 
     return true;
 }
 
 /*
-* Recupera os regstros buscados de um determinado arquivo de dados lnhas de onibus usando o indice arvore-B
+* Recupera as linhas de onibus cujo campo de texto e igual a um valor usando o indice arvore-B com chaves de texto.
+* Exibe o mesmo que select_from_bus_line_where, sem percorrer o arquivo de dados inteiro
 * @params bin_fname - nome do arquivo binario linhas de onibus
-* @params index_fname - nome do arquivo binario de indices arvore-B
-* @params code - valor do campo cdigo em que sera feita a busca
+* @params index_fname - nome do arquivo binario de indice criado por index_bus_line_string_create
+* @params field - o campo indexado
+* @params value - valor do campo em que sera feita a busca
 * @returns um valor booleano - true se a busca for feita com sucesso, false se ocorrer algum erro
 */
-bool search_for_bus_line(const char *bin_fname, const char *index_fname, uint32_t code) {
-    BTreeMap btree = btree_new();
+bool search_for_bus_lines_where(const char *bin_fname, const char *index_fname, const char *field, const char *value) {
+    StrBTreeMap btree = str_btree_new();
+
+    BusLineField get_field = bus_line_string_field(field);
+    if (!get_field)
+        return handle_error_str(NULL, btree, "field %s is not indexed", field);
 
     FILE *bin_fp = fopen(bin_fname, "rb");
 
     if (!bin_fp)
-        return handle_error(bin_fp, btree, "failed to open file %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to open file %s", bin_fname);
 
     DBBusLineHeader header;
     if (!read_header_bus_line(bin_fp, &header))
-        return handle_error(bin_fp, btree, "failed to read bus line header from %s", bin_fname);
+        return handle_error_str(bin_fp, btree, "failed to read bus line header from %s", bin_fname);
 
-    if (btree_load(&btree, index_fname) != BTREE_OK)
-        return handle_error(bin_fp, btree, NULL);
+    if (str_btree_load_read_only(&btree, index_fname) != BTREE_OK)
+        return handle_error_str(bin_fp, btree, NULL);
 
-    int64_t off = btree_get(&btree, code);
+    // O índice precisa ter sido criado para o campo buscado.
+    if (strcmp(btree.label, field) != 0)
+        return handle_error_str(bin_fp, btree, "index %s holds field %s, not %s", index_fname, btree.label, field);
 
-    if (btree_has_error(&btree))
-        return handle_error(bin_fp, btree, NULL);
+    StrBTreeValues values;
+    str_btree_values_open(&btree, &values, value);
 
-    // Verifica se o valor buscado contem algum resultado. Em caso positivo
-    // exibe os valores buscados, em caso contrario exibe uma mensagem de erro
-    if (off < 0) {
-        printf(NO_REGISTER);
-    } else {
-        fseek(bin_fp, off, SEEK_SET);
+    // Assim como em `search_for_vehicles_where`, o campo de cada registro
+    // ainda é comparado por causa das chaves truncadas.
+    int n_matching = 0;
+    while (str_btree_values_next(&values)) {
+        fseek(bin_fp, values.value, SEEK_SET);
 
         DBBusLineRegister reg;
         if (!read_bus_line_register(bin_fp, &reg))
-            return handle_error(bin_fp, btree, "failed to read bus line register");
+            return handle_error_str(bin_fp, btree, "failed to read bus line register");
 
-        print_bus_line(stdout, &reg, &header);
+        const char *key = get_field(&reg);
+        if (reg.removido == '1' && key && strcmp(key, value) == 0) {
+            print_bus_line(stdout, &reg, &header);
+            printf("\n");
+            n_matching++;
+        }
         bus_line_drop(reg);
     }
 
-    btree_drop(btree);
+    if (str_btree_has_error(&btree))
+        return handle_error_str(bin_fp, btree, NULL);
+
+    if (n_matching == 0)
+        printf(NO_REGISTER);
+
+    str_btree_drop(btree);
     fclose(bin_fp);
+
     return true;
 }
 
 typedef struct {
     FILE *bin_fp;
     BTreeMap *btree;
+    // O índice hash, ou NULL caso o índice seja a árvore-B `btree`.
+    HashIndex *hash;
+    // A tabela organizada por índice, ou NULL. Somente as linhas de ônibus
+    // podem ser inseridas nela.
+    RecBTreeMap *rec;
+    BloomFilter *filter;
     size_t reg_count;
     size_t removed_reg_count;
 } IterArgs;
 
+// Insere um par no índice do iterador. Somente a árvore-B possui filtro de
+// Bloom, que é atualizado junto dela.
+static bool iter_index_insert(IterArgs *args, int32_t key, uint64_t offset) {
+    if (args->hash)
+        return hash_index_insert(args->hash, key, offset) == BTREE_OK;
+
+    bloom_add(args->filter, key);
+    return btree_insert(args->btree, key, offset) == BTREE_OK;
+}
+
+static const char *iter_index_error(IterArgs *args) {
+    if (args->rec) return rec_btree_get_error(args->rec);
+    return args->hash ? hash_index_get_error(args->hash) : btree_get_error(args->btree);
+}
+
 /*
 * Itera sobre sobre os dados de indice dos veiculos.
 * @params csv - struct do tipo CSV
@@ -260,6 +1696,11 @@ typedef struct {
 static CSVResult vehicle_index_row_iterator(CSV *csv, const Vehicle *vehicle, IterArgs *args) {
     size_t offset = ftell(args->bin_fp);
 
+    if (args->rec) {
+        csv_error(csv, "clustered index only holds bus lines");
+        return CSV_ERR_OTHER;
+    }
+
     if (!write_vehicle(vehicle, args->bin_fp)) {
         csv_error(csv, "failed to write vehicle");
         return CSV_ERR_OTHER;
@@ -271,13 +1712,17 @@ static CSVResult vehicle_index_row_iterator(CSV *csv, const Vehicle *vehicle, It
     } else {
         args->reg_count++;
 
-        // Por algum motivo `convertePrefixo` recebe um argumento não `const`, então
-        // precisamos desse cast.
-        int32_t hash = convertePrefixo((char *)vehicle->prefixo);
+        // O índice de chaves duplicadas criado por `index_vehicle_line_create`
+        // é organizado por codLinha, e os demais pelo prefixo. Por algum motivo
+        // `convertePrefixo` recebe um argumento não `const`, então precisamos
+        // desse cast.
+        int32_t key = args->btree->duplicate_keys
+            ? vehicle->codLinha
+            : convertePrefixo((char *)vehicle->prefixo);
 
-        if (btree_insert(args->btree, hash, offset) != BTREE_OK) {
+        if (!iter_index_insert(args, key, offset)) {
             csv_error(csv, "failed to insert vehicle register in index: %s",
-                      btree_get_error(args->btree));
+                      iter_index_error(args));
             return CSV_ERR_OTHER;
         }
     }
@@ -306,9 +1751,23 @@ static CSVResult bus_line_index_row_iterator(CSV *csv, const BusLine *bus_line,
         args->reg_count++;
 
         int32_t codLinha = (int)strtol(bus_line->codLinha, NULL, 10);
-        if (btree_insert(args->btree, codLinha, offset) != BTREE_OK) {
+
+        // A tabela organizada por índice guarda o registro inteiro, no mesmo
+        // formato em que ele foi escrito no arquivo de dados.
+        DBBusLineRegister reg = {
+            .removido     = '1',
+            .codLinha     = codLinha,
+            .aceitaCartao = bus_line->aceitaCartao[0],
+            .nomeLinha    = bus_line->nomeLinha,
+            .corLinha     = bus_line->corLinha,
+        };
+
+        bool inserted = args->rec ? rec_btree_insert_bus_line(args->rec, &reg)
+                                  : iter_index_insert(args, codLinha, offset);
+
+        if (!inserted) {
             csv_error(csv, "failed to insert bus line register in index: %s",
-                      btree_get_error(args->btree));
+                      iter_index_error(args));
             return CSV_ERR_OTHER;
         }
     }
@@ -332,29 +1791,67 @@ static bool csv_append_to_bin_and_index(
     const char *sep
 ) {
     BTreeMap btree = btree_new();
+    HashIndex hash = hash_index_new();
+    RecBTreeMap rec = rec_btree_new();
     FILE *bin_fp = fopen(bin_fname, "r+b");
 
     if (!bin_fp)
         return handle_error(bin_fp, btree, "could not open file %s", bin_fname);
 
-    // Verifica se a arvore-B consegue ser carregada
-    if (btree_load(&btree, index_fname) != BTREE_OK)
-        return handle_error(bin_fp, btree, "could not load btree from file %s", index_fname);
+    // O índice pode ser uma árvore-B, um índice hash ou uma tabela organizada
+    // por índice. Como somente um deles é vinculado, os erros abaixo liberam
+    // todos.
+    bool is_hash = hash_index_detect(index_fname);
+    bool is_rec  = !is_hash && rec_btree_detect(index_fname);
+
+    if (is_rec) {
+        if (rec_btree_load(&rec, index_fname) != BTREE_OK)
+            return handle_error_rec(bin_fp, rec, "could not load clustered index from file %s", index_fname);
+    } else if (is_hash) {
+        if (hash_index_load(&hash, index_fname) != BTREE_OK)
+            return handle_error_hash(bin_fp, hash, "could not load hash index from file %s", index_fname);
+    } else {
+        // Verifica se a arvore-B consegue ser carregada
+        if (btree_load(&btree, index_fname) != BTREE_OK)
+            return handle_error(bin_fp, btree, "could not load btree from file %s", index_fname);
+
+        // As inserções não sobrescrevem as páginas do índice, de modo que ele
+        // pode ser lido, por exemplo por uma junção, enquanto os registros são
+        // adicionados. Os índices B+ e os de chaves duplicadas continuam sendo
+        // modificados no lugar.
+        bool copy_on_write = !btree.linked_leaves && !btree.duplicate_keys;
+        if (copy_on_write && btree_set_copy_on_write(&btree, true) != BTREE_OK)
+            return handle_error(bin_fp, btree, NULL);
+    }
 
     DBMeta meta;
 
     // Verifica se o arquivo binario consegue ser lido e reailza a leitura
-    if (!read_meta(bin_fp, &meta))
+    if (!read_meta(bin_fp, &meta)) {
+        hash_index_drop(hash);
+        rec_btree_drop(rec);
         return handle_error(bin_fp, btree, "could not read meta header from file %s", bin_fname);
+    }
 
     // Verifica se o status do arquivo binario consegue ser atualizado e o atualiza para 0
     // (siginifica que sera realizado insercao)
-    if (!update_header_status('0', bin_fp))
+    if (!update_header_status('0', bin_fp)) {
+        hash_index_drop(hash);
+        rec_btree_drop(rec);
         return handle_error(bin_fp, btree, "could not write status to file %s", bin_fname);
+    }
+
+    // O filtro de Bloom da árvore-B é atualizado junto dela. Caso o índice não
+    // tenha filtro, o filtro vazio ignora as chaves inseridas.
+    BloomFilter filter = bloom_empty();
+    if (!is_hash && !is_rec) bloom_load(&filter, index_fname);
 
     IterArgs args = {
         .bin_fp            = bin_fp,
         .btree             = &btree,
+        .hash              = is_hash ? &hash : NULL,
+        .rec               = is_rec ? &rec : NULL,
+        .filter            = &filter,
         .reg_count         = 0,
         .removed_reg_count = 0,
     };
@@ -362,19 +1859,31 @@ static bool csv_append_to_bin_and_index(
     // Vai para o fim do arquivo para adicionar novos registros.
     fseek(bin_fp, 0L, SEEK_END);
 
-    if (csv_iterate_rows(csv, sep, (CSVIterFunc *)iter, &args) != CSV_OK)
+    bool ok = csv_iterate_rows(csv, sep, (CSVIterFunc *)iter, &args) == CSV_OK
+           && (filter.n_bits == 0 || bloom_save(&filter, index_fname));
+    bloom_drop(filter);
+
+    if (!ok) {
+        hash_index_drop(hash);
+        rec_btree_drop(rec);
         return handle_error(bin_fp, btree, NULL);
+    }
 
     meta.status = '1';
     meta.byteProxReg = ftell(bin_fp);
     meta.nroRegRemovidos += args.removed_reg_count;
     meta.nroRegistros += args.reg_count;
 
-    if (!update_header_meta(&meta, bin_fp))
+    if (!update_header_meta(&meta, bin_fp)) {
+        hash_index_drop(hash);
+        rec_btree_drop(rec);
         return handle_error(bin_fp, btree, "could not write meta header to file %s", bin_fname);
+    }
 
     fclose(bin_fp);
     btree_drop(btree);
+    hash_index_drop(hash);
+    rec_btree_drop(rec);
 
     return true;
 }
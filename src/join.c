@@ -8,6 +8,14 @@
 #include <bin.h>
 #include <sort.h>
 #include <btree.h>
+#include <hash_index.h>
+#include <rec_btree.h>
+#include <bloom.h>
+#include <index.h>
+
+// Número de veículos cujas linhas são buscadas de uma só vez na junção com
+// índice árvore-B.
+#define JOIN_BATCH_SZ 256
 
 // Verifica a quantidade de itens que satisfazem uma busca. Exibe uma mensagem de erro se
 // nenhuma é encontrada e retorna false, retorna true em caso contrário.
@@ -19,6 +27,11 @@ static bool checks_matching(int n_matching){
     return true;
 }
 
+// Libera os `n` primeiros registros de veículo de `batch`.
+static void drop_vehicles(DBVehicleRegister *batch, size_t n) {
+    for (size_t i = 0; i < n; i++) vehicle_drop(batch[i]);
+}
+
 // Mesmo que `handle_error` mas recebe uma `va_list` ao invés de argumentos
 // variádicos.
 static inline bool vhandle_error(FILE *restrict to_close1, FILE *restrict to_close2, const char *format, va_list ap) {
@@ -97,6 +110,52 @@ static inline bool handle_error_btree(
     return false;
 }
 
+/**
+ * Mesmo que `handle_error_btree`, mas o índice pode ser uma `BTreeMap`, um
+ * `HashIndex` ou uma `RecBTreeMap`, e todos são liberados.
+ *
+ * @param to_close1 - um arquivo que será fechado.
+ * @param to_close2 - outro arquivo que será fechado.
+ * @param failed_btree - btree com erro, ou sem arquivo vinculado.
+ * @param failed_hash - índice hash com erro, ou sem arquivo vinculado.
+ * @param failed_rec - tabela organizada por índice com erro, ou sem arquivo
+ *                     vinculado.
+ * @param format - uma string de formato, igual a do `printf`.
+ * @param ... - argumentos variádicos que seguem ao padrão `printf`.
+ */
+static inline bool handle_error_index(
+    FILE *restrict to_close1,
+    FILE *restrict to_close2,
+    BTreeMap failed_btree,
+    HashIndex failed_hash,
+    RecBTreeMap failed_rec,
+    const char *format,
+    ...
+) {
+    va_list ap;
+    va_start(ap, format);
+
+#ifdef DEBUG
+    if (btree_has_error(&failed_btree)) {
+        fprintf(stderr, "Error: %s.\n", btree_get_error(&failed_btree));
+    }
+    if (hash_index_has_error(&failed_hash)) {
+        fprintf(stderr, "Error: %s.\n", hash_index_get_error(&failed_hash));
+    }
+    if (rec_btree_has_error(&failed_rec)) {
+        fprintf(stderr, "Error: %s.\n", rec_btree_get_error(&failed_rec));
+    }
+#endif
+    btree_drop(failed_btree);
+    hash_index_drop(failed_hash);
+    rec_btree_drop(failed_rec);
+
+    vhandle_error(to_close1, to_close2, format, ap);
+
+    va_end(ap);
+    return false;
+}
+
 /**
  * Exibe os resultados que satisfazem a busca de codLinha no arquivo binário de veículos e
  * no arquivo binário de linhsa de ônibus
@@ -139,63 +198,77 @@ bool join_vehicle_and_bus_line(const char *vehicle_bin_fname, const char *buslin
                             "could not read header from %s",
                             busline_bin_fname);
 
-    // Buffers para os registros que serão lidos.
-    DBBusLineRegister reg_busline;
-    DBVehicleRegister reg_vehicle;
-
-    // O número total de registros em cada arquivo.
-    uint32_t n_vehicle_registers = header_vehicle.meta.nroRegistros + header_vehicle.meta.nroRegRemovidos;
-    uint32_t n_busline_registers = header_busline.meta.nroRegistros + header_busline.meta.nroRegRemovidos;
+    // Os arquivos são mapeados em memória e os registros são lidos como visões,
+    // sem alocar as strings. Cada arquivo tem o próprio leitor, de modo que o
+    // veículo atual continua válido enquanto as linhas são percorridas. Os
+    // removidos são pulados pelos leitores sem serem decodificados.
+    RecordScan scan_vehicle_file = scan_map(file_vehicle);
+    RecordScan scan_busline_file = scan_map(file_busline);
+    scan_vehicle_file.skip_removed = true;
+    scan_busline_file.skip_removed = true;
+    DBVehicleView reg_vehicle;
+    DBBusLineView reg_busline;
+
+    // O número de registros não removidos em cada arquivo, que são os únicos
+    // devolvidos pelos leitores.
+    uint32_t n_vehicle_registers = header_vehicle.meta.nroRegistros;
+    uint32_t n_busline_registers = header_busline.meta.nroRegistros;
 
     // Contador de registros imprimidos
     int n_matching = 0;
 
     // Itera por todos os registros de veículo.
     for (int i = 0; i < n_vehicle_registers; i++){
-        // Lê e verifica erros na leitura do registro de veículo.
-        if (!read_vehicle_register(file_vehicle, &reg_vehicle))
+        // Lê e verifica erros na leitura do registro de veículo. Até que haja
+        // uma linha correspondente, só o `codLinha` é necessário.
+        if (!scan_vehicle_fields(&scan_vehicle_file, &reg_vehicle, VEHICLE_FIELD_COD_LINHA)) {
+            scan_drop(scan_vehicle_file);
+            scan_drop(scan_busline_file);
             return handle_error(file_busline, file_vehicle,
                                 "could not read register from %s",
                                 vehicle_bin_fname);
-
-        // Caso necessário, posiciona o ponteiro de leitura do arquivo de linha
-        // logo após o header, ou seja, onde começam os registros.
-        if (i > 0)
-            fseek(file_busline, BUS_LINE_HEADER_SIZE, SEEK_SET);
-
-        // Se o veículo estiver removido, leia outro veículo até achar um que
-        // não esteja.
-        if (reg_vehicle.removido == '0') {
-            vehicle_drop(reg_vehicle);
-            continue;
         }
 
+        // Volta o leitor de linhas para logo após o header, ou seja, onde
+        // começam os registros.
+        scan_rewind(&scan_busline_file);
+
         // Itera por todos os registros de linha
         for (int j = 0; j < n_busline_registers; j++){
             // Lê e verifica erros na leitura do registro de linha.
-            if (!read_bus_line_register(file_busline, &reg_busline))
+            if (!scan_bus_line_fields(&scan_busline_file, &reg_busline, BUS_LINE_FIELD_COD_LINHA)) {
+                scan_drop(scan_vehicle_file);
+                scan_drop(scan_busline_file);
                 return handle_error(file_busline, file_vehicle,
                                     "could not read register from %s",
                                     busline_bin_fname);
+            }
 
-            // Se a linha não estiver removida, imprime o veículo seguido da
-            // linha caso os códigos sejam iguais.
-
-            bool removed_busline = reg_busline.removido == '0';
-
-            if(reg_vehicle.codLinha == reg_busline.codLinha && !removed_busline){
-                print_vehicle(stdout, &reg_vehicle, &header_vehicle);
-                print_bus_line(stdout, &reg_busline, &header_busline);
+            // Imprime o veículo seguido da linha caso os códigos sejam iguais,
+            // decodificando antes o restante dos dois registros.
+            if(reg_vehicle.codLinha == reg_busline.codLinha){
+                if (!scan_vehicle_complete(&scan_vehicle_file, &reg_vehicle) ||
+                    !scan_bus_line_complete(&scan_busline_file, &reg_busline)) {
+                    scan_drop(scan_vehicle_file);
+                    scan_drop(scan_busline_file);
+                    return handle_error(file_busline, file_vehicle,
+                                        "could not read register from %s",
+                                        vehicle_bin_fname);
+                }
+
+                print_vehicle_view(stdout, &reg_vehicle, &header_vehicle);
+                print_bus_line_view(stdout, &reg_busline, &header_busline);
                 fprintf(stdout, "\n");
 
                 // Adiciona o contador de registros imprimidos.
                 n_matching++; 
             }
-            bus_line_drop(reg_busline);
         }
-        vehicle_drop(reg_vehicle);
     }
 
+    scan_drop(scan_vehicle_file);
+    scan_drop(scan_busline_file);
+
     // Closes the binary files
     fclose(file_busline);
     fclose(file_vehicle);
@@ -206,11 +279,12 @@ bool join_vehicle_and_bus_line(const char *vehicle_bin_fname, const char *buslin
 
 /**
  * Exibe os resultados que satisfazem a busca de codLinha no arquivo binário de veículos e
- * no arquivo binário de linha de ônibus
+ * no arquivo binário de linha de ônibus. As linhas dos veículos são buscadas
+ * no índice em lotes de `JOIN_BATCH_SZ` registros.
  *
  * @param vehicle_bin_fname - caminho para o arquivo binário de veículos
  * @param busline_bin_fname - caminho para o arquivo binário de linhas de ônibus
- * @param index_btree_fname - caminho para o arquivo binário de índices árvore-B
+ * @param index_btree_fname - caminho para o arquivo binário de índices árvore-B, hash ou de linhas organizadas por índice
  * @returns - um valor booleano = true se a leitura dos arquivos der certo e retornar algum
  *            resultado, false se a leitura dos arquivos der errado ou não retornar nenhum
  *            resultado da busca
@@ -237,8 +311,12 @@ bool join_vehicle_and_bus_line_using_btree(
                             "could not open %s",
                             busline_bin_fname);
 
-    // Lê os headers de ambos os binários e da btree e verifica se houve algum erro.
+    // Lê os headers de ambos os binários e do índice e verifica se houve algum
+    // erro. O índice pode ser uma árvore-B, um índice hash ou uma tabela
+    // organizada por índice, e somente um deles é vinculado.
     BTreeMap btree = btree_new();
+    HashIndex hash = hash_index_new();
+    RecBTreeMap rec = rec_btree_new();
 
     DBVehicleHeader header_vehicle;
     if (!read_header_vehicle(file_vehicle, &header_vehicle))
@@ -252,52 +330,133 @@ bool join_vehicle_and_bus_line_using_btree(
                                   "could not read header from %s",
                                   vehicle_bin_fname);
 
-    if (btree_load(&btree, index_btree_fname) != BTREE_OK)
-        return handle_error_btree(file_vehicle, file_busline, btree, NULL);
+    bool is_hash = hash_index_detect(index_btree_fname);
+    bool is_rec  = !is_hash && rec_btree_detect(index_btree_fname);
+    BTreeResult opened = is_hash ? hash_index_load(&hash, index_btree_fname)
+                       : is_rec  ? rec_btree_load(&rec, index_btree_fname)
+                                 : btree_open_mmap(&btree, index_btree_fname);
+
+    if (opened != BTREE_OK)
+        return handle_error_index(file_vehicle, file_busline, btree, hash, rec, NULL);
+
+    // Veículos cujas linhas não existem são descartados pelo filtro de Bloom
+    // da árvore-B, sem buscar nela. No índice hash cada busca já custa a
+    // leitura de uma única página.
+    BloomFilter filter = bloom_empty();
+    if (!is_hash && !is_rec) bloom_load(&filter, index_btree_fname);
+
+    // Na tabela organizada por índice, a busca de cada veículo já traz o
+    // registro da linha, sem ler o arquivo de linhas.
+    uint8_t record[REC_BTREE_MAX_RECORD_SZ];
 
     uint32_t n_vehicle_registers = header_vehicle.meta.nroRegistros + header_vehicle.meta.nroRegRemovidos;
 
+    // Os veículos são lidos em lotes e as linhas de todos os veículos do lote
+    // são buscadas de uma só vez na btree. `probe_of` guarda a posição no lote
+    // do veículo de cada chave buscada.
+    DBVehicleRegister batch[JOIN_BATCH_SZ];
+    int32_t keys[JOIN_BATCH_SZ];
+    size_t  probe_of[JOIN_BATCH_SZ];
+    int64_t found[JOIN_BATCH_SZ];
+    int64_t offsets[JOIN_BATCH_SZ];
+
     int n_matching = 0;
-    // Loops and reads all the binary vehicle registers
-    for (int i = 0; i < n_vehicle_registers; i++){
-        // Lê o registro de veículo e verifica se ocorreu erro.
-        DBVehicleRegister reg_vehicle;
-        if (!read_vehicle_register(file_vehicle, &reg_vehicle))
-            return handle_error_btree(file_vehicle, file_busline, btree,
-                                      "failed to read register from %s",
-                                      vehicle_bin_fname);
+    for (uint32_t i = 0; i < n_vehicle_registers; i += JOIN_BATCH_SZ) {
+        uint32_t n_batch = n_vehicle_registers - i;
+        if (n_batch > JOIN_BATCH_SZ) n_batch = JOIN_BATCH_SZ;
+
+        // Lê os registros de veículo do lote, guardando apenas os não
+        // removidos, e verifica se ocorreu erro.
+        size_t n_keys = 0;
+        size_t n_probes = 0;
+        for (uint32_t j = 0; j < n_batch; j++) {
+            DBVehicleRegister reg_vehicle;
+            if (!read_vehicle_register(file_vehicle, &reg_vehicle)) {
+                drop_vehicles(batch, n_keys);
+                bloom_drop(filter);
+                return handle_error_index(file_vehicle, file_busline, btree, hash, rec,
+                                          "failed to read register from %s",
+                                          vehicle_bin_fname);
+            }
 
-        // Verifica se o atual registro veículo está marcado como removido. Se
-        // estiver, passa para a próxima iteração.
-        if(reg_vehicle.removido == '0') {
-            vehicle_drop(reg_vehicle);
-            continue;
+            if (reg_vehicle.removido == '0') {
+                vehicle_drop(reg_vehicle);
+                continue;
+            }
+
+            offsets[n_keys] = -1;
+            if (bloom_may_contain(&filter, reg_vehicle.codLinha)) {
+                keys[n_probes] = reg_vehicle.codLinha;
+                probe_of[n_probes++] = n_keys;
+            }
+            batch[n_keys++] = reg_vehicle;
         }
 
-        int64_t off = btree_get(&btree, reg_vehicle.codLinha);
-        if(btree_has_error(&btree)) 
-            return handle_error_btree(file_vehicle, file_busline, btree, NULL);
+        BTreeResult got = is_rec  ? BTREE_OK
+                        : is_hash ? hash_index_get_many(&hash, keys, n_probes, found)
+                                  : btree_get_many(&btree, keys, n_probes, found);
 
-        if(off >= 0){
-            fseek(file_busline, off, SEEK_SET);
+        if (got != BTREE_OK) {
+            drop_vehicles(batch, n_keys);
+            bloom_drop(filter);
+            return handle_error_index(file_vehicle, file_busline, btree, hash, rec, NULL);
+        }
+
+        for (size_t p = 0; p < n_probes && !is_rec; p++)
+            offsets[probe_of[p]] = found[p];
 
-            // Lê o registro de linha e verifica se ocorreu erro.
+        for (size_t j = 0; j < n_keys; j++) {
             DBBusLineRegister reg_busline;
-            if (!read_bus_line_register(file_busline, &reg_busline))
-                return handle_error_btree(file_vehicle, file_busline, btree,
-                                          "failed to read bus line register from %s",
-                                          busline_bin_fname);
+
+            if (is_rec) {
+                int32_t len = rec_btree_get(&rec, batch[j].codLinha, record);
+
+                if (len < 0 && rec_btree_has_error(&rec)) {
+                    drop_vehicles(batch, n_keys);
+                    bloom_drop(filter);
+                    return handle_error_index(file_vehicle, file_busline, btree, hash, rec, NULL);
+                }
+
+                if (len < 0) continue;
+
+                if (!decode_bus_line_register(record, len, &reg_busline)) {
+                    drop_vehicles(batch, n_keys);
+                    bloom_drop(filter);
+                    return handle_error_index(file_vehicle, file_busline, btree, hash, rec,
+                                              "failed to decode bus line register %d",
+                                              batch[j].codLinha);
+                }
+            } else if (offsets[j] < 0) {
+                continue;
+            } else {
+                fseek(file_busline, offsets[j], SEEK_SET);
+
+                // Lê o registro de linha e verifica se ocorreu erro.
+                if (!read_bus_line_register(file_busline, &reg_busline)) {
+                    drop_vehicles(batch, n_keys);
+                    bloom_drop(filter);
+                    return handle_error_index(file_vehicle, file_busline, btree, hash, rec,
+                                              "failed to read bus line register from %s",
+                                              busline_bin_fname);
+                }
+            }
 
             // Imprime ambos os registros
-            print_vehicle(stdout, &reg_vehicle, &header_vehicle);
+            print_vehicle(stdout, &batch[j], &header_vehicle);
             print_bus_line(stdout, &reg_busline, &header_busline);
             fprintf(stdout, "\n");
             n_matching++;
             bus_line_drop(reg_busline);
         }
-        vehicle_drop(reg_vehicle);
+
+        drop_vehicles(batch, n_keys);
     }
 
+    bloom_drop(filter);
+    btree_drop(btree);
+    hash_index_drop(hash);
+    rec_btree_drop(rec);
+
     // Closes the binary files
     fclose(file_busline);
     fclose(file_vehicle);
@@ -307,10 +466,126 @@ bool join_vehicle_and_bus_line_using_btree(
 }
 
 /**
- * Ordena os dois arquivos fornecidos gerando novos arquivos ordenados com o
- * sufixo "_ordenado". Em seguida abre esses arquivos ordenados e itera sobre os
- * registros imprimindo os registros onde veiculo.codLinha == linha.codLinha
- * usando um merge.
+ * Exibe os resultados que satisfazem a busca de codLinha no arquivo binário de
+ * veículos e no arquivo binário de linha de ônibus. Percorre as linhas e busca
+ * os veículos de cada uma no índice árvore-B de codLinha com chaves duplicadas,
+ * sem percorrer o arquivo de veículos inteiro. Os resultados são agrupados por
+ * linha, na ordem do arquivo de linhas.
+ *
+ * @param vehicle_bin_fname - caminho para o arquivo binário de veículos
+ * @param busline_bin_fname - caminho para o arquivo binário de linhas de ônibus
+ * @param vehicle_index_fname - caminho para o índice criado por
+ *                              `index_vehicle_line_create`
+ * @returns - um valor booleano = true se a leitura dos arquivos der certo e retornar algum
+ *            resultado, false se a leitura dos arquivos der errado ou não retornar nenhum
+ *            resultado da busca
+ */
+bool join_vehicle_index_and_bus_line(
+    const char *vehicle_bin_fname,
+    const char *busline_bin_fname,
+    const char *vehicle_index_fname
+){
+    FILE *file_vehicle = NULL;
+    FILE *file_busline = NULL;
+
+    file_vehicle = fopen(vehicle_bin_fname, "rb");
+    if(!file_vehicle)
+        return handle_error(file_busline, file_vehicle,
+                            "could not open %s",
+                            vehicle_bin_fname);
+
+    file_busline = fopen(busline_bin_fname, "rb");
+    if(!file_busline)
+        return handle_error(file_busline, file_vehicle,
+                            "could not open %s",
+                            busline_bin_fname);
+
+    BTreeMap btree = btree_new();
+
+    DBVehicleHeader header_vehicle;
+    if (!read_header_vehicle(file_vehicle, &header_vehicle))
+        return handle_error_btree(file_vehicle, file_busline, btree,
+                                  "could not read header from %s",
+                                  vehicle_bin_fname);
+
+    DBBusLineHeader header_busline;
+    if (!read_header_bus_line(file_busline, &header_busline))
+        return handle_error_btree(file_vehicle, file_busline, btree,
+                                  "could not read header from %s",
+                                  busline_bin_fname);
+
+    if (btree_open_mmap(&btree, vehicle_index_fname) != BTREE_OK)
+        return handle_error_btree(file_vehicle, file_busline, btree, NULL);
+
+    // Linhas sem nenhum veículo são descartadas pelo filtro de Bloom do
+    // índice, sem buscar na btree.
+    BloomFilter filter;
+    bloom_load(&filter, vehicle_index_fname);
+
+    uint32_t n_busline_registers = header_busline.meta.nroRegistros + header_busline.meta.nroRegRemovidos;
+
+    int n_matching = 0;
+    for (int i = 0; i < n_busline_registers; i++){
+        DBBusLineRegister reg_busline;
+        if (!read_bus_line_register(file_busline, &reg_busline)) {
+            bloom_drop(filter);
+            return handle_error_btree(file_vehicle, file_busline, btree,
+                                      "failed to read register from %s",
+                                      busline_bin_fname);
+        }
+
+        if(reg_busline.removido == '0' || !bloom_may_contain(&filter, reg_busline.codLinha)) {
+            bus_line_drop(reg_busline);
+            continue;
+        }
+
+        // Lê cada um dos veículos da linha diretamente do seu offset.
+        BTreePostings postings;
+        btree_postings_open(&btree, &postings, reg_busline.codLinha);
+
+        while (btree_postings_next(&postings)) {
+            fseek(file_vehicle, postings.value, SEEK_SET);
+
+            DBVehicleRegister reg_vehicle;
+            if (!read_vehicle_register(file_vehicle, &reg_vehicle)) {
+                bus_line_drop(reg_busline);
+                bloom_drop(filter);
+                return handle_error_btree(file_vehicle, file_busline, btree,
+                                          "failed to read vehicle register from %s",
+                                          vehicle_bin_fname);
+            }
+
+            if (reg_vehicle.removido == '1') {
+                print_vehicle(stdout, &reg_vehicle, &header_vehicle);
+                print_bus_line(stdout, &reg_busline, &header_busline);
+                fprintf(stdout, "\n");
+                n_matching++;
+            }
+            vehicle_drop(reg_vehicle);
+        }
+        bus_line_drop(reg_busline);
+
+        if(btree_has_error(&btree)) {
+            bloom_drop(filter);
+            return handle_error_btree(file_vehicle, file_busline, btree, NULL);
+        }
+    }
+
+    bloom_drop(filter);
+    btree_drop(btree);
+    fclose(file_busline);
+    fclose(file_vehicle);
+
+    return checks_matching(n_matching);
+}
+
+/**
+ * Ordena o arquivo de veículos gerando um novo arquivo ordenado com o sufixo
+ * "_ordenado", e cria um índice árvore B+ de codLinha do arquivo de linhas com
+ * o sufixo "_indice". Em seguida percorre os veículos ordenados junto das
+ * folhas encadeadas do índice, que já estão em ordem de codLinha, imprimindo os
+ * registros onde veiculo.codLinha == linha.codLinha usando um merge. Somente as
+ * linhas com algum veículo correspondente são lidas do arquivo de linhas.
  *
  * @param vehicle_bin_fname - nome do arquivo binário com os registros de veículo.
  * @param busline_bin_fname - nome do arquivo binário com os registros de linha.
@@ -318,109 +593,130 @@ bool join_vehicle_and_bus_line_using_btree(
  *            (uma mensagem de erro será exibida).
  */
 bool join_vehicle_and_bus_line_merge_sorted(const char *vehicle_bin_fname, const char *busline_bin_fname) {
-    // Cria os nomes dos arquivos ordenados como sendo o mesmo nome dos arquivos
-    // originais mas com o sufixo "_ordenado".
+    // Cria os nomes do arquivo ordenado e do índice como sendo o mesmo nome
+    // dos arquivos originais mas com os sufixos "_ordenado" e "_indice".
     char *sorted_vehicle_bin_fname = alloc_sprintf("%s_ordenado", vehicle_bin_fname);
-    char *sorted_busline_bin_fname = alloc_sprintf("%s_ordenado", busline_bin_fname);
+    char *busline_index_fname      = alloc_sprintf("%s_indice", busline_bin_fname);
 
-    // Chama as funcionalidades que ordenam os arquivos de linha e veículo.
+    // Chama as funcionalidades que ordenam o arquivo de veículos e indexam o
+    // arquivo de linhas.
     if (!sort_vehicle_bin_file(vehicle_bin_fname, sorted_vehicle_bin_fname) ||
-        !sort_bus_line_bin_file(busline_bin_fname, sorted_busline_bin_fname))
+        !index_bus_line_ordered_create(busline_bin_fname, busline_index_fname))
     {
         free(sorted_vehicle_bin_fname);
-        free(sorted_busline_bin_fname);
+        free(busline_index_fname);
         return false;
     }
-    // Tenta abrir os dois arquivos gerados pelas funcionalidades de ordenação e
-    // libera os nomes que foram alocados dinamicamente.
+    // Tenta abrir o arquivo ordenado e o de linhas.
 
     FILE *sorted_vehicle_fp = NULL;
-    FILE *sorted_busline_fp = NULL;
+    FILE *busline_fp = NULL;
 
     sorted_vehicle_fp = fopen(sorted_vehicle_bin_fname, "rb");
+    free(sorted_vehicle_bin_fname);
     if(!sorted_vehicle_fp) {
-        free(sorted_vehicle_bin_fname);
-        free(sorted_busline_bin_fname);
-        return handle_error(sorted_vehicle_fp, sorted_busline_fp,
+        free(busline_index_fname);
+        return handle_error(sorted_vehicle_fp, busline_fp,
                             "could not open %s",
                             vehicle_bin_fname);
     }
 
-    sorted_busline_fp = fopen(sorted_busline_bin_fname, "rb");
-    if(!sorted_busline_fp) {
-        free(sorted_vehicle_bin_fname);
-        free(sorted_busline_bin_fname);
-        return handle_error(sorted_vehicle_fp, sorted_busline_fp,
+    busline_fp = fopen(busline_bin_fname, "rb");
+    if(!busline_fp) {
+        free(busline_index_fname);
+        return handle_error(sorted_vehicle_fp, busline_fp,
                             "could not open %s",
                             busline_bin_fname);
     }
 
-    free(sorted_vehicle_bin_fname);
-    free(sorted_busline_bin_fname);
+    BTreeMap btree = btree_new();
 
     // Carrega o header de cada um dos arquivos binários, sempre verificando se
     // ocorreu algum erro.
 
     DBVehicleHeader header_vehicle;
-    if (!read_header_vehicle(sorted_vehicle_fp, &header_vehicle))
-        return handle_error(sorted_vehicle_fp, sorted_busline_fp,
-                            "could not read header from %s",
-                            vehicle_bin_fname);
+    if (!read_header_vehicle(sorted_vehicle_fp, &header_vehicle)) {
+        free(busline_index_fname);
+        return handle_error_btree(sorted_vehicle_fp, busline_fp, btree,
+                                  "could not read header from %s",
+                                  vehicle_bin_fname);
+    }
 
     DBBusLineHeader header_busline;
-    if (!read_header_bus_line(sorted_busline_fp, &header_busline))
-        return handle_error(sorted_vehicle_fp, sorted_busline_fp,
-                            "could not read header from %s",
-                            vehicle_bin_fname);
+    if (!read_header_bus_line(busline_fp, &header_busline)) {
+        free(busline_index_fname);
+        return handle_error_btree(sorted_vehicle_fp, busline_fp, btree,
+                                  "could not read header from %s",
+                                  busline_bin_fname);
+    }
+
+    BTreeResult opened = btree_open_mmap(&btree, busline_index_fname);
+    free(busline_index_fname);
+
+    if (opened != BTREE_OK)
+        return handle_error_btree(sorted_vehicle_fp, busline_fp, btree, NULL);
 
     DBBusLineRegister reg_busline;
     DBVehicleRegister reg_vehicle;
 
-    // Os arquivos binários ordenados não possuem registros removidos, então o
-    // número total de registros é simplesmente `nroRegistros`.
+    // O arquivo binário ordenado não possui registros removidos, então o
+    // número total de registros é simplesmente `nroRegistros`. O índice também
+    // só possui as linhas que não foram removidas.
 
     uint32_t n_vehicle_registers = header_vehicle.meta.nroRegistros;
-    uint32_t n_busline_registers = header_busline.meta.nroRegistros;
-
     uint32_t vehicle_count = 0;
-    uint32_t busline_count = 0;
 
     uint32_t n_matching = 0;
 
-    // Zera os registros para garantir que não tenha lixo de memória. Isso
-    // também garante que `reg_vehicle.codLinha` e `reg_busline.codLinha` são 0.
+    // Zera os registros para garantir que não tenha lixo de memória.
     memset(&reg_vehicle, 0, sizeof(DBVehicleRegister));
     memset(&reg_busline, 0, sizeof(DBBusLineRegister));
 
+    // O cursor percorre as entradas do índice em ordem de codLinha, lendo as
+    // folhas em sequência. `loaded_offset` é o offset da linha em
+    // `reg_busline`, que só é lida do arquivo quando algum veículo corresponde
+    // a ela.
+    BTreeCursor cursor;
+    bool has_busline = btree_cursor_seek(&btree, &cursor, INT32_MIN);
+    int64_t loaded_offset = -1;
+
     // Itera pelos registros de maneira intercalada. Enquanto os códigos de
-    // linha forme iguais, ele continua imprimindo e lendo registros de veículo,
-    // quando o código dos registros de veículo ultrapassam, avança os registros
-    // de linha até encontrar a correspondente. Isso fornece tempo linear de
-    // acordo com a soma da quantidade de registros em ambos os arquivos.
+    // linha forem iguais, ele continua imprimindo e lendo registros de
+    // veículo, quando o código dos registros de veículo ultrapassam, avança o
+    // cursor até encontrar a linha correspondente. Isso fornece tempo linear
+    // de acordo com a soma da quantidade de registros em ambos os arquivos.
 
-    while (vehicle_count < n_vehicle_registers && busline_count <= n_busline_registers) {
+    while (vehicle_count < n_vehicle_registers && has_busline) {
         vehicle_drop(reg_vehicle);
-        if (!read_vehicle_register(sorted_vehicle_fp, &reg_vehicle))
-            return handle_error(sorted_vehicle_fp, sorted_busline_fp,
-                                "could not read vehicle register");
+        if (!read_vehicle_register(sorted_vehicle_fp, &reg_vehicle)) {
+            bus_line_drop(reg_busline);
+            return handle_error_btree(sorted_vehicle_fp, busline_fp, btree,
+                                      "could not read vehicle register");
+        }
 
         vehicle_count++;
 
-        while (busline_count < n_busline_registers && reg_busline.codLinha < reg_vehicle.codLinha) {
-            bus_line_drop(reg_busline);
-            if (!read_bus_line_register(sorted_busline_fp, &reg_busline))
-                return handle_error(sorted_vehicle_fp, sorted_busline_fp,
-                                    "could not read bus line register");
+        while (has_busline && cursor.key < reg_vehicle.codLinha)
+            has_busline = btree_cursor_next(&cursor);
 
-            busline_count++;
-        }
+        if (!has_busline || cursor.key != reg_vehicle.codLinha)
+            continue;
 
-        if (reg_vehicle.codLinha == reg_busline.codLinha) {
-            n_matching++;
-            print_vehicle(stdout, &reg_vehicle, &header_vehicle);
-            print_bus_line(stdout, &reg_busline, &header_busline);
-            printf("\n");
+        if (loaded_offset != (int64_t)cursor.value) {
+            bus_line_drop(reg_busline);
+            fseek(busline_fp, cursor.value, SEEK_SET);
+            if (!read_bus_line_register(busline_fp, &reg_busline)) {
+                vehicle_drop(reg_vehicle);
+                return handle_error_btree(sorted_vehicle_fp, busline_fp, btree,
+                                          "could not read bus line register");
+            }
+            loaded_offset = cursor.value;
         }
+
+        n_matching++;
+        print_vehicle(stdout, &reg_vehicle, &header_vehicle);
+        print_bus_line(stdout, &reg_busline, &header_busline);
+        printf("\n");
     }
 
     // Libera tudo que foi alocado e retorna.
@@ -428,8 +724,12 @@ bool join_vehicle_and_bus_line_merge_sorted(const char *vehicle_bin_fname, const
     vehicle_drop(reg_vehicle);
     bus_line_drop(reg_busline);
 
+    if (btree_has_error(&btree))
+        return handle_error_btree(sorted_vehicle_fp, busline_fp, btree, NULL);
+
+    btree_drop(btree);
     fclose(sorted_vehicle_fp);
-    fclose(sorted_busline_fp);
+    fclose(busline_fp);
 
     // Se não houveram registros imprimidos imprime a mensagem correspondente e
     // retorna `false`.
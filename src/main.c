@@ -41,6 +41,19 @@ typedef enum {
     OP_SORT_VEHICLE_BIN_FILE                = 17,
     OP_SORT_BUS_LINE_BIN_FILE               = 18,
     OP_JOIN_ORDERED_VEHICLE_AND_BUS_LINE    = 19,
+    OP_CREATE_INDEX_VEHICLE_LINE            = 20,
+    OP_SEARCH_FOR_VEHICLES_OF_LINE          = 21,
+    OP_JOIN_VEHICLE_INDEX_AND_BUS_LINE      = 22,
+    OP_CREATE_STRING_INDEX_VEHICLE          = 23,
+    OP_CREATE_STRING_INDEX_BUS_LINE         = 24,
+    OP_SEARCH_FOR_VEHICLES_WHERE            = 25,
+    OP_SEARCH_FOR_BUS_LINES_WHERE           = 26,
+    OP_PRINT_INDEX_STATS                    = 27,
+    OP_CHECK_INDEX_VEHICLE                  = 28,
+    OP_CHECK_INDEX_BUS_LINE                 = 29,
+    OP_CREATE_HASH_INDEX_VEHICLE            = 30,
+    OP_CREATE_HASH_INDEX_BUS_LINE           = 31,
+    OP_CREATE_CLUSTERED_INDEX_BUS_LINE      = 32,
 } Op;
 
 int main(void){
@@ -198,6 +211,102 @@ int main(void){
             ignore_word(stdin);
             join_vehicle_and_bus_line_merge_sorted(file_name, input1);
             break;
+
+        case OP_CREATE_INDEX_VEHICLE_LINE:
+            input1 = read_word(stdin);
+            if (index_vehicle_line_create(file_name, input1))
+                binarioNaTela(input1);
+            break;
+
+        case OP_SEARCH_FOR_VEHICLES_OF_LINE: {
+            input1 = read_word(stdin);
+            // Garantido de ser "codLinha"
+            ignore_word(stdin);
+
+            int32_t code;
+            scanf(" %d", &code);
+            search_for_vehicles_of_line(file_name, input1, code);
+            break;
+        }
+
+        case OP_JOIN_VEHICLE_INDEX_AND_BUS_LINE:
+            input1 = read_word(stdin);
+            // Consome a entrada dos campos 'codLinha'
+            ignore_word(stdin);
+            ignore_word(stdin);
+            input2 = read_word(stdin);
+            join_vehicle_index_and_bus_line(file_name, input1, input2);
+            break;
+
+        case OP_CREATE_STRING_INDEX_VEHICLE:
+            input1 = read_word(stdin);
+            // O campo indexado
+            input2 = read_word(stdin);
+            if (index_vehicle_string_create(file_name, input1, input2))
+                binarioNaTela(input1);
+            break;
+
+        case OP_CREATE_STRING_INDEX_BUS_LINE:
+            input1 = read_word(stdin);
+            // O campo indexado
+            input2 = read_word(stdin);
+            if (index_bus_line_string_create(file_name, input1, input2))
+                binarioNaTela(input1);
+            break;
+
+        case OP_SEARCH_FOR_VEHICLES_WHERE: {
+            input1 = read_word(stdin);
+            // O campo indexado
+            input2 = read_word(stdin);
+
+            char *value = read_word(stdin);
+            search_for_vehicles_where(file_name, input1, input2, value);
+            free(value);
+            break;
+        }
+
+        case OP_SEARCH_FOR_BUS_LINES_WHERE: {
+            input1 = read_word(stdin);
+            // O campo indexado
+            input2 = read_word(stdin);
+
+            char *value = read_word(stdin);
+            search_for_bus_lines_where(file_name, input1, input2, value);
+            free(value);
+            break;
+        }
+
+        case OP_PRINT_INDEX_STATS:
+            print_index_stats(file_name);
+            break;
+
+        case OP_CHECK_INDEX_VEHICLE:
+            input1 = read_word(stdin);
+            check_vehicle_index(file_name, input1);
+            break;
+
+        case OP_CHECK_INDEX_BUS_LINE:
+            input1 = read_word(stdin);
+            check_bus_line_index(file_name, input1);
+            break;
+
+        case OP_CREATE_HASH_INDEX_VEHICLE:
+            input1 = read_word(stdin);
+            if (index_vehicle_hash_create(file_name, input1))
+                binarioNaTela(input1);
+            break;
+
+        case OP_CREATE_HASH_INDEX_BUS_LINE:
+            input1 = read_word(stdin);
+            if (index_bus_line_hash_create(file_name, input1))
+                binarioNaTela(input1);
+            break;
+
+        case OP_CREATE_CLUSTERED_INDEX_BUS_LINE:
+            input1 = read_word(stdin);
+            if (index_bus_line_clustered_create(file_name, input1))
+                binarioNaTela(input1);
+            break;
     }
 
     if (file_name != NULL)
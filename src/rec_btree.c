@@ -0,0 +1,930 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <utils.h>
+#include <rec_btree.h>
+
+// Identificador gravado logo após o status, que diferencia uma RecBTree de uma
+// BTree. Numa BTree, esses bytes são o RRN da raiz.
+#define MAGIC           "RECS"
+#define MAGIC_SZ        4
+
+// Bytes ocupados pelos campos do header: status, identificador, RRN da raiz e
+// próximo RRN.
+#define HEADER_SZ       13
+
+// Bytes ocupados pelos campos fixos de um nó: folha, número de células e o RRN
+// da próxima folha (nas folhas) ou do primeiro filho (nos nós internos).
+#define NODE_HEADER_SZ  7
+
+// Bytes ocupados por cada slot, que é o offset de uma célula na página.
+#define SLOT_SZ         2
+
+// Bytes fixos de uma célula. Nas folhas: a chave e o tamanho do registro, que
+// vem logo em seguida. Nos nós internos: a chave e o RRN do filho à direita.
+#define LEAF_CELL_SZ    6
+#define INNER_CELL_SZ   8
+
+// Maior número de células que cabem num nó, quando todos os registros são
+// vazios.
+#define MAX_CELLS ((REC_BTREE_PAGE_SZ - NODE_HEADER_SZ) / (SLOT_SZ + LEAF_CELL_SZ))
+
+// Macro simples para prevenir repetição no código
+#define ASSERT(expr) \
+    if (!(expr)) return false
+
+// Uma célula de um nó em memória. O registro fica em `Node.records`.
+typedef struct {
+    int32_t  key;
+    // RRN do filho à direita, usado somente nos nós internos.
+    uint32_t child;
+    uint32_t rec_off;
+    uint32_t rec_len;
+} Cell;
+
+// Um nó decodificado. Cabe uma célula a mais do que numa página para que um nó
+// cheio possa receber a célula nova antes de ser dividido.
+typedef struct {
+    bool     is_leaf;
+    uint32_t rrn;
+    // RRN da próxima folha (-1 na última) ou do primeiro filho.
+    int32_t  link;
+    uint32_t len;
+    Cell     cells[MAX_CELLS + 1];
+    uint32_t records_sz;
+    uint8_t  records[REC_BTREE_PAGE_SZ + REC_BTREE_MAX_RECORD_SZ];
+} Node;
+
+// Mesmo que `error` mas funciona com argumentos variáveis
+static void verror(RecBTreeMap *btree, const char *format, va_list ap) {
+    if (btree->error_msg) free(btree->error_msg);
+    btree->error_msg = alloc_vsprintf(format, ap);
+}
+
+// Coloca uma determinada mensagem de erro na `btree`. O formato dos argumentos
+// de formatação é o mesmo da função `printf`.
+static void error(RecBTreeMap *btree, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    verror(btree, format, ap);
+    va_end(ap);
+}
+
+// Calcula o byte offset de uma página de acordo com o `rrn`. A primeira página
+// é o header.
+static inline off_t rrn_offset(uint32_t rrn) {
+    return (off_t)REC_BTREE_PAGE_SZ * ((uint64_t)rrn + 1);
+}
+
+static inline void encode(uint8_t **ptr, const void *src, size_t size) {
+    memcpy(*ptr, src, size);
+    *ptr += size;
+}
+
+static inline void decode(const uint8_t **ptr, void *dst, size_t size) {
+    memcpy(dst, *ptr, size);
+    *ptr += size;
+}
+
+/* Acesso às páginas */
+
+// As funções abaixo leem os campos de uma página sem decodificar o nó inteiro,
+// o que permite buscar numa página com busca binária sobre os slots.
+
+static inline uint16_t page_u16(const uint8_t *ptr) {
+    uint16_t value;
+    memcpy(&value, ptr, sizeof(uint16_t));
+    return value;
+}
+
+static inline int32_t page_i32(const uint8_t *ptr) {
+    int32_t value;
+    memcpy(&value, ptr, sizeof(int32_t));
+    return value;
+}
+
+static inline bool page_is_leaf(const uint8_t *page) {
+    return page[0] == '1';
+}
+
+static inline uint32_t page_len(const uint8_t *page) {
+    return page_u16(page + 1);
+}
+
+static inline int32_t page_link(const uint8_t *page) {
+    return page_i32(page + 3);
+}
+
+static inline const uint8_t *page_cell(const uint8_t *page, uint32_t i) {
+    return page + page_u16(page + NODE_HEADER_SZ + i * SLOT_SZ);
+}
+
+static inline int32_t cell_key(const uint8_t *cell) {
+    return page_i32(cell);
+}
+
+static inline uint32_t cell_child(const uint8_t *cell) {
+    return page_i32(cell + sizeof(int32_t));
+}
+
+static inline uint32_t cell_rec_len(const uint8_t *cell) {
+    return page_u16(cell + sizeof(int32_t));
+}
+
+static inline const uint8_t *cell_record(const uint8_t *cell) {
+    return cell + LEAF_CELL_SZ;
+}
+
+// Verifica se todos os campos de uma página lida do disco estão dentro dos
+// limites, para que uma página corrompida não faça com que lêssemos fora dela.
+static bool valid_page(const uint8_t *page) {
+    uint32_t len       = page_len(page);
+    uint32_t cell_sz   = page_is_leaf(page) ? LEAF_CELL_SZ : INNER_CELL_SZ;
+    uint32_t slots_end = NODE_HEADER_SZ + len * SLOT_SZ;
+
+    ASSERT(page[0] == '0' || page[0] == '1');
+    ASSERT(len <= MAX_CELLS && slots_end <= REC_BTREE_PAGE_SZ);
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t offset = page_u16(page + NODE_HEADER_SZ + i * SLOT_SZ);
+        ASSERT(offset >= slots_end && offset + cell_sz <= REC_BTREE_PAGE_SZ);
+
+        if (page_is_leaf(page)) {
+            uint32_t rec_len = cell_rec_len(page + offset);
+            ASSERT(rec_len <= REC_BTREE_MAX_RECORD_SZ && offset + cell_sz + rec_len <= REC_BTREE_PAGE_SZ);
+        }
+    }
+
+    return true;
+}
+
+// Lê a página de um nó do disco com uma única chamada de sistema.
+static bool read_node_page(RecBTreeMap *btree, uint32_t rrn, uint8_t *page) {
+    ASSERT(pread(btree->fd, page, REC_BTREE_PAGE_SZ, rrn_offset(rrn)) == REC_BTREE_PAGE_SZ);
+    return valid_page(page);
+}
+
+static bool write_node_page(RecBTreeMap *btree, uint32_t rrn, const uint8_t *page) {
+    return pwrite(btree->fd, page, REC_BTREE_PAGE_SZ, rrn_offset(rrn)) == REC_BTREE_PAGE_SZ;
+}
+
+// Encontra a primeira célula com chave maior ou igual a `key` com busca
+// binária. `found` indica se essa célula tem a chave `key`.
+static uint32_t page_lower_bound(const uint8_t *page, int32_t key, bool *found) {
+    uint32_t lo = 0, hi = page_len(page);
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cell_key(page_cell(page, mid)) < key) lo = mid + 1;
+        else hi = mid;
+    }
+
+    *found = lo < page_len(page) && cell_key(page_cell(page, lo)) == key;
+    return lo;
+}
+
+// Encontra o filho de um nó interno onde a chave estaria. Cada separador é
+// igual à primeira chave da subárvore à sua direita.
+static uint32_t page_child_for(const uint8_t *page, int32_t key) {
+    bool found;
+    uint32_t i = page_lower_bound(page, key, &found);
+
+    if (found) return cell_child(page_cell(page, i));
+    if (i == 0) return page_link(page);
+    return cell_child(page_cell(page, i - 1));
+}
+
+// Desce da raiz até a folha onde a chave estaria e guarda a página dela em
+// `page`. Caso `path` não seja NULL, os RRNs dos nós visitados são guardados
+// nele, da raiz até a folha, e `depth` recebe quantos são.
+static bool find_leaf(RecBTreeMap *btree, int32_t key, uint8_t *page, uint32_t *path, uint32_t *depth) {
+    uint32_t rrn = btree->rrn_root;
+
+    for (uint32_t d = 0; d < REC_BTREE_MAX_DEPTH; d++) {
+        if (!read_node_page(btree, rrn, page)) {
+            error(btree, "failed to read node with RRN %d", rrn);
+            return false;
+        }
+
+        if (path) {
+            path[d] = rrn;
+            *depth  = d + 1;
+        }
+
+        if (page_is_leaf(page)) return true;
+
+        rrn = page_child_for(page, key);
+    }
+
+    error(btree, "btree is deeper than %d levels", REC_BTREE_MAX_DEPTH);
+    return false;
+}
+
+/* Nós em memória */
+
+static void decode_node(const uint8_t *page, uint32_t rrn, Node *node) {
+    node->is_leaf    = page_is_leaf(page);
+    node->rrn        = rrn;
+    node->link       = page_link(page);
+    node->len        = page_len(page);
+    node->records_sz = 0;
+
+    for (uint32_t i = 0; i < node->len; i++) {
+        const uint8_t *cell = page_cell(page, i);
+        Cell *c = &node->cells[i];
+
+        c->key     = cell_key(cell);
+        c->child   = node->is_leaf ? 0 : cell_child(cell);
+        c->rec_off = node->records_sz;
+        c->rec_len = node->is_leaf ? cell_rec_len(cell) : 0;
+
+        memcpy(&node->records[node->records_sz], cell_record(cell), c->rec_len);
+        node->records_sz += c->rec_len;
+    }
+}
+
+// Prepara um nó vazio. Os campos são atribuídos um a um para não criar um
+// `Node` temporário, que é grande.
+static void node_init(Node *node, bool is_leaf, uint32_t rrn, int32_t link) {
+    node->is_leaf    = is_leaf;
+    node->rrn        = rrn;
+    node->link       = link;
+    node->len        = 0;
+    node->records_sz = 0;
+}
+
+// Substitui o registro da célula `at`. Os bytes do registro anterior continuam
+// em `Node.records`, mas não são mais codificados.
+static void node_replace(Node *node, uint32_t at, const void *record, uint32_t len) {
+    node->cells[at].rec_off = node->records_sz;
+    node->cells[at].rec_len = len;
+
+    // As células dos nós internos não têm registro.
+    if (len == 0) return;
+
+    memcpy(&node->records[node->records_sz], record, len);
+    node->records_sz += len;
+}
+
+// Insere uma célula na posição `at` do nó, deslocando as seguintes.
+static void node_insert(Node *node, uint32_t at, int32_t key, const void *record, uint32_t len, uint32_t child) {
+    memmove(&node->cells[at + 1], &node->cells[at], (node->len - at) * sizeof(Cell));
+
+    node->cells[at].key   = key;
+    node->cells[at].child = child;
+    node->len++;
+
+    node_replace(node, at, record, len);
+}
+
+// Bytes que uma célula ocupa na página, incluindo o slot.
+static inline uint32_t cell_size(const Node *node, uint32_t i) {
+    return SLOT_SZ + (node->is_leaf ? LEAF_CELL_SZ + node->cells[i].rec_len : INNER_CELL_SZ);
+}
+
+// Tamanho da página que guardaria as células `[begin, end)`.
+static uint32_t encoded_size(const Node *node, uint32_t begin, uint32_t end) {
+    uint32_t size = NODE_HEADER_SZ;
+    for (uint32_t i = begin; i < end; i++) size += cell_size(node, i);
+    return size;
+}
+
+// Codifica as células `[begin, end)` do nó numa página cujo campo de ligação
+// é `link`. As células são escritas a partir do fim da página, na ordem
+// inversa dos slots.
+static void encode_node(const Node *node, uint32_t begin, uint32_t end, int32_t link, uint8_t *page) {
+    // O espaço livre entre os slots e as células é preenchido com lixo ('@').
+    memset(page, '@', REC_BTREE_PAGE_SZ);
+
+    uint16_t len     = end - begin;
+    char     is_leaf = node->is_leaf ? '1' : '0';
+
+    uint8_t *ptr = page;
+    encode(&ptr, &is_leaf, sizeof(char));
+    encode(&ptr, &len    , sizeof(uint16_t));
+    encode(&ptr, &link   , sizeof( int32_t));
+
+    uint16_t cell_end = REC_BTREE_PAGE_SZ;
+
+    for (uint32_t i = begin; i < end; i++) {
+        const Cell *c = &node->cells[i];
+
+        cell_end -= cell_size(node, i) - SLOT_SZ;
+        encode(&ptr, &cell_end, sizeof(uint16_t));
+
+        uint8_t *cell = page + cell_end;
+        encode(&cell, &c->key, sizeof(int32_t));
+
+        if (node->is_leaf) {
+            uint16_t rec_len = c->rec_len;
+            encode(&cell, &rec_len, sizeof(uint16_t));
+            encode(&cell, &node->records[c->rec_off], c->rec_len);
+        } else {
+            encode(&cell, &c->child, sizeof(uint32_t));
+        }
+    }
+}
+
+// Escolhe onde dividir um nó que não cabe numa página: as células `[0, m)`
+// ficam à esquerda e as demais à direita, exceto nos nós internos, em que a
+// célula `m` sobe para o pai. Entre as divisões possíveis, escolhe a que deixa
+// a maior das duas páginas menor.
+static uint32_t split_point(const Node *node) {
+    uint32_t total = encoded_size(node, 0, node->len) - NODE_HEADER_SZ;
+
+    uint32_t best = node->len / 2, best_sz = UINT32_MAX;
+    uint32_t left = 0;
+
+    for (uint32_t m = 1; m < node->len; m++) {
+        left += cell_size(node, m - 1);
+
+        uint32_t right_begin = node->is_leaf ? m : m + 1;
+        if (right_begin >= node->len) break;
+
+        uint32_t right = total - left - (node->is_leaf ? 0 : cell_size(node, m));
+        uint32_t worst = left > right ? left : right;
+
+        if (worst < best_sz) {
+            best    = m;
+            best_sz = worst;
+        }
+    }
+
+    return best;
+}
+
+/* Header */
+
+static bool read_header(RecBTreeMap *btree) {
+    uint8_t header[HEADER_SZ];
+    ASSERT(pread(btree->fd, header, HEADER_SZ, 0) == HEADER_SZ);
+
+    const uint8_t *ptr = header;
+
+    char status;
+    decode(&ptr, &status, sizeof(char));
+    ASSERT(status == '1' && memcmp(ptr, MAGIC, MAGIC_SZ) == 0);
+    ptr += MAGIC_SZ;
+
+    decode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    decode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+
+    ASSERT(btree->rrn_root < (int64_t)btree->next_rrn);
+
+    return true;
+}
+
+static bool write_header(RecBTreeMap *btree, char status) {
+    uint8_t page[REC_BTREE_PAGE_SZ];
+
+    // O espaço que sobra no header é preenchido com lixo ('@').
+    memset(page, '@', REC_BTREE_PAGE_SZ);
+
+    uint8_t *ptr = page;
+    encode(&ptr, &status         , sizeof(char));
+    encode(&ptr, MAGIC           , MAGIC_SZ);
+    encode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    encode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+
+    return pwrite(btree->fd, page, REC_BTREE_PAGE_SZ, 0) == REC_BTREE_PAGE_SZ;
+}
+
+// Antes da primeira modificação o header passa a ter status '0', de modo que
+// uma btree que não foi fechada corretamente é reconhecida.
+static bool mark_dirty(RecBTreeMap *btree) {
+    if (btree->dirty) return true;
+
+    ASSERT(write_header(btree, '0'));
+    btree->dirty = true;
+    return true;
+}
+
+/**
+ * Cria um novo `RecBTreeMap`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return uma RecBTree ainda sem arquivo vinculado.
+ */
+RecBTreeMap rec_btree_new() {
+    return (RecBTreeMap) {
+        .fd        = -1,
+        .error_msg = NULL,
+        .rrn_root  = -1,
+        .next_rrn  = 0,
+        .dirty     = false,
+    };
+}
+
+/**
+ * Libera o `RecBTreeMap` inclusive fechando algum arquivo vinculado.
+ *
+ * @param btree - a btree a ser liberada.
+ */
+void rec_btree_drop(RecBTreeMap btree) {
+    if (btree.fd >= 0) {
+        // Antes de fechar o arquivo, escreve o header, agora com status '1'.
+        if (btree.dirty) write_header(&btree, '1');
+        close(btree.fd);
+    }
+
+    if (btree.error_msg)
+        free(btree.error_msg);
+}
+
+/**
+ * Verifica se um arquivo contém uma RecBTree, criada por `rec_btree_create`,
+ * independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja uma RecBTree e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool rec_btree_detect(const char *fname) {
+    int fd = open(fname, O_RDONLY);
+    ASSERT(fd >= 0);
+
+    uint8_t header[1 + MAGIC_SZ];
+    bool is_rec = pread(fd, header, sizeof(header), 0) == sizeof(header)
+               && memcmp(header + 1, MAGIC, MAGIC_SZ) == 0;
+
+    close(fd);
+    return is_rec;
+}
+
+/**
+ * Carrega a RecBTree de um arquivo. Essa operação lê apenas o header. O
+ * arquivo precisa já estar criado por `rec_btree_create`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_load(RecBTreeMap *btree, const char *fname) {
+    int fd = open(fname, O_RDWR);
+
+    if (fd < 0) {
+        error(btree, "failed to open file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->fd = fd;
+
+    if (!read_header(btree)) {
+        // Desvincula o arquivo para que `rec_btree_drop` não sobrescreva o
+        // header.
+        close(fd);
+        btree->fd = -1;
+        error(btree, "unable to read btree header from file");
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Cria um arquivo de RecBTree vazio e vincula ele a um `RecBTreeMap`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_create(RecBTreeMap *btree, const char *fname) {
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        error(btree, "failed to create file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->fd       = fd;
+    btree->rrn_root = -1;
+    btree->next_rrn = 0;
+
+    if (!mark_dirty(btree)) {
+        error(btree, "failed to create header in file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Insere um registro na RecBTree. Caso a chave já exista, o seu registro é
+ * substituído.
+ *
+ * @param btree - a btree no qual inserir, que precisa ter um arquivo vinculado.
+ * @param key - a chave do registro.
+ * @param record - os bytes do registro.
+ * @param len - o tamanho do registro, de até `REC_BTREE_MAX_RECORD_SZ` bytes.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_insert(RecBTreeMap *btree, int32_t key, const void *record, uint32_t len) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (len > REC_BTREE_MAX_RECORD_SZ) {
+        error(btree, "record with key %d has %u bytes, more than %d", key, len, REC_BTREE_MAX_RECORD_SZ);
+        return BTREE_FAIL;
+    }
+
+    if (!mark_dirty(btree)) {
+        error(btree, "failed to write btree header");
+        return BTREE_FAIL;
+    }
+
+    // Como os nós podem ser grandes, um único `Node` é reaproveitado em todos
+    // os níveis, da folha até a raiz.
+    Node node;
+    uint8_t page[REC_BTREE_PAGE_SZ];
+
+    // A btree está vazia -> a raiz é uma folha com apenas esse registro.
+    if (btree->rrn_root < 0) {
+        node_init(&node, true, btree->next_rrn++, -1);
+        node_insert(&node, 0, key, record, len, 0);
+        encode_node(&node, 0, 1, node.link, page);
+
+        if (!write_node_page(btree, node.rrn, page)) {
+            error(btree, "failed to write root");
+            return BTREE_FAIL;
+        }
+
+        btree->rrn_root = node.rrn;
+        return BTREE_OK;
+    }
+
+    uint32_t path[REC_BTREE_MAX_DEPTH];
+    uint32_t depth;
+    if (!find_leaf(btree, key, page, path, &depth)) return BTREE_FAIL;
+
+    bool found;
+    uint32_t at = page_lower_bound(page, key, &found);
+
+    decode_node(page, path[depth - 1], &node);
+
+    if (found) node_replace(&node, at, record, len);
+    else node_insert(&node, at, key, record, len, 0);
+
+    while (true) {
+        // Coube na página -> nada mais muda nos níveis de cima.
+        if (encoded_size(&node, 0, node.len) <= REC_BTREE_PAGE_SZ) {
+            encode_node(&node, 0, node.len, node.link, page);
+
+            if (!write_node_page(btree, node.rrn, page)) {
+                error(btree, "failed to write node with RRN %d", node.rrn);
+                return BTREE_FAIL;
+            }
+            return BTREE_OK;
+        }
+
+        // Não coube -> divide o nó em dois. Nas folhas o separador é a chave do
+        // primeiro registro da direita e as folhas continuam encadeadas. Nos
+        // nós internos o separador sobe e o seu filho vira o primeiro da
+        // direita.
+        uint32_t m         = split_point(&node);
+        uint32_t right_rrn = btree->next_rrn++;
+        const Cell *sep    = &node.cells[m];
+
+        int32_t left_link    = node.is_leaf ? (int32_t)right_rrn : node.link;
+        int32_t right_link   = node.is_leaf ? node.link : (int32_t)sep->child;
+        uint32_t right_begin = node.is_leaf ? m : m + 1;
+
+        encode_node(&node, 0, m, left_link, page);
+        bool ok = write_node_page(btree, node.rrn, page);
+
+        encode_node(&node, right_begin, node.len, right_link, page);
+        ok = ok && write_node_page(btree, right_rrn, page);
+
+        if (!ok) {
+            error(btree, "failed to write nodes while splitting node with RRN %d", node.rrn);
+            return BTREE_FAIL;
+        }
+
+        int32_t  sep_key  = sep->key;
+        uint32_t left_rrn = node.rrn;
+        depth--;
+
+        // A raiz foi dividida -> a nova raiz tem apenas o separador.
+        if (depth == 0) {
+            node_init(&node, false, btree->next_rrn++, left_rrn);
+            node_insert(&node, 0, sep_key, NULL, 0, right_rrn);
+            encode_node(&node, 0, 1, node.link, page);
+
+            if (!write_node_page(btree, node.rrn, page)) {
+                error(btree, "failed to write new root");
+                return BTREE_FAIL;
+            }
+
+            btree->rrn_root = node.rrn;
+            return BTREE_OK;
+        }
+
+        uint32_t parent = path[depth - 1];
+        if (!read_node_page(btree, parent, page)) {
+            error(btree, "failed to read node with RRN %d", parent);
+            return BTREE_FAIL;
+        }
+
+        at = page_lower_bound(page, sep_key, &found);
+        decode_node(page, parent, &node);
+        node_insert(&node, at, sep_key, NULL, 0, right_rrn);
+    }
+}
+
+/* Carregamento em massa */
+
+// Um nó já escrito durante o carregamento em massa, representado no nível de
+// cima pela primeira chave da sua subárvore.
+typedef struct {
+    int32_t  key;
+    uint32_t rrn;
+} BulkChild;
+
+// Escreve as folhas em sequência, cada uma com os registros que couberem em
+// `limit` bytes, e coloca em `children` a primeira chave e o RRN de cada uma.
+static bool bulk_write_leaves(
+    RecBTreeMap *btree,
+    const RecBTreeRecord *records,
+    size_t n,
+    uint32_t limit,
+    BulkChild *children,
+    size_t *n_children
+) {
+    Node node;
+    uint8_t page[REC_BTREE_PAGE_SZ];
+
+    *n_children = 0;
+    for (size_t i = 0; i < n;) {
+        node_init(&node, true, btree->next_rrn++, -1);
+        children[(*n_children)++] = (BulkChild){ .key = records[i].key, .rrn = node.rrn };
+
+        // Cada folha recebe ao menos um registro, que sempre cabe na página.
+        uint32_t size = NODE_HEADER_SZ;
+        do {
+            node_insert(&node, node.len, records[i].key, records[i].record, records[i].len, 0);
+            size += cell_size(&node, node.len - 1);
+            i++;
+        } while (i < n && size + SLOT_SZ + LEAF_CELL_SZ + records[i].len <= limit);
+
+        // As folhas são escritas em sequência, então a próxima é a do RRN
+        // seguinte.
+        int32_t link = i < n ? (int32_t)btree->next_rrn : -1;
+        encode_node(&node, 0, node.len, link, page);
+        ASSERT(write_node_page(btree, node.rrn, page));
+    }
+
+    return true;
+}
+
+// Escreve os nós internos do nível acima de `children`, cada um com até
+// `per_node` filhos, e coloca os nós escritos no lugar de `children`.
+static bool bulk_write_level(RecBTreeMap *btree, BulkChild *children, size_t *n_children, uint32_t per_node) {
+    Node node;
+    uint8_t page[REC_BTREE_PAGE_SZ];
+
+    size_t n = *n_children;
+    *n_children = 0;
+
+    for (size_t begin = 0; begin < n;) {
+        size_t end = n - begin > per_node ? begin + per_node : n;
+
+        // O último nó ficaria com um único filho e nenhum separador, então
+        // recebe um dos filhos deste.
+        if (n - end == 1) end--;
+
+        node_init(&node, false, btree->next_rrn++, children[begin].rrn);
+        for (size_t j = begin + 1; j < end; j++) {
+            node_insert(&node, node.len, children[j].key, NULL, 0, children[j].rrn);
+        }
+
+        encode_node(&node, 0, node.len, node.link, page);
+        ASSERT(write_node_page(btree, node.rrn, page));
+
+        // Os nós do nível de cima são sempre menos que os de baixo, então a
+        // posição sobrescrita já foi lida.
+        children[(*n_children)++] = (BulkChild){ .key = children[begin].key, .rrn = node.rrn };
+        begin = end;
+    }
+
+    return true;
+}
+
+/**
+ * Constrói a RecBTree de baixo para cima a partir de registros ordenados. As
+ * folhas são preenchidas até `fill_factor` da página e escritas em sequência,
+ * seguidas pelos nós internos de cada nível, sem as divisões que ocorreriam
+ * com `rec_btree_insert`. Assume que `btree` já possua algum arquivo vinculado
+ * e que esteja vazia.
+ *
+ * @param btree - a btree a ser construída.
+ * @param records - os registros em ordem estritamente crescente de chave.
+ * @param n - o número de registros.
+ * @param fill_factor - fração de cada página a ser ocupada, no intervalo
+ *                      (0, 1].
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult rec_btree_bulk_load(RecBTreeMap *btree, const RecBTreeRecord *records, size_t n, double fill_factor) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (btree->rrn_root >= 0) {
+        error(btree, "bulk loading is only possible into an empty btree");
+        return BTREE_FAIL;
+    }
+
+    if (!(fill_factor > 0 && fill_factor <= 1)) {
+        error(btree, "invalid fill factor %f", fill_factor);
+        return BTREE_FAIL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (records[i].len > REC_BTREE_MAX_RECORD_SZ) {
+            error(btree, "record with key %d has %u bytes, more than %d",
+                  records[i].key, records[i].len, REC_BTREE_MAX_RECORD_SZ);
+            return BTREE_FAIL;
+        }
+
+        if (i > 0 && records[i - 1].key >= records[i].key) {
+            error(btree, "keys must be unique and sorted, but %d comes before %d",
+                  records[i - 1].key, records[i].key);
+            return BTREE_FAIL;
+        }
+    }
+
+    if (n == 0) return BTREE_OK;
+
+    if (!mark_dirty(btree)) {
+        error(btree, "failed to write btree header");
+        return BTREE_FAIL;
+    }
+
+    // Número de filhos por nó interno. Com ao menos três, um nó que cede um
+    // filho para o último do nível continua com um separador.
+    uint32_t per_node = fill_factor * ((REC_BTREE_PAGE_SZ - NODE_HEADER_SZ) / (SLOT_SZ + INNER_CELL_SZ)) + 1;
+    if (per_node < 3) per_node = 3;
+
+    // Há no máximo uma folha por registro.
+    BulkChild *children = (BulkChild *)malloc(n * sizeof(BulkChild));
+    size_t n_children;
+
+    bool ok = bulk_write_leaves(btree, records, n, fill_factor * REC_BTREE_PAGE_SZ, children, &n_children);
+    while (ok && n_children > 1) {
+        ok = bulk_write_level(btree, children, &n_children, per_node);
+    }
+
+    if (ok) btree->rrn_root = children[0].rrn;
+    free(children);
+
+    if (!ok) {
+        error(btree, "failed to write node with RRN %d during bulk load", btree->next_rrn - 1);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Busca o registro de uma chave, lendo somente os nós do caminho da raiz até a
+ * folha.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
+ * @param key - a chave de busca.
+ * @param record - onde o registro é copiado, com espaço para
+ *                 `REC_BTREE_MAX_RECORD_SZ` bytes.
+ * @return o tamanho do registro caso `key` esteja contida na btree e -1 caso
+ *         contrário. Em caso de erro, -1 é retornado e `rec_btree_has_error()`
+ *         retorna `true`.
+ */
+int32_t rec_btree_get(RecBTreeMap *btree, int32_t key, uint8_t *record) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return -1;
+    }
+
+    if (btree->rrn_root < 0) return -1;
+
+    uint8_t page[REC_BTREE_PAGE_SZ];
+    if (!find_leaf(btree, key, page, NULL, NULL)) return -1;
+
+    bool found;
+    uint32_t i = page_lower_bound(page, key, &found);
+    if (!found) return -1;
+
+    const uint8_t *cell = page_cell(page, i);
+    uint32_t len = cell_rec_len(cell);
+    memcpy(record, cell_record(cell), len);
+
+    return len;
+}
+
+/* Cursor */
+
+/**
+ * Prepara um cursor antes do primeiro registro da btree.
+ *
+ * @param btree - a btree a ser percorrida, que precisa ter um arquivo
+ *                vinculado.
+ * @param cursor - o cursor a ser preparado.
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool rec_btree_cursor_first(RecBTreeMap *btree, RecBTreeCursor *cursor) {
+    cursor->btree = btree;
+    cursor->pos   = 0;
+    cursor->next  = -1;
+
+    // Uma btree vazia é percorrida como uma única folha vazia.
+    memset(cursor->page, 0, NODE_HEADER_SZ);
+    cursor->page[0] = '1';
+
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return false;
+    }
+
+    if (btree->rrn_root < 0) return true;
+
+    // Desce sempre pelo primeiro filho até a primeira folha.
+    int32_t rrn = btree->rrn_root;
+    for (uint32_t d = 0; d < REC_BTREE_MAX_DEPTH; d++) {
+        if (!read_node_page(btree, rrn, cursor->page)) {
+            error(btree, "failed to read node with RRN %d", rrn);
+            return false;
+        }
+
+        if (page_is_leaf(cursor->page)) {
+            cursor->next = page_link(cursor->page);
+            return true;
+        }
+
+        rrn = page_link(cursor->page);
+    }
+
+    error(btree, "btree is deeper than %d levels", REC_BTREE_MAX_DEPTH);
+    return false;
+}
+
+/**
+ * Avança para o próximo registro, cuja chave, tamanho e bytes são colocados no
+ * cursor.
+ *
+ * @param cursor - o cursor, preparado por `rec_btree_cursor_first`.
+ * @return `true` caso haja um próximo registro e `false` caso os registros
+ *         tenham acabado ou em caso de erro.
+ */
+bool rec_btree_cursor_next(RecBTreeCursor *cursor) {
+    while (cursor->pos == page_len(cursor->page) && cursor->next >= 0) {
+        uint32_t rrn = cursor->next;
+
+        if (!read_node_page(cursor->btree, rrn, cursor->page) || !page_is_leaf(cursor->page)) {
+            error(cursor->btree, "failed to read leaf with RRN %d", rrn);
+            cursor->next = -1;
+            return false;
+        }
+
+        cursor->pos  = 0;
+        cursor->next = page_link(cursor->page);
+    }
+
+    ASSERT(cursor->pos < page_len(cursor->page));
+
+    const uint8_t *cell = page_cell(cursor->page, cursor->pos++);
+    cursor->key    = cell_key(cell);
+    cursor->len    = cell_rec_len(cell);
+    cursor->record = cell_record(cell);
+
+    return true;
+}
+
+/**
+ * Verifica se a `btree` possui algum erro registrado.
+ *
+ * @param btree - a btree a ser verificada.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool rec_btree_has_error(RecBTreeMap *btree) {
+    return btree->error_msg;
+}
+
+/**
+ * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param btree - a btree com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *rec_btree_get_error(RecBTreeMap *btree) {
+    return btree->error_msg;
+}
@@ -73,14 +73,17 @@ bool sort_vehicle_bin_file(const char *bin_fname, const char *ordered_bin_fname)
     // Aloca o espaço de memória para armazenar os dados lidos do arquivo binário na RAM
     DBVehicleRegister *reg = malloc(header.meta.nroRegistros * sizeof(DBVehicleRegister));
     int32_t i = 0;
-    // Lê todos os registros do arquivo binário de dados de veículo e apenas armazena na RAM os itens que não estão marcados como removidos
-    while (read_vehicle_register(bin_file, &reg[i])){
-        if(reg[i].removido != '0') {
-            i++;
-        } else {
-            vehicle_drop(reg[i]);
-        }
+    // Lê todos os registros do arquivo binário de dados de veículo e apenas armazena na RAM os itens que não estão marcados como removidos.
+    // O arquivo é mapeado em memória e os registros são lidos como visões, então as strings dos removidos nunca são alocadas.
+    // Os removidos são pulados pelo leitor sem que o restante deles seja lido.
+    RecordScan scan = scan_map(bin_file);
+    scan.skip_removed = true;
+    DBVehicleView view;
+    while (scan_vehicle(&scan, &view)){
+        if(i < header.meta.nroRegistros)
+            vehicle_view_materialize(&view, &reg[i++]);
     }
+    scan_drop(scan);
 
     fclose(bin_file);
 
@@ -145,14 +148,17 @@ bool sort_bus_line_bin_file(const char *bin_fname, const char *ordered_bin_fname
     // Aloca o espaço de memória para armazenar os dados lidos do arquivo binário na RAM
     DBBusLineRegister *reg = malloc(header.meta.nroRegistros * sizeof(DBBusLineRegister));
     int32_t i = 0;
-    // Lê todos os registros do arquivo binário de dados de veículo e apenas armazena os itens que não estão marcados como removidos
-    while (read_bus_line_register(bin_file, &reg[i])){
-        if(reg[i].removido != '0') {
-            i++;
-        } else {
-            bus_line_drop(reg[i]);
-        }
+    // Lê todos os registros do arquivo binário de dados de veículo e apenas armazena os itens que não estão marcados como removidos.
+    // O arquivo é mapeado em memória e os registros são lidos como visões, então as strings dos removidos nunca são alocadas.
+    // Os removidos são pulados pelo leitor sem que o restante deles seja lido.
+    RecordScan scan = scan_map(bin_file);
+    scan.skip_removed = true;
+    DBBusLineView view;
+    while (scan_bus_line(&scan, &view)){
+        if(i < header.meta.nroRegistros)
+            bus_line_view_materialize(&view, &reg[i++]);
     }
+    scan_drop(scan);
 
     fclose(bin_file);
 
@@ -0,0 +1,1042 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <utils.h>
+#include <str_btree.h>
+
+// Identificador gravado logo após o status, que diferencia uma StrBTree das
+// outras árvores. Numa BTree, esses bytes são o RRN da raiz.
+#define MAGIC           "STRS"
+#define MAGIC_SZ        4
+
+// Bytes ocupados pelos campos do header: status, identificador, RRN da raiz,
+// próximo RRN e rótulo.
+#define HEADER_SZ       (13 + STR_BTREE_MAX_LABEL_SZ)
+
+// Bytes ocupados pelos campos fixos de um nó: folha, número de células,
+// tamanho do prefixo e o RRN da próxima folha (nas folhas) ou do primeiro
+// filho (nos nós internos). O prefixo vem logo em seguida.
+#define NODE_HEADER_SZ  9
+
+// Bytes ocupados por cada slot, que é o offset de uma célula na página.
+#define SLOT_SZ         2
+
+// Bytes fixos de uma célula: tamanho do sufixo da chave e o valor. Nos nós
+// internos a célula também guarda o RRN do filho à direita.
+#define CELL_SZ         10
+#define CHILD_SZ        4
+
+// Maior número de células que cabem num nó, quando todos os sufixos são vazios.
+#define MAX_CELLS ((STR_BTREE_PAGE_SZ - NODE_HEADER_SZ) / (SLOT_SZ + CELL_SZ))
+
+// Macro simples para prevenir repetição no código
+#define ASSERT(expr) \
+    if (!(expr)) return false
+
+// Uma célula de um nó em memória. A chave inteira, já com o prefixo do nó, fica
+// em `Node.keys`.
+typedef struct {
+    uint32_t key_off;
+    uint32_t key_len;
+    uint64_t value;
+    // RRN do filho à direita, usado somente nos nós internos.
+    uint32_t child;
+} Cell;
+
+// Um nó decodificado. Cabe uma célula a mais do que numa página para que um nó
+// cheio possa receber a célula nova antes de ser dividido.
+typedef struct {
+    bool     is_leaf;
+    uint32_t rrn;
+    // RRN da próxima folha (-1 na última) ou do primeiro filho.
+    int32_t  link;
+    uint32_t len;
+    Cell     cells[MAX_CELLS + 1];
+    uint32_t keys_sz;
+    uint8_t  keys[(MAX_CELLS + 1) * STR_BTREE_MAX_KEY_SZ];
+} Node;
+
+// Mesmo que `error` mas funciona com argumentos variáveis
+static void verror(StrBTreeMap *btree, const char *format, va_list ap) {
+    if (btree->error_msg) free(btree->error_msg);
+    btree->error_msg = alloc_vsprintf(format, ap);
+}
+
+// Coloca uma determinada mensagem de erro na `btree`. O formato dos argumentos
+// de formatação é o mesmo da função `printf`.
+static void error(StrBTreeMap *btree, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    verror(btree, format, ap);
+    va_end(ap);
+}
+
+// Calcula o byte offset de uma página de acordo com o `rrn`. A primeira página
+// é o header.
+static inline off_t rrn_offset(uint32_t rrn) {
+    return (off_t)STR_BTREE_PAGE_SZ * ((uint64_t)rrn + 1);
+}
+
+static inline void encode(uint8_t **ptr, const void *src, size_t size) {
+    memcpy(*ptr, src, size);
+    *ptr += size;
+}
+
+static inline void decode(const uint8_t **ptr, void *dst, size_t size) {
+    memcpy(dst, *ptr, size);
+    *ptr += size;
+}
+
+// Tamanho de uma chave depois de truncada.
+static inline uint32_t key_length(const char *key) {
+    size_t len = strlen(key);
+    return len < STR_BTREE_MAX_KEY_SZ ? len : STR_BTREE_MAX_KEY_SZ;
+}
+
+/* Acesso às páginas */
+
+// As funções abaixo leem os campos de uma página sem decodificar o nó inteiro,
+// o que permite buscar numa página com busca binária sobre os slots.
+
+static inline uint16_t page_u16(const uint8_t *ptr) {
+    uint16_t value;
+    memcpy(&value, ptr, sizeof(uint16_t));
+    return value;
+}
+
+static inline bool page_is_leaf(const uint8_t *page) {
+    return page[0] == '1';
+}
+
+static inline uint32_t page_len(const uint8_t *page) {
+    return page_u16(page + 1);
+}
+
+static inline uint32_t page_prefix_len(const uint8_t *page) {
+    return page_u16(page + 3);
+}
+
+static inline int32_t page_link(const uint8_t *page) {
+    int32_t link;
+    memcpy(&link, page + 5, sizeof(int32_t));
+    return link;
+}
+
+// Endereço da célula `i`, que começa pelo tamanho do sufixo.
+static inline const uint8_t *page_cell(const uint8_t *page, uint32_t i) {
+    const uint8_t *slots = page + NODE_HEADER_SZ + page_prefix_len(page);
+    return page + page_u16(slots + i * SLOT_SZ);
+}
+
+static inline uint64_t cell_value(const uint8_t *cell) {
+    uint64_t value;
+    memcpy(&value, cell + sizeof(uint16_t) + page_u16(cell), sizeof(uint64_t));
+    return value;
+}
+
+static inline uint32_t cell_child(const uint8_t *cell) {
+    uint32_t child;
+    memcpy(&child, cell + sizeof(uint16_t) + page_u16(cell) + sizeof(uint64_t), sizeof(uint32_t));
+    return child;
+}
+
+// Verifica se todos os campos de uma página lida do disco estão dentro dos
+// limites, para que uma página corrompida não faça com que lêssemos fora dela.
+static bool valid_page(const uint8_t *page) {
+    uint32_t prefix_len = page_prefix_len(page);
+    uint32_t len        = page_len(page);
+    uint32_t child_sz   = page_is_leaf(page) ? 0 : CHILD_SZ;
+    uint32_t slots_end  = NODE_HEADER_SZ + prefix_len + len * SLOT_SZ;
+
+    ASSERT(prefix_len <= STR_BTREE_MAX_KEY_SZ && len <= MAX_CELLS && slots_end <= STR_BTREE_PAGE_SZ);
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t offset = page_u16(page + NODE_HEADER_SZ + prefix_len + i * SLOT_SZ);
+        ASSERT(offset >= slots_end && offset + CELL_SZ + child_sz <= STR_BTREE_PAGE_SZ);
+
+        uint32_t suffix_len = page_u16(page + offset);
+        ASSERT(prefix_len + suffix_len <= STR_BTREE_MAX_KEY_SZ);
+        ASSERT(offset + CELL_SZ + suffix_len + child_sz <= STR_BTREE_PAGE_SZ);
+    }
+
+    return true;
+}
+
+// Lê a página de um nó do disco com uma única chamada de sistema.
+static bool read_node_page(StrBTreeMap *btree, uint32_t rrn, uint8_t *page) {
+    ASSERT(pread(btree->fd, page, STR_BTREE_PAGE_SZ, rrn_offset(rrn)) == STR_BTREE_PAGE_SZ);
+    return valid_page(page);
+}
+
+static bool write_node_page(StrBTreeMap *btree, uint32_t rrn, const uint8_t *page) {
+    return pwrite(btree->fd, page, STR_BTREE_PAGE_SZ, rrn_offset(rrn)) == STR_BTREE_PAGE_SZ;
+}
+
+// Compara a chave `key`, de tamanho `len`, com a chave da célula `i`. Retorna
+// um número negativo, 0 ou positivo, assim como `memcmp`.
+static int compare_key(const uint8_t *page, uint32_t i, const uint8_t *key, uint32_t len) {
+    // O prefixo é comum a todas as células, então é comparado primeiro.
+    uint32_t prefix_len = page_prefix_len(page);
+    int cmp = memcmp(key, page + NODE_HEADER_SZ, len < prefix_len ? len : prefix_len);
+    if (cmp != 0) return cmp;
+    if (len < prefix_len) return -1;
+
+    const uint8_t *cell = page_cell(page, i);
+    uint32_t suffix_len = page_u16(cell);
+    uint32_t rest       = len - prefix_len;
+
+    cmp = memcmp(key + prefix_len, cell + sizeof(uint16_t), rest < suffix_len ? rest : suffix_len);
+    if (cmp != 0) return cmp;
+    if (rest != suffix_len) return rest < suffix_len ? -1 : 1;
+
+    return 0;
+}
+
+// Mesmo que `compare_key`, mas os pares com a mesma chave são ordenados pelo
+// valor.
+static int compare_cell(const uint8_t *page, uint32_t i, const uint8_t *key, uint32_t len, uint64_t value) {
+    int cmp = compare_key(page, i, key, len);
+    if (cmp != 0) return cmp;
+
+    uint64_t other = cell_value(page_cell(page, i));
+    if (value != other) return value < other ? -1 : 1;
+
+    return 0;
+}
+
+// Encontra a primeira célula maior ou igual ao par com busca binária. `found`
+// indica se essa célula é igual ao par.
+static uint32_t page_lower_bound(const uint8_t *page, const uint8_t *key, uint32_t len, uint64_t value, bool *found) {
+    uint32_t lo = 0, hi = page_len(page);
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compare_cell(page, mid, key, len, value) > 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    *found = lo < page_len(page) && compare_cell(page, lo, key, len, value) == 0;
+    return lo;
+}
+
+// Encontra o filho de um nó interno onde o par estaria. Cada separador é igual
+// ao primeiro par da subárvore à sua direita.
+static uint32_t page_child_for(const uint8_t *page, const uint8_t *key, uint32_t len, uint64_t value) {
+    bool found;
+    uint32_t i = page_lower_bound(page, key, len, value, &found);
+
+    if (found) return cell_child(page_cell(page, i));
+    if (i == 0) return page_link(page);
+    return cell_child(page_cell(page, i - 1));
+}
+
+// Desce da raiz até a folha onde o par estaria e guarda a página dela em
+// `page`. Caso `path` não seja NULL, os RRNs dos nós visitados são guardados
+// nele, da raiz até a folha, e `depth` recebe quantos são.
+static bool find_leaf(
+    StrBTreeMap *btree,
+    const uint8_t *key,
+    uint32_t len,
+    uint64_t value,
+    uint8_t *page,
+    uint32_t *path,
+    uint32_t *depth
+) {
+    uint32_t rrn = btree->rrn_root;
+
+    for (uint32_t d = 0; d < STR_BTREE_MAX_DEPTH; d++) {
+        if (!read_node_page(btree, rrn, page)) {
+            error(btree, "failed to read node with RRN %d", rrn);
+            return false;
+        }
+
+        if (path) {
+            path[d] = rrn;
+            *depth  = d + 1;
+        }
+
+        if (page_is_leaf(page)) return true;
+
+        rrn = page_child_for(page, key, len, value);
+    }
+
+    error(btree, "btree is deeper than %d levels", STR_BTREE_MAX_DEPTH);
+    return false;
+}
+
+/* Nós em memória */
+
+static void decode_node(const uint8_t *page, uint32_t rrn, Node *node) {
+    uint32_t prefix_len = page_prefix_len(page);
+    const uint8_t *prefix = page + NODE_HEADER_SZ;
+
+    node->is_leaf = page_is_leaf(page);
+    node->rrn     = rrn;
+    node->link    = page_link(page);
+    node->len     = page_len(page);
+    node->keys_sz = 0;
+
+    for (uint32_t i = 0; i < node->len; i++) {
+        const uint8_t *cell = page_cell(page, i);
+        uint32_t suffix_len = page_u16(cell);
+        Cell *c = &node->cells[i];
+
+        c->key_off = node->keys_sz;
+        c->key_len = prefix_len + suffix_len;
+        c->value   = cell_value(cell);
+        c->child   = node->is_leaf ? 0 : cell_child(cell);
+
+        // A chave é guardada inteira, já que o prefixo pode mudar quando o
+        // nó for codificado novamente.
+        memcpy(&node->keys[node->keys_sz], prefix, prefix_len);
+        memcpy(&node->keys[node->keys_sz + prefix_len], cell + sizeof(uint16_t), suffix_len);
+        node->keys_sz += c->key_len;
+    }
+}
+
+// Prepara um nó vazio. Os campos são atribuídos um a um para não criar um
+// `Node` temporário, que é grande.
+static void node_init(Node *node, bool is_leaf, uint32_t rrn, int32_t link) {
+    node->is_leaf = is_leaf;
+    node->rrn     = rrn;
+    node->link    = link;
+    node->len     = 0;
+    node->keys_sz = 0;
+}
+
+static inline const uint8_t *cell_key(const Node *node, uint32_t i) {
+    return &node->keys[node->cells[i].key_off];
+}
+
+// Insere uma célula na posição `at` do nó, deslocando as seguintes.
+static void node_insert(Node *node, uint32_t at, const uint8_t *key, uint32_t len, uint64_t value, uint32_t child) {
+    memmove(&node->cells[at + 1], &node->cells[at], (node->len - at) * sizeof(Cell));
+
+    node->cells[at] = (Cell) {
+        .key_off = node->keys_sz,
+        .key_len = len,
+        .value   = value,
+        .child   = child,
+    };
+
+    memcpy(&node->keys[node->keys_sz], key, len);
+    node->keys_sz += len;
+    node->len++;
+}
+
+// Tamanho do prefixo comum às chaves das células `[begin, end)`. Como as
+// células estão ordenadas, é o prefixo comum entre a primeira e a última.
+static uint32_t common_prefix(const Node *node, uint32_t begin, uint32_t end) {
+    if (begin >= end) return 0;
+
+    const Cell *first = &node->cells[begin];
+    const Cell *last  = &node->cells[end - 1];
+    uint32_t max = first->key_len < last->key_len ? first->key_len : last->key_len;
+
+    uint32_t i = 0;
+    while (i < max && cell_key(node, begin)[i] == cell_key(node, end - 1)[i]) i++;
+    return i;
+}
+
+// Bytes que uma célula ocuparia sem a compressão de prefixo, incluindo o slot.
+static inline uint32_t raw_cell_size(const Node *node, uint32_t i) {
+    return SLOT_SZ + CELL_SZ + node->cells[i].key_len + (node->is_leaf ? 0 : CHILD_SZ);
+}
+
+// Tamanho da página que guardaria as células `[begin, end)`, sabendo que elas
+// ocupariam `raw` bytes sem a compressão de prefixo.
+static uint32_t encoded_size(const Node *node, uint32_t begin, uint32_t end, uint32_t raw) {
+    uint32_t prefix_len = common_prefix(node, begin, end);
+    return NODE_HEADER_SZ + prefix_len + raw - (end - begin) * prefix_len;
+}
+
+// Codifica as células `[begin, end)` do nó numa página cujo campo de ligação
+// é `link`. As células são escritas a partir do fim da página, na ordem
+// inversa dos slots.
+static void encode_node(const Node *node, uint32_t begin, uint32_t end, int32_t link, uint8_t *page) {
+    // O espaço livre entre os slots e as células é preenchido com lixo ('@').
+    memset(page, '@', STR_BTREE_PAGE_SZ);
+
+    uint16_t len        = end - begin;
+    uint16_t prefix_len = common_prefix(node, begin, end);
+    char     is_leaf    = node->is_leaf ? '1' : '0';
+
+    uint8_t *ptr = page;
+    encode(&ptr, &is_leaf   , sizeof(char));
+    encode(&ptr, &len       , sizeof(uint16_t));
+    encode(&ptr, &prefix_len, sizeof(uint16_t));
+    encode(&ptr, &link      , sizeof( int32_t));
+    if (len > 0) encode(&ptr, cell_key(node, begin), prefix_len);
+
+    uint16_t cell_end = STR_BTREE_PAGE_SZ;
+
+    for (uint32_t i = begin; i < end; i++) {
+        const Cell *c = &node->cells[i];
+        uint16_t suffix_len = c->key_len - prefix_len;
+
+        cell_end -= CELL_SZ + suffix_len + (node->is_leaf ? 0 : CHILD_SZ);
+        encode(&ptr, &cell_end, sizeof(uint16_t));
+
+        uint8_t *cell = page + cell_end;
+        encode(&cell, &suffix_len, sizeof(uint16_t));
+        encode(&cell, cell_key(node, i) + prefix_len, suffix_len);
+        encode(&cell, &c->value, sizeof(uint64_t));
+        if (!node->is_leaf) encode(&cell, &c->child, sizeof(uint32_t));
+    }
+}
+
+// Escolhe onde dividir um nó que não cabe numa página: as células `[0, m)`
+// ficam à esquerda e as demais à direita, exceto nos nós internos, em que a
+// célula `m` sobe para o pai. Entre as divisões possíveis, escolhe a que deixa
+// a maior das duas páginas menor.
+static uint32_t split_point(const Node *node) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < node->len; i++) total += raw_cell_size(node, i);
+
+    uint32_t best = node->len / 2, best_sz = UINT32_MAX;
+    uint32_t left_raw = 0;
+
+    for (uint32_t m = 1; m < node->len; m++) {
+        left_raw += raw_cell_size(node, m - 1);
+
+        uint32_t right_begin = node->is_leaf ? m : m + 1;
+        if (right_begin >= node->len) break;
+
+        uint32_t right_raw = total - left_raw - (node->is_leaf ? 0 : raw_cell_size(node, m));
+        uint32_t left_sz   = encoded_size(node, 0, m, left_raw);
+        uint32_t right_sz  = encoded_size(node, right_begin, node->len, right_raw);
+        uint32_t worst     = left_sz > right_sz ? left_sz : right_sz;
+
+        if (worst < best_sz) {
+            best    = m;
+            best_sz = worst;
+        }
+    }
+
+    return best;
+}
+
+/* Header */
+
+static bool read_header(StrBTreeMap *btree) {
+    uint8_t header[HEADER_SZ];
+    ASSERT(pread(btree->fd, header, HEADER_SZ, 0) == HEADER_SZ);
+
+    const uint8_t *ptr = header;
+
+    char status;
+    decode(&ptr, &status, sizeof(char));
+    ASSERT(status == '1' && memcmp(ptr, MAGIC, MAGIC_SZ) == 0);
+    ptr += MAGIC_SZ;
+
+    decode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    decode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+    decode(&ptr, btree->label    , STR_BTREE_MAX_LABEL_SZ);
+    btree->label[STR_BTREE_MAX_LABEL_SZ] = '\0';
+
+    ASSERT(btree->rrn_root < (int64_t)btree->next_rrn);
+
+    return true;
+}
+
+static bool write_header(StrBTreeMap *btree, char status) {
+    uint8_t page[STR_BTREE_PAGE_SZ];
+
+    // O espaço que sobra no header é preenchido com lixo ('@').
+    memset(page, '@', STR_BTREE_PAGE_SZ);
+
+    uint8_t *ptr = page;
+    encode(&ptr, &status         , sizeof(char));
+    encode(&ptr, MAGIC           , MAGIC_SZ);
+    encode(&ptr, &btree->rrn_root, sizeof( int32_t));
+    encode(&ptr, &btree->next_rrn, sizeof(uint32_t));
+
+    // O rótulo é completado com '\0' até o seu tamanho máximo.
+    memset(ptr, '\0', STR_BTREE_MAX_LABEL_SZ);
+    encode(&ptr, btree->label    , strlen(btree->label));
+
+    return pwrite(btree->fd, page, STR_BTREE_PAGE_SZ, 0) == STR_BTREE_PAGE_SZ;
+}
+
+// Antes da primeira modificação o header passa a ter status '0', de modo que
+// uma btree que não foi fechada corretamente é reconhecida.
+static bool mark_dirty(StrBTreeMap *btree) {
+    if (btree->dirty) return true;
+
+    ASSERT(write_header(btree, '0'));
+    btree->dirty = true;
+    return true;
+}
+
+/**
+ * Cria um novo `StrBTreeMap`. Não envolve alocação ou abertura de arquivos.
+ *
+ * @return uma StrBTree ainda sem arquivo vinculado.
+ */
+StrBTreeMap str_btree_new() {
+    return (StrBTreeMap) {
+        .fd        = -1,
+        .error_msg = NULL,
+        .rrn_root  = -1,
+        .next_rrn  = 0,
+        .read_only = false,
+        .dirty     = false,
+        .label     = "",
+    };
+}
+
+/**
+ * Libera o `StrBTreeMap` inclusive fechando algum arquivo vinculado.
+ *
+ * @param btree - a btree a ser liberada.
+ */
+void str_btree_drop(StrBTreeMap btree) {
+    if (btree.fd >= 0) {
+        // Antes de fechar o arquivo, escreve o header, agora com status '1'.
+        if (btree.dirty) write_header(&btree, '1');
+        close(btree.fd);
+    }
+
+    if (btree.error_msg)
+        free(btree.error_msg);
+}
+
+/**
+ * Verifica se um arquivo contém uma StrBTree, criada por `str_btree_create`,
+ * independente do seu status.
+ *
+ * @param fname - nome do arquivo.
+ * @return `true` caso o arquivo seja uma StrBTree e `false` caso contrário,
+ *         inclusive caso ele não possa ser lido.
+ */
+bool str_btree_detect(const char *fname) {
+    int fd = open(fname, O_RDONLY);
+    ASSERT(fd >= 0);
+
+    uint8_t header[1 + MAGIC_SZ];
+    bool is_str = pread(fd, header, sizeof(header), 0) == sizeof(header)
+               && memcmp(header + 1, MAGIC, MAGIC_SZ) == 0;
+
+    close(fd);
+    return is_str;
+}
+
+/**
+ * Lê o rótulo de uma StrBTree independente do seu status, de modo que ele
+ * possa ser recuperado mesmo de um arquivo que não foi fechado corretamente.
+ *
+ * @param fname - nome do arquivo.
+ * @param label - onde o rótulo é colocado, com espaço para
+ *                `STR_BTREE_MAX_LABEL_SZ + 1` bytes.
+ * @return `true` caso o arquivo seja uma StrBTree e o rótulo seja lido e
+ *         `false` caso contrário.
+ */
+bool str_btree_read_label(const char *fname, char *label) {
+    ASSERT(str_btree_detect(fname));
+
+    int fd = open(fname, O_RDONLY);
+    ASSERT(fd >= 0);
+
+    bool ok = pread(fd, label, STR_BTREE_MAX_LABEL_SZ, HEADER_SZ - STR_BTREE_MAX_LABEL_SZ) == STR_BTREE_MAX_LABEL_SZ;
+    label[STR_BTREE_MAX_LABEL_SZ] = '\0';
+
+    close(fd);
+    return ok;
+}
+
+// Mesmo que `str_btree_load`, mas abre o arquivo com as permissões `flags`.
+static BTreeResult load_with(StrBTreeMap *btree, const char *fname, int flags) {
+    int fd = open(fname, flags);
+
+    if (fd < 0) {
+        error(btree, "failed to open file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->fd        = fd;
+    btree->read_only = flags == O_RDONLY;
+
+    if (!read_header(btree)) {
+        // Desvincula o arquivo para que `str_btree_drop` não sobrescreva o
+        // header.
+        close(fd);
+        btree->fd = -1;
+        error(btree, "unable to read btree header from file");
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Carrega a StrBTree de um arquivo. Essa operação lê apenas o header. O
+ * arquivo precisa já estar criado por `str_btree_create`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_load(StrBTreeMap *btree, const char *fname) {
+    return load_with(btree, fname, O_RDWR);
+}
+
+/**
+ * Carrega a StrBTree de um arquivo somente para buscas. O arquivo é aberto
+ * apenas para leitura e nunca é modificado, nem mesmo por `str_btree_drop`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser vinculado a essa btree.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_load_read_only(StrBTreeMap *btree, const char *fname) {
+    return load_with(btree, fname, O_RDONLY);
+}
+
+/**
+ * Cria um arquivo de StrBTree vazio e vincula ele a um `StrBTreeMap`.
+ *
+ * @param btree - referência mutável da btree que terá o arquivo vinculado.
+ * @param fname - nome do arquivo a ser criado e vinculado a essa btree.
+ * @param label - texto de até `STR_BTREE_MAX_LABEL_SZ` bytes guardado no
+ *                header, como o nome do campo indexado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_create(StrBTreeMap *btree, const char *fname, const char *label) {
+    if (strlen(label) > STR_BTREE_MAX_LABEL_SZ) {
+        error(btree, "label %s has more than %d bytes", label, STR_BTREE_MAX_LABEL_SZ);
+        return BTREE_FAIL;
+    }
+
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        error(btree, "failed to create file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    btree->fd       = fd;
+    btree->rrn_root = -1;
+    btree->next_rrn = 0;
+    strcpy(btree->label, label);
+
+    if (!mark_dirty(btree)) {
+        error(btree, "failed to create header in file %s", fname);
+        return BTREE_FAIL;
+    }
+
+    return BTREE_OK;
+}
+
+/**
+ * Insere um par chave-valor na StrBTree. Uma chave pode ter vários valores,
+ * mas inserir um par que já existe não tem efeito.
+ *
+ * @param btree - a btree no qual inserir, que precisa ter um arquivo vinculado.
+ * @param key - a chave, truncada em `STR_BTREE_MAX_KEY_SZ` bytes.
+ * @param value - o valor associado.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_insert(StrBTreeMap *btree, const char *key, uint64_t value) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    if (btree->read_only) {
+        error(btree, "btree was loaded as read-only");
+        return BTREE_FAIL;
+    }
+
+    if (!mark_dirty(btree)) {
+        error(btree, "failed to write btree header");
+        return BTREE_FAIL;
+    }
+
+    // Como os nós podem ser grandes, um único `Node` é reaproveitado em todos
+    // os níveis, da folha até a raiz.
+    Node node;
+    uint8_t page[STR_BTREE_PAGE_SZ];
+
+    // A célula a ser inserida no nó atual. Depois de um split, é o separador
+    // que sobe para o pai.
+    uint8_t  sep_key[STR_BTREE_MAX_KEY_SZ];
+    uint32_t sep_len   = key_length(key);
+    uint64_t sep_value = value;
+    uint32_t sep_child = 0;
+    memcpy(sep_key, key, sep_len);
+
+    // A btree está vazia -> a raiz é uma folha com apenas esse par.
+    if (btree->rrn_root < 0) {
+        node_init(&node, true, btree->next_rrn++, -1);
+        node_insert(&node, 0, sep_key, sep_len, sep_value, 0);
+        encode_node(&node, 0, 1, node.link, page);
+
+        if (!write_node_page(btree, node.rrn, page)) {
+            error(btree, "failed to write root");
+            return BTREE_FAIL;
+        }
+
+        btree->rrn_root = node.rrn;
+        return BTREE_OK;
+    }
+
+    uint32_t path[STR_BTREE_MAX_DEPTH];
+    uint32_t depth;
+    if (!find_leaf(btree, sep_key, sep_len, sep_value, page, path, &depth)) return BTREE_FAIL;
+
+    bool found;
+    uint32_t at = page_lower_bound(page, sep_key, sep_len, sep_value, &found);
+
+    // O par já existe.
+    if (found) return BTREE_OK;
+
+    decode_node(page, path[depth - 1], &node);
+
+    while (true) {
+        node_insert(&node, at, sep_key, sep_len, sep_value, sep_child);
+
+        uint32_t raw = 0;
+        for (uint32_t i = 0; i < node.len; i++) raw += raw_cell_size(&node, i);
+
+        // Coube na página -> nada mais muda nos níveis de cima.
+        if (encoded_size(&node, 0, node.len, raw) <= STR_BTREE_PAGE_SZ) {
+            encode_node(&node, 0, node.len, node.link, page);
+
+            if (!write_node_page(btree, node.rrn, page)) {
+                error(btree, "failed to write node with RRN %d", node.rrn);
+                return BTREE_FAIL;
+            }
+            return BTREE_OK;
+        }
+
+        // Não coube -> divide o nó em dois. Nas folhas o separador é uma cópia
+        // do primeiro par da direita e as folhas continuam encadeadas. Nos nós
+        // internos o separador sobe e o seu filho vira o primeiro da direita.
+        uint32_t m         = split_point(&node);
+        uint32_t right_rrn = btree->next_rrn++;
+        const Cell *sep    = &node.cells[m];
+
+        int32_t left_link   = node.is_leaf ? (int32_t)right_rrn : node.link;
+        int32_t right_link  = node.is_leaf ? node.link : (int32_t)sep->child;
+        uint32_t right_begin = node.is_leaf ? m : m + 1;
+
+        encode_node(&node, 0, m, left_link, page);
+        bool ok = write_node_page(btree, node.rrn, page);
+
+        encode_node(&node, right_begin, node.len, right_link, page);
+        ok = ok && write_node_page(btree, right_rrn, page);
+
+        if (!ok) {
+            error(btree, "failed to write nodes while splitting node with RRN %d", node.rrn);
+            return BTREE_FAIL;
+        }
+
+        memcpy(sep_key, cell_key(&node, m), sep->key_len);
+        sep_len   = sep->key_len;
+        sep_value = sep->value;
+        sep_child = right_rrn;
+
+        uint32_t left_rrn = node.rrn;
+        depth--;
+
+        // A raiz foi dividida -> a nova raiz tem apenas o separador.
+        if (depth == 0) {
+            node_init(&node, false, btree->next_rrn++, left_rrn);
+            node_insert(&node, 0, sep_key, sep_len, sep_value, sep_child);
+            encode_node(&node, 0, 1, node.link, page);
+
+            if (!write_node_page(btree, node.rrn, page)) {
+                error(btree, "failed to write new root");
+                return BTREE_FAIL;
+            }
+
+            btree->rrn_root = node.rrn;
+            return BTREE_OK;
+        }
+
+        uint32_t parent = path[depth - 1];
+        if (!read_node_page(btree, parent, page)) {
+            error(btree, "failed to read node with RRN %d", parent);
+            return BTREE_FAIL;
+        }
+
+        at = page_lower_bound(page, sep_key, sep_len, sep_value, &found);
+        decode_node(page, parent, &node);
+    }
+}
+
+/* Leitura dos valores de uma chave */
+
+// Posiciona o leitor na próxima célula, passando para a próxima folha quando
+// a atual acabar, e verifica se ela ainda pertence à chave buscada.
+static bool values_peek(StrBTreeValues *values) {
+    while (values->pos == page_len(values->page) && values->next >= 0) {
+        uint32_t rrn = values->next;
+
+        if (!read_node_page(values->btree, rrn, values->page)) {
+            error(values->btree, "failed to read leaf with RRN %d", rrn);
+            values->next = -1;
+            return false;
+        }
+
+        values->pos  = 0;
+        values->next = page_link(values->page);
+    }
+
+    return values->pos < page_len(values->page)
+        && compare_key(values->page, values->pos, (uint8_t *)values->key, values->key_len) == 0;
+}
+
+/**
+ * Prepara a leitura dos valores de uma chave, que são lidos em ordem crescente
+ * com `str_btree_values_next`.
+ *
+ * @param btree - a btree a ser utilizada que precisa ter um arquivo vinculado.
+ * @param values - o leitor a ser preparado.
+ * @param key - a chave de busca, truncada em `STR_BTREE_MAX_KEY_SZ` bytes.
+ * @return `true` caso `key` possua algum valor e `false` caso contrário ou em
+ *         caso de erro. No segundo caso, `str_btree_has_error()` retorna
+ *         `true`.
+ */
+bool str_btree_values_open(StrBTreeMap *btree, StrBTreeValues *values, const char *key) {
+    values->btree   = btree;
+    values->next    = -1;
+    values->pos     = 0;
+    values->key_len = key_length(key);
+    memcpy(values->key, key, values->key_len);
+
+    // Uma folha vazia, para que `str_btree_values_next` não retorne nada caso
+    // a busca falhe.
+    memset(values->page, 0, NODE_HEADER_SZ);
+
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return false;
+    }
+
+    if (btree->rrn_root < 0) return false;
+
+    // Nenhum par da chave é menor que o par com o menor valor possível.
+    if (!find_leaf(btree, (uint8_t *)values->key, values->key_len, 0, values->page, NULL, NULL)) {
+        memset(values->page, 0, NODE_HEADER_SZ);
+        return false;
+    }
+
+    bool found;
+    values->pos  = page_lower_bound(values->page, (uint8_t *)values->key, values->key_len, 0, &found);
+    values->next = page_link(values->page);
+
+    return values_peek(values);
+}
+
+/**
+ * Avança para o próximo valor da chave, que é colocado em `values->value`.
+ *
+ * @param values - o leitor, preparado por `str_btree_values_open`.
+ * @return `true` caso haja um próximo valor e `false` caso os valores tenham
+ *         acabado ou em caso de erro.
+ */
+bool str_btree_values_next(StrBTreeValues *values) {
+    ASSERT(values_peek(values));
+
+    values->value = cell_value(page_cell(values->page, values->pos++));
+    return true;
+}
+
+/* Leitura de todos os pares */
+
+/**
+ * Prepara um cursor antes do primeiro par da btree, descendo pelo primeiro
+ * filho de cada nó até a folha mais à esquerda.
+ *
+ * @param btree - a btree a ser percorrida, que precisa ter um arquivo
+ *                vinculado.
+ * @param cursor - o cursor a ser preparado.
+ * @return `true` em caso de sucesso e `false` em caso de erro.
+ */
+bool str_btree_cursor_first(StrBTreeMap *btree, StrBTreeCursor *cursor) {
+    cursor->btree   = btree;
+    cursor->next    = -1;
+    cursor->pos     = 0;
+    cursor->key_len = 0;
+
+    // Uma folha vazia, para que `str_btree_cursor_next` não retorne nada caso
+    // a btree esteja vazia ou haja um erro.
+    memset(cursor->page, 0, NODE_HEADER_SZ);
+
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return false;
+    }
+
+    if (btree->rrn_root < 0) return true;
+
+    uint32_t rrn = btree->rrn_root;
+
+    for (uint32_t d = 0; d < STR_BTREE_MAX_DEPTH; d++) {
+        if (!read_node_page(btree, rrn, cursor->page)) {
+            memset(cursor->page, 0, NODE_HEADER_SZ);
+            error(btree, "failed to read node with RRN %d", rrn);
+            return false;
+        }
+
+        if (page_is_leaf(cursor->page)) {
+            cursor->next = page_link(cursor->page);
+            return true;
+        }
+
+        rrn = page_link(cursor->page);
+    }
+
+    memset(cursor->page, 0, NODE_HEADER_SZ);
+    error(btree, "btree is deeper than %d levels", STR_BTREE_MAX_DEPTH);
+    return false;
+}
+
+/**
+ * Avança para o próximo par, cuja chave e valor são colocados no cursor.
+ *
+ * @param cursor - o cursor, preparado por `str_btree_cursor_first`.
+ * @return `true` caso haja um próximo par e `false` caso os pares tenham
+ *         acabado ou em caso de erro.
+ */
+bool str_btree_cursor_next(StrBTreeCursor *cursor) {
+    while (cursor->pos == page_len(cursor->page) && cursor->next >= 0) {
+        uint32_t rrn = cursor->next;
+
+        if (!read_node_page(cursor->btree, rrn, cursor->page)) {
+            error(cursor->btree, "failed to read leaf with RRN %d", rrn);
+            memset(cursor->page, 0, NODE_HEADER_SZ);
+            cursor->next = -1;
+            return false;
+        }
+
+        cursor->pos  = 0;
+        cursor->next = page_link(cursor->page);
+    }
+
+    if (cursor->pos == page_len(cursor->page)) return false;
+
+    // A chave é o prefixo da folha seguido do sufixo da célula.
+    const uint8_t *cell = page_cell(cursor->page, cursor->pos++);
+    uint32_t prefix_len = page_prefix_len(cursor->page);
+    uint32_t suffix_len = page_u16(cell);
+
+    memcpy(cursor->key, cursor->page + NODE_HEADER_SZ, prefix_len);
+    memcpy(cursor->key + prefix_len, cell + sizeof(uint16_t), suffix_len);
+    cursor->key_len = prefix_len + suffix_len;
+    cursor->value   = cell_value(cell);
+
+    return true;
+}
+
+/* Estatísticas */
+
+// Bytes ocupados de uma página: o header do nó, o prefixo, os slots e as
+// células.
+static uint32_t page_used_bytes(const uint8_t *page) {
+    uint32_t child_sz = page_is_leaf(page) ? 0 : CHILD_SZ;
+    uint32_t used     = NODE_HEADER_SZ + page_prefix_len(page);
+
+    for (uint32_t i = 0; i < page_len(page); i++)
+        used += SLOT_SZ + CELL_SZ + page_u16(page_cell(page, i)) + child_sz;
+
+    return used;
+}
+
+/**
+ * Calcula as estatísticas da estrutura da `btree`. Todas as páginas são lidas.
+ *
+ * @param btree - a btree a ser consultada, que precisa ter um arquivo
+ *                vinculado. Essa função não causa escritas ao disco.
+ * @param stats - referência mutável para onde as estatísticas são colocadas.
+ * @return `BTREE_OK` em caso de sucesso e `BTREE_FAIL` em caso de erro. No
+ *         segundo caso, uma mensagem de erro estará disponível.
+ */
+BTreeResult str_btree_stats(StrBTreeMap *btree, StrBTreeStats *stats) {
+    if (btree->fd < 0) {
+        error(btree, "no associated file");
+        return BTREE_FAIL;
+    }
+
+    *stats = (StrBTreeStats){ .n_pages = btree->next_rrn };
+
+    uint8_t page[STR_BTREE_PAGE_SZ];
+    uint64_t used = 0;
+
+    // Como não há páginas livres, todo RRN até `next_rrn` é um nó.
+    for (uint32_t rrn = 0; rrn < btree->next_rrn; rrn++) {
+        if (!read_node_page(btree, rrn, page)) {
+            error(btree, "failed to read node with RRN %d", rrn);
+            return BTREE_FAIL;
+        }
+
+        used += page_used_bytes(page);
+        if (page_is_leaf(page)) stats->leaf_nodes++;
+    }
+
+    if (stats->n_pages > 0)
+        stats->fill_factor = (double)used / ((double)stats->n_pages * STR_BTREE_PAGE_SZ);
+
+    // A altura é o comprimento do caminho pelo primeiro filho de cada nó.
+    for (int32_t rrn = btree->rrn_root; rrn >= 0 && stats->height < STR_BTREE_MAX_DEPTH; stats->height++) {
+        if (!read_node_page(btree, rrn, page)) {
+            error(btree, "failed to read node with RRN %d", rrn);
+            return BTREE_FAIL;
+        }
+
+        rrn = page_is_leaf(page) ? -1 : page_link(page);
+    }
+
+    // Os pares e as chaves distintas são contados percorrendo as folhas.
+    StrBTreeCursor *cursor = malloc(sizeof(StrBTreeCursor));
+    char     last_key[STR_BTREE_MAX_KEY_SZ];
+    uint32_t last_len = 0;
+
+    bool ok = str_btree_cursor_first(btree, cursor);
+    while (ok && str_btree_cursor_next(cursor)) {
+        if (stats->n_values == 0 || cursor->key_len != last_len || memcmp(cursor->key, last_key, last_len) != 0)
+            stats->n_keys++;
+
+        memcpy(last_key, cursor->key, cursor->key_len);
+        last_len = cursor->key_len;
+        stats->n_values++;
+    }
+    free(cursor);
+
+    if (!ok || str_btree_has_error(btree)) return BTREE_FAIL;
+
+    return BTREE_OK;
+}
+
+/**
+ * Verifica se a `btree` possui algum erro registrado.
+ *
+ * @param btree - a btree a ser verificada.
+ * @return `false` caso não tenha ocorrido erro e `true` caso tenha.
+ */
+bool str_btree_has_error(StrBTreeMap *btree) {
+    return btree->error_msg;
+}
+
+/**
+ * Recupera a mensagem de erro da `btree`. A string retornada não deve ser
+ * modificada ou liberada.
+ *
+ * @param btree - a btree com erro.
+ * @return uma string contendo a mensagem de erro.
+ */
+const char *str_btree_get_error(StrBTreeMap *btree) {
+    return btree->error_msg;
+}
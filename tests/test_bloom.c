@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <bloom.h>
+
+#define ASSERT(expr)                                     \
+    do {                                                 \
+        if (!(expr)) {                                   \
+            fprintf(stderr, "Error: assertion %s\n", #expr); \
+            goto teardown;                               \
+        }                                                \
+    } while (0);
+
+int main() {
+    system("mkdir -p tmp");
+
+    bool ok = false;
+    const int n_keys = 5000;
+
+    BloomFilter filter = bloom_with_capacity(n_keys);
+    BloomFilter loaded = bloom_empty();
+
+    // Um filtro vazio não descarta nenhuma chave.
+    ASSERT(bloom_may_contain(&loaded, 42));
+
+    for (int i = 0; i < n_keys; i++) {
+        bloom_add(&filter, 2 * i);
+    }
+
+    // Depois de escrito e carregado, o filtro nunca descarta uma chave
+    // adicionada, e descarta a grande maioria das que não foram.
+    ASSERT(bloom_save(&filter, "tmp/myindex.bin"));
+    ASSERT(bloom_load(&loaded, "tmp/myindex.bin"));
+
+    int n_false_positives = 0;
+    for (int i = 0; i < n_keys; i++) {
+        ASSERT(bloom_may_contain(&loaded, 2 * i));
+        n_false_positives += bloom_may_contain(&loaded, 2 * i + 1);
+    }
+    ASSERT(n_false_positives < n_keys / 20);
+
+    ASSERT(!bloom_load(&loaded, "tmp/nonexistent.bin") && bloom_may_contain(&loaded, 1));
+
+    ok = true;
+
+teardown:
+    bloom_drop(filter);
+    bloom_drop(loaded);
+
+    if (!ok) return 1;
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <btree.h>
 
@@ -13,6 +14,51 @@
         }                                                    \
     } while (0);
 
+// Aceita somente os valores pares, usada para verificar a árvore.
+static bool is_even(int32_t key, uint64_t value, void *data) {
+    return value % 2 == 0;
+}
+
+// Chaves inseridas antes das threads começarem e pela thread que escreve.
+#define N_PRESENT  2000
+#define N_INSERTED 2000
+#define N_READERS  4
+
+// Busca todas as chaves com um leitor próprio, enquanto outra thread insere as
+// últimas. As chaves já presentes devem ser sempre encontradas, e as demais
+// ainda podem não ter sido inseridas.
+static void *read_concurrently(void *data) {
+    BTreeMap *btree = (BTreeMap *)data;
+    BTreeReader reader = btree_reader_new(btree);
+    bool *ok = (bool *)malloc(sizeof(bool));
+    *ok = true;
+
+    for (int round = 0; round < 5; round++) {
+        for (int32_t key = 0; key < N_PRESENT + N_INSERTED; key++) {
+            int64_t value = btree_reader_get(&reader, key);
+            bool found = value == 3 * key;
+
+            if (btree_reader_has_error(&reader) || (key < N_PRESENT && !found) || (!found && value != -1))
+                *ok = false;
+        }
+    }
+
+    btree_reader_drop(reader);
+    return ok;
+}
+
+static void *insert_concurrently(void *data) {
+    BTreeMap *btree = (BTreeMap *)data;
+    bool *ok = (bool *)malloc(sizeof(bool));
+    *ok = true;
+
+    for (int32_t key = N_PRESENT; key < N_PRESENT + N_INSERTED; key++) {
+        if (btree_insert(btree, key, 3 * key) != BTREE_OK) *ok = false;
+    }
+
+    return ok;
+}
+
 int main() {
     system("mkdir -p tmp");
 
@@ -20,10 +66,17 @@ int main() {
 
     BTreeMap btree = btree_new();
 
+    // Usa páginas pequenas (ordem 5) para que as inserções causem splits.
+    ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
     ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree.bin") == BTREE_OK);
     btree_print(&btree);
     printf("\n");
 
+    // Uma árvore vazia não tem nós, e a sua ocupação é zero.
+    BTreeStats empty;
+    ASSERT(btree, ok = btree_stats(&btree, &empty) == BTREE_OK);
+    ASSERT(btree, ok = empty.height == 0 && empty.n_nodes == 0 && empty.fill_factor == 0);
+
     ASSERT(btree, ok = btree_insert(&btree, 'a', 0x1) == BTREE_OK);
     btree_print(&btree);
     printf("\n");
@@ -92,6 +145,356 @@ int main() {
     btree_print(&btree);
     printf("\n");
 
+    const char *keys = "abcdefghijkZXYWVP";
+
+    // Todas as chaves devem ser encontradas, lendo os nós do cache.
+    for (int i = 0; keys[i]; i++) {
+        ASSERT(btree, ok = btree_get(&btree, keys[i]) >= 0);
+    }
+    ASSERT(btree, ok = btree_cache_stats(&btree).hits > 0);
+
+    // A busca em lote deve encontrar os mesmos valores, em qualquer ordem.
+    int32_t many_keys[] = { 'k', 'a', 'l', 'Z', 'a', 'P' };
+    int64_t many_values[6];
+    ASSERT(btree, ok = btree_get_many(&btree, many_keys, 6, many_values) == BTREE_OK);
+    for (int i = 0; i < 6; i++) {
+        ASSERT(btree, ok = many_values[i] == btree_get(&btree, many_keys[i]));
+    }
+    ASSERT(btree, ok = many_values[2] == -1);
+
+    // Um leitor encontra as mesmas chaves, registrando os erros em si mesmo.
+    BTreeReader reader = btree_reader_new(&btree);
+    for (int i = 0; keys[i]; i++) {
+        ASSERT(btree, ok = btree_reader_get(&reader, keys[i]) == btree_get(&btree, keys[i]));
+    }
+    ASSERT(btree, ok = btree_reader_get(&reader, 'l') == -1 && !btree_reader_has_error(&reader));
+    btree_reader_drop(reader);
+
+    // O cursor deve percorrer todas as chaves em ordem, nos dois sentidos.
+    const char *sorted = "PVWXYZabcdefghijk";
+    BTreeCursor cursor;
+    int n_visited = 0;
+
+    ok = btree_cursor_seek(&btree, &cursor, 'P');
+    for (; ok; ok = btree_cursor_next(&cursor), n_visited++) {
+        ASSERT(btree, ok = cursor.key == sorted[n_visited]);
+    }
+    ASSERT(btree, ok = n_visited == strlen(sorted));
+
+    // Não há chave maior ou igual a 'l'.
+    ASSERT(btree, ok = !btree_cursor_seek(&btree, &cursor, 'l') && !btree_has_error(&btree));
+
+    ok = btree_cursor_seek(&btree, &cursor, 'k');
+    for (; ok; ok = btree_cursor_prev(&cursor)) {
+        ASSERT(btree, ok = cursor.key == sorted[--n_visited]);
+    }
+    ASSERT(btree, ok = n_visited == 0 && !btree_has_error(&btree));
+
+    // Remover quase todas as chaves causa empréstimos e junções de nós, e as
+    // páginas liberadas são reaproveitadas ao inserir as chaves novamente.
+    const char *to_remove = "aZcXeWgPi";
+    uint32_t next_rrn = btree.next_rrn;
+
+    for (int i = 0; to_remove[i]; i++) {
+        ASSERT(btree, ok = btree_remove(&btree, to_remove[i]) >= 0);
+        ASSERT(btree, ok = btree_get(&btree, to_remove[i]) < 0 && !btree_has_error(&btree));
+    }
+    ASSERT(btree, ok = btree_remove(&btree, 'a') < 0 && !btree_has_error(&btree));
+    ASSERT(btree, ok = btree.rrn_free >= 0);
+
+    for (int i = 0; keys[i]; i++) {
+        bool removed = strchr(to_remove, keys[i]) != NULL;
+        ASSERT(btree, ok = (btree_get(&btree, keys[i]) >= 0) != removed);
+    }
+
+    // As estatísticas contam as chaves restantes e as páginas liberadas, e
+    // cada página é um nó ou está livre.
+    BTreeStats stats;
+    ASSERT(btree, ok = btree_stats(&btree, &stats) == BTREE_OK);
+    ASSERT(btree, ok = stats.n_keys == strlen(keys) - strlen(to_remove) && stats.free_pages > 0);
+    ASSERT(btree, ok = stats.min_key == 'V' && stats.max_key == 'k');
+    ASSERT(btree, ok = stats.n_nodes + stats.free_pages == stats.n_pages && stats.postings_pages == 0);
+    ASSERT(btree, ok = stats.orphan_pages == 0);
+
+    uint32_t n_nodes = 0;
+    for (uint32_t i = 0; i < stats.height; i++) n_nodes += stats.level_nodes[i];
+    ASSERT(btree, ok = stats.level_nodes[0] == 1 && n_nodes == stats.n_nodes);
+
+    // A árvore continua consistente, e a verificação encontra as mesmas páginas.
+    BTreeCheck check;
+    ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK);
+    ASSERT(btree, ok = check.n_keys == stats.n_keys && check.free_pages == stats.free_pages);
+    ASSERT(btree, ok = check.node_pages == stats.n_nodes && check.orphan_pages == 0);
+
+    for (int i = 0; to_remove[i]; i++) {
+        ASSERT(btree, ok = btree_insert(&btree, to_remove[i], 0xe) == BTREE_OK);
+    }
+    ASSERT(btree, ok = btree.next_rrn == next_rrn);
+
+    // Depois de fechada, a btree deve ter sido escrita por completo no disco,
+    // então as chaves são encontradas mesmo sem o cache.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_cache_budget(&btree, 0) == BTREE_OK);
+    ASSERT(btree, ok = btree_load(&btree, "tmp/mybtree.bin") == BTREE_OK);
+    ASSERT(btree, ok = btree.page_sz == BTREE_LEGACY_PAGE_SZ && btree.order == 5);
+
+    for (int i = 0; keys[i]; i++) {
+        ASSERT(btree, ok = btree_get(&btree, keys[i]) >= 0);
+    }
+    ASSERT(btree, ok = btree_cache_stats(&btree).hits == 0);
+
+    // Mapeado em memória, o arquivo pode ser lido mas não modificado.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_open_mmap(&btree, "tmp/mybtree.bin") == BTREE_OK);
+
+    for (int i = 0; keys[i]; i++) {
+        ASSERT(btree, ok = btree_get(&btree, keys[i]) >= 0);
+    }
+    ASSERT(btree, ok = btree_insert(&btree, 'z', 0xf) == BTREE_FAIL);
+
+    // Com chaves duplicadas, cada chave guarda todos os seus valores na ordem
+    // de inserção, mesmo quando ocupam mais de uma página.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+    ASSERT(btree, ok = btree_set_duplicate_keys(&btree, true) == BTREE_OK);
+    ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_dup.bin") == BTREE_OK);
+
+    for (int i = 0; i < 20; i++) {
+        ASSERT(btree, ok = btree_insert(&btree, keys[i % 2], i) == BTREE_OK);
+    }
+
+    BTreePostings postings;
+    int n_values = 0;
+    ASSERT(btree, ok = btree_postings_open(&btree, &postings, keys[1]));
+    while (btree_postings_next(&postings)) {
+        ASSERT(btree, ok = postings.value == 2 * n_values + 1);
+        n_values++;
+    }
+    ASSERT(btree, ok = n_values == 10 && !btree_has_error(&btree));
+
+    ASSERT(btree, ok = btree_remove(&btree, keys[1]) == 1);
+    ASSERT(btree, ok = !btree_postings_open(&btree, &postings, keys[1]) && !btree_has_error(&btree));
+    ASSERT(btree, ok = btree_postings_open(&btree, &postings, keys[0]));
+
+    // As listas curtas de várias chaves dividem as mesmas páginas, e uma lista
+    // que não cabe na sua fatia continua em páginas encadeadas.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_duplicate_keys(&btree, true) == BTREE_OK);
+    ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_dup.bin") == BTREE_OK);
+
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(btree, ok = btree_insert(&btree, i % 300, i) == BTREE_OK);
+    }
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(btree, ok = btree_insert(&btree, 7, 1000 + i) == BTREE_OK);
+    }
+    ASSERT(btree, ok = btree_remove(&btree, 8) == 8);
+
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_load(&btree, "tmp/mybtree_dup.bin") == BTREE_OK);
+    ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK);
+    ASSERT(btree, ok = check.n_keys == 299 && check.n_values == 2000 - 4);
+    ASSERT(btree, ok = check.postings_pages < 20);
+
+    // As estatísticas contam as mesmas páginas de listas de valores.
+    ASSERT(btree, ok = btree_stats(&btree, &stats) == BTREE_OK);
+    ASSERT(btree, ok = stats.postings_pages == check.postings_pages && stats.orphan_pages == 0);
+
+    n_values = 0;
+    ASSERT(btree, ok = btree_postings_open(&btree, &postings, 7));
+    while (btree_postings_next(&postings)) {
+        int expected = n_values < 4 ? 7 + 300 * n_values : 1000 + n_values - 4;
+        ASSERT(btree, ok = postings.value == expected);
+        n_values++;
+    }
+    ASSERT(btree, ok = n_values == 1004 && !btree_has_error(&btree));
+
+    // A fatia liberada pela remoção é reaproveitada.
+    uint32_t next_dup = btree.next_rrn;
+    ASSERT(btree, ok = btree_insert(&btree, 1000, 0) == BTREE_OK && btree.next_rrn == next_dup);
+
+    // Com folhas encadeadas, as entradas ficam todas nas folhas e o cursor as
+    // percorre em ordem seguindo o encadeamento, inclusive depois de recarregar.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+    ASSERT(btree, ok = btree_set_linked_leaves(&btree, true) == BTREE_OK);
+    ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_linked.bin") == BTREE_OK);
+
+    for (int i = 0; keys[i]; i++) {
+        ASSERT(btree, ok = btree_insert(&btree, keys[i], i) == BTREE_OK);
+    }
+    ASSERT(btree, ok = btree_remove(&btree, 'a') == 0);
+
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_load(&btree, "tmp/mybtree_linked.bin") == BTREE_OK && btree.linked_leaves);
+
+    n_visited = 0;
+    for (bool found = btree_cursor_seek(&btree, &cursor, 'P'); found; found = btree_cursor_next(&cursor)) {
+        if (sorted[n_visited] == 'a') n_visited++;
+        ASSERT(btree, ok = cursor.key == sorted[n_visited] && btree_get(&btree, cursor.key) == cursor.value);
+        n_visited++;
+    }
+    ASSERT(btree, ok = n_visited == strlen(sorted) && !btree_has_error(&btree));
+    ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK);
+    ASSERT(btree, ok = check.n_keys == strlen(keys) - 1 && check.n_values == check.n_keys);
+
+    // Chaves inseridas em ordem crescente deixam os nós à esquerda cheios,
+    // e não pela metade, nos dois formatos.
+    for (int linked = 0; linked < 2; linked++) {
+        btree_drop(btree);
+        btree = btree_new();
+        ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+        ASSERT(btree, ok = btree_set_linked_leaves(&btree, linked) == BTREE_OK);
+        ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_seq.bin") == BTREE_OK);
+
+        for (int i = 0; i < 200; i++) {
+            ASSERT(btree, ok = btree_insert(&btree, i, i) == BTREE_OK);
+        }
+        for (int i = 0; i < 200; i++) {
+            ASSERT(btree, ok = btree_get(&btree, i) == i);
+        }
+
+        ASSERT(btree, ok = btree_stats(&btree, &stats) == BTREE_OK);
+        ASSERT(btree, ok = stats.n_keys == 200 && stats.fill_factor > 0.7);
+    }
+
+    // Com cópia na escrita, quem abre o arquivo durante as inserções vê o
+    // último snapshot gravado, cujas páginas não são sobrescritas. Sem cache,
+    // cada página modificada é escrita no disco imediatamente.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+    ASSERT(btree, ok = btree_set_cache_budget(&btree, 0) == BTREE_OK);
+    ASSERT(btree, ok = btree_set_copy_on_write(&btree, true) == BTREE_OK);
+    ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_cow.bin") == BTREE_OK);
+
+    for (int i = 0; i < 100; i += 2) {
+        ASSERT(btree, ok = btree_insert(&btree, i, i) == BTREE_OK);
+    }
+    ASSERT(btree, ok = btree_commit(&btree) == BTREE_OK);
+
+    BTreeMap snapshot = btree_new();
+    ASSERT(snapshot, ok = btree_open_mmap(&snapshot, "tmp/mybtree_cow.bin") == BTREE_OK);
+
+    for (int i = 1; i < 100; i += 2) {
+        ASSERT(btree, ok = btree_insert(&btree, i, i) == BTREE_OK);
+    }
+    ASSERT(btree, ok = btree_insert(&btree, 0, 0xf) == BTREE_OK);
+    ASSERT(btree, ok = btree_remove(&btree, 2) < 0 && btree_has_error(&btree));
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT(snapshot, ok = btree_get(&snapshot, i) == (i % 2 == 0 ? i : -1));
+        ASSERT(btree, ok = btree_get(&btree, i) == (i == 0 ? 0xf : i));
+    }
+    btree_drop(snapshot);
+
+    // Depois de gravado, o novo snapshot possui todas as chaves.
+    ASSERT(btree, ok = btree_commit(&btree) == BTREE_OK);
+    snapshot = btree_new();
+    ASSERT(snapshot, ok = btree_open_mmap(&snapshot, "tmp/mybtree_cow.bin") == BTREE_OK);
+
+    for (int i = 1; i < 100; i++) {
+        ASSERT(snapshot, ok = btree_get(&snapshot, i) == i);
+    }
+    btree_drop(snapshot);
+
+    // A verificação aceita os nós substituídos com cópia na escrita, que não
+    // são alcançados a partir da raiz, e passa cada valor para a função dada.
+    ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK);
+    ASSERT(btree, ok = check.n_keys == 100 && check.n_values == 100 && check.orphan_pages > 0);
+    ASSERT(btree, ok = check.node_pages == check.n_pages);
+
+    // As estatísticas contam esses nós como órfãos, e não como listas de
+    // valores.
+    ASSERT(btree, ok = btree_stats(&btree, &stats) == BTREE_OK);
+    ASSERT(btree, ok = stats.orphan_pages == check.orphan_pages && stats.postings_pages == 0);
+
+    ASSERT(btree, ok = btree_check(&btree, &check, is_even, NULL) == BTREE_FAIL);
+    ASSERT(btree, ok = check.n_problems == 51 && btree_has_error(&btree));
+
+    // Depois do carregamento em massa, os nós têm ao menos o número mínimo de
+    // entradas, e as remoções mantêm a árvore consistente, para qualquer
+    // número de pares.
+    BTreePair pairs[60];
+    for (int i = 0; i < 60; i++) pairs[i] = (BTreePair){ .key = i, .value = i };
+
+    for (int n = 1; n <= 60; n++) {
+        btree_drop(btree);
+        btree = btree_new();
+        ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+        ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_bulk.bin") == BTREE_OK);
+        ASSERT(btree, ok = btree_bulk_load(&btree, pairs, n, BTREE_DEFAULT_FILL_FACTOR) == BTREE_OK);
+
+        // Com ao menos 2 entradas em cada nó além da raiz, há no máximo
+        // 1 + (n - 1) / 2 nós.
+        ASSERT(btree, ok = btree_stats(&btree, &stats) == BTREE_OK && stats.n_keys == n);
+        ASSERT(btree, ok = stats.n_nodes <= 1 + (n - 1) / 2);
+
+        // Remove as chaves pares em ordem crescente e depois as ímpares em
+        // ordem decrescente, verificando as restantes a cada remoção.
+        bool removed[60] = { false };
+        int n_even = (n + 1) / 2;
+        int last_odd = n % 2 == 0 ? n - 1 : n - 2;
+
+        for (int i = 0; i < n; i++) {
+            int key = i < n_even ? 2 * i : last_odd - 2 * (i - n_even);
+            ASSERT(btree, ok = btree_remove(&btree, key) == key);
+            removed[key] = true;
+
+            for (int j = 0; j < n; j++) {
+                ASSERT(btree, ok = btree_get(&btree, j) == (removed[j] ? -1 : j));
+            }
+        }
+        ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK && check.n_keys == 0);
+    }
+
+    // Vários leitores buscam ao mesmo tempo em que outra thread insere. Com um
+    // cache pequeno, as páginas são despejadas e lidas novamente durante as
+    // buscas.
+    btree_drop(btree);
+    btree = btree_new();
+    ASSERT(btree, ok = btree_set_page_size(&btree, BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+    ASSERT(btree, ok = btree_set_cache_budget(&btree, 16 * BTREE_LEGACY_PAGE_SZ) == BTREE_OK);
+    ASSERT(btree, ok = btree_create(&btree, "tmp/mybtree_threads.bin") == BTREE_OK);
+
+    for (int32_t key = 0; key < N_PRESENT; key++) {
+        ASSERT(btree, ok = btree_insert(&btree, key, 3 * key) == BTREE_OK);
+    }
+
+    pthread_t threads[N_READERS + 1];
+    for (int i = 0; i < N_READERS; i++) {
+        pthread_create(&threads[i], NULL, read_concurrently, &btree);
+    }
+    pthread_create(&threads[N_READERS], NULL, insert_concurrently, &btree);
+
+    int n_failed = 0;
+    for (int i = 0; i <= N_READERS; i++) {
+        bool *thread_ok;
+        pthread_join(threads[i], (void **)&thread_ok);
+        if (!*thread_ok) n_failed++;
+        free(thread_ok);
+    }
+    ASSERT(btree, ok = n_failed == 0);
+
+    for (int32_t key = 0; key < N_PRESENT + N_INSERTED; key++) {
+        ASSERT(btree, ok = btree_get(&btree, key) == 3 * key);
+    }
+    ASSERT(btree, ok = btree_cache_stats(&btree).evictions > 0);
+    ASSERT(btree, ok = btree_check(&btree, &check, NULL, NULL) == BTREE_OK);
+
+    // A configuração de uma btree pode ser lida mesmo sem vincular o arquivo.
+    BTreeMap layout = btree_new();
+    ASSERT(layout, ok = btree_read_layout(&layout, "tmp/mybtree_dup.bin") == BTREE_OK);
+    ASSERT(layout, ok = layout.duplicate_keys && layout.fd < 0 && layout.rrn_root < 0);
+    btree_drop(layout);
+
 teardown:
     btree_drop(btree);
 
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <hash_index.h>
+
+#define ASSERT(index, expr)                                  \
+    do {                                                     \
+        if (!(expr)) {                                       \
+            fprintf(stderr, "Error: %s\n", index.error_msg); \
+            goto teardown;                                   \
+        }                                                    \
+    } while (0);
+
+// Aceita somente valores que são o dobro da chave.
+static bool is_double(int32_t key, uint64_t value, void *data) {
+    return value == 2 * (uint64_t)key;
+}
+
+int main() {
+    system("mkdir -p tmp");
+
+    bool ok;
+    const int n_keys = 20000;
+
+    HashIndex index = hash_index_new();
+    ASSERT(index, ok = hash_index_create(&index, "tmp/myhash.bin") == BTREE_OK);
+
+    // Chaves negativas e positivas, o suficiente para dividir muitos buckets e
+    // dobrar o diretório várias vezes.
+    for (int i = 0; i < n_keys; i++) {
+        int32_t key = i % 2 ? i : -i;
+        ASSERT(index, ok = hash_index_insert(&index, key, 2 * (int64_t)key) == BTREE_OK);
+    }
+
+    // Inserir uma chave que já existe substitui o seu valor.
+    ASSERT(index, ok = hash_index_insert(&index, 7, 0) == BTREE_OK);
+    ASSERT(index, ok = hash_index_get(&index, 7) == 0 && index.n_keys == n_keys);
+    ASSERT(index, ok = hash_index_insert(&index, 7, 14) == BTREE_OK);
+
+    // Depois de fechado, o índice contém todas as chaves.
+    hash_index_drop(index);
+    index = hash_index_new();
+    ASSERT(index, ok = hash_index_detect("tmp/myhash.bin"));
+    ASSERT(index, ok = hash_index_load(&index, "tmp/myhash.bin") == BTREE_OK);
+
+    for (int i = 0; i < n_keys; i++) {
+        int32_t key = i % 2 ? i : -i;
+        ASSERT(index, ok = hash_index_get(&index, key) == 2 * (int64_t)key);
+    }
+    ASSERT(index, ok = hash_index_get(&index, n_keys + 1) == -1 && !hash_index_has_error(&index));
+
+    int32_t keys[] = { 3, 3, -4, n_keys * 2 };
+    int64_t values[4];
+    ASSERT(index, ok = hash_index_get_many(&index, keys, 4, values) == BTREE_OK);
+    ASSERT(index, ok = values[0] == 6 && values[1] == 6 && values[2] == -8 && values[3] == -1);
+
+    HashIndexStats stats;
+    ASSERT(index, ok = hash_index_check(&index, &stats, NULL, NULL) == BTREE_OK);
+    ASSERT(index, ok = stats.n_keys == n_keys && stats.n_buckets > 1 && stats.global_depth > 0);
+    ASSERT(index, ok = stats.fill_factor > 0.5 && stats.n_problems == 0);
+
+    // Todos os valores são o dobro da chave, exceto o que for substituído.
+    ASSERT(index, ok = hash_index_check(&index, &stats, is_double, NULL) == BTREE_OK);
+    ASSERT(index, ok = hash_index_insert(&index, 5, 0) == BTREE_OK);
+    ASSERT(index, ok = hash_index_check(&index, &stats, is_double, NULL) == BTREE_FAIL && stats.n_problems == 1);
+    ASSERT(index, ok = hash_index_insert(&index, 5, 10) == BTREE_OK);
+
+    // Um arquivo com outro conteúdo no lugar do identificador não é reconhecido
+    // como índice hash.
+    FILE *fp = fopen("tmp/myhash_other.bin", "wb");
+    fwrite("1\xff\xff\xff\xff", 1, 5, fp);
+    fclose(fp);
+    ASSERT(index, ok = !hash_index_detect("tmp/myhash_other.bin"));
+    ASSERT(index, ok = !hash_index_detect("tmp/nonexistent.bin"));
+
+    // Um índice modificado e não fechado não pode ser carregado.
+    HashIndex other = hash_index_new();
+    ASSERT(index, ok = hash_index_insert(&index, n_keys + 1, 0) == BTREE_OK);
+    ASSERT(index, ok = hash_index_load(&other, "tmp/myhash.bin") == BTREE_FAIL);
+    hash_index_drop(other);
+
+teardown:
+    hash_index_drop(index);
+
+    if (!ok) return 1;
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <rec_btree.h>
+
+#define ASSERT(btree, expr)                                  \
+    do {                                                     \
+        if (!(expr)) {                                       \
+            fprintf(stderr, "Error: %s\n", btree.error_msg); \
+            goto teardown;                                   \
+        }                                                    \
+    } while (0);
+
+// Escreve em `record` um registro cujo tamanho e conteúdo dependem da chave, e
+// retorna o seu tamanho.
+static uint32_t make_record(int32_t key, uint8_t *record) {
+    uint32_t len = (uint32_t)(key * 37) % 300;
+    for (uint32_t i = 0; i < len; i++) record[i] = (uint8_t)(key + i);
+    return len;
+}
+
+static bool same_record(int32_t key, const uint8_t *record, int32_t len) {
+    uint8_t expected[REC_BTREE_MAX_RECORD_SZ];
+    return len == make_record(key, expected) && memcmp(record, expected, len) == 0;
+}
+
+int main() {
+    system("mkdir -p tmp");
+
+    bool ok;
+    const int n_keys = 5000;
+    uint8_t record[REC_BTREE_MAX_RECORD_SZ];
+
+    RecBTreeMap btree = rec_btree_new();
+    RecBTreeMap bulk  = rec_btree_new();
+    RecBTreeCursor *cursor = malloc(sizeof(RecBTreeCursor));
+    RecBTreeRecord *records = malloc(n_keys * sizeof(RecBTreeRecord));
+    uint8_t *bytes = malloc((size_t)n_keys * 300);
+
+    ASSERT(btree, ok = rec_btree_create(&btree, "tmp/myrecbtree.bin") == BTREE_OK);
+
+    // Uma tabela vazia não tem registros.
+    ASSERT(btree, ok = rec_btree_get(&btree, 1, record) == -1 && !rec_btree_has_error(&btree));
+    ASSERT(btree, ok = rec_btree_cursor_first(&btree, cursor) && !rec_btree_cursor_next(cursor));
+
+    // Insere as chaves fora de ordem, com registros de tamanhos variados, o
+    // suficiente para dividir folhas e nós internos.
+    for (int i = 0; i < n_keys; i++) {
+        int32_t key = (i * 7919) % n_keys;
+        uint32_t len = make_record(key, record);
+        ASSERT(btree, ok = rec_btree_insert(&btree, key, record, len) == BTREE_OK);
+    }
+
+    // Inserir uma chave que já existe substitui o seu registro, inclusive por
+    // um maior.
+    memset(record, 'x', REC_BTREE_MAX_RECORD_SZ);
+    ASSERT(btree, ok = rec_btree_insert(&btree, 42, record, REC_BTREE_MAX_RECORD_SZ) == BTREE_OK);
+    ASSERT(btree, ok = rec_btree_get(&btree, 42, record) == REC_BTREE_MAX_RECORD_SZ && record[0] == 'x');
+    uint32_t len = make_record(42, record);
+    ASSERT(btree, ok = rec_btree_insert(&btree, 42, record, len) == BTREE_OK);
+
+    // Registros maiores do que o limite são rejeitados.
+    ASSERT(btree, ok = rec_btree_insert(&btree, 1, record, REC_BTREE_MAX_RECORD_SZ + 1) == BTREE_FAIL);
+    free(btree.error_msg);
+    btree.error_msg = NULL;
+
+    // Depois de fechada, a tabela contém todos os registros.
+    rec_btree_drop(btree);
+    btree = rec_btree_new();
+    ASSERT(btree, ok = rec_btree_detect("tmp/myrecbtree.bin"));
+    ASSERT(btree, ok = rec_btree_load(&btree, "tmp/myrecbtree.bin") == BTREE_OK);
+
+    for (int32_t key = 0; key < n_keys; key++) {
+        int32_t got = rec_btree_get(&btree, key, record);
+        ASSERT(btree, ok = same_record(key, record, got));
+    }
+    ASSERT(btree, ok = rec_btree_get(&btree, n_keys, record) == -1 && !rec_btree_has_error(&btree));
+    ASSERT(btree, ok = rec_btree_get(&btree, -1, record) == -1 && !rec_btree_has_error(&btree));
+
+    // O cursor percorre todos os registros em ordem de chave.
+    ASSERT(btree, ok = rec_btree_cursor_first(&btree, cursor));
+    for (int32_t key = 0; key < n_keys; key++) {
+        ASSERT(btree, ok = rec_btree_cursor_next(cursor));
+        ASSERT(btree, ok = cursor->key == key && same_record(key, cursor->record, cursor->len));
+    }
+    ASSERT(btree, ok = !rec_btree_cursor_next(cursor) && !rec_btree_has_error(&btree));
+
+    // O carregamento em massa produz a mesma tabela em menos páginas, e ela
+    // continua aceitando inserções.
+    for (int32_t key = 0; key < n_keys; key++) {
+        uint8_t *at = bytes + (size_t)key * 300;
+        records[key] = (RecBTreeRecord){ .key = key, .len = make_record(key, at), .record = at };
+    }
+
+    ASSERT(bulk, ok = rec_btree_create(&bulk, "tmp/myrecbtree_bulk.bin") == BTREE_OK);
+    ASSERT(bulk, ok = rec_btree_bulk_load(&bulk, records, n_keys, BTREE_DEFAULT_FILL_FACTOR) == BTREE_OK);
+    ASSERT(bulk, ok = bulk.next_rrn < btree.next_rrn);
+    ASSERT(bulk, ok = rec_btree_bulk_load(&bulk, records, n_keys, BTREE_DEFAULT_FILL_FACTOR) == BTREE_FAIL);
+    free(bulk.error_msg);
+    bulk.error_msg = NULL;
+
+    ASSERT(bulk, ok = rec_btree_insert(&bulk, n_keys, record, 0) == BTREE_OK);
+    for (int32_t key = 0; key < n_keys; key++) {
+        int32_t got = rec_btree_get(&bulk, key, record);
+        ASSERT(bulk, ok = same_record(key, record, got));
+    }
+
+    ASSERT(bulk, ok = rec_btree_cursor_first(&bulk, cursor));
+    for (int32_t key = 0; key <= n_keys; key++) {
+        ASSERT(bulk, ok = rec_btree_cursor_next(cursor) && cursor->key == key);
+    }
+    ASSERT(bulk, ok = !rec_btree_cursor_next(cursor) && !rec_btree_has_error(&bulk));
+
+    // Chaves fora de ordem ou repetidas são rejeitadas.
+    rec_btree_drop(bulk);
+    bulk = rec_btree_new();
+    ASSERT(bulk, ok = rec_btree_create(&bulk, "tmp/myrecbtree_bulk.bin") == BTREE_OK);
+    records[1].key = 0;
+    ASSERT(bulk, ok = rec_btree_bulk_load(&bulk, records, n_keys, BTREE_DEFAULT_FILL_FACTOR) == BTREE_FAIL);
+    free(bulk.error_msg);
+    bulk.error_msg = NULL;
+
+    // Um arquivo com outro conteúdo no lugar do identificador não é reconhecido.
+    FILE *fp = fopen("tmp/myrecbtree_other.bin", "wb");
+    fwrite("1\xff\xff\xff\xff", 1, 5, fp);
+    fclose(fp);
+    ASSERT(btree, ok = !rec_btree_detect("tmp/myrecbtree_other.bin"));
+    ASSERT(btree, ok = !rec_btree_detect("tmp/nonexistent.bin"));
+
+    // Uma tabela modificada e não fechada não pode ser carregada.
+    RecBTreeMap other = rec_btree_new();
+    ASSERT(btree, ok = rec_btree_insert(&btree, n_keys, record, 0) == BTREE_OK);
+    ASSERT(btree, ok = rec_btree_load(&other, "tmp/myrecbtree.bin") == BTREE_FAIL);
+    rec_btree_drop(other);
+
+teardown:
+    rec_btree_drop(btree);
+    rec_btree_drop(bulk);
+    free(cursor);
+    free(records);
+    free(bytes);
+
+    if (!ok) return 1;
+    return 0;
+}
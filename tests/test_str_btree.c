@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <str_btree.h>
+
+#define ASSERT(btree, expr)                                  \
+    do {                                                     \
+        if (!(expr)) {                                       \
+            fprintf(stderr, "Error: %s\n", btree.error_msg); \
+            goto teardown;                                   \
+        }                                                    \
+    } while (0);
+
+int main() {
+    system("mkdir -p tmp");
+
+    bool ok;
+
+    const char *keys[] = { "MARCOPOLO TORINO", "MARCOPOLO TORINO GV", "CAIO APACHE", "MARCOPOLO" };
+    const int n_keys = 4;
+    const int n_values = 2000;
+
+    StrBTreeMap btree = str_btree_new();
+    ASSERT(btree, ok = str_btree_create(&btree, "tmp/mystrbtree.bin", "modelo") == BTREE_OK);
+
+    // Uma árvore vazia não tem pares, e a sua ocupação é zero.
+    StrBTreeStats empty;
+    ASSERT(btree, ok = str_btree_stats(&btree, &empty) == BTREE_OK);
+    ASSERT(btree, ok = empty.height == 0 && empty.n_values == 0 && empty.fill_factor == 0);
+
+    // Chaves com prefixos em comum e muitos valores repetidos, em ordem
+    // decrescente, o suficiente para dividir as folhas e a raiz.
+    for (int i = n_values - 1; i >= 0; i--) {
+        ASSERT(btree, ok = str_btree_insert(&btree, keys[i % n_keys], i) == BTREE_OK);
+    }
+
+    // Inserir um par que já existe não tem efeito.
+    ASSERT(btree, ok = str_btree_insert(&btree, keys[0], 0) == BTREE_OK);
+
+    // Uma árvore modificada e não fechada não pode ser carregada.
+    StrBTreeMap other = str_btree_new();
+    ASSERT(btree, ok = str_btree_load(&other, "tmp/mystrbtree.bin") == BTREE_FAIL);
+    str_btree_drop(other);
+
+    // Depois de fechada, cada chave deve ter todos os seus valores, em ordem.
+    str_btree_drop(btree);
+    btree = str_btree_new();
+    ASSERT(btree, ok = str_btree_detect("tmp/mystrbtree.bin"));
+    ASSERT(btree, ok = str_btree_load_read_only(&btree, "tmp/mystrbtree.bin") == BTREE_OK);
+
+    // Uma árvore carregada somente para buscas não aceita inserções.
+    ASSERT(btree, ok = str_btree_insert(&btree, keys[0], n_values) == BTREE_FAIL);
+    free(btree.error_msg);
+    btree.error_msg = NULL;
+
+    for (int k = 0; k < n_keys; k++) {
+        StrBTreeValues values;
+        int n_found = 0;
+
+        ASSERT(btree, ok = str_btree_values_open(&btree, &values, keys[k]));
+        while (str_btree_values_next(&values)) {
+            ASSERT(btree, ok = values.value == k + n_keys * n_found);
+            n_found++;
+        }
+        ASSERT(btree, ok = n_found == n_values / n_keys && !str_btree_has_error(&btree));
+    }
+
+    // Todos os pares estão nas folhas e as chaves distintas são contadas uma
+    // vez.
+    StrBTreeStats stats;
+    ASSERT(btree, ok = str_btree_stats(&btree, &stats) == BTREE_OK);
+    ASSERT(btree, ok = stats.n_values == n_values && stats.n_keys == n_keys);
+    ASSERT(btree, ok = stats.height >= 2 && stats.leaf_nodes < stats.n_pages);
+    ASSERT(btree, ok = stats.fill_factor > 0 && stats.fill_factor <= 1);
+
+    // O rótulo é mantido no header.
+    ASSERT(btree, ok = strcmp(btree.label, "modelo") == 0);
+
+    // O cursor percorre todos os pares em ordem de chave e depois de valor.
+    StrBTreeCursor *cursor = malloc(sizeof(StrBTreeCursor));
+    const int sorted[] = { 2, 3, 0, 1 };
+    int n_pairs = 0;
+
+    ok = str_btree_cursor_first(&btree, cursor);
+    while (ok && str_btree_cursor_next(cursor)) {
+        int k = sorted[n_pairs / (n_values / n_keys)];
+        int i = n_pairs % (n_values / n_keys);
+
+        ok = cursor->key_len == strlen(keys[k]) && memcmp(cursor->key, keys[k], cursor->key_len) == 0
+          && cursor->value == k + n_keys * i;
+        n_pairs++;
+    }
+    free(cursor);
+    ASSERT(btree, ok = ok && n_pairs == n_values && !str_btree_has_error(&btree));
+
+    // Um prefixo de uma chave não é a chave.
+    StrBTreeValues values;
+    ASSERT(btree, ok = !str_btree_values_open(&btree, &values, "MARCOPOLO TORINO G"));
+    ASSERT(btree, ok = !str_btree_values_next(&values) && !str_btree_has_error(&btree));
+
+    // Um arquivo com outro conteúdo no lugar do identificador não é reconhecido.
+    FILE *fp = fopen("tmp/mystrbtree_other.bin", "wb");
+    fwrite("1\xff\xff\xff\xff", 1, 5, fp);
+    fclose(fp);
+    ASSERT(btree, ok = !str_btree_detect("tmp/mystrbtree_other.bin"));
+    other = str_btree_new();
+    ASSERT(btree, ok = str_btree_load(&other, "tmp/mystrbtree_other.bin") == BTREE_FAIL);
+    str_btree_drop(other);
+
+teardown:
+    str_btree_drop(btree);
+
+    if (!ok) return 1;
+    return 0;
+}